@@ -28,6 +28,7 @@
 #include <asm/secure.h>
 #include <linux/compiler.h>
 #include <bootm.h>
+#include <serial.h>
 #include <vxworks.h>
 #include <video_link.h>
 
@@ -112,6 +113,7 @@ static void announce_and_cleanup(int fake)
 
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
+	serial_flush_tx();
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
@@ -23,6 +23,7 @@
 #include <common.h>
 #include <cpu_func.h>
 #include <irq_func.h>
+#include <serial.h>
 
 __weak void reset_misc(void)
 {
@@ -31,6 +32,7 @@ __weak void reset_misc(void)
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	puts ("resetting ...\n");
+	serial_flush_tx();
 
 	udelay (50000);				/* wait 50 ms */
 
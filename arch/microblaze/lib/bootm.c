@@ -14,6 +14,7 @@
 #include <fdt_support.h>
 #include <hang.h>
 #include <image.h>
+#include <serial.h>
 #include <u-boot/zlib.h>
 #include <asm/byteorder.h>
 
@@ -76,6 +77,7 @@ static void boot_jump_linux(bootm_headers_t *images, int flag)
 
 	printf("\nStarting kernel ...%s\n\n", fake ?
 	       "(fake run for tracing)" : "");
+	serial_flush_tx();
 	bootstage_mark_name(BOOTSTAGE_ID_BOOTM_HANDOFF, "start_kernel");
 
 #ifdef XILINX_USE_DCACHE
@@ -10,6 +10,7 @@
 #include <env.h>
 #include <hang.h>
 #include <image.h>
+#include <serial.h>
 #include <u-boot/zlib.h>
 #include <asm/byteorder.h>
 #include <asm/bootm.h>
@@ -105,6 +106,7 @@ int do_bootm_linux(int flag, int argc, char *argv[], bootm_headers_t *images)
 
 	/* we assume that the kernel is in place */
 	printf("\nStarting kernel ...\n\n");
+	serial_flush_tx();
 
 #ifdef CONFIG_USB_DEVICE
 	{
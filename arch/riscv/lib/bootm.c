@@ -13,6 +13,7 @@
 #include <hang.h>
 #include <dm/root.h>
 #include <image.h>
+#include <serial.h>
 #include <asm/byteorder.h>
 #include <asm/csr.h>
 #include <asm/smp.h>
@@ -40,6 +41,7 @@ static void announce_and_cleanup(int fake)
 {
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
+	serial_flush_tx();
 	bootstage_mark_name(BOOTSTAGE_ID_BOOTM_HANDOFF, "start_kernel");
 #ifdef CONFIG_BOOTSTAGE_FDT
 	bootstage_fdt_add_report();
@@ -108,6 +108,141 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * struct sandbox_flash_stats - commands seen by the USB flash emulator
+ *
+ * @read10: Number of READ(10) commands
+ * @read16: Number of READ(16) commands
+ * @read_blks: Number of blocks read
+ * @max_read_blks: Largest number of blocks read by one command
+ */
+struct sandbox_flash_stats {
+	uint read10;
+	uint read16;
+	ulong read_blks;
+	uint max_read_blks;
+};
+
+/**
+ * sandbox_flash_get_stats() - get the commands seen by a USB flash emulator
+ *
+ * @dev:	USB emulator device (UCLASS_USB_EMUL)
+ * @stats:	Returns the counters since the emulator was probed
+ */
+void sandbox_flash_get_stats(struct udevice *dev,
+			     struct sandbox_flash_stats *stats);
+
+/**
+ * struct sandbox_nand_stats - operations seen by the NAND simulator
+ *
+ * @reads: Number of pages read into the page register
+ * @programs: Number of page programs
+ * @erases: Number of block erases
+ * @bitflips: Number of bits flipped in the data read
+ * @busy_us: Total tR, tPROG and tBERS time of these operations
+ */
+struct sandbox_nand_stats {
+	ulong reads;
+	ulong programs;
+	ulong erases;
+	ulong bitflips;
+	u64 busy_us;
+};
+
+/**
+ * sandbox_nand_get_stats() - get the operations seen by a NAND simulator
+ *
+ * @dev:	NAND device (UCLASS_MTD)
+ * @stats:	Returns the counters since the device was probed
+ */
+void sandbox_nand_get_stats(struct udevice *dev,
+			    struct sandbox_nand_stats *stats);
+
+/**
+ * sandbox_nand_set_bitflips() - inject bit flips into page reads
+ *
+ * Flips are spread over the ECC steps of the page, so each read can be
+ * corrected as long as @bits is no more than the number of steps.
+ *
+ * @dev:	NAND device (UCLASS_MTD)
+ * @interval:	Flip bits in every Nth page read, 0 to stop
+ * @bits:	Number of bits to flip in each such read
+ */
+void sandbox_nand_set_bitflips(struct udevice *dev, uint interval, uint bits);
+
+/**
+ * sandbox_nand_get_mtd() - get the MTD device of a NAND simulator
+ *
+ * @dev:	NAND device (UCLASS_MTD)
+ * @return the MTD device, set up once @dev is probed
+ */
+struct mtd_info *sandbox_nand_get_mtd(struct udevice *dev);
+
+/**
+ * struct sandbox_mmc_stats - commands seen by the MMC emulator
+ *
+ * @cmds: Number of commands of any kind
+ * @single_reads: Number of CMD17 (READ_SINGLE_BLOCK)
+ * @multi_reads: Number of CMD18 (READ_MULTIPLE_BLOCK)
+ * @single_writes: Number of CMD24 (WRITE_BLOCK)
+ * @multi_writes: Number of CMD25 (WRITE_MULTIPLE_BLOCK)
+ * @erases: Number of CMD38 (ERASE)
+ * @tuning_cmds: Number of CMD21 (SEND_TUNING_BLOCK_HS200)
+ * @bytes_read: Number of data bytes sent by the card
+ * @bytes_written: Number of data bytes received by the card
+ * @busy_ns: Time the bus and card would have spent on these commands
+ * @cmdq_tasks: Number of tasks queued with CMD44 / CMD45
+ * @cmdq_max_queued: Largest number of tasks queued at the same time
+ * @packed_writes: Number of packed write commands
+ * @packed_entries: Number of writes carried by packed write commands
+ * @protocol_errors: Number of commands refused for breaking the protocol
+ */
+struct sandbox_mmc_stats {
+	ulong cmds;
+	ulong single_reads;
+	ulong multi_reads;
+	ulong single_writes;
+	ulong multi_writes;
+	ulong erases;
+	ulong tuning_cmds;
+	u64 bytes_read;
+	u64 bytes_written;
+	u64 busy_ns;
+	ulong cmdq_tasks;
+	ulong cmdq_max_queued;
+	ulong packed_writes;
+	ulong packed_entries;
+	ulong protocol_errors;
+};
+
+/**
+ * sandbox_mmc_get_stats() - get the commands seen by an MMC emulator
+ *
+ * @dev:	MMC device (UCLASS_MMC)
+ * @stats:	Returns the counters since the device was probed
+ */
+void sandbox_mmc_get_stats(struct udevice *dev, struct sandbox_mmc_stats *stats);
+
+/**
+ * sandbox_mmc_get_tuning_phase() - get the sampling phase picked by tuning
+ *
+ * @dev:	MMC device (UCLASS_MMC)
+ * @return phase selected by the last execute_tuning(), 0 if none
+ */
+uint sandbox_mmc_get_tuning_phase(struct udevice *dev);
+
+/**
+ * sandbox_mmc_set_cmdq() - change the queueing support of an emulated eMMC
+ *
+ * This only changes the EXT_CSD, so the MMC core sees it on the next
+ * mmc_init().
+ *
+ * @dev:	MMC device (UCLASS_MMC)
+ * @depth:	Number of tasks in the command queue, 0 for none
+ * @max_packed:	Largest number of writes in a packed write, 0 for none
+ */
+void sandbox_mmc_set_cmdq(struct udevice *dev, uint depth, uint max_packed);
+
 /**
  * sandbox_osd_get_mem() - get the internal memory of a sandbox OSD
  *
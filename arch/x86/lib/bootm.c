@@ -15,6 +15,7 @@
 #include <errno.h>
 #include <fdt_support.h>
 #include <image.h>
+#include <serial.h>
 #include <u-boot/zlib.h>
 #include <asm/bootparam.h>
 #include <asm/cpu.h>
@@ -31,6 +32,7 @@ DECLARE_GLOBAL_DATA_PTR;
 void bootm_announce_and_cleanup(void)
 {
 	printf("\nStarting kernel ...\n\n");
+	serial_flush_tx();
 
 #ifdef CONFIG_SYS_COREBOOT
 	timestamp_add_now(TS_U_BOOT_START_KERNEL);
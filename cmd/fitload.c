@@ -0,0 +1,352 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Load only the parts of a FIT which are needed for one configuration
+ *
+ * A FIT with external data (mkimage -E) keeps the device-tree structure at
+ * the start of the file and the image data after it. This reads the structure,
+ * selects the configuration and then reads just the images it uses, so that
+ * the kernels, FDTs and ramdisks for other boards are never read from the
+ * filesystem.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <env.h>
+#include <fs.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <linux/libfdt.h>
+#include <linux/math64.h>
+
+/* Configuration properties which refer to images that may need loading */
+static const char *const fitload_props[] = {
+	FIT_KERNEL_PROP,
+	FIT_FDT_PROP,
+	FIT_RAMDISK_PROP,
+	FIT_LOADABLE_PROP,
+	FIT_SETUP_PROP,
+	FIT_FPGA_PROP,
+	FIT_FIRMWARE_PROP,
+	FIT_STANDALONE_PROP,
+};
+
+/**
+ * fitload_read() - Read part of a file
+ *
+ * fs_read() closes the filesystem after each call, so it must be set up again
+ * each time
+ */
+static int fitload_read(const char *ifname, const char *dev_part,
+			const char *filename, ulong addr, loff_t pos,
+			loff_t len)
+{
+	loff_t actread;
+	int ret;
+
+	if (fs_set_blk_dev(ifname, dev_part, FS_TYPE_ANY))
+		return -ENODEV;
+	ret = fs_read(filename, addr, pos, len, &actread);
+	if (ret)
+		return ret;
+	if (actread != len) {
+		printf("** Short read of '%s' at %llx (%llx of %llx bytes) **\n",
+		       filename, pos, actread, len);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * struct fitload_img - An image to be read for the configuration
+ *
+ * @noffset: Image node offset
+ * @prop: Property holding the position of the data (data-position or
+ *	data-offset)
+ * @base: Address which the position is relative to
+ * @pos: Position of the data in the file, relative to @base - addr
+ * @size: Size of the data in bytes
+ * @dest: Address to read the data to
+ */
+struct fitload_img {
+	int noffset;
+	const char *prop;
+	ulong base;
+	int pos;
+	int size;
+	ulong dest;
+};
+
+static bool fitload_overlaps(ulong start, ulong size, ulong other_start,
+			     ulong other_size)
+{
+	return start < other_start + other_size &&
+	       other_start < start + size;
+}
+
+/**
+ * fitload_plan() - Work out where the data of one image comes from
+ *
+ * @fit: FIT structure, already loaded at @addr
+ * @addr: Address of the FIT structure
+ * @noffset: Image node offset
+ * @img: Returns the details of the image
+ * @return 0 if the data must be read, -ENOENT if it is inside the FIT
+ *	structure, other -ve on error
+ */
+static int fitload_plan(void *fit, ulong addr, int noffset,
+			struct fitload_img *img)
+{
+	img->noffset = noffset;
+	img->prop = FIT_DATA_POSITION_PROP;
+	img->base = addr;
+	if (fit_image_get_data_position(fit, noffset, &img->pos)) {
+		img->prop = FIT_DATA_OFFSET_PROP;
+		img->base = addr + ALIGN(fdt_totalsize(fit), 4);
+		if (fit_image_get_data_offset(fit, noffset, &img->pos))
+			return -ENOENT;
+	}
+	if (fit_image_get_data_size(fit, noffset, &img->size)) {
+		printf("** No data size for '%s' **\n",
+		       fit_get_name(fit, noffset, NULL));
+		return -EINVAL;
+	}
+	img->dest = img->base + img->pos;
+
+	return 0;
+}
+
+/**
+ * fitload_direct() - Try to read an image straight to its load address
+ *
+ * This is only done if the image is not compressed and the load range does
+ * not overlap the FIT structure or the range any other image is read to. The
+ * image's data-position / data-offset is then updated to point to the load
+ * address, so that bootm finds the data in place and does not copy it.
+ *
+ * @fit: FIT structure, already loaded at @addr
+ * @addr: Address of the FIT structure
+ * @imgs: All images to be read
+ * @count: Number of images
+ * @img: Image to try, one of @imgs
+ */
+static void fitload_direct(void *fit, ulong addr, struct fitload_img *imgs,
+			   int count, struct fitload_img *img)
+{
+	ulong load;
+	long newpos;
+	u8 comp;
+	int i;
+
+	if (fit_image_get_load(fit, img->noffset, &load) ||
+	    (!fit_image_get_comp(fit, img->noffset, &comp) &&
+	     comp != IH_COMP_NONE))
+		return;
+	if (fitload_overlaps(load, img->size, addr, fdt_totalsize(fit)))
+		return;
+	for (i = 0; i < count; i++) {
+		if (&imgs[i] != img &&
+		    fitload_overlaps(load, img->size, imgs[i].dest,
+				     imgs[i].size))
+			return;
+	}
+
+	newpos = load - img->base;
+	if (newpos == (int)newpos &&
+	    !fdt_setprop_inplace_u32(fit, img->noffset, img->prop, newpos))
+		img->dest = load;
+}
+
+/* Whether a configuration has a signature, which covers its image nodes */
+static bool fitload_conf_signed(void *fit, int cfg_noffset)
+{
+	int noffset;
+
+	fdt_for_each_subnode(noffset, fit, cfg_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (!strncmp(name, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * fit_fs_load() - Load the FIT structure and the images for a configuration
+ *
+ * @ifname: Interface name (e.g. "mmc")
+ * @dev_part: Device and partition (e.g. "0:1")
+ * @filename: Name of the FIT file
+ * @addr: Address to load the FIT structure to
+ * @conf: Configuration name, or NULL for the default
+ * @bytesp: Returns the number of bytes read
+ * @return 0 if OK, -ve on error
+ */
+static int fit_fs_load(const char *ifname, const char *dev_part,
+		       const char *filename, ulong addr, const char *conf,
+		       loff_t *bytesp)
+{
+	struct fitload_img *imgs, *img;
+	int cfg_noffset, noffset;
+	int count, total = 0;
+	void *fit;
+	int ret;
+	int i, j, k;
+
+	/* Read the header to find the size of the FIT structure */
+	ret = fitload_read(ifname, dev_part, filename, addr, 0,
+			   sizeof(struct fdt_header));
+	if (ret)
+		return ret;
+	fit = map_sysmem(addr, 0);
+	if (fdt_magic(fit) != FDT_MAGIC) {
+		printf("** '%s' is not a FIT **\n", filename);
+		return -EINVAL;
+	}
+	ret = fitload_read(ifname, dev_part, filename, addr, 0,
+			   fdt_totalsize(fit));
+	if (ret)
+		return ret;
+	*bytesp = fdt_totalsize(fit);
+	if (!fit_check_format(fit)) {
+		printf("** Bad FIT format in '%s' **\n", filename);
+		return -EINVAL;
+	}
+
+	cfg_noffset = fit_conf_get_node(fit, conf);
+	if (cfg_noffset < 0) {
+		printf("** Configuration '%s' not found **\n",
+		       conf ? conf : "<default>");
+		return -ENOENT;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(fitload_props); i++) {
+		count = fit_conf_get_prop_node_count(fit, cfg_noffset,
+						     fitload_props[i]);
+		if (count > 0)
+			total += count;
+	}
+	imgs = calloc(total ? total : 1, sizeof(*imgs));
+	if (!imgs)
+		return -ENOMEM;
+
+	/* Find the images with external data, each only once */
+	count = 0;
+	for (i = 0; i < ARRAY_SIZE(fitload_props); i++) {
+		total = fit_conf_get_prop_node_count(fit, cfg_noffset,
+						     fitload_props[i]);
+		for (j = 0; j < total; j++) {
+			noffset = fit_conf_get_prop_node_index(fit, cfg_noffset,
+							       fitload_props[i],
+							       j);
+			if (noffset < 0)
+				continue;
+			for (k = 0; k < count; k++) {
+				if (imgs[k].noffset == noffset)
+					break;
+			}
+			if (k < count)
+				continue;
+			ret = fitload_plan(fit, addr, noffset, &imgs[count]);
+			if (ret == -ENOENT)
+				continue;	/* Data is inside the structure */
+			if (ret)
+				goto out;
+			count++;
+		}
+	}
+
+	/*
+	 * A configuration signature covers the image nodes, including their
+	 * data-position / data-offset, so leave those alone if there is one
+	 */
+	if (!fitload_conf_signed(fit, cfg_noffset)) {
+		for (i = 0; i < count; i++)
+			fitload_direct(fit, addr, imgs, count, &imgs[i]);
+	}
+
+	for (i = 0; i < count; i++) {
+		img = &imgs[i];
+		debug("%s: %s: %x bytes at %lx to %lx\n", __func__,
+		      fit_get_name(fit, img->noffset, NULL), img->size,
+		      img->base - addr + img->pos, img->dest);
+		ret = fitload_read(ifname, dev_part, filename, img->dest,
+				   img->base - addr + img->pos, img->size);
+		if (ret)
+			goto out;
+		*bytesp += img->size;
+	}
+	ret = 0;
+out:
+	free(imgs);
+
+	return ret;
+}
+
+static int do_fitload(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	const char *filename;
+	const char *conf;
+	loff_t bytes = 0;
+	loff_t size = 0;
+	ulong time;
+	ulong addr;
+	char *ep;
+
+	if (argc < 4 || argc > 6)
+		return CMD_RET_USAGE;
+
+	addr = simple_strtoul(argv[3], &ep, 16);
+	if (ep == argv[3] || *ep != '\0')
+		return CMD_RET_USAGE;
+	if (argc >= 5) {
+		filename = argv[4];
+	} else {
+		filename = env_get("bootfile");
+		if (!filename) {
+			puts("** No boot file defined **\n");
+			return CMD_RET_FAILURE;
+		}
+	}
+	conf = argc >= 6 ? argv[5] : NULL;
+	if (conf && *conf == '#')
+		conf++;
+
+	if (fs_set_blk_dev(argv[1], argv[2], FS_TYPE_ANY) ||
+	    fs_size(filename, &size))
+		return CMD_RET_FAILURE;
+
+	time = get_timer(0);
+	if (fit_fs_load(argv[1], argv[2], filename, addr, conf, &bytes))
+		return CMD_RET_FAILURE;
+	time = get_timer(time);
+
+	printf("%llu of %llu bytes read in %lu ms", bytes, size, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64(bytes, time) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	env_set_hex("fileaddr", addr);
+	env_set_hex("filesize", bytes);
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	fitload, 6, 0, do_fitload,
+	"load the images for one FIT configuration from a filesystem",
+	"<interface> <dev[:part]> <addr> [<filename> [<config>]]\n"
+	"    - Read the FIT structure in 'filename' to 'addr', then read only\n"
+	"      the external-data images used by configuration 'config' (or the\n"
+	"      default configuration). Uncompressed images with a load address\n"
+	"      are read straight to that address. The FIT can then be booted\n"
+	"      with 'bootm <addr>#<config>'."
+);
@@ -79,6 +79,7 @@
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/mtd/mtd.h>
+#include <mtd.h>
 
 #if defined(CONFIG_CMD_NAND)
 #include <linux/mtd/rawnand.h>
@@ -137,6 +138,14 @@ static char last_ids[MTDIDS_MAXLEN + 1];
 static char last_parts[MTDPARTS_MAXLEN + 1];
 static char last_partition[PARTITION_MAXLEN + 1];
 
+/* mtd_env_generation() when 'mtdids' and 'mtdparts' were last parsed */
+static ulong last_env_gen;
+
+/* partitions of all devices hashed by name, rebuilt when the lists change */
+#define PART_HASH_SIZE		32
+static struct hlist_head part_hash[PART_HASH_SIZE];
+static int part_hash_valid;
+
 /* low level jffs2 cache cleaning routine */
 extern void jffs2_free_cache(struct part_info *part);
 
@@ -270,6 +279,8 @@ static void index_partitions(void)
 
 	debug("--- index partitions ---\n");
 
+	part_hash_valid = 0;
+
 	if (current_mtd_dev) {
 		mtddevnum = 0;
 		list_for_each(dentry, &devices) {
@@ -532,6 +543,8 @@ static void part_delall(struct list_head *head)
 	struct list_head *entry, *n;
 	struct part_info *part_tmp;
 
+	part_hash_valid = 0;
+
 	/* clean tmp_list and free allocated memory */
 	list_for_each_safe(entry, n, head) {
 		part_tmp = list_entry(entry, struct part_info, link);
@@ -1369,6 +1382,82 @@ static void list_partitions(void)
 	puts("\n");
 }
 
+static struct hlist_head *part_hash_bucket(const char *name)
+{
+	unsigned int hash = 0;
+
+	while (*name)
+		hash = hash * 31 + *name++;
+
+	return &part_hash[hash % PART_HASH_SIZE];
+}
+
+/**
+ * Hash all partitions by name. Where several share a name, only the first one
+ * in device and partition order is hashed, as that is the one a search of the
+ * lists would find.
+ */
+static void part_hash_build(void)
+{
+	struct list_head *dentry, *pentry;
+	struct hlist_node *pos;
+	struct part_info *part, *other;
+	struct mtd_device *dev;
+	struct hlist_head *head;
+	int i;
+
+	for (i = 0; i < PART_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&part_hash[i]);
+
+	list_for_each(dentry, &devices) {
+		dev = list_entry(dentry, struct mtd_device, link);
+		list_for_each(pentry, &dev->parts) {
+			part = list_entry(pentry, struct part_info, link);
+			head = part_hash_bucket(part->name);
+			hlist_for_each_entry(other, pos, head, hash) {
+				if (strcmp(other->name, part->name) == 0)
+					break;
+			}
+			if (!pos)
+				hlist_add_head(&part->hash, head);
+		}
+	}
+
+	part_hash_valid = 1;
+}
+
+/**
+ * Find a partition by name.
+ *
+ * @param name partition name
+ * @param part_num partition number within its device (output)
+ * @return pointer to the partition, NULL if there is none of that name
+ */
+static struct part_info *part_find_by_name(const char *name, u8 *part_num)
+{
+	struct list_head *entry;
+	struct hlist_node *pos;
+	struct part_info *part;
+
+	if (!part_hash_valid)
+		part_hash_build();
+
+	hlist_for_each_entry(part, pos, part_hash_bucket(name), hash) {
+		if (strcmp(part->name, name) != 0)
+			continue;
+
+		*part_num = 0;
+		list_for_each(entry, &part->dev->parts) {
+			if (entry == &part->link)
+				break;
+			(*part_num)++;
+		}
+		return part;
+	}
+
+	return NULL;
+}
+
 /**
  * Given partition identifier in form of <dev_type><dev_num>,<part_num> find
  * corresponding device and verify partition number.
@@ -1382,21 +1471,15 @@ static void list_partitions(void)
 int find_dev_and_part(const char *id, struct mtd_device **dev,
 		u8 *part_num, struct part_info **part)
 {
-	struct list_head *dentry, *pentry;
 	u8 type, dnum, pnum;
 	const char *p;
 
 	debug("--- find_dev_and_part ---\nid = %s\n", id);
 
-	list_for_each(dentry, &devices) {
-		*part_num = 0;
-		*dev = list_entry(dentry, struct mtd_device, link);
-		list_for_each(pentry, &(*dev)->parts) {
-			*part = list_entry(pentry, struct part_info, link);
-			if (strcmp((*part)->name, id) == 0)
-				return 0;
-			(*part_num)++;
-		}
+	*part = part_find_by_name(id, part_num);
+	if (*part) {
+		*dev = (*part)->dev;
+		return 0;
 	}
 
 	p = id;
@@ -1630,6 +1713,7 @@ static int parse_mtdparts(const char *const mtdparts)
 		}
 
 		list_add_tail(&dev->link, &devices);
+		part_hash_valid = 0;
 		err = 0;
 	}
 	if (err == 1) {
@@ -1800,11 +1884,17 @@ int mtdparts_init(void)
 
 	/* save it for later parsing, cannot rely on current partition pointer
 	 * as 'partition' variable may be updated during init */
-	memset(tmp_parts, 0, sizeof(tmp_parts));
 	memset(tmp_ep, 0, sizeof(tmp_ep));
 	if (current_partition)
 		strncpy(tmp_ep, current_partition, PARTITION_MAXLEN);
 
+	/* neither 'mtdids' nor 'mtdparts' was set since they were parsed */
+	if ((gd->flags & GD_FLG_ENV_READY) &&
+	    last_env_gen == mtd_env_generation())
+		goto current;
+
+	memset(tmp_parts, 0, sizeof(tmp_parts));
+
 	debug("last_ids  : %s\n", last_ids);
 	debug("env_ids   : %s\n", ids);
 	debug("last_parts: %s\n", last_parts);
@@ -1891,6 +1981,9 @@ int mtdparts_init(void)
 	if (!parts)
 		return 0;
 
+	last_env_gen = mtd_env_generation();
+
+current:
 	/* is current partition set in environment? if so, use it */
 	if ((tmp_ep[0] != '\0') && (strcmp(tmp_ep, last_partition) != 0)) {
 		struct part_info *p;
@@ -306,6 +306,8 @@ static void nand_print_and_set_info(int idx)
 	printf("  subpagesize %8d b\n", chip->subpagesize);
 	printf("  options     0x%08x\n", chip->options);
 	printf("  bbt options 0x%08x\n", chip->bbt_options);
+	if (chip->bbt_scan_us)
+		printf("  bbt scan    %8lu us\n", chip->bbt_scan_us);
 
 	/* Set geometry info */
 	env_set_hex("nand_writesize", mtd->writesize);
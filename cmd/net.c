@@ -9,9 +9,12 @@
  */
 #include <common.h>
 #include <command.h>
+#include <dm.h>
 #include <env.h>
 #include <image.h>
 #include <net.h>
+#include <part.h>
+#include <net/wget.h>
 
 static int netboot_common(enum proto_t, cmd_tbl_t *, int, char * const []);
 
@@ -115,6 +118,45 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+static int do_wget(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct blk_desc *desc;
+	char *nargv[3];
+	lbaint_t start;
+	int ret;
+
+	if (argc < 2 || strcmp(argv[1], "-b"))
+		return netboot_common(WGET, cmdtp, argc, argv);
+
+	/* wget -b <interface> <dev> <blk#> ... */
+	if (argc < 5 || argc > 7)
+		return CMD_RET_USAGE;
+	if (blk_get_device_by_str(argv[2], argv[3], &desc) < 0)
+		return CMD_RET_FAILURE;
+	start = simple_strtoul(argv[4], NULL, 16);
+
+	nargv[0] = argv[0];
+	memcpy(nargv + 1, argv + 5, (argc - 5) * sizeof(char *));
+	wget_set_blk_dev(desc, start);
+	ret = netboot_common(WGET, cmdtp, argc - 4, nargv);
+	wget_set_blk_dev(NULL, 0);
+
+	return ret;
+}
+
+U_BOOT_CMD(
+	wget,	7,	1,	do_wget,
+	"download a file via network using HTTP",
+	"[loadAddress] [[hostIPaddr:]path]\n"
+	"    - download 'path' to 'loadAddress'\n"
+	"wget -b <interface> <dev> <blk#> [bufAddress] [[hostIPaddr:]path]\n"
+	"    - write 'path' to block device <interface> <dev> starting at\n"
+	"      hex block 'blk#', using 1MiB at 'bufAddress' as a buffer\n"
+	"The server port is 80 unless set by 'httpdstp'."
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
@@ -298,6 +340,83 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_ARP)
+static int do_arp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	if (argc == 2 && !strcmp(argv[1], "-d")) {
+		arp_cache_flush();
+		return CMD_RET_SUCCESS;
+	}
+	if (argc != 1)
+		return CMD_RET_USAGE;
+
+	arp_cache_show();
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	arp,	2,	1,	do_arp,
+	"show or flush the ARP cache",
+	"\n"
+	"    - show the neighbours whose MAC address is known\n"
+	"arp -d\n"
+	"    - remove all entries"
+);
+#endif
+
+#if defined(CONFIG_CMD_NET_STATS)
+static void net_show_stats(struct udevice *dev)
+{
+	struct eth_stats *stats = eth_get_stats(dev);
+
+	printf("eth%d: %s\n", dev->seq, dev->name);
+	if (!stats) {
+		printf("    not probed\n");
+		return;
+	}
+	printf("    rx %u packets in %u batches, %u errors, %u dropped, %u ring full\n",
+	       stats->rx_packets, stats->rx_batches, stats->rx_errors,
+	       stats->rx_dropped, stats->rx_ring_full);
+	printf("    tx %u packets, %u errors\n", stats->tx_packets,
+	       stats->tx_errors);
+}
+
+static int do_net_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 2) {
+		dev = eth_get_dev_by_name(argv[1]);
+		if (!dev) {
+			printf("No such device '%s'\n", argv[1]);
+			return CMD_RET_FAILURE;
+		}
+		net_show_stats(dev);
+		return CMD_RET_SUCCESS;
+	}
+
+	if (uclass_get(UCLASS_ETH, &uc))
+		return CMD_RET_FAILURE;
+	uclass_foreach_dev(dev, uc)
+		net_show_stats(dev);
+
+	return CMD_RET_SUCCESS;
+}
+
+static char net_help_text[] =
+	"stats [<dev>]\tshow packet counters of all Ethernet devices, or\n"
+	"\t\tof <dev> (name or ethN alias)";
+
+U_BOOT_CMD_WITH_SUBCMDS(net, "network devices", net_help_text,
+			U_BOOT_SUBCMD_MKENT(stats, 2, 1, do_net_stats));
+#endif
+
 #if defined(CONFIG_CMD_CDP)
 
 static void cdp_update_env(void)
@@ -12,8 +12,10 @@
 #include <mapmem.h>
 #include <spi.h>
 #include <spi_flash.h>
+#include <u-boot/crc.h>
 #include <jffs2/jffs2.h>
 #include <linux/mtd/mtd.h>
+#include <linux/sizes.h>
 
 #include <asm/io.h>
 #include <dm/device-internal.h>
@@ -153,48 +155,276 @@ static int do_spi_flash_probe(int argc, char * const argv[])
 	return 0;
 }
 
+/* Amount of flash read back in one go when checking for changes */
+#define SF_UPDATE_READ_SIZE	SZ_256K
+
+/* Magic number at the start of a digest table: "SFDG" */
+#define SF_DIGEST_MAGIC		0x47444653
+
+/**
+ * struct sf_digest_hdr - Header of an on-flash table of sector digests
+ *
+ * The header is followed by the crc32 of each whole sector of the region
+ * last written by 'sf update'. It lets a later update skip reading back
+ * sectors which are already correct.
+ *
+ * @magic:		SF_DIGEST_MAGIC
+ * @offset:		Flash offset of the region
+ * @sector_size:	Sector size the digests were calculated with
+ * @count:		Number of digests which follow
+ * @crc:		crc32 of the digests
+ */
+struct sf_digest_hdr {
+	u32 magic;
+	u32 offset;
+	u32 sector_size;
+	u32 count;
+	u32 crc;
+};
+
+/**
+ * struct sf_update - State of an 'sf update'
+ *
+ * @flash:		Flash being updated
+ * @offset:		Flash offset of the region being updated
+ * @rbuf:		Sectors read back from the flash
+ * @rbuf_size:		Size of @rbuf, a whole number of sectors
+ * @rbuf_offset:	Flash offset of the data in @rbuf
+ * @rbuf_len:		Number of bytes in @rbuf, 0 if it is empty
+ * @table:		Digest table, or NULL if none is used
+ * @table_offset:	Flash offset of the digest table
+ * @table_size:		Size of the digest table, a whole number of sectors
+ * @table_valid:	true if the digest table described the flash before
+ *			this update
+ * @table_erased:	true if the digest table has been erased from the flash
+ * @table_dirty:	true if a digest changed
+ * @written:		Number of sectors erased and written
+ * @unchanged:		Number of sectors which did not need to change
+ * @digest_hits:	Number of unchanged sectors found from the digest table
+ * @read_bytes:		Number of bytes read back from the flash
+ * @write_ms:		Time spent erasing and writing sectors
+ */
+struct sf_update {
+	struct spi_flash *flash;
+	u32 offset;
+	char *rbuf;
+	u32 rbuf_size;
+	u32 rbuf_offset;
+	u32 rbuf_len;
+	struct sf_digest_hdr *table;
+	u32 table_offset;
+	u32 table_size;
+	bool table_valid;
+	bool table_erased;
+	bool table_dirty;
+	uint written;
+	uint unchanged;
+	uint digest_hits;
+	ulong read_bytes;
+	ulong write_ms;
+};
+
+/* Size of the digest table for @count sectors, a whole number of sectors */
+static u32 sf_digest_table_size(struct spi_flash *flash, uint count)
+{
+	return ROUND(sizeof(struct sf_digest_hdr) + count * sizeof(u32),
+		     flash->sector_size);
+}
+
+static u32 *sf_digests(struct sf_update *upd)
+{
+	return (u32 *)(upd->table + 1);
+}
+
+/**
+ * Read the digest table and check that it describes the region to update
+ *
+ * @param upd		update state
+ * @param count		number of whole sectors to update
+ * @return NULL if OK, else a string containing the stage which failed
+ */
+static const char *sf_digest_read(struct sf_update *upd, uint count)
+{
+	struct spi_flash *flash = upd->flash;
+	struct sf_digest_hdr *hdr;
+
+	upd->table_size = sf_digest_table_size(flash, count);
+	upd->table = memalign(ARCH_DMA_MINALIGN, upd->table_size);
+	if (!upd->table)
+		return "malloc";
+	if (spi_flash_read(flash, upd->table_offset, upd->table_size,
+			   upd->table))
+		return "digest read";
+
+	hdr = upd->table;
+	upd->table_valid = hdr->magic == SF_DIGEST_MAGIC &&
+		hdr->offset == upd->offset &&
+		hdr->sector_size == flash->sector_size &&
+		hdr->count <= (upd->table_size - sizeof(*hdr)) / sizeof(u32) &&
+		hdr->crc == crc32(0, (uchar *)sf_digests(upd),
+				  hdr->count * sizeof(u32));
+	if (!upd->table_valid)
+		hdr->count = 0;
+
+	return NULL;
+}
+
+/**
+ * Erase the digest table, so that it cannot describe a partial update
+ *
+ * @param upd		update state
+ * @return NULL if OK, else a string containing the stage which failed
+ */
+static const char *sf_digest_erase(struct sf_update *upd)
+{
+	if (!upd->table || upd->table_erased)
+		return NULL;
+	if (spi_flash_erase(upd->flash, upd->table_offset, upd->table_size))
+		return "digest erase";
+	upd->table_erased = true;
+
+	return NULL;
+}
+
+/**
+ * Write the digest table back if it does not match the flash any more
+ *
+ * @param upd		update state
+ * @param count		number of whole sectors updated
+ * @return NULL if OK, else a string containing the stage which failed
+ */
+static const char *sf_digest_write(struct sf_update *upd, uint count)
+{
+	struct sf_digest_hdr *hdr = upd->table;
+	const char *err_oper;
+
+	if (upd->table_valid && !upd->table_dirty && !upd->table_erased &&
+	    hdr->count == count)
+		return NULL;
+
+	hdr->magic = SF_DIGEST_MAGIC;
+	hdr->offset = upd->offset;
+	hdr->sector_size = upd->flash->sector_size;
+	hdr->count = count;
+	hdr->crc = crc32(0, (uchar *)sf_digests(upd), count * sizeof(u32));
+
+	err_oper = sf_digest_erase(upd);
+	if (err_oper)
+		return err_oper;
+	if (spi_flash_write(upd->flash, upd->table_offset, upd->table_size,
+			    upd->table))
+		return "digest write";
+
+	return NULL;
+}
+
+/**
+ * Make sure a sector is in the read-back buffer
+ *
+ * If it is not, the sector and those after it are read in one go, up to the
+ * end of the region being updated.
+ *
+ * @param upd		update state
+ * @param offset	flash offset of the sector
+ * @param end		flash offset of the end of the update
+ * @param sectp		returns a pointer to the sector in the buffer
+ * @return NULL if OK, else a string containing the stage which failed
+ */
+static const char *sf_update_readback(struct sf_update *upd, u32 offset,
+				      u32 end, char **sectp)
+{
+	struct spi_flash *flash = upd->flash;
+	u32 len;
+
+	if (!upd->rbuf_len || offset < upd->rbuf_offset ||
+	    offset >= upd->rbuf_offset + upd->rbuf_len) {
+		len = ROUND(end - offset, flash->sector_size);
+		len = min(len, upd->rbuf_size);
+		if (spi_flash_read(flash, offset, len, upd->rbuf))
+			return "read";
+		upd->rbuf_offset = offset;
+		upd->rbuf_len = len;
+		upd->read_bytes += len;
+	}
+	*sectp = upd->rbuf + offset - upd->rbuf_offset;
+
+	return NULL;
+}
+
 /**
  * Write a block of data to SPI flash, first checking if it is different from
  * what is already there.
  *
+ * A whole sector whose digest matches the digest table is taken to be
+ * unchanged without reading it back. Otherwise the flash is read back in
+ * large bursts and compared.
+ *
  * If the data being written is the same, then *skipped is incremented by len.
  *
- * @param flash		flash context pointer
+ * @param upd		update state
  * @param offset	flash offset to write
  * @param len		number of bytes to write
  * @param buf		buffer to write from
- * @param cmp_buf	read buffer to use to compare data
+ * @param end		flash offset of the end of the update
  * @param skipped	Count of skipped data (incremented by this function)
  * @return NULL if OK, else a string containing the stage which failed
  */
-static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
-		size_t len, const char *buf, char *cmp_buf, size_t *skipped)
+static const char *spi_flash_update_block(struct sf_update *upd, u32 offset,
+		size_t len, const char *buf, u32 end, size_t *skipped)
 {
-	char *ptr = (char *)buf;
+	struct spi_flash *flash = upd->flash;
+	uint idx = (offset - upd->offset) / flash->sector_size;
+	const char *err_oper;
+	ulong start;
+	char *sect;
+	u32 digest = 0;
 
 	debug("offset=%#x, sector_size=%#x, len=%#zx\n",
 	      offset, flash->sector_size, len);
+	if (upd->table && len == flash->sector_size) {
+		digest = crc32(0, (const uchar *)buf, len);
+		if (idx < upd->table->count && sf_digests(upd)[idx] == digest) {
+			debug("Skip region %x size %zx: digest matches\n",
+			      offset, len);
+			upd->digest_hits++;
+			goto unchanged;
+		}
+		sf_digests(upd)[idx] = digest;
+		upd->table_dirty = true;
+	}
+
 	/* Read the entire sector so to allow for rewriting */
-	if (spi_flash_read(flash, offset, flash->sector_size, cmp_buf))
-		return "read";
+	err_oper = sf_update_readback(upd, offset, end, &sect);
+	if (err_oper)
+		return err_oper;
 	/* Compare only what is meaningful (len) */
-	if (memcmp(cmp_buf, buf, len) == 0) {
+	if (memcmp(sect, buf, len) == 0) {
 		debug("Skip region %x size %zx: no change\n",
 		      offset, len);
-		*skipped += len;
-		return NULL;
+		goto unchanged;
 	}
+
+	/* The digest table must not survive a partial update */
+	err_oper = sf_digest_erase(upd);
+	if (err_oper)
+		return err_oper;
+
+	start = get_timer(0);
 	/* Erase the entire sector */
 	if (spi_flash_erase(flash, offset, flash->sector_size))
 		return "erase";
-	/* If it's a partial sector, copy the data into the temp-buffer */
-	if (len != flash->sector_size) {
-		memcpy(cmp_buf, buf, len);
-		ptr = cmp_buf;
-	}
-	/* Write one complete sector */
-	if (spi_flash_write(flash, offset, flash->sector_size, ptr))
+	/* Write one complete sector, keeping the rest of a partial one */
+	memcpy(sect, buf, len);
+	if (spi_flash_write(flash, offset, flash->sector_size, sect))
 		return "write";
+	upd->write_ms += get_timer(start);
+	upd->written++;
+
+	return NULL;
+
+unchanged:
+	upd->unchanged++;
+	*skipped += len;
 
 	return NULL;
 }
@@ -203,29 +433,47 @@ static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
  * Update an area of SPI flash by erasing and writing any blocks which need
  * to change. Existing blocks with the correct data are left unchanged.
  *
+ * If a digest table is used, it is read first and rewritten afterwards when
+ * anything changed. An update of identical data then needs no erase or
+ * write, and reads back only a partial last sector.
+ *
  * @param flash		flash context pointer
  * @param offset	flash offset to write
  * @param len		number of bytes to write
  * @param buf		buffer to write from
+ * @param digest	true to use a digest table
+ * @param digest_offset	flash offset of the digest table
  * @return 0 if ok, 1 on error
  */
 static int spi_flash_update(struct spi_flash *flash, u32 offset,
-		size_t len, const char *buf)
+		size_t len, const char *buf, bool digest, u32 digest_offset)
 {
+	struct sf_update upd;
 	const char *err_oper = NULL;
-	char *cmp_buf;
 	const char *end = buf + len;
 	size_t todo;		/* number of bytes to do in this pass */
 	size_t skipped = 0;	/* statistics */
 	const ulong start_time = get_timer(0);
 	size_t scale = 1;
 	const char *start_buf = buf;
+	uint count = len / flash->sector_size;
 	ulong delta;
 
+	memset(&upd, '\0', sizeof(upd));
+	upd.flash = flash;
+	upd.offset = offset;
+	upd.rbuf_size = min_t(u32, ROUND(len, flash->sector_size),
+			      ROUND(SF_UPDATE_READ_SIZE, flash->sector_size));
+	upd.table_offset = digest_offset;
+
 	if (end - buf >= 200)
 		scale = (end - buf) / 100;
-	cmp_buf = memalign(ARCH_DMA_MINALIGN, flash->sector_size);
-	if (cmp_buf) {
+	upd.rbuf = memalign(ARCH_DMA_MINALIGN, upd.rbuf_size);
+	if (!upd.rbuf)
+		err_oper = "malloc";
+	else if (digest)
+		err_oper = sf_digest_read(&upd, count);
+	if (!err_oper) {
 		ulong last_update = get_timer(0);
 
 		for (; buf < end && !err_oper; buf += todo, offset += todo) {
@@ -237,13 +485,14 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 							 start_time));
 				last_update = get_timer(0);
 			}
-			err_oper = spi_flash_update_block(flash, offset, todo,
-					buf, cmp_buf, &skipped);
+			err_oper = spi_flash_update_block(&upd, offset, todo,
+					buf, offset + (end - buf), &skipped);
 		}
-	} else {
-		err_oper = "malloc";
 	}
-	free(cmp_buf);
+	if (!err_oper && upd.table)
+		err_oper = sf_digest_write(&upd, count);
+	free(upd.table);
+	free(upd.rbuf);
 	putc('\r');
 	if (err_oper) {
 		printf("SPI flash failed in %s step\n", err_oper);
@@ -255,6 +504,15 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 	       skipped);
 	printf(" in %ld.%lds, speed %ld B/s\n",
 	       delta / 1000, delta % 1000, bytes_per_second(len, start_time));
+	printf("%u sectors written, %u unchanged (%u from digests), %lu bytes read back\n",
+	       upd.written, upd.unchanged, upd.digest_hits, upd.read_bytes);
+	if (upd.unchanged) {
+		printf("Saved %u erase cycles", upd.unchanged);
+		if (upd.written)
+			printf(", about %lu ms", upd.write_ms / upd.written *
+			       upd.unchanged);
+		puts("\n");
+	}
 
 	return 0;
 }
@@ -267,6 +525,9 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 	int ret = 1;
 	int dev = 0;
 	loff_t offset, len, maxsize;
+	ulong digest_offset = 0;
+	bool update, digest = false;
+	u32 table_size;
 
 	if (argc < 3)
 		return -1;
@@ -275,6 +536,15 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 	if (*argv[1] == 0 || *endp != 0)
 		return -1;
 
+	update = strcmp(argv[0], "update") == 0;
+	if (update && argc > 4) {
+		digest_offset = simple_strtoul(argv[4], &endp, 16);
+		if (*argv[4] == 0 || *endp != 0)
+			return -1;
+		digest = true;
+		argc--;
+	}
+
 	if (mtd_arg_off_size(argc - 2, &argv[2], &dev, &offset, &len,
 			     &maxsize, MTD_DEV_TYPE_NOR, flash->size))
 		return -1;
@@ -286,14 +556,29 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 		return 1;
 	}
 
+	if (digest) {
+		table_size = sf_digest_table_size(flash,
+						  len / flash->sector_size);
+		if (digest_offset % flash->sector_size ||
+		    digest_offset >= flash->size ||
+		    table_size > flash->size - digest_offset ||
+		    (digest_offset < offset + len &&
+		     digest_offset + table_size > offset)) {
+			printf("ERROR: digest table at %#lx (%#x bytes) must be sector aligned, within the flash and outside the update\n",
+			       digest_offset, table_size);
+			return 1;
+		}
+	}
+
 	buf = map_physmem(addr, len, MAP_WRBACK);
 	if (!buf && addr) {
 		puts("Failed to map physical memory\n");
 		return 1;
 	}
 
-	if (strcmp(argv[0], "update") == 0) {
-		ret = spi_flash_update(flash, offset, len, buf);
+	if (update) {
+		ret = spi_flash_update(flash, offset, len, buf, digest,
+				       digest_offset);
 	} else if (strncmp(argv[0], "read", 4) == 0 ||
 			strncmp(argv[0], "write", 5) == 0) {
 		int read;
@@ -317,6 +602,37 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 	return ret == 0 ? 0 : 1;
 }
 
+/**
+ * show_erase_plan() - Show the erase commands used for a range
+ *
+ * @offset:	Start of the range
+ * @len:	Length of the range
+ */
+static void show_erase_plan(u32 offset, u32 len)
+{
+	struct spi_nor_erase_plan plan;
+	const char *sep = "";
+	int cmds, i;
+
+	cmds = spi_nor_erase_plan(flash, offset, len, &plan);
+	if (cmds <= 0)
+		return;
+
+	printf("SF: Erasing with %d command%s: ", cmds, cmds == 1 ? "" : "s");
+	if (plan.chip) {
+		puts("chip\n");
+		return;
+	}
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		if (!plan.count[i])
+			continue;
+		printf("%s%u x ", sep, plan.count[i]);
+		print_size(flash->erase_types[i].size, "");
+		sep = ", ";
+	}
+	puts("\n");
+}
+
 static int do_spi_flash_erase(int argc, char * const argv[])
 {
 	int ret;
@@ -342,6 +658,7 @@ static int do_spi_flash_erase(int argc, char * const argv[])
 		return 1;
 	}
 
+	show_erase_plan(offset, size);
 	ret = spi_flash_erase(flash, offset, size);
 	printf("SF: %zu bytes @ %#x Erased: %s\n", (size_t)size, (u32)offset,
 	       ret ? "ERROR" : "OK");
@@ -597,7 +914,7 @@ usage:
 #endif
 
 U_BOOT_CMD(
-	sf,	5,	1,	do_spi_flash,
+	sf,	6,	1,	do_spi_flash,
 	"SPI flash sub-system",
 	"probe [[bus:]cs] [hz] [mode]	- init flash device on given SPI bus\n"
 	"				  and chip select\n"
@@ -610,9 +927,13 @@ U_BOOT_CMD(
 	"sf erase offset|partition [+]len	- erase `len' bytes from `offset'\n"
 	"					  or from start of mtd `partition'\n"
 	"					 `+len' round up `len' to block size\n"
-	"sf update addr offset|partition len	- erase and write `len' bytes from memory\n"
+	"sf update addr offset|partition len [digest]\n"
+	"					- erase and write `len' bytes from memory\n"
 	"					  at `addr' to flash at `offset'\n"
-	"					  or to start of mtd `partition'\n"
+	"					  or to start of mtd `partition',\n"
+	"					  skipping unchanged sectors. A table of\n"
+	"					  sector digests at flash offset `digest'\n"
+	"					  avoids reading those sectors back\n"
 	"sf protect lock/unlock sector len	- protect/unprotect 'len' bytes starting\n"
 	"					  at address 'sector'\n"
 	SF_TEST_HELP
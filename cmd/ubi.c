@@ -51,6 +51,8 @@ static void display_volume_info(struct ubi_device *ubi)
 
 static void display_ubi_info(struct ubi_device *ubi)
 {
+	struct ubi_attach_times *times = &ubi->attach_times;
+
 	ubi_msg("MTD device name:            \"%s\"", ubi->mtd->name);
 	ubi_msg("MTD device size:            %llu MiB", ubi->flash_size >> 20);
 	ubi_msg("physical eraseblock size:   %d bytes (%d KiB)",
@@ -72,6 +74,14 @@ static void display_ubi_info(struct ubi_device *ubi)
 	ubi_msg("number of PEBs reserved for bad PEB handling: %d",
 			ubi->beb_rsvd_pebs);
 	ubi_msg("max/mean erase counter: %d/%d", ubi->max_ec, ubi->mean_ec);
+	ubi_msg("attached by:                %s, %d PEB header reads",
+			ubi->fm ? "fastmap" : "scanning", times->hdr_reads);
+	ubi_msg("attach time:                %lu ms",
+			(times->scan_us + times->vtbl_us + times->wl_us +
+			 times->eba_us) / 1000);
+	ubi_msg("  scan/vtbl/wl/eba:         %lu/%lu/%lu/%lu ms",
+			times->scan_us / 1000, times->vtbl_us / 1000,
+			times->wl_us / 1000, times->eba_us / 1000);
 }
 
 static int ubi_info(int layout)
@@ -48,7 +48,7 @@ static int do_gzwrite(cmd_tbl_t *cmdtp, int flag,
 	int ret;
 	unsigned char *addr;
 	unsigned long length;
-	unsigned long writebuf = 1<<20;
+	unsigned long writebuf;
 	u64 startoffs = 0;
 	u64 szexpected = 0;
 
@@ -60,6 +60,7 @@ static int do_gzwrite(cmd_tbl_t *cmdtp, int flag,
 
 	addr = (unsigned char *)simple_strtoul(argv[3], NULL, 16);
 	length = simple_strtoul(argv[4], NULL, 16);
+	writebuf = env_get_hex("gzwrite_bufsize", 1 << 20);
 
 	if (5 < argc) {
 		writebuf = simple_strtoul(argv[5], NULL, 16);
@@ -79,9 +80,10 @@ static int do_gzwrite(cmd_tbl_t *cmdtp, int flag,
 U_BOOT_CMD(
 	gzwrite, 8, 0, do_gzwrite,
 	"unzip and write memory to block device",
-	"<interface> <dev> <addr> length [wbuf=1M [offs=0 [outsize=0]]]\n"
+	"<interface> <dev> <addr> length [wbuf [offs=0 [outsize=0]]]\n"
 	"\twbuf is the size in bytes (hex) of write buffer\n"
 	"\t\tand should be padded to erase size for SSDs\n"
+	"\t\t(default $gzwrite_bufsize, or 1M)\n"
 	"\toffs is the output start offset in bytes (hex)\n"
 	"\toutsize is the size of the expected output (hex bytes)\n"
 	"\t\tand is required for files with uncompressed lengths\n"
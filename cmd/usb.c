@@ -20,6 +20,7 @@
 #include <asm/unaligned.h>
 #include <part.h>
 #include <usb.h>
+#include <linux/math64.h>
 
 #ifdef CONFIG_USB_STORAGE
 static int usb_stor_curr_dev = -1; /* current device */
@@ -618,6 +619,37 @@ static void usb_show_info(struct usb_device *udev)
 		}
 	}
 }
+
+/* show the transfer counters of each active controller */
+static void usb_show_stats(void)
+{
+	struct udevice *bus;
+
+	for (uclass_find_first_device(UCLASS_USB, &bus);
+	     bus;
+	     uclass_find_next_device(&bus)) {
+		struct usb_bus_priv *priv;
+		struct usb_bus_stats *stats;
+		ulong xfers;
+
+		if (!device_active(bus))
+			continue;
+		priv = dev_get_uclass_priv(bus);
+		stats = &priv->stats;
+		xfers = stats->control + stats->bulk;
+		printf("Bus %s:\n", bus->name);
+		printf("  Transfers: %lu control, %lu bulk, %lu interrupt, %lu errors\n",
+		       stats->control, stats->bulk, stats->interrupt,
+		       stats->errors);
+		printf("  Bytes: %llu, latency: %lu us average, %lu us max\n",
+		       stats->bytes,
+		       xfers ? (ulong)div_u64(stats->total_us, xfers) : 0,
+		       stats->max_us);
+		if (stats->pool_misses)
+			printf("  Descriptor pool misses: %lu\n",
+			       stats->pool_misses);
+	}
+}
 #endif
 
 /******************************************************************************
@@ -667,9 +699,13 @@ static int do_usb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		return 0;
 	}
 	if (strncmp(argv[1], "inf", 3) == 0) {
-		if (argc == 2) {
+		bool verbose = argc == 3 && !strcmp(argv[2], "-v");
+
+		if (argc == 2 || verbose) {
 #ifdef CONFIG_DM_USB
 			usb_for_each_root_dev(usb_show_info);
+			if (verbose)
+				usb_show_stats();
 #else
 			int d;
 			for (d = 0; d < USB_MAX_DEVICE; d++) {
@@ -730,6 +766,9 @@ U_BOOT_CMD(
 	"usb stop [f] - stop USB [f]=force stop\n"
 	"usb tree - show USB device tree\n"
 	"usb info [dev] - show available USB devices\n"
+#ifdef CONFIG_DM_USB
+	"usb info -v - also show transfer counters for each controller\n"
+#endif
 	"usb test [dev] [port] [mode] - set USB 2.0 test mode\n"
 	"    (specify port 0 to indicate the device's upstream port)\n"
 	"    Available modes: J, K, S[E0_NAK], P[acket], F[orce_Enable]\n"
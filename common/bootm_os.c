@@ -13,6 +13,7 @@
 #include <linux/libfdt.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <serial.h>
 #include <vxworks.h>
 #include <tee/optee.h>
 
@@ -609,6 +610,8 @@ int boot_selected_os(int argc, char * const argv[], int state,
 {
 	arch_preboot_os();
 	board_preboot_os();
+	/* Nothing drains buffered console output once the OS runs */
+	serial_flush_tx();
 	boot_fn(state, argc, argv, images);
 
 	/* Stand-alone may return when 'autostart' is 'no' */
@@ -11,6 +11,8 @@
 #include <errno.h>
 #include <bouncebuf.h>
 
+static struct bounce_buffer_stats bb_stats;
+
 static int addr_aligned(struct bounce_buffer *state)
 {
 	const ulong align_mask = ARCH_DMA_MINALIGN - 1;
@@ -31,6 +33,60 @@ static int addr_aligned(struct bounce_buffer *state)
 	return 1;
 }
 
+static void bounce_buffer_add_seg(struct bounce_buffer *state, void *addr,
+				  size_t len)
+{
+	struct bounce_buffer_seg *seg = &state->seg[state->nsegs++];
+
+	seg->addr = addr;
+	seg->len = len;
+}
+
+/*
+ * Bounce only the partial cache lines at each end of the buffer, using one
+ * cache line for each. The middle is used directly, which is safe since it
+ * shares no cache line with anything else.
+ */
+static int bounce_buffer_split(struct bounce_buffer *state)
+{
+	ulong start = (ulong)state->user_buffer;
+	ulong end = start + state->len;
+	ulong mid_start = roundup(start, ARCH_DMA_MINALIGN);
+	ulong mid_end = rounddown(end, ARCH_DMA_MINALIGN);
+	void *ends;
+
+	if ((start | state->len) & 3 || mid_end <= mid_start)
+		return -EINVAL;
+
+	ends = memalign(ARCH_DMA_MINALIGN, 2 * ARCH_DMA_MINALIGN);
+	if (!ends)
+		return -ENOMEM;
+
+	state->ends_buffer = ends;
+	state->head_len = mid_start - start;
+	state->tail_len = end - mid_end;
+	if (state->flags & GEN_BB_READ) {
+		memcpy(ends, state->user_buffer, state->head_len);
+		memcpy(ends + ARCH_DMA_MINALIGN, (void *)mid_end,
+		       state->tail_len);
+	}
+
+	if (state->head_len)
+		bounce_buffer_add_seg(state, ends, state->head_len);
+	bounce_buffer_add_seg(state, (void *)mid_start, mid_end - mid_start);
+	if (state->tail_len)
+		bounce_buffer_add_seg(state, ends + ARCH_DMA_MINALIGN,
+				      state->tail_len);
+
+	flush_dcache_range((ulong)ends, (ulong)ends + 2 * ARCH_DMA_MINALIGN);
+	flush_dcache_range(mid_start, mid_end);
+
+	bb_stats.split++;
+	bb_stats.bytes_bounced += state->head_len + state->tail_len;
+
+	return 0;
+}
+
 int bounce_buffer_start(struct bounce_buffer *state, void *data,
 			size_t len, unsigned int flags)
 {
@@ -39,8 +95,18 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
 	state->len = len;
 	state->len_aligned = roundup(len, ARCH_DMA_MINALIGN);
 	state->flags = flags;
+	state->nsegs = 0;
+	state->ends_buffer = NULL;
+	state->head_len = 0;
+	state->tail_len = 0;
+
+	bb_stats.sessions++;
+	bb_stats.bytes += len;
 
 	if (!addr_aligned(state)) {
+		if ((flags & GEN_BB_SPLIT) && !bounce_buffer_split(state))
+			return 0;
+
 		state->bounce_buffer = memalign(ARCH_DMA_MINALIGN,
 						state->len_aligned);
 		if (!state->bounce_buffer)
@@ -49,7 +115,11 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
 		if (state->flags & GEN_BB_READ)
 			memcpy(state->bounce_buffer, state->user_buffer,
 				state->len);
+
+		bb_stats.bounced++;
+		bb_stats.bytes_bounced += len;
 	}
+	bounce_buffer_add_seg(state, state->bounce_buffer, len);
 
 	/*
 	 * Flush data to RAM so DMA reads can pick it up,
@@ -62,8 +132,31 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
 	return 0;
 }
 
+static int bounce_buffer_stop_split(struct bounce_buffer *state)
+{
+	ulong mid_start = (ulong)state->user_buffer + state->head_len;
+	ulong mid_end = (ulong)state->user_buffer + state->len -
+			state->tail_len;
+	void *ends = state->ends_buffer;
+
+	if (state->flags & GEN_BB_WRITE) {
+		invalidate_dcache_range((ulong)ends,
+					(ulong)ends + 2 * ARCH_DMA_MINALIGN);
+		invalidate_dcache_range(mid_start, mid_end);
+		memcpy(state->user_buffer, ends, state->head_len);
+		memcpy((void *)mid_end, ends + ARCH_DMA_MINALIGN,
+		       state->tail_len);
+	}
+	free(ends);
+
+	return 0;
+}
+
 int bounce_buffer_stop(struct bounce_buffer *state)
 {
+	if (state->ends_buffer)
+		return bounce_buffer_stop_split(state);
+
 	if (state->flags & GEN_BB_WRITE) {
 		/* Invalidate cache so that CPU can see any newly DMA'd data */
 		invalidate_dcache_range((unsigned long)state->bounce_buffer,
@@ -81,3 +174,13 @@ int bounce_buffer_stop(struct bounce_buffer *state)
 
 	return 0;
 }
+
+void bounce_buffer_get_stats(struct bounce_buffer_stats *stats)
+{
+	*stats = bb_stats;
+}
+
+void bounce_buffer_reset_stats(void)
+{
+	memset(&bb_stats, '\0', sizeof(bb_stats));
+}
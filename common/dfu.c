@@ -98,6 +98,9 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 
 		WATCHDOG_RESET();
 		usb_gadget_handle_interrupts(usbctrl_index);
+
+		/* Write out part of a full buffer while the next one fills */
+		dfu_drain_step();
 	}
 exit:
 	g_dnl_unregister();
@@ -0,0 +1,630 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Logging support - binary ring buffer with deferred formatting
+ *
+ * Records are stored in binary form: the timestamp, category, level, pointers
+ * to the file / function / format strings and the raw arguments. Formatting
+ * happens only when the buffer is read ('log dump'), so debug-level records
+ * can be kept without paying for vsnprintf() during boot.
+ */
+
+#include <common.h>
+#include <bloblist.h>
+#include <log.h>
+#include <malloc.h>
+#include <linux/ctype.h>
+#include <linux/err.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+enum {
+	LOG_BUFFER_MAGIC	= 0x6c6f6762,	/* "logb" */
+	LOG_BUFFER_ALIGN	= 8,
+	LOG_BUFFER_MAX_SPEC	= 32,	/* max length of a single %... spec */
+};
+
+/* Flags for struct log_buffer_hdr */
+enum log_buffer_hdr_flags {
+	LOGBH_BUSY	= 1 << 0,	/* A record is being written */
+};
+
+/* Flags for struct log_buffer_rec */
+enum log_buffer_rec_flags {
+	LOGBR_TEXT	= 1 << 0,	/* Payload is the formatted message */
+	LOGBR_RELOC	= 1 << 1,	/* Pointers are post-relocation */
+};
+
+/**
+ * struct log_buffer_hdr - header at the start of the log buffer
+ *
+ * This is also the format of the BLOBLISTT_LOG_BUFFER bloblist record, so it
+ * must not contain pointers and must have the same layout on all archs.
+ * Records follow this header; offsets are relative to the first record.
+ *
+ * @magic: LOG_BUFFER_MAGIC
+ * @size: Number of bytes available for records
+ * @head: Offset at which the next record will be written
+ * @tail: Offset of the oldest record
+ * @count: Number of records in the buffer
+ * @dropped: Number of records overwritten because the buffer was full
+ * @flags: LOGBH_... flags
+ * @spare: Spare space, for alignment
+ * @reloc_off: gd->reloc_off when the records were written. A host tool can
+ *	use this with the U-Boot ELF file to resolve the string pointers
+ */
+struct log_buffer_hdr {
+	u32 magic;
+	u32 size;
+	u32 head;
+	u32 tail;
+	u32 count;
+	u32 dropped;
+	u32 flags;
+	u32 spare;
+	u64 reloc_off;
+};
+
+/**
+ * struct log_buffer_rec - header of a single record in the buffer
+ *
+ * The payload follows this header. If LOGBR_TEXT is set it is the
+ * nul-terminated message. Otherwise it holds one slot for each argument
+ * consumed by @fmt: integers and pointers use a u64, strings use a u32 length
+ * followed by the nul-terminated string, padded to LOG_BUFFER_ALIGN.
+ *
+ * @size: Size of this record including the header, or 0 to indicate that the
+ *	next record is at the start of the buffer
+ * @level: Log level (enum log_level_t)
+ * @flags: LOGBR_... flags
+ * @cat: Log category (enum log_category_t)
+ * @line: Line number where the record was generated
+ * @time_us: Timestamp in microseconds
+ * @file: Pointer to the filename
+ * @func: Pointer to the function name
+ * @fmt: Pointer to the printf() format string
+ */
+struct log_buffer_rec {
+	u16 size;
+	u8 level;
+	u8 flags;
+	u16 cat;
+	u16 spare;
+	u32 line;
+	u32 spare2;
+	u64 time_us;
+	u64 file;
+	u64 func;
+	u64 fmt;
+};
+
+/* Types of argument consumed by a printf() conversion */
+enum log_buffer_arg {
+	LBA_NONE,	/* No argument, e.g. %% */
+	LBA_INT,
+	LBA_LONG,
+	LBA_LLONG,
+	LBA_PTR,
+	LBA_STR,
+	LBA_UNSUPP,	/* Cannot be deferred, e.g. %pM */
+};
+
+/**
+ * log_buffer_parse_spec() - Parse a single printf() conversion specification
+ *
+ * @p: Pointer to the '%' character
+ * @stars: Returns the number of '*' width/precision arguments (0 to 2)
+ * @typep: Returns the type of argument consumed by the conversion
+ * @return pointer to the character following the conversion
+ */
+static const char *log_buffer_parse_spec(const char *p, int *stars,
+					 enum log_buffer_arg *typep)
+{
+	int qualifier = 0;
+
+	*stars = 0;
+	p++;
+	while (*p && strchr("-+ #0", *p))
+		p++;
+	if (*p == '*') {
+		(*stars)++;
+		p++;
+	}
+	while (isdigit(*p))
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			(*stars)++;
+			p++;
+		}
+		while (isdigit(*p))
+			p++;
+	}
+	if (*p && strchr("hlLqzjt", *p)) {
+		qualifier = *p++;
+		if (qualifier == *p && (qualifier == 'l' || qualifier == 'h')) {
+			qualifier = qualifier == 'l' ? 'L' : 'h';
+			p++;
+		}
+	}
+
+	switch (*p) {
+	case '%':
+		*typep = LBA_NONE;
+		break;
+	case 'c':
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		if (qualifier == 'L' || qualifier == 'q' || qualifier == 'j')
+			*typep = LBA_LLONG;
+		else if (qualifier == 'l' || qualifier == 'z' ||
+			 qualifier == 't')
+			*typep = LBA_LONG;
+		else
+			*typep = LBA_INT;
+		break;
+	case 'p':
+		/* Extended formats such as %pM dereference the pointer */
+		*typep = isalnum(p[1]) ? LBA_UNSUPP : LBA_PTR;
+		break;
+	case 's':
+		*typep = qualifier ? LBA_UNSUPP : LBA_STR;
+		break;
+	default:
+		*typep = LBA_UNSUPP;
+		break;
+	}
+	if (*p)
+		p++;
+
+	return p;
+}
+
+/**
+ * log_buffer_encode() - Encode the arguments of a log record
+ *
+ * @fmt: Format string
+ * @args: Arguments for @fmt
+ * @buf: Buffer to write the encoded arguments into
+ * @size: Size of @buf
+ * @return number of bytes written, or -E2BIG if @buf is too small, or
+ *	-ENOTSUPP if @fmt contains a conversion which cannot be deferred
+ */
+static int log_buffer_encode(const char *fmt, va_list args, char *buf,
+			     int size)
+{
+	enum log_buffer_arg type;
+	char *ptr = buf;
+	const char *p;
+	int stars;
+	u64 val;
+	int len;
+
+	for (p = fmt; *p;) {
+		if (*p != '%') {
+			p++;
+			continue;
+		}
+		p = log_buffer_parse_spec(p, &stars, &type);
+		if (type == LBA_UNSUPP)
+			return -ENOTSUPP;
+		for (; stars; stars--) {
+			if (ptr + sizeof(u64) > buf + size)
+				return -E2BIG;
+			*(u64 *)ptr = va_arg(args, int);
+			ptr += sizeof(u64);
+		}
+		switch (type) {
+		case LBA_NONE:
+		case LBA_UNSUPP:
+			continue;
+		case LBA_INT:
+			val = va_arg(args, unsigned int);
+			break;
+		case LBA_LONG:
+			val = va_arg(args, unsigned long);
+			break;
+		case LBA_LLONG:
+			val = va_arg(args, unsigned long long);
+			break;
+		case LBA_PTR:
+			val = (ulong)va_arg(args, void *);
+			break;
+		case LBA_STR: {
+			const char *str = va_arg(args, const char *);
+
+			if (!str)
+				str = "<NULL>";
+			len = strlen(str) + 1;
+			if (ptr + sizeof(u32) + len > buf + size)
+				return -E2BIG;
+			*(u32 *)ptr = len;
+			memcpy(ptr + sizeof(u32), str, len);
+			ptr += ALIGN(sizeof(u32) + len, LOG_BUFFER_ALIGN);
+			continue;
+		}
+		}
+		if (ptr + sizeof(u64) > buf + size)
+			return -E2BIG;
+		*(u64 *)ptr = val;
+		ptr += sizeof(u64);
+	}
+
+	return ptr - buf;
+}
+
+/**
+ * log_buffer_decode() - Format a record from its encoded arguments
+ *
+ * Each conversion in @fmt is copied into a small spec string, with any '*'
+ * replaced by the stored value, and formatted with its own stored argument
+ *
+ * @fmt: Format string
+ * @data: Encoded arguments, as written by log_buffer_encode()
+ * @end: End of encoded arguments
+ * @buf: Buffer for the formatted message
+ * @size: Size of @buf
+ */
+static void log_buffer_decode(const char *fmt, const char *data,
+			      const char *end, char *buf, int size)
+{
+	char spec[LOG_BUFFER_MAX_SPEC];
+	enum log_buffer_arg type;
+	const char *p, *next;
+	int len = 0;
+	int stars;
+	int pos;
+	u64 val;
+
+	for (p = fmt; *p && len < size - 1;) {
+		if (*p != '%') {
+			buf[len++] = *p++;
+			continue;
+		}
+		next = log_buffer_parse_spec(p, &stars, &type);
+		if (type == LBA_NONE) {
+			buf[len++] = '%';
+			p = next;
+			continue;
+		}
+
+		/* Build a spec string with the '*' values filled in */
+		for (pos = 0; p < next && pos < sizeof(spec) - 12; p++) {
+			if (*p == '*' && data + sizeof(u64) <= end) {
+				pos += snprintf(spec + pos, sizeof(spec) - pos,
+						"%d", (int)*(u64 *)data);
+				data += sizeof(u64);
+			} else {
+				spec[pos++] = *p;
+			}
+		}
+		spec[pos] = '\0';
+		p = next;
+
+		if (type == LBA_STR) {
+			if (data + sizeof(u32) > end)
+				break;
+			len += snprintf(buf + len, size - len, spec,
+					data + sizeof(u32));
+			data += ALIGN(sizeof(u32) + *(u32 *)data,
+				      LOG_BUFFER_ALIGN);
+			continue;
+		}
+		if (data + sizeof(u64) > end)
+			break;
+		val = *(u64 *)data;
+		data += sizeof(u64);
+		switch (type) {
+		case LBA_INT:
+			len += snprintf(buf + len, size - len, spec, (uint)val);
+			break;
+		case LBA_LONG:
+			len += snprintf(buf + len, size - len, spec, (ulong)val);
+			break;
+		case LBA_LLONG:
+			len += snprintf(buf + len, size - len, spec,
+					(unsigned long long)val);
+			break;
+		case LBA_PTR:
+			len += snprintf(buf + len, size - len, spec,
+					(void *)(ulong)val);
+			break;
+		default:
+			break;
+		}
+	}
+	buf[min(len, size - 1)] = '\0';
+}
+
+static struct log_buffer_rec *log_buffer_rec_at(struct log_buffer_hdr *hdr,
+						uint offset)
+{
+	return (void *)(hdr + 1) + offset;
+}
+
+/* Drop the oldest record in the buffer */
+static void log_buffer_drop(struct log_buffer_hdr *hdr)
+{
+	struct log_buffer_rec *rec;
+
+	if (hdr->tail + sizeof(*rec) > hdr->size) {
+		hdr->tail = 0;
+		return;
+	}
+	rec = log_buffer_rec_at(hdr, hdr->tail);
+	if (!rec->size) {
+		hdr->tail = 0;
+		return;
+	}
+	hdr->tail += rec->size;
+	if (!--hdr->count)
+		hdr->tail = hdr->head;
+}
+
+/**
+ * log_buffer_reserve() - Make room for a new record, dropping old ones
+ *
+ * @hdr: Log buffer
+ * @size: Size of the record in bytes (aligned to LOG_BUFFER_ALIGN)
+ * @return pointer to the space for the record, or NULL if it is too large
+ */
+static struct log_buffer_rec *log_buffer_reserve(struct log_buffer_hdr *hdr,
+						 uint size)
+{
+	struct log_buffer_rec *rec;
+
+	if (size > hdr->size / 2)
+		return NULL;
+	if (hdr->head + size > hdr->size) {
+		/* Drop everything between the head and the end of the buffer */
+		while (hdr->count && hdr->tail >= hdr->head) {
+			log_buffer_drop(hdr);
+			hdr->dropped++;
+		}
+		if (!hdr->count) {
+			hdr->tail = 0;
+		} else if (hdr->head + sizeof(*rec) <= hdr->size) {
+			rec = log_buffer_rec_at(hdr, hdr->head);
+			rec->size = 0;
+		}
+		hdr->head = 0;
+	}
+	while (hdr->count && hdr->tail >= hdr->head &&
+	       hdr->tail < hdr->head + size) {
+		log_buffer_drop(hdr);
+		hdr->dropped++;
+	}
+	rec = log_buffer_rec_at(hdr, hdr->head);
+	hdr->head += size;
+	if (!hdr->count)
+		hdr->tail = hdr->head - size;
+	hdr->count++;
+
+	return rec;
+}
+
+/**
+ * log_buffer_get() - Get the log buffer, setting it up if needed
+ *
+ * With CONFIG_LOG_BUFFER_BLOBLIST the buffer is placed in the bloblist, so
+ * that it survives relocation and can be passed on to the OS. Records
+ * generated before the bloblist is set up are dropped.
+ *
+ * @ldev: Log device
+ * @return log buffer, or NULL if not available
+ */
+static struct log_buffer_hdr *log_buffer_get(struct log_device *ldev)
+{
+	const int size = CONFIG_LOG_BUFFER_SIZE;
+	struct log_buffer_hdr *hdr;
+
+	if (ldev->priv)
+		return IS_ERR(ldev->priv) ? NULL : ldev->priv;
+
+	if (IS_ENABLED(CONFIG_LOG_BUFFER_BLOBLIST)) {
+		if (!gd->bloblist)
+			return NULL;
+		/* Stop any records logged by the bloblist code coming here */
+		ldev->priv = ERR_PTR(-EBUSY);
+		hdr = bloblist_ensure(BLOBLISTT_LOG_BUFFER, size);
+	} else {
+		ldev->priv = ERR_PTR(-EBUSY);
+		hdr = malloc(size);
+		if (hdr)
+			hdr->magic = 0;
+	}
+	if (!hdr) {
+		ldev->priv = ERR_PTR(-ENOMEM);
+		return NULL;
+	}
+	if (hdr->magic != LOG_BUFFER_MAGIC) {
+		memset(hdr, '\0', sizeof(*hdr));
+		hdr->magic = LOG_BUFFER_MAGIC;
+		hdr->size = size - sizeof(*hdr);
+	}
+	hdr->flags &= ~LOGBH_BUSY;
+	ldev->priv = hdr;
+
+	return hdr;
+}
+
+static int log_buffer_emit(struct log_device *ldev, struct log_rec *rec)
+{
+	char data[CONFIG_LOG_BUFFER_MAX_REC];
+	struct log_buffer_hdr *hdr;
+	struct log_buffer_rec *brec;
+	va_list args;
+	int flags = 0;
+	u64 time_us;
+	int len;
+
+	hdr = log_buffer_get(ldev);
+	if (!hdr || (hdr->flags & LOGBH_BUSY))
+		return -ENOSPC;
+	hdr->flags |= LOGBH_BUSY;
+	time_us = timer_get_us();
+
+	if (rec->msg) {
+		len = -ENOTSUPP;
+	} else {
+		va_copy(args, *rec->args);
+		len = log_buffer_encode(rec->fmt, args, data, sizeof(data));
+		va_end(args);
+	}
+	if (len < 0) {
+		/* Fall back to storing the formatted message */
+		flags |= LOGBR_TEXT;
+		if (rec->msg) {
+			strlcpy(data, rec->msg, sizeof(data));
+		} else {
+			va_copy(args, *rec->args);
+			vsnprintf(data, sizeof(data), rec->fmt, args);
+			va_end(args);
+		}
+		len = strlen(data) + 1;
+	}
+	if (gd->flags & GD_FLG_RELOC)
+		flags |= LOGBR_RELOC;
+
+	brec = log_buffer_reserve(hdr, ALIGN(sizeof(*brec) + len,
+					     LOG_BUFFER_ALIGN));
+	if (!brec) {
+		hdr->flags &= ~LOGBH_BUSY;
+		return -E2BIG;
+	}
+	brec->size = ALIGN(sizeof(*brec) + len, LOG_BUFFER_ALIGN);
+	brec->level = rec->level;
+	brec->flags = flags;
+	brec->cat = rec->cat;
+	brec->line = rec->line;
+	brec->time_us = time_us;
+	brec->file = (ulong)rec->file;
+	brec->func = (ulong)rec->func;
+	brec->fmt = (ulong)rec->fmt;
+	memcpy(brec + 1, data, len);
+	hdr->reloc_off = gd->reloc_off;
+	hdr->flags &= ~LOGBH_BUSY;
+
+	return 0;
+}
+
+static struct log_device *log_buffer_find(void)
+{
+	struct log_device *ldev;
+
+	list_for_each_entry(ldev, &gd->log_head, sibling_node) {
+		if (!strcmp(ldev->drv->name, "buffer"))
+			return ldev;
+	}
+
+	return NULL;
+}
+
+/* Convert a pointer stored in a record to one we can use */
+static const char *log_buffer_ptr(struct log_buffer_rec *brec, u64 ptr)
+{
+	if (!(brec->flags & LOGBR_RELOC) && (gd->flags & GD_FLG_RELOC))
+		ptr += gd->reloc_off;
+
+	return (const char *)(ulong)ptr;
+}
+
+int log_buffer_dump(void)
+{
+	struct log_driver *console = NULL;
+	struct log_buffer_rec *brec;
+	struct log_buffer_hdr *hdr;
+	struct log_device *ldev;
+	char buf[CONFIG_SYS_CBSIZE];
+	struct log_rec rec;
+	uint offset;
+	uint i;
+
+	ldev = log_buffer_find();
+	hdr = ldev ? log_buffer_get(ldev) : NULL;
+	if (!hdr)
+		return -ENOENT;
+#if CONFIG_IS_ENABLED(LOG_CONSOLE)
+	console = ll_entry_get(struct log_driver, console, log_driver);
+#endif
+
+	hdr->flags |= LOGBH_BUSY;
+	offset = hdr->tail;
+	for (i = 0; i < hdr->count; i++) {
+		brec = log_buffer_rec_at(hdr, offset);
+		if (offset + sizeof(*brec) > hdr->size || !brec->size) {
+			offset = 0;
+			brec = log_buffer_rec_at(hdr, offset);
+		}
+		offset += brec->size;
+
+		memset(&rec, '\0', sizeof(rec));
+		rec.cat = brec->cat;
+		rec.level = brec->level;
+		rec.file = log_buffer_ptr(brec, brec->file);
+		rec.line = brec->line;
+		rec.func = log_buffer_ptr(brec, brec->func);
+		rec.fmt = log_buffer_ptr(brec, brec->fmt);
+		if (brec->flags & LOGBR_TEXT) {
+			rec.msg = (char *)(brec + 1);
+		} else {
+			log_buffer_decode(rec.fmt, (char *)(brec + 1),
+					  (char *)brec + brec->size, buf,
+					  sizeof(buf));
+			rec.msg = buf;
+		}
+		printf("[%5lu.%06lu] ", (ulong)(brec->time_us / 1000000),
+		       (ulong)(brec->time_us % 1000000));
+		if (console)
+			console->emit(ldev, &rec);
+		else
+			printf("%s", rec.msg);
+	}
+	if (hdr->dropped)
+		printf("(%u records dropped)\n", hdr->dropped);
+	hdr->flags &= ~LOGBH_BUSY;
+
+	return 0;
+}
+
+int log_buffer_clear(void)
+{
+	struct log_buffer_hdr *hdr;
+	struct log_device *ldev;
+
+	ldev = log_buffer_find();
+	hdr = ldev ? log_buffer_get(ldev) : NULL;
+	if (!hdr)
+		return -ENOENT;
+	hdr->head = 0;
+	hdr->tail = 0;
+	hdr->count = 0;
+	hdr->dropped = 0;
+
+	return 0;
+}
+
+/*
+ * Keep records down to CONFIG_LOG_BUFFER_LEVEL, whatever the default log level
+ * used by the console
+ */
+static int log_buffer_probe(struct log_device *ldev)
+{
+	int ret;
+
+	ret = log_add_filter(ldev->drv->name, NULL, CONFIG_LOG_BUFFER_LEVEL,
+			     NULL);
+
+	return ret < 0 ? ret : 0;
+}
+
+LOG_DRIVER(buffer) = {
+	.name	= "buffer",
+	.flags	= LOGDF_DEFER_FMT,
+	.emit	= log_buffer_emit,
+	.probe	= log_buffer_probe,
+};
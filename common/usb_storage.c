@@ -36,6 +36,7 @@
 #include <command.h>
 #include <dm.h>
 #include <errno.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <memalign.h>
 #include <asm/byteorder.h>
@@ -56,16 +57,29 @@
 static const unsigned char us_direction[256/8] = {
 	0x28, 0x81, 0x14, 0x14, 0x20, 0x01, 0x90, 0x77,
 	0x0C, 0x20, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01,
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 #define US_DIRECTION(x) ((us_direction[x>>3] >> (x & 7)) & 1)
 
+/*
+ * SCSI READ(16) and WRITE(16) opcodes. SCSI_READ16 in scsi.h is only used
+ * between U-Boot's SCSI and AHCI layers and is not the value on the wire.
+ */
+#define USB_STOR_READ16		0x88
+#define USB_STOR_WRITE16	0x8a
+
 static struct scsi_cmd usb_ccb __aligned(ARCH_DMA_MINALIGN);
 static __u32 CBWTag;
 
 static int usb_max_devs; /* number of highest available usb device */
 
+#if CONFIG_IS_ENABLED(BLOCK_CACHE) && CONFIG_USB_STORAGE_READAHEAD
+/* Buffer for reads which include blocks to read ahead */
+static void *usb_ra_buf;
+static size_t usb_ra_size;
+#endif
+
 #if !CONFIG_IS_ENABLED(BLK)
 static struct blk_desc usb_dev_desc[USB_MAX_STOR_DEV];
 #endif
@@ -74,6 +88,25 @@ struct us_data;
 typedef int (*trans_cmnd)(struct scsi_cmd *cb, struct us_data *data);
 typedef int (*trans_reset)(struct us_data *data);
 
+/**
+ * struct us_stats - transfer counters for a mass-storage device
+ *
+ * @read_cmds: READ commands sent
+ * @read_blks: Blocks read, including those read ahead
+ * @ra_blks: Blocks read ahead into the block cache
+ * @write_cmds: WRITE commands sent
+ * @write_blks: Blocks written
+ * @retries: Commands which failed and were sent again
+ */
+struct us_stats {
+	u32 read_cmds;
+	u64 read_blks;
+	u64 ra_blks;
+	u32 write_cmds;
+	u64 write_blks;
+	u32 retries;
+};
+
 struct us_data {
 	struct usb_device *pusb_dev;	 /* this usb_device */
 
@@ -96,7 +129,9 @@ struct us_data {
 	struct scsi_cmd	*srb;			/* current srb */
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
-	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
+	unsigned long	max_xfer_blk;		/* maximum transfer blocks */
+	lbaint_t	next_blk;		/* block after the last read */
+	struct us_stats	stats;			/* transfer counters */
 };
 
 #if !CONFIG_IS_ENABLED(BLK)
@@ -129,6 +164,19 @@ static void usb_show_progress(void)
 	debug(".");
 }
 
+static void usb_stor_show_stats(struct usb_device *udev)
+{
+	struct us_data *ss;
+
+	if (!udev || !udev->privptr)
+		return;
+	ss = udev->privptr;
+	printf("            Read: %u commands, %llu blocks (%llu read ahead)\n",
+	       ss->stats.read_cmds, ss->stats.read_blks, ss->stats.ra_blks);
+	printf("            Write: %u commands, %llu blocks, %u retries\n",
+	       ss->stats.write_cmds, ss->stats.write_blks, ss->stats.retries);
+}
+
 /*******************************************************************************
  * show info on storage devices; 'usb start/init' must be invoked earlier
  * as we only retrieve structures populated during devices initialization
@@ -146,6 +194,7 @@ int usb_stor_info(void)
 
 		printf("  Device %d: ", desc->devnum);
 		dev_print(desc);
+		usb_stor_show_stats(dev_get_parent_priv(dev_get_parent(dev)));
 		count++;
 	}
 #else
@@ -155,6 +204,7 @@ int usb_stor_info(void)
 		for (i = 0; i < usb_max_devs; i++) {
 			printf("  Device %d: ", i);
 			dev_print(&usb_dev_desc[i]);
+			usb_stor_show_stats(usb_dev_desc[i].priv);
 		}
 		return 0;
 	}
@@ -954,16 +1004,19 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	 * Windows 7 limiting transfers to 128 sectors for both USB2 and USB3
 	 * and Apple Mac OS X 10.11 limiting transfers to 256 sectors for USB2
 	 * and 2048 for USB3 devices.
+	 *
+	 * Boards which only need to work with newer devices can raise the
+	 * limit with CONFIG_USB_STORAGE_MAX_XFER_BLK.
 	 */
-	unsigned short blk = 240;
+	unsigned long blk = CONFIG_USB_STORAGE_MAX_XFER_BLK;
 
 #if CONFIG_IS_ENABLED(DM_USB)
 	size_t size;
 	int ret;
 
-	ret = usb_get_max_xfer_size(udev, (size_t *)&size);
-	if ((ret >= 0) && (size < blk * 512))
-		blk = size / 512;
+	ret = usb_get_max_xfer_size(udev, &size);
+	if ((ret >= 0) && (size / 512 < blk))
+		blk = max_t(size_t, size / 512, 1);
 #endif
 
 	us->max_xfer_blk = blk;
@@ -1096,6 +1149,41 @@ static int usb_write_10(struct scsi_cmd *srb, struct us_data *ss,
 	return ss->transport(srb, ss);
 }
 
+/* Set up a READ(16) or WRITE(16), for transfers which READ(10) cannot do */
+static int usb_rw_16(struct scsi_cmd *srb, struct us_data *ss, u8 opcode,
+		     u64 start, u32 blocks)
+{
+	int i;
+
+	memset(&srb->cmd[0], 0, 16);
+	srb->cmd[0] = opcode;
+	for (i = 0; i < 8; i++)
+		srb->cmd[2 + i] = start >> (56 - i * 8);
+	for (i = 0; i < 4; i++)
+		srb->cmd[10 + i] = blocks >> (24 - i * 8);
+	srb->cmdlen = 16;
+	debug("rw16: cmd %x start %llx blocks %x\n", opcode, start, blocks);
+	return ss->transport(srb, ss);
+}
+
+static int usb_read_blocks(struct scsi_cmd *srb, struct us_data *ss,
+			   lbaint_t start, unsigned long blocks)
+{
+	if ((u64)start + blocks - 1 > 0xffffffffULL || blocks > 0xffff)
+		return usb_rw_16(srb, ss, USB_STOR_READ16, start, blocks);
+
+	return usb_read_10(srb, ss, start, blocks);
+}
+
+static int usb_write_blocks(struct scsi_cmd *srb, struct us_data *ss,
+			    lbaint_t start, unsigned long blocks)
+{
+	if ((u64)start + blocks - 1 > 0xffffffffULL || blocks > 0xffff)
+		return usb_rw_16(srb, ss, USB_STOR_WRITE16, start, blocks);
+
+	return usb_write_10(srb, ss, start, blocks);
+}
+
 
 #ifdef CONFIG_USB_BIN_FIXUP
 /*
@@ -1120,6 +1208,132 @@ static void usb_bin_fixup(struct usb_device_descriptor descriptor,
 }
 #endif /* CONFIG_USB_BIN_FIXUP */
 
+/*
+ * Read blocks in chunks of at most max_xfer_blk, returning the number of
+ * blocks read
+ */
+static lbaint_t usb_stor_read_chunks(struct us_data *ss,
+				     struct blk_desc *block_dev,
+				     lbaint_t start, lbaint_t blkcnt,
+				     uintptr_t buf_addr)
+{
+	struct scsi_cmd *srb = &usb_ccb;
+	unsigned long smallblks;
+	lbaint_t blks;
+	int retry;
+
+	srb->lun = block_dev->lun;
+	blks = blkcnt;
+	do {
+		/* XXX need some comment here */
+		retry = 2;
+		if (blks > ss->max_xfer_blk)
+			smallblks = ss->max_xfer_blk;
+		else
+			smallblks = blks;
+retry_it:
+		if (smallblks == ss->max_xfer_blk)
+			usb_show_progress();
+		srb->datalen = block_dev->blksz * smallblks;
+		srb->pdata = (unsigned char *)buf_addr;
+		ss->stats.read_cmds++;
+		if (usb_read_blocks(srb, ss, start, smallblks)) {
+			debug("Read ERROR\n");
+			ss->flags &= ~USB_READY;
+			usb_request_sense(srb, ss);
+			if (retry--) {
+				ss->stats.retries++;
+				goto retry_it;
+			}
+			blkcnt -= blks;
+			break;
+		}
+		start += smallblks;
+		blks -= smallblks;
+		buf_addr += srb->datalen;
+		ss->stats.read_blks += smallblks;
+	} while (blks != 0);
+
+	debug("usb_read: end startblk " LBAF ", blccnt %lx buffer %lx\n",
+	      start, smallblks, buf_addr);
+
+	return blkcnt;
+}
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE) && CONFIG_USB_STORAGE_READAHEAD
+/*
+ * If this small read follows on from the last one, read the blocks after it
+ * as well and put them in the block cache, so that the reads which follow
+ * are found there. Returns the number of blocks read into @buffer, or 0 if
+ * this read is not worth reading ahead for.
+ */
+static lbaint_t usb_stor_readahead(struct us_data *ss,
+				   struct blk_desc *block_dev,
+				   lbaint_t blknr, lbaint_t blkcnt,
+				   void *buffer)
+{
+	lbaint_t ra, count, chunk, pos;
+	unsigned blocks, entries;
+	size_t size;
+
+	if (blknr != ss->next_blk || blkcnt >= CONFIG_USB_STORAGE_READAHEAD ||
+	    blknr + blkcnt >= block_dev->lba)
+		return 0;
+
+	/*
+	 * Only fill half the cache, so that read-ahead does not push out
+	 * what the filesystem has read before
+	 */
+	blkcache_get_config(&blocks, &entries);
+	chunk = blocks;
+	ra = min_t(lbaint_t, CONFIG_USB_STORAGE_READAHEAD - blkcnt,
+		   chunk * max(entries / 2, 1U));
+	if (blknr + blkcnt + ra > block_dev->lba)
+		ra = block_dev->lba - blknr - blkcnt;
+	/* Read whole cache entries, so the next miss is sequential again */
+	if (!chunk)
+		return 0;
+	ra -= ra % chunk;
+	if (!ra)
+		return 0;
+
+	size = (blkcnt + ra) * block_dev->blksz;
+	if (size > usb_ra_size) {
+		free(usb_ra_buf);
+		usb_ra_size = 0;
+		usb_ra_buf = memalign(ARCH_DMA_MINALIGN, size);
+		if (!usb_ra_buf)
+			return 0;
+		usb_ra_size = size;
+	}
+
+	count = usb_stor_read_chunks(ss, block_dev, blknr, blkcnt + ra,
+				     (uintptr_t)usb_ra_buf);
+	if (!count)
+		return 0;
+	memcpy(buffer, usb_ra_buf, min(count, blkcnt) * block_dev->blksz);
+	ss->next_blk = blknr + count;
+
+	for (pos = blkcnt; pos + chunk <= count; pos += chunk) {
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      blknr + pos, chunk, block_dev->blksz,
+			      usb_ra_buf + pos * block_dev->blksz);
+		ss->stats.ra_blks += chunk;
+	}
+	debug("usb_read: read ahead " LBAFU " blocks\n", pos - blkcnt);
+
+	return min(count, blkcnt);
+}
+#else
+static lbaint_t usb_stor_readahead(struct us_data *ss,
+				   struct blk_desc *block_dev,
+				   lbaint_t blknr, lbaint_t blkcnt,
+				   void *buffer)
+{
+	return 0;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 static unsigned long usb_stor_read(struct udevice *dev, lbaint_t blknr,
 				   lbaint_t blkcnt, void *buffer)
@@ -1128,13 +1342,9 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 				   lbaint_t blkcnt, void *buffer)
 #endif
 {
-	lbaint_t start, blks;
-	uintptr_t buf_addr;
-	unsigned short smallblks;
 	struct usb_device *udev;
 	struct us_data *ss;
-	int retry;
-	struct scsi_cmd *srb = &usb_ccb;
+	lbaint_t count;
 #if CONFIG_IS_ENABLED(BLK)
 	struct blk_desc *block_dev;
 #endif
@@ -1158,49 +1368,22 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
-	srb->lun = block_dev->lun;
-	buf_addr = (uintptr_t)buffer;
-	start = blknr;
-	blks = blkcnt;
 
 	debug("\nusb_read: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
-	      block_dev->devnum, start, blks, buf_addr);
-
-	do {
-		/* XXX need some comment here */
-		retry = 2;
-		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > ss->max_xfer_blk)
-			smallblks = ss->max_xfer_blk;
-		else
-			smallblks = (unsigned short) blks;
-retry_it:
-		if (smallblks == ss->max_xfer_blk)
-			usb_show_progress();
-		srb->datalen = block_dev->blksz * smallblks;
-		srb->pdata = (unsigned char *)buf_addr;
-		if (usb_read_10(srb, ss, start, smallblks)) {
-			debug("Read ERROR\n");
-			ss->flags &= ~USB_READY;
-			usb_request_sense(srb, ss);
-			if (retry--)
-				goto retry_it;
-			blkcnt -= blks;
-			break;
-		}
-		start += smallblks;
-		blks -= smallblks;
-		buf_addr += srb->datalen;
-	} while (blks != 0);
+	      block_dev->devnum, blknr, blkcnt, (uintptr_t)buffer);
 
-	debug("usb_read: end startblk " LBAF ", blccnt %x buffer %lx\n",
-	      start, smallblks, buf_addr);
+	count = usb_stor_readahead(ss, block_dev, blknr, blkcnt, buffer);
+	if (!count) {
+		count = usb_stor_read_chunks(ss, block_dev, blknr, blkcnt,
+					     (uintptr_t)buffer);
+		ss->next_blk = blknr + count;
+	}
 
 	usb_lock_async(udev, 0);
 	usb_disable_asynch(0); /* asynch transfer allowed */
 	if (blkcnt >= ss->max_xfer_blk)
 		debug("\n");
-	return blkcnt;
+	return count;
 }
 
 #if CONFIG_IS_ENABLED(BLK)
@@ -1213,7 +1396,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned long smallblks;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1242,6 +1425,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
+	ss->next_blk = -1;
 
 	srb->lun = block_dev->lun;
 	buf_addr = (uintptr_t)buffer;
@@ -1260,27 +1444,31 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 		if (blks > ss->max_xfer_blk)
 			smallblks = ss->max_xfer_blk;
 		else
-			smallblks = (unsigned short) blks;
+			smallblks = blks;
 retry_it:
 		if (smallblks == ss->max_xfer_blk)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (usb_write_10(srb, ss, start, smallblks)) {
+		ss->stats.write_cmds++;
+		if (usb_write_blocks(srb, ss, start, smallblks)) {
 			debug("Write ERROR\n");
 			ss->flags &= ~USB_READY;
 			usb_request_sense(srb, ss);
-			if (retry--)
+			if (retry--) {
+				ss->stats.retries++;
 				goto retry_it;
+			}
 			blkcnt -= blks;
 			break;
 		}
 		start += smallblks;
 		blks -= smallblks;
 		buf_addr += srb->datalen;
+		ss->stats.write_blks += smallblks;
 	} while (blks != 0);
 
-	debug("usb_write: end startblk " LBAF ", blccnt %x buffer %lx\n",
+	debug("usb_write: end startblk " LBAF ", blccnt %lx buffer %lx\n",
 	      start, smallblks, buf_addr);
 
 	usb_lock_async(udev, 0);
@@ -1409,6 +1597,7 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 
 	/* Set the maximum transfer size per host controller setting */
 	usb_stor_set_max_xfer_blk(dev, ss);
+	ss->next_blk = -1;
 
 	dev->privptr = (void *)ss;
 	return 1;
@@ -183,3 +183,9 @@ void blkcache_stats(struct block_cache_stats *stats)
 	_stats.hits = 0;
 	_stats.misses = 0;
 }
+
+void blkcache_get_config(unsigned *blocks, unsigned *entries)
+{
+	*blocks = _stats.max_blocks_per_entry;
+	*entries = _stats.max_entries;
+}
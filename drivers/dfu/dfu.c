@@ -165,13 +165,18 @@ done:
 }
 
 static unsigned char *dfu_buf;
+static unsigned char *dfu_buf2;
 static unsigned long dfu_buf_size;
 static enum dfu_device_type dfu_buf_device_type;
+/* Entity with a full buffer waiting for dfu_drain_step() */
+static struct dfu_entity *dfu_drain_entity;
 
 unsigned char *dfu_free_buf(void)
 {
 	free(dfu_buf);
+	free(dfu_buf2);
 	dfu_buf = NULL;
+	dfu_buf2 = NULL;
 	return dfu_buf;
 }
 
@@ -206,6 +211,14 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 		printf("%s: Could not memalign 0x%lx bytes\n",
 		       __func__, dfu_buf_size);
 
+	/* Without a second buffer, dfu_write() just drains synchronously */
+	if (IS_ENABLED(CONFIG_DFU_DOUBLE_BUFFER) && dfu_buf) {
+		dfu_buf2 = memalign(CONFIG_SYS_CACHELINE_SIZE, dfu_buf_size);
+		if (!dfu_buf2)
+			debug("%s: No second buffer, draining synchronously\n",
+			      __func__);
+	}
+
 	dfu_buf_device_type = dfu->dev_type;
 	return dfu_buf;
 }
@@ -218,7 +231,7 @@ static char *dfu_get_hash_algo(void)
 	if (!s)
 		return NULL;
 
-	if (!strcmp(s, "crc32")) {
+	if (!strcmp(s, "crc32") || !strcmp(s, "sha256")) {
 		debug("%s: DFU hash method: %s\n", __func__, s);
 		return s;
 	}
@@ -227,20 +240,103 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+static void dfu_hash_update(struct dfu_entity *dfu, const void *buf, int size)
+{
+	if (dfu->hash_ctx)
+		dfu_hash_algo->hash_update(dfu_hash_algo, dfu->hash_ctx, buf,
+					   size, 0);
+}
+
+/* Print the hash of the data written or read, and free its context */
+static void dfu_hash_finish(struct dfu_entity *dfu, const char *what)
+{
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+	int i;
+
+	if (!dfu->hash_ctx)
+		return;
+
+	if (dfu_hash_algo->hash_finish(dfu_hash_algo, dfu->hash_ctx, digest,
+				       sizeof(digest))) {
+		dfu->hash_ctx = NULL;
+		return;
+	}
+	dfu->hash_ctx = NULL;
+
+	printf("\n%s %s: ", what, dfu_hash_algo->name);
+	if (!strcmp(dfu_hash_algo->name, "crc32")) {
+		printf("0x%08x\n", *(u32 *)digest);
+		return;
+	}
+	for (i = 0; i < dfu_hash_algo->digest_size; i++)
+		printf("%02x", digest[i]);
+	putc('\n');
+}
+
+/**
+ * dfu_drain_chunk() - write the next part of the buffer waiting to drain
+ *
+ * @dfu: Entity with a buffer waiting
+ * @return 0 if OK, -ve on error
+ */
+static int dfu_drain_chunk(struct dfu_entity *dfu)
+{
+	long w_size = dfu->d_left;
+	int ret;
+
+	if (dfu->drain_chunk && w_size > dfu->drain_chunk)
+		w_size = dfu->drain_chunk;
+
+	ret = dfu->write_medium(dfu, dfu->offset, dfu->d_buf, &w_size);
+	if (ret) {
+		debug("%s: Write error!\n", __func__);
+		dfu->d_ret = ret;
+		dfu->d_left = 0;
+	} else {
+		dfu->offset += w_size;
+		dfu->d_buf += w_size;
+		dfu->d_left -= min(w_size, dfu->d_left);
+	}
+
+	if (!dfu->d_left) {
+		dfu_drain_entity = NULL;
+		puts("#");
+	}
+
+	return ret;
+}
+
+/* Finish writing out the buffer waiting to drain, if any */
+static int dfu_drain_finish(struct dfu_entity *dfu)
+{
+	while (dfu->d_left && !dfu->d_ret)
+		dfu_drain_chunk(dfu);
+
+	return dfu->d_ret;
+}
+
+int dfu_drain_step(void)
+{
+	if (!dfu_drain_entity)
+		return 0;
+
+	return dfu_drain_chunk(dfu_drain_entity);
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
 	int ret;
 
+	ret = dfu_drain_finish(dfu);
+	if (ret)
+		return ret;
+
 	/* flush size? */
 	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
-
 	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
 	if (ret)
 		debug("%s: Write error!\n", __func__);
@@ -256,10 +352,54 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 	return ret;
 }
 
+/**
+ * dfu_write_buffer_swap() - hand a full buffer over to be drained
+ *
+ * If there is a second buffer, the full one is left for dfu_drain_step()
+ * and dfu_write() carries on filling the other one. Otherwise, or while
+ * the previous buffer is still being drained, this writes synchronously.
+ *
+ * @dfu: Entity being written
+ * @return 0 if OK, -ve on error
+ */
+static int dfu_write_buffer_swap(struct dfu_entity *dfu)
+{
+	u8 *next;
+	int ret;
+
+	if (!dfu_buf2)
+		return dfu_write_buffer_drain(dfu);
+
+	ret = dfu_drain_finish(dfu);
+	if (ret)
+		return ret;
+
+	dfu->d_buf = dfu->i_buf_start;
+	dfu->d_left = dfu->i_buf - dfu->i_buf_start;
+	if (!dfu->d_left)
+		return 0;
+	dfu_drain_entity = dfu;
+
+	next = dfu->i_buf_start == dfu_buf ? dfu_buf2 : dfu_buf;
+	dfu->i_buf_start = next;
+	dfu->i_buf = next;
+	dfu->i_buf_end = next + dfu_get_buf_size();
+
+	return 0;
+}
+
 void dfu_transaction_cleanup(struct dfu_entity *dfu)
 {
 	/* clear everything */
-	dfu->crc = 0;
+	if (dfu->hash_ctx) {
+		free(dfu->hash_ctx);
+		dfu->hash_ctx = NULL;
+	}
+	if (dfu_drain_entity == dfu)
+		dfu_drain_entity = NULL;
+	dfu->d_buf = NULL;
+	dfu->d_left = 0;
+	dfu->d_ret = 0;
 	dfu->offset = 0;
 	dfu->i_blk_seq_num = 0;
 	dfu->i_buf_start = dfu_get_buf(dfu);
@@ -286,6 +426,10 @@ int dfu_transaction_initiate(struct dfu_entity *dfu, bool read)
 
 	dfu->i_buf_end = dfu->i_buf_start + dfu_get_buf_size();
 
+	if (dfu_hash_algo && dfu_hash_algo->hash_init(dfu_hash_algo,
+						      &dfu->hash_ctx))
+		dfu->hash_ctx = NULL;
+
 	if (read) {
 		ret = dfu->get_medium_size(dfu, &dfu->r_left);
 		if (ret < 0)
@@ -310,9 +454,7 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	if (dfu->flush_medium)
 		ret = dfu->flush_medium(dfu);
 
-	if (dfu_hash_algo)
-		printf("\nDFU complete %s: 0x%08x\n", dfu_hash_algo->name,
-		       dfu->crc);
+	dfu_hash_finish(dfu, "DFU complete");
 
 	dfu_flush_callback(dfu);
 
@@ -340,6 +482,13 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 		return -1;
 	}
 
+	/* report a failure to write out the previous buffer */
+	if (dfu->d_ret) {
+		ret = dfu->d_ret;
+		dfu_transaction_cleanup(dfu);
+		return ret;
+	}
+
 	/* DFU 1.1 standard says:
 	 * The wBlockNum field is a block sequence number. It increments each
 	 * time a block is transferred, wrapping to zero from 65,535. It is used
@@ -358,7 +507,7 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		ret = dfu_write_buffer_swap(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			return ret;
@@ -374,15 +523,22 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	}
 
 	memcpy(dfu->i_buf, buf, size);
+	dfu_hash_update(dfu, buf, size);
 	dfu->i_buf += size;
 
 	/* if end or if buffer full flush */
-	if (size == 0 || (dfu->i_buf + size) > dfu->i_buf_end) {
+	if (size == 0) {
 		ret = dfu_write_buffer_drain(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			return ret;
 		}
+	} else if ((dfu->i_buf + size) > dfu->i_buf_end) {
+		ret = dfu_write_buffer_swap(dfu);
+		if (ret) {
+			dfu_transaction_cleanup(dfu);
+			return ret;
+		}
 	}
 
 	return 0;
@@ -400,10 +556,7 @@ static int dfu_read_buffer_fill(struct dfu_entity *dfu, void *buf, int size)
 		/* consume */
 		if (chunk > 0) {
 			memcpy(buf, dfu->i_buf, chunk);
-			if (dfu_hash_algo)
-				dfu_hash_algo->hash_update(dfu_hash_algo,
-							   &dfu->crc, buf,
-							   chunk, 0);
+			dfu_hash_update(dfu, buf, chunk);
 
 			dfu->i_buf += chunk;
 			dfu->b_left -= chunk;
@@ -468,9 +621,7 @@ int dfu_read(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	}
 
 	if (ret < size) {
-		if (dfu_hash_algo)
-			debug("%s: %s %s: 0x%x\n", __func__, dfu->name,
-			      dfu_hash_algo->name, dfu->crc);
+		dfu_hash_finish(dfu, "UPLOAD complete");
 		puts("\nUPLOAD ... done\nCtrl+C to exit ...\n");
 
 		dfu_transaction_cleanup(dfu);
@@ -490,6 +641,7 @@ static int dfu_fill_entity(struct dfu_entity *dfu, char *s, int alt,
 
 	dfu->alt = alt;
 	dfu->max_buf_size = 0;
+	dfu->drain_chunk = 0;
 	dfu->free_entity = NULL;
 
 	/* Specific for mmc device */
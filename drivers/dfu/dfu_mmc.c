@@ -14,6 +14,10 @@
 #include <ext4fs.h>
 #include <fat.h>
 #include <mmc.h>
+#include <linux/sizes.h>
+
+/* Bytes written per dfu_drain_step() call for raw writes */
+#define DFU_MMC_DRAIN_CHUNK	SZ_128K
 
 static unsigned char *dfu_file_buf;
 static u64 dfu_file_buf_len;
@@ -416,6 +420,13 @@ int dfu_fill_entity_mmc(struct dfu_entity *dfu, char *devstr, char *s)
 	dfu->inited = 0;
 	dfu->free_entity = dfu_free_entity_mmc;
 
+	/*
+	 * Raw writes can be split at any block, so drain a full buffer in
+	 * steps rather than holding up the USB gadget for the whole write
+	 */
+	if (dfu->layout == DFU_RAW_ADDR)
+		dfu->drain_chunk = DFU_MMC_DRAIN_CHUNK;
+
 	/* Check if file buffer is ready */
 	if (!dfu_file_buf) {
 		dfu_file_buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
@@ -28,6 +28,11 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+/**
+ * fastboot_download_start - get_timer() value when the download started
+ */
+static ulong fastboot_download_start;
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -180,6 +185,7 @@ static void download(char *cmd_parameter, char *response)
 	} else {
 		printf("Starting download of %d bytes\n",
 		       fastboot_bytes_expected);
+		fastboot_download_start = get_timer(0);
 		fastboot_response("DATA", response, "%s", cmd_parameter);
 	}
 }
@@ -247,9 +253,16 @@ void fastboot_data_download(const void *fastboot_data,
  */
 void fastboot_data_complete(char *response)
 {
+	ulong time = get_timer(fastboot_download_start);
+
 	/* Download complete. Respond with "OKAY" */
 	fastboot_okay(NULL, response);
-	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
+	printf("\ndownloading of %d bytes finished in %lu ms",
+	       fastboot_bytes_received, time);
+	if (time)
+		printf(" (%lu KiB/s)",
+		       (ulong)(fastboot_bytes_received / time * 1000 / 1024));
+	putc('\n');
 	image_size = fastboot_bytes_received;
 	env_set_hex("filesize", image_size);
 	fastboot_bytes_expected = 0;
@@ -47,14 +47,13 @@ static void dwmci_set_idma_desc(struct dwmci_idmac *idmac,
 static void dwmci_prepare_data(struct dwmci_host *host,
 			       struct mmc_data *data,
 			       struct dwmci_idmac *cur_idmac,
-			       void *bounce_buffer)
+			       struct bounce_buffer *bbstate)
 {
 	unsigned long ctrl;
-	unsigned int i = 0, flags, cnt, blk_cnt;
-	ulong data_start, data_end;
-
-
-	blk_cnt = data->blocks;
+	unsigned int flags, cnt, max_cnt = data->blocksize * 8;
+	ulong data_start, data_end, addr;
+	size_t len;
+	int seg;
 
 	dwmci_wait_reset(host, DWMCI_CTRL_FIFO_RESET);
 
@@ -64,24 +63,25 @@ static void dwmci_prepare_data(struct dwmci_host *host,
 	data_start = (ulong)cur_idmac;
 	dwmci_writel(host, DWMCI_DBADDR, (ulong)cur_idmac);
 
-	do {
-		flags = DWMCI_IDMAC_OWN | DWMCI_IDMAC_CH ;
-		flags |= (i == 0) ? DWMCI_IDMAC_FS : 0;
-		if (blk_cnt <= 8) {
-			flags |= DWMCI_IDMAC_LD;
-			cnt = data->blocksize * blk_cnt;
-		} else
-			cnt = data->blocksize * 8;
-
-		dwmci_set_idma_desc(cur_idmac, flags, cnt,
-				    (ulong)bounce_buffer + (i * PAGE_SIZE));
-
-		cur_idmac++;
-		if (blk_cnt <= 8)
-			break;
-		blk_cnt -= 8;
-		i++;
-	} while(1);
+	/* Up to eight blocks per descriptor, for each piece of the buffer */
+	for (seg = 0; seg < bbstate->nsegs; seg++) {
+		addr = (ulong)bbstate->seg[seg].addr;
+		len = bbstate->seg[seg].len;
+		while (len) {
+			flags = DWMCI_IDMAC_OWN | DWMCI_IDMAC_CH;
+			if ((ulong)cur_idmac == data_start)
+				flags |= DWMCI_IDMAC_FS;
+			cnt = min_t(size_t, len, max_cnt);
+			if (cnt == len && seg == bbstate->nsegs - 1)
+				flags |= DWMCI_IDMAC_LD;
+
+			dwmci_set_idma_desc(cur_idmac, flags, cnt, addr);
+
+			cur_idmac++;
+			addr += cnt;
+			len -= cnt;
+		}
+	}
 
 	data_end = (ulong)cur_idmac;
 	flush_dcache_range(data_start, roundup(data_end, ARCH_DMA_MINALIGN));
@@ -248,7 +248,8 @@ static int dwmci_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 #endif
 	struct dwmci_host *host = mmc->priv;
 	ALLOC_CACHE_ALIGN_BUFFER(struct dwmci_idmac, cur_idmac,
-				 data ? DIV_ROUND_UP(data->blocks, 8) : 0);
+				 data ? DIV_ROUND_UP(data->blocks, 8) +
+					BOUNCE_BUFFER_MAX_SEGS - 1 : 0);
 	int ret = 0, flags = 0, i;
 	unsigned int timeout = 500;
 	u32 retry = 100000;
@@ -276,19 +277,20 @@ static int dwmci_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 				ret = bounce_buffer_start(&bbstate,
 						(void*)data->dest,
 						data->blocksize *
-						data->blocks, GEN_BB_WRITE);
+						data->blocks,
+						GEN_BB_WRITE | GEN_BB_SPLIT);
 			} else {
 				ret = bounce_buffer_start(&bbstate,
 						(void*)data->src,
 						data->blocksize *
-						data->blocks, GEN_BB_READ);
+						data->blocks,
+						GEN_BB_READ | GEN_BB_SPLIT);
 			}
 
 			if (ret)
 				return ret;
 
-			dwmci_prepare_data(host, data, cur_idmac,
-					   bbstate.bounce_buffer);
+			dwmci_prepare_data(host, data, cur_idmac, &bbstate);
 		}
 	}
 
@@ -52,6 +52,11 @@ DECLARE_GLOBAL_DATA_PTR;
 				IRQSTATEN_CIE | IRQSTATEN_DTOE | IRQSTATEN_DCE | \
 				IRQSTATEN_DEBE | IRQSTATEN_BRR | IRQSTATEN_BWR | \
 				IRQSTATEN_DINT)
+#ifdef CONFIG_FSL_ESDHC_IMX_ADMA2
+#define ESDHC_IRQ_EN_BITS	(SDHCI_IRQ_EN_BITS | IRQSTATEN_DMAE)
+#else
+#define ESDHC_IRQ_EN_BITS	SDHCI_IRQ_EN_BITS
+#endif
 #define MAX_TUNING_LOOP 40
 #define ESDHC_DRIVER_STAGE_VALUE 0xffffffff
 
@@ -138,6 +143,10 @@ struct esdhc_soc_data {
  * @signal_voltage: indicating the current voltage
  * @cd_gpio: gpio for card detection
  * @wp_gpio: gpio for write protection
+ * @adma_desc: ADMA2 descriptor table, NULL to always use SDMA
+ * @adma_size: number of entries in @adma_desc
+ * @adma_descs: descriptors used by the current transfer, 0 if it uses SDMA
+ * @stats: data transfer statistics
  */
 struct fsl_esdhc_priv {
 	struct fsl_esdhc *esdhc_regs;
@@ -170,6 +179,12 @@ struct fsl_esdhc_priv {
 	struct gpio_desc cd_gpio;
 	struct gpio_desc wp_gpio;
 #endif
+#ifdef CONFIG_FSL_ESDHC_IMX_ADMA2
+	struct esdhc_adma_desc *adma_desc;
+	uint adma_size;
+	uint adma_descs;
+#endif
+	struct fsl_esdhc_stats stats;
 };
 
 /* Return the XFERTYP flags for a given command and data packet */
@@ -276,6 +291,112 @@ static void esdhc_pio_read_write(struct fsl_esdhc_priv *priv,
 }
 #endif
 
+#if defined(CONFIG_FSL_ESDHC_IMX_ADMA2) && !defined(CONFIG_SYS_FSL_ESDHC_USE_PIO)
+static dma_addr_t esdhc_dma_addr(const void *ptr)
+{
+#if defined(CONFIG_S32V234) || defined(CONFIG_IMX8) || defined(CONFIG_IMX8M)
+	return virt_to_phys((void *)ptr);
+#else
+	return (ulong)ptr;
+#endif
+}
+
+/*
+ * Describe the whole transfer in one ADMA2 table, so that the controller
+ * does not stop at SDMA buffer boundaries. Returns 0 if the transfer is set
+ * up for ADMA2, otherwise the controller is left in SDMA mode.
+ */
+static int esdhc_setup_adma(struct fsl_esdhc_priv *priv,
+			    struct mmc_data *data)
+{
+	struct fsl_esdhc *regs = priv->esdhc_regs;
+	struct esdhc_adma_table tbl;
+	const void *buf;
+	dma_addr_t addr;
+	int ret;
+
+	priv->adma_descs = 0;
+	if (!priv->adma_desc) {
+		ret = -ENOSYS;
+		goto sdma;
+	}
+
+	if (data->flags & MMC_DATA_READ)
+		buf = data->dest;
+	else
+		buf = data->src;
+
+	esdhc_adma_init(&tbl, priv->adma_desc, priv->adma_size);
+	ret = esdhc_adma_add(&tbl, esdhc_dma_addr(buf),
+			     data->blocks * data->blocksize);
+	if (!ret)
+		ret = esdhc_adma_finish(&tbl);
+	if (ret)
+		goto sdma;
+
+	addr = esdhc_dma_addr(tbl.desc);
+	if (upper_32_bits(addr)) {
+		ret = -EINVAL;
+		goto sdma;
+	}
+	flush_dcache_range((ulong)tbl.desc, (ulong)tbl.desc +
+			   roundup(tbl.count * sizeof(*tbl.desc),
+				   ARCH_DMA_MINALIGN));
+	esdhc_write32(&regs->adsaddr, lower_32_bits(addr));
+	esdhc_clrsetbits32(&regs->proctl, PROCTL_DMAS_MASK, PROCTL_DMAS_ADMA2);
+	priv->adma_descs = tbl.count;
+
+	return 0;
+
+sdma:
+	debug("%s: using SDMA (err=%d)\n", __func__, ret);
+	esdhc_clrsetbits32(&regs->proctl, PROCTL_DMAS_MASK, PROCTL_DMAS_SDMA);
+
+	return ret;
+}
+#endif
+
+static void esdhc_update_stats(struct fsl_esdhc_priv *priv,
+			       struct mmc_data *data, int err)
+{
+	struct fsl_esdhc_stats *stats = &priv->stats;
+	uint descs = 0;
+
+#if defined(CONFIG_FSL_ESDHC_IMX_ADMA2) && !defined(CONFIG_SYS_FSL_ESDHC_USE_PIO)
+	descs = priv->adma_descs;
+#endif
+	if (err) {
+		stats->errors++;
+		return;
+	}
+	stats->transfers++;
+	stats->blocks += data->blocks;
+	stats->bytes += data->blocks * data->blocksize;
+	if (descs) {
+		stats->adma_transfers++;
+		stats->descs += descs;
+		stats->max_descs = max(stats->max_descs, descs);
+	} else {
+		stats->sdma_transfers++;
+	}
+	debug("%s: %u x %u bytes, %u descriptors\n", __func__, data->blocks,
+	      data->blocksize, descs);
+}
+
+void fsl_esdhc_get_stats(struct mmc *mmc, struct fsl_esdhc_stats *stats)
+{
+	struct fsl_esdhc_priv *priv = mmc->priv;
+
+	*stats = priv->stats;
+}
+
+void fsl_esdhc_reset_stats(struct mmc *mmc)
+{
+	struct fsl_esdhc_priv *priv = mmc->priv;
+
+	memset(&priv->stats, '\0', sizeof(priv->stats));
+}
+
 static int esdhc_setup_data(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 			    struct mmc_data *data)
 {
@@ -343,6 +464,10 @@ static int esdhc_setup_data(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 #endif
 	}
 
+#if defined(CONFIG_FSL_ESDHC_IMX_ADMA2) && !defined(CONFIG_SYS_FSL_ESDHC_USE_PIO)
+	esdhc_setup_adma(priv, data);
+#endif
+
 	esdhc_write32(&regs->blkattr, data->blocks << 16 | data->blocksize);
 
 	/* Calculate the timeout period for data transactions */
@@ -568,6 +693,11 @@ static int esdhc_send_cmd_common(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 		esdhc_pio_read_write(priv, data);
 #else
 		flags = DATA_COMPLETE;
+#ifdef CONFIG_FSL_ESDHC_IMX_ADMA2
+		/* There is no DMA interrupt unless a descriptor asks for one */
+		if (priv->adma_descs)
+			flags = IRQSTAT_TC;
+#endif
 		if ((cmd->cmdidx == MMC_CMD_SEND_TUNING_BLOCK) ||
 		    (cmd->cmdidx == MMC_CMD_SEND_TUNING_BLOCK_HS200)) {
 			flags = IRQSTAT_BRR;
@@ -582,6 +712,11 @@ static int esdhc_send_cmd_common(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 			}
 
 			if (irqstat & DATA_ERR) {
+#ifdef CONFIG_FSL_ESDHC_IMX_ADMA2
+				if (irqstat & IRQSTAT_DMAE)
+					debug("%s: ADMA error %x\n", __func__,
+					      esdhc_read32(&regs->admaes));
+#endif
 				err = -ECOMM;
 				goto out;
 			}
@@ -602,6 +737,9 @@ static int esdhc_send_cmd_common(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 	}
 
 out:
+	if (data)
+		esdhc_update_stats(priv, data, err);
+
 	/* Reset CMD and DATA portions on error */
 	if (err) {
 		esdhc_write32(&regs->sysctl, esdhc_read32(&regs->sysctl) |
@@ -1189,7 +1327,7 @@ static int fsl_esdhc_init(struct fsl_esdhc_priv *priv,
 	if (priv->vs18_enable)
 		esdhc_setbits32(&regs->vendorspec, ESDHC_VENDORSPEC_VSELECT);
 
-	writel(SDHCI_IRQ_EN_BITS, &regs->irqstaten);
+	writel(ESDHC_IRQ_EN_BITS, &regs->irqstaten);
 	cfg = &plat->cfg;
 #ifndef CONFIG_DM_MMC
 	memset(cfg, '\0', sizeof(*cfg));
@@ -1270,6 +1408,16 @@ static int fsl_esdhc_init(struct fsl_esdhc_priv *priv,
 
 	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
 
+#ifdef CONFIG_FSL_ESDHC_IMX_ADMA2
+	/* Enough descriptors for the largest transfer; else stay with SDMA */
+	if (!priv->adma_desc) {
+		priv->adma_size = esdhc_adma_table_size(cfg->b_max *
+							MMC_MAX_BLOCK_LEN, 1);
+		priv->adma_desc = memalign(ARCH_DMA_MINALIGN, priv->adma_size *
+					   sizeof(struct esdhc_adma_desc));
+	}
+#endif
+
 	writel(0, &regs->dllctrl);
 	if (priv->flags & ESDHC_FLAG_USDHC) {
 		if (priv->flags & ESDHC_FLAG_STD_TUNING) {
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * ADMA2 descriptor tables for the i.MX eSDHC
+ *
+ * These are kept apart from the driver so that they can be built and
+ * tested on sandbox.
+ */
+
+#include <common.h>
+#include <fsl_esdhc_imx.h>
+#include <asm/byteorder.h>
+
+void esdhc_adma_init(struct esdhc_adma_table *tbl,
+		     struct esdhc_adma_desc *desc, uint size)
+{
+	tbl->desc = desc;
+	tbl->size = size;
+	tbl->count = 0;
+	tbl->bytes = 0;
+}
+
+int esdhc_adma_add(struct esdhc_adma_table *tbl, dma_addr_t addr, uint len)
+{
+	struct esdhc_adma_desc *desc;
+	uint chunk, prev;
+
+	if (!len || (addr & 3) || (len & 3))
+		return -EINVAL;
+	if (upper_32_bits(addr + len - 1))
+		return -EINVAL;
+
+	/* Carry on from the previous piece if it ends where this starts */
+	if (tbl->count) {
+		desc = &tbl->desc[tbl->count - 1];
+		prev = le16_to_cpu(desc->len);
+		if (le32_to_cpu(desc->addr) + prev == addr &&
+		    prev < ESDHC_ADMA_MAX_LEN) {
+			chunk = min(len, ESDHC_ADMA_MAX_LEN - prev);
+			desc->len = cpu_to_le16(prev + chunk);
+			tbl->bytes += chunk;
+			addr += chunk;
+			len -= chunk;
+		}
+	}
+
+	while (len) {
+		if (tbl->count == tbl->size)
+			return -ENOSPC;
+		chunk = min(len, (uint)ESDHC_ADMA_MAX_LEN);
+		desc = &tbl->desc[tbl->count++];
+		desc->attr = ESDHC_ADMA_ATTR_VALID | ESDHC_ADMA_ATTR_TRAN;
+		desc->reserved = 0;
+		desc->len = cpu_to_le16(chunk);
+		desc->addr = cpu_to_le32(lower_32_bits(addr));
+		tbl->bytes += chunk;
+		addr += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+int esdhc_adma_finish(struct esdhc_adma_table *tbl)
+{
+	if (!tbl->count)
+		return -EINVAL;
+	tbl->desc[tbl->count - 1].attr |= ESDHC_ADMA_ATTR_END;
+
+	return 0;
+}
@@ -300,7 +300,7 @@ int mmc_set_blocklen(struct mmc *mmc, int len)
 }
 
 #ifdef MMC_SUPPORTS_TUNING
-static const u8 tuning_blk_pattern_4bit[] = {
+const u8 tuning_blk_pattern_4bit[MMC_TUNING_BLK_PATTERN_4BIT_SIZE] = {
 	0xff, 0x0f, 0xff, 0x00, 0xff, 0xcc, 0xc3, 0xcc,
 	0xc3, 0x3c, 0xcc, 0xff, 0xfe, 0xff, 0xfe, 0xef,
 	0xff, 0xdf, 0xff, 0xdd, 0xff, 0xfb, 0xff, 0xfb,
@@ -311,7 +311,7 @@ static const u8 tuning_blk_pattern_4bit[] = {
 	0xbb, 0xff, 0xf7, 0xff, 0xf7, 0x7f, 0x7b, 0xde,
 };
 
-static const u8 tuning_blk_pattern_8bit[] = {
+const u8 tuning_blk_pattern_8bit[MMC_TUNING_BLK_PATTERN_8BIT_SIZE] = {
 	0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00,
 	0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc, 0xcc,
 	0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff, 0xff,
@@ -369,8 +369,8 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
-static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
-			   lbaint_t blkcnt)
+int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+		    lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
@@ -452,6 +452,19 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		return 0;
 	}
 
+#if CONFIG_IS_ENABLED(MMC_CMDQ)
+	/* Keep the pieces of a large read queued on the card */
+	if (blkcnt > mmc->cfg->b_max && mmc->cmdq_depth > 1) {
+		struct mmc_req req = {
+			.start = start,
+			.blkcnt = blkcnt,
+			.buf = dst,
+		};
+
+		return mmc_queue_rw(mmc, &req, 1) ? 0 : blkcnt;
+	}
+#endif
+
 	do {
 		cur = (blocks_todo > mmc->cfg->b_max) ?
 			mmc->cfg->b_max : blocks_todo;
@@ -2375,6 +2388,19 @@ static int mmc_startup_v4(struct mmc *mmc)
 
 	mmc->wr_rel_set = ext_csd[EXT_CSD_WR_REL_SET];
 
+#if CONFIG_IS_ENABLED(MMC_CMDQ)
+	/* Both need a host which leaves CMD12 to the core */
+	if (mmc->host_caps & MMC_CAP_CMDQ) {
+		if (mmc->version >= MMC_VERSION_5_1 &&
+		    (ext_csd[EXT_CSD_CMDQ_SUPPORT] & 1))
+			mmc->cmdq_depth = (ext_csd[EXT_CSD_CMDQ_DEPTH] & 0x1f) +
+					  1;
+		if (mmc->version >= MMC_VERSION_4_5)
+			mmc->max_packed_writes =
+				ext_csd[EXT_CSD_MAX_PACKED_WRITES];
+	}
+#endif
+
 	return 0;
 error:
 	if (mmc->ext_csd) {
@@ -2560,6 +2586,10 @@ static int mmc_startup(struct mmc *mmc)
 	mmc->erase_grp_size = 1;
 #endif
 	mmc->part_config = MMCPART_NOAVAILABLE;
+#if CONFIG_IS_ENABLED(MMC_CMDQ)
+	mmc->cmdq_depth = 0;
+	mmc->max_packed_writes = 0;
+#endif
 
 	err = mmc_startup_v4(mmc);
 	if (err)
@@ -0,0 +1,451 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * eMMC command queueing and packed writes
+ *
+ * Several block requests are handed to the card at once, so that it can
+ * prepare the next one while the current one moves data. Cards which support
+ * neither get the requests one at a time.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <mmc.h>
+#include <linux/bitops.h>
+#include "mmc_private.h"
+
+/* CMD44 and CMD23 carry a 16-bit block count */
+#define MMC_CMDQ_MAX_BLKS	MMC_CMDQ_BLKCNT_MASK
+#define MMC_CMDQ_MAX_DEPTH	32
+#define MMC_CMDQ_TIMEOUT_MS	1000
+
+/* Largest amount of data gathered into one packed write */
+#define MMC_PACKED_MAX_BLKS	128
+/* Each write takes two words of the header block, after the first two */
+#define MMC_PACKED_ENTRIES(blksz)	((blksz) / 8 - 1)
+
+/**
+ * struct mmc_task - A piece of a request, moved by a single data command
+ *
+ * @req: Request this belongs to
+ * @start: First block
+ * @blkcnt: Number of blocks
+ * @buf: Data buffer
+ */
+struct mmc_task {
+	struct mmc_req *req;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buf;
+};
+
+/**
+ * struct mmc_req_iter - Walks through requests, a piece at a time
+ *
+ * @reqs: Requests
+ * @count: Number of requests
+ * @idx: Current request
+ * @offset: Blocks of the current request already handed out
+ */
+struct mmc_req_iter {
+	struct mmc_req *reqs;
+	int count;
+	int idx;
+	lbaint_t offset;
+};
+
+static uint mmc_req_blksz(struct mmc *mmc, struct mmc_req *req)
+{
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	if (req->write)
+		return mmc->write_bl_len;
+#endif
+	return mmc->read_bl_len;
+}
+
+static ulong mmc_blk_addr(struct mmc *mmc, lbaint_t start, uint blksz)
+{
+	return mmc->high_capacity ? start : start * blksz;
+}
+
+/* Get the next piece of at most @max blocks, without moving on */
+static bool mmc_req_peek(struct mmc *mmc, struct mmc_req_iter *iter,
+			 lbaint_t max, struct mmc_task *task)
+{
+	struct mmc_req *req;
+
+	while (iter->idx < iter->count &&
+	       iter->offset == iter->reqs[iter->idx].blkcnt) {
+		iter->idx++;
+		iter->offset = 0;
+	}
+	if (iter->idx == iter->count)
+		return false;
+
+	req = &iter->reqs[iter->idx];
+	task->req = req;
+	task->start = req->start + iter->offset;
+	task->blkcnt = min(req->blkcnt - iter->offset, max);
+	task->buf = req->buf + iter->offset * mmc_req_blksz(mmc, req);
+
+	return true;
+}
+
+static void mmc_req_advance(struct mmc_req_iter *iter, struct mmc_task *task)
+{
+	iter->offset += task->blkcnt;
+}
+
+static int mmc_task_rw(struct mmc *mmc, struct mmc_task *task)
+{
+	ulong done;
+
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	if (task->req->write)
+		done = mmc_write_blocks(mmc, task->start, task->blkcnt,
+					task->buf);
+	else
+#endif
+		done = mmc_read_blocks(mmc, task->buf, task->start,
+				       task->blkcnt);
+	if (done != task->blkcnt)
+		return -EIO;
+	task->req->done += done;
+
+	return 0;
+}
+
+static int mmc_queue_rw_single(struct mmc *mmc, struct mmc_req_iter *iter)
+{
+	struct mmc_task task;
+	int err;
+
+	while (mmc_req_peek(mmc, iter, mmc->cfg->b_max, &task)) {
+		err = mmc_task_rw(mmc, &task);
+		if (err)
+			return err;
+		mmc_req_advance(iter, &task);
+	}
+
+	return 0;
+}
+
+static int mmc_cmdq_enable(struct mmc *mmc, bool enable)
+{
+	return mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN,
+			  enable);
+}
+
+static int mmc_cmdq_queue(struct mmc *mmc, uint id, struct mmc_task *task)
+{
+	struct mmc_cmd cmd;
+	int err;
+
+	cmd.cmdidx = MMC_CMD_QUE_TASK_PARAMS;
+	cmd.resp_type = MMC_RSP_R1;
+	cmd.cmdarg = MMC_CMDQ_TASK_ID(id) | task->blkcnt;
+	if (!task->req->write)
+		cmd.cmdarg |= MMC_CMDQ_DIR_READ;
+	err = mmc_send_cmd(mmc, &cmd, NULL);
+	if (err)
+		return err;
+
+	cmd.cmdidx = MMC_CMD_QUE_TASK_ADDR;
+	cmd.cmdarg = mmc_blk_addr(mmc, task->start,
+				  mmc_req_blksz(mmc, task->req));
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
+/* Read the Queue Status Register, which has a bit for each ready task */
+static int mmc_cmdq_status(struct mmc *mmc, u32 *qsr)
+{
+	struct mmc_cmd cmd;
+	int err;
+
+	cmd.cmdidx = MMC_CMD_SEND_STATUS;
+	cmd.resp_type = MMC_RSP_R1;
+	cmd.cmdarg = mmc->rca << 16 | MMC_SEND_STATUS_SQS;
+	err = mmc_send_cmd(mmc, &cmd, NULL);
+	if (err)
+		return err;
+	*qsr = cmd.response[0];
+
+	return 0;
+}
+
+static int mmc_cmdq_execute(struct mmc *mmc, uint id, struct mmc_task *task)
+{
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+	int err;
+
+	cmd.cmdarg = MMC_CMDQ_TASK_ID(id);
+	cmd.resp_type = MMC_RSP_R1;
+	data.blocks = task->blkcnt;
+	data.blocksize = mmc_req_blksz(mmc, task->req);
+	if (task->req->write) {
+		cmd.cmdidx = MMC_CMD_EXECUTE_WRITE_TASK;
+		data.src = task->buf;
+		data.flags = MMC_DATA_WRITE;
+	} else {
+		cmd.cmdidx = MMC_CMD_EXECUTE_READ_TASK;
+		data.dest = task->buf;
+		data.flags = MMC_DATA_READ;
+	}
+	err = mmc_send_cmd(mmc, &cmd, &data);
+	if (err)
+		return err;
+	task->req->done += task->blkcnt;
+
+	return 0;
+}
+
+static void mmc_cmdq_discard(struct mmc *mmc)
+{
+	struct mmc_cmd cmd;
+
+	cmd.cmdidx = MMC_CMD_CMDQ_TASK_MGMT;
+	cmd.resp_type = MMC_RSP_R1b;
+	cmd.cmdarg = MMC_CMDQ_DISCARD_QUEUE;
+	mmc_send_cmd(mmc, &cmd, NULL);
+}
+
+/*
+ * The card may run queued tasks in any order, so a task which overlaps a
+ * queued write, or a write which overlaps any queued task, has to wait.
+ */
+static bool mmc_cmdq_conflict(struct mmc_task *tasks, u32 queued,
+			      struct mmc_task *task)
+{
+	struct mmc_task *other;
+	uint id;
+
+	for (id = 0; queued; id++, queued >>= 1) {
+		other = &tasks[id];
+		if (!(queued & 1))
+			continue;
+		if (!other->req->write && !task->req->write)
+			continue;
+		if (task->start < other->start + other->blkcnt &&
+		    other->start < task->start + task->blkcnt)
+			return true;
+	}
+
+	return false;
+}
+
+static int mmc_cmdq_rw(struct mmc *mmc, struct mmc_req_iter *iter)
+{
+	struct mmc_task tasks[MMC_CMDQ_MAX_DEPTH];
+	uint depth = min(mmc->cmdq_depth, (u8)MMC_CMDQ_MAX_DEPTH);
+	lbaint_t max = min_t(lbaint_t, mmc->cfg->b_max, MMC_CMDQ_MAX_BLKS);
+	struct mmc_task task;
+	u32 queued = 0, ready;
+	ulong start;
+	uint id;
+	int err;
+
+	err = mmc_cmdq_enable(mmc, true);
+	if (err)
+		return err;
+
+	for (;;) {
+		/* Keep the queue as full as ordering allows */
+		while (hweight32(queued) < depth &&
+		       mmc_req_peek(mmc, iter, max, &task) &&
+		       !mmc_cmdq_conflict(tasks, queued, &task)) {
+			id = ffz(queued);
+			tasks[id] = task;
+			err = mmc_cmdq_queue(mmc, id, &tasks[id]);
+			if (err)
+				goto err;
+			queued |= BIT(id);
+			mmc_req_advance(iter, &task);
+		}
+		if (!queued)
+			break;
+
+		start = get_timer(0);
+		do {
+			if (get_timer(start) > MMC_CMDQ_TIMEOUT_MS) {
+				err = -ETIMEDOUT;
+				goto err;
+			}
+			err = mmc_cmdq_status(mmc, &ready);
+			if (err)
+				goto err;
+			ready &= queued;
+		} while (!ready);
+
+		/* Run whatever the card has ready, in the order it chose */
+		while (ready) {
+			id = __ffs(ready);
+			err = mmc_cmdq_execute(mmc, id, &tasks[id]);
+			if (err)
+				goto err;
+			ready &= ~BIT(id);
+			queued &= ~BIT(id);
+		}
+	}
+
+	/* The last write must be programmed before leaving queueing mode */
+	err = mmc_poll_for_busy(mmc, MMC_CMDQ_TIMEOUT_MS);
+	if (err)
+		goto err;
+
+	return mmc_cmdq_enable(mmc, false);
+
+err:
+	debug("%s: err=%d\n", __func__, err);
+	mmc_cmdq_discard(mmc);
+	mmc_cmdq_enable(mmc, false);
+
+	return err;
+}
+
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+/*
+ * Send up to @num writes from @tasks as one packed command: a header block
+ * listing the writes, followed by their data
+ */
+static int mmc_packed_write(struct mmc *mmc, struct mmc_task *tasks, int num,
+			    lbaint_t blocks)
+{
+	uint blksz = mmc->write_bl_len;
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+	__le32 *hdr;
+	void *buf, *ptr;
+	int err, i;
+
+	buf = malloc_cache_aligned((blocks + 1) * blksz);
+	if (!buf)
+		return -ENOMEM;
+	memset(buf, '\0', blksz);
+	hdr = buf;
+	hdr[0] = cpu_to_le32(num << 16 | MMC_PACKED_WRITE << 8 |
+			     MMC_PACKED_VERSION);
+	ptr = buf + blksz;
+	for (i = 0; i < num; i++) {
+		hdr[(i + 1) * 2] = cpu_to_le32(tasks[i].blkcnt);
+		hdr[(i + 1) * 2 + 1] = cpu_to_le32(mmc_blk_addr(mmc,
+							tasks[i].start, blksz));
+		memcpy(ptr, tasks[i].buf, tasks[i].blkcnt * blksz);
+		ptr += tasks[i].blkcnt * blksz;
+	}
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.resp_type = MMC_RSP_R1;
+	cmd.cmdarg = MMC_CMD23_ARG_PACKED | (blocks + 1);
+	err = mmc_send_cmd(mmc, &cmd, NULL);
+	if (err)
+		goto out;
+
+	/* The count is set, so the card stops by itself with no CMD12 */
+	cmd.cmdidx = MMC_CMD_WRITE_MULTIPLE_BLOCK;
+	cmd.cmdarg = mmc_blk_addr(mmc, tasks[0].start, blksz);
+	data.src = buf;
+	data.blocks = blocks + 1;
+	data.blocksize = blksz;
+	data.flags = MMC_DATA_WRITE;
+	err = mmc_send_cmd(mmc, &cmd, &data);
+	if (err)
+		goto out;
+
+	err = mmc_poll_for_busy(mmc, MMC_CMDQ_TIMEOUT_MS);
+	if (err)
+		goto out;
+	for (i = 0; i < num; i++)
+		tasks[i].req->done += tasks[i].blkcnt;
+
+out:
+	free(buf);
+
+	return err;
+}
+
+/*
+ * Gather runs of separate write requests into packed commands. A request is
+ * never split up to be packed: a single contiguous write is faster as one
+ * plain multi-block write than as pieces behind a header block.
+ */
+static int mmc_packed_rw(struct mmc *mmc, struct mmc_req_iter *iter)
+{
+	struct mmc_task tasks[MMC_PACKED_ENTRIES(MMC_MAX_BLOCK_LEN)];
+	uint max_num = min_t(uint, mmc->max_packed_writes,
+			     MMC_PACKED_ENTRIES(mmc->write_bl_len));
+	lbaint_t max = min_t(lbaint_t, mmc->cfg->b_max - 1,
+			     MMC_PACKED_MAX_BLKS);
+	struct mmc_req_iter one;
+	struct mmc_req *req;
+	lbaint_t blocks;
+	int num, err;
+
+	while (iter->idx < iter->count) {
+		num = 0;
+		blocks = 0;
+		while (num < max_num && iter->idx + num < iter->count) {
+			req = &iter->reqs[iter->idx + num];
+			if (!req->write || !req->blkcnt ||
+			    blocks + req->blkcnt > max)
+				break;
+			tasks[num].req = req;
+			tasks[num].start = req->start;
+			tasks[num].blkcnt = req->blkcnt;
+			tasks[num].buf = req->buf;
+			blocks += req->blkcnt;
+			num++;
+		}
+
+		if (num > 1) {
+			err = mmc_packed_write(mmc, tasks, num, blocks);
+			iter->idx += num;
+		} else {
+			one = (struct mmc_req_iter){
+				.reqs = &iter->reqs[iter->idx],
+				.count = 1,
+			};
+			err = mmc_queue_rw_single(mmc, &one);
+			iter->idx++;
+		}
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+#endif
+
+int mmc_queue_rw(struct mmc *mmc, struct mmc_req *reqs, int count)
+{
+	struct blk_desc *desc = mmc_get_blk_desc(mmc);
+	struct mmc_req_iter iter = {
+		.reqs = reqs,
+		.count = count,
+	};
+	bool write = false;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].start + reqs[i].blkcnt > desc->lba)
+			return -EINVAL;
+		write |= reqs[i].write;
+		reqs[i].done = 0;
+	}
+	if (write && !CONFIG_IS_ENABLED(MMC_WRITE))
+		return -ENOSYS;
+
+	/* Queueing is not allowed on the RPMB partition */
+	if (mmc->cmdq_depth > 1 &&
+	    desc->hwpart != MMC_PART_RPMB)
+		return mmc_cmdq_rw(mmc, &iter);
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	if (write && count > 1 && mmc->max_packed_writes > 1 &&
+	    mmc->cfg->b_max > 1)
+		return mmc_packed_rw(mmc, &iter);
+#endif
+
+	return mmc_queue_rw_single(mmc, &iter);
+}
@@ -18,6 +18,18 @@ int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
 
+/**
+ * mmc_read_blocks() - Read blocks with a single read command
+ *
+ * @mmc:	MMC device
+ * @dst:	Buffer to read into
+ * @start:	First block
+ * @blkcnt:	Number of blocks, at most mmc->cfg->b_max
+ * @return @blkcnt if OK, 0 on error
+ */
+int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+		    lbaint_t blkcnt);
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
@@ -28,6 +40,18 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 
+/**
+ * mmc_write_blocks() - Write blocks with a single write command
+ *
+ * @mmc:	MMC device
+ * @start:	First block
+ * @blkcnt:	Number of blocks, at most mmc->cfg->b_max
+ * @src:	Data to write
+ * @return @blkcnt if OK, 0 on error
+ */
+ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start, lbaint_t blkcnt,
+		       const void *src);
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bwrite(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		 const void *src);
@@ -126,8 +126,8 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 	return blk;
 }
 
-static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
-		lbaint_t blkcnt, const void *src)
+ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start, lbaint_t blkcnt,
+		       const void *src)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
@@ -209,6 +209,20 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	if (mmc_set_blocklen(mmc, mmc->write_bl_len))
 		return 0;
 
+#if CONFIG_IS_ENABLED(MMC_CMDQ)
+	/* Keep the pieces of a large write queued on the card */
+	if (blkcnt > mmc->cfg->b_max && mmc->cmdq_depth > 1) {
+		struct mmc_req req = {
+			.start = start,
+			.blkcnt = blkcnt,
+			.buf = (void *)src,
+			.write = true,
+		};
+
+		return mmc_queue_rw(mmc, &req, 1) ? 0 : blkcnt;
+	}
+#endif
+
 	do {
 		cur = (blocks_todo > mmc->cfg->b_max) ?
 			mmc->cfg->b_max : blocks_todo;
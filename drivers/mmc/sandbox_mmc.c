@@ -2,14 +2,53 @@
 /*
  * Copyright (c) 2015 Google, Inc
  * Written by Simon Glass <sjg@chromium.org>
+ *
+ * The emulated card is an SD card version 2 by default, or an eMMC 5.1 device
+ * if "sandbox,emmc" is given. Its contents are kept in a host file if
+ * "sandbox,filepath" is given, otherwise in memory.
+ *
+ * Every command is charged the time it would take on a real bus: the command
+ * and response bits at the current clock, the card's access latency and the
+ * data transfer, which is limited by both the bus (clock, width and DDR) and
+ * the card's internal read / write rate. Single-block CMD17 / CMD24 pay the
+ * access latency for every block, CMD18 / CMD25 only once per command. By
+ * default this time is not spent, which keeps tests fast; set
+ * "sandbox,real-time" to delay for it as well.
+ *
+ * The eMMC supports HS200, which needs tuning: above 52MHz data can only be
+ * sampled if the host's tuning phase is within "sandbox,tuning-window".
+ *
+ * The eMMC can also have a command queue of "sandbox,cmdq-depth" tasks and
+ * accept packed writes of up to "sandbox,max-packed-writes" entries. The
+ * order of the queueing commands is checked, and a host which breaks it gets
+ * -EIO and a count in the protocol_errors statistic. Queued reads are made
+ * ready before queued writes. A task queued while others are waiting has its
+ * access time hidden behind their transfers.
  */
 
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <mmc.h>
+#include <os.h>
 #include <asm/test.h>
+#include <linux/bitops.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+
+/* Number of sampling phases the host can select while tuning */
+#define SANDBOX_MMC_TUNING_PHASES	16
+
+/* Card state reported in the R1 status, with the card selected */
+#define SANDBOX_MMC_STATE_TRAN		(4 << 9)
+
+/* Number of bits sent for a command (48) plus a short response (48) */
+#define SANDBOX_MMC_CMD_BITS		96
+
+/* Largest command queue of an eMMC */
+#define SANDBOX_MMC_CMDQ_TASKS		32
 
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
@@ -17,14 +56,462 @@ struct sandbox_mmc_plat {
 };
 
 /**
- * sandbox_mmc_send_cmd() - Emulate SD commands
+ * struct sandbox_mmc_priv - state of a sandbox MMC card and its host
  *
- * This emulate an SD card version 2. Single-block reads result in zero data.
- * Multiple-block reads return a test string.
+ * @emmc: true to emulate an eMMC, false for an SD card
+ * @capacity: Size of the card in bytes, a multiple of 512KiB
+ * @read_latency: Access time of each read command, in us
+ * @write_latency: Programming overhead of each write command, in us
+ * @read_rate: Rate at which the card can read data, in KiB/s
+ * @write_rate: Rate at which the card can write data, in KiB/s
+ * @real_time: true to delay for each command, not just count the time
+ * @fd: Backing file, or -1 to keep the contents in memory
+ * @mem: Contents of the card when kept in memory
+ * @ext_csd: EXT_CSD register of an eMMC
+ * @erase_start: First block of the erase range
+ * @erase_end: Last block of the erase range
+ * @switch_error: true if the last SWITCH command was refused
+ * @window_first: First tuning phase at which HS200 data can be sampled
+ * @window_last: Last tuning phase at which HS200 data can be sampled
+ * @phase: Tuning phase selected by the host
+ * @clock: Bus clock set by the host, in Hz
+ * @bus_width: Bus width set by the host (1, 4 or 8)
+ * @ddr: true if data is transferred on both clock edges
+ * @cmdq_depth: Number of tasks the eMMC can queue, 0 if it has no queue
+ * @queued: Tasks queued with CMD44 / CMD45 and not yet executed
+ * @writes: Queued tasks which are writes
+ * @overlapped: Queued tasks whose access time is hidden
+ * @task_params: CMD44 argument of each task
+ * @task_addr: CMD45 argument of each task
+ * @pending: Task given by CMD44 which waits for its CMD45, or -1
+ * @packed_blocks: Blocks of the packed write announced by CMD23, or 0
+ * @stats: Command counters
+ */
+struct sandbox_mmc_priv {
+	bool emmc;
+	u64 capacity;
+	u32 read_latency;
+	u32 write_latency;
+	u32 read_rate;
+	u32 write_rate;
+	bool real_time;
+	int fd;
+	u8 *mem;
+	u8 ext_csd[MMC_MAX_BLOCK_LEN];
+	u32 erase_start;
+	u32 erase_end;
+	bool switch_error;
+	uint window_first;
+	uint window_last;
+	uint phase;
+	uint clock;
+	uint bus_width;
+	bool ddr;
+	uint cmdq_depth;
+	u32 queued;
+	u32 writes;
+	u32 overlapped;
+	u32 task_params[SANDBOX_MMC_CMDQ_TASKS];
+	u32 task_addr[SANDBOX_MMC_CMDQ_TASKS];
+	int pending;
+	uint packed_blocks;
+	struct sandbox_mmc_stats stats;
+};
+
+static void sandbox_mmc_busy(struct sandbox_mmc_priv *priv, u64 ns)
+{
+	priv->stats.busy_ns += ns;
+	if (priv->real_time)
+		udelay(div_u64(ns, 1000));
+}
+
+/* Time to send a command and get its response at the current clock */
+static u64 sandbox_mmc_cmd_ns(struct sandbox_mmc_priv *priv)
+{
+	uint clock = priv->clock ? priv->clock : 400000;
+
+	return div_u64((u64)SANDBOX_MMC_CMD_BITS * 1000000000, clock);
+}
+
+/*
+ * Time to move @bytes over the data lines. The card streams at its internal
+ * rate while the bus is busy, so whichever is slower sets the pace.
+ */
+static u64 sandbox_mmc_xfer_ns(struct sandbox_mmc_priv *priv, u64 bytes,
+			       u32 rate)
+{
+	u64 bus_bits = (u64)(priv->clock ? priv->clock : 400000) *
+		       (priv->bus_width ? priv->bus_width : 1);
+	u64 bus_ns, card_ns;
+
+	if (priv->ddr)
+		bus_bits *= 2;
+	bus_ns = div_u64(bytes * 8 * 1000000000, bus_bits);
+	card_ns = div_u64(bytes * 1000000000, (u64)rate * SZ_1K);
+
+	return max(bus_ns, card_ns);
+}
+
+/* Whether data sent by the card at the current clock can be sampled */
+static bool sandbox_mmc_sample_ok(struct sandbox_mmc_priv *priv)
+{
+	if (priv->clock <= 52000000)
+		return true;
+
+	return priv->phase >= priv->window_first &&
+	       priv->phase <= priv->window_last;
+}
+
+static int sandbox_mmc_access(struct sandbox_mmc_priv *priv, u64 offset,
+			      void *buf, ulong size, bool write)
+{
+	ssize_t len;
+
+	if (offset + size > priv->capacity)
+		return -EIO;
+	if (priv->fd == -1) {
+		if (write)
+			memcpy(priv->mem + offset, buf, size);
+		else
+			memcpy(buf, priv->mem + offset, size);
+		return 0;
+	}
+
+	if (os_lseek(priv->fd, offset, OS_SEEK_SET) != offset)
+		return -EIO;
+	if (write) {
+		len = os_write(priv->fd, buf, size);
+		return len == size ? 0 : -EIO;
+	}
+
+	/* Anything past the end of the file has not been written yet */
+	len = os_read(priv->fd, buf, size);
+	if (len < 0)
+		return -EIO;
+	memset(buf + len, '\0', size - len);
+
+	return 0;
+}
+
+/* Move the data of a command, charging the access time if @latency */
+static int sandbox_mmc_transfer(struct sandbox_mmc_priv *priv, u64 offset,
+				struct mmc_data *data, bool write, bool latency)
+{
+	ulong bytes = data->blocks * data->blocksize;
+	int ret;
+
+	if (write) {
+		ret = sandbox_mmc_access(priv, offset, (void *)data->src, bytes,
+					 true);
+		priv->stats.bytes_written += bytes;
+		sandbox_mmc_busy(priv, (latency ? priv->write_latency : 0) *
+				 1000ULL + sandbox_mmc_xfer_ns(priv, bytes,
+							       priv->write_rate));
+	} else {
+		if (!sandbox_mmc_sample_ok(priv))
+			return -EILSEQ;
+		ret = sandbox_mmc_access(priv, offset, data->dest, bytes,
+					 false);
+		priv->stats.bytes_read += bytes;
+		sandbox_mmc_busy(priv, (latency ? priv->read_latency : 0) *
+				 1000ULL + sandbox_mmc_xfer_ns(priv, bytes,
+							       priv->read_rate));
+	}
+
+	return ret;
+}
+
+static int sandbox_mmc_protocol_error(struct sandbox_mmc_priv *priv,
+				      const char *what)
+{
+	debug("%s: %s\n", __func__, what);
+	priv->stats.protocol_errors++;
+
+	return -EIO;
+}
+
+static bool sandbox_mmc_cmdq_enabled(struct sandbox_mmc_priv *priv)
+{
+	return priv->ext_csd[EXT_CSD_CMDQ_MODE_EN] & 1;
+}
+
+static int sandbox_mmc_rw(struct sandbox_mmc_priv *priv, struct mmc_cmd *cmd,
+			  struct mmc_data *data, bool write)
+{
+	u64 offset = (u64)cmd->cmdarg * MMC_MAX_BLOCK_LEN;
+	bool multi;
+	int ret;
+
+	if (sandbox_mmc_cmdq_enabled(priv))
+		return sandbox_mmc_protocol_error(priv, "legacy transfer");
+	multi = cmd->cmdidx == MMC_CMD_READ_MULTIPLE_BLOCK ||
+		cmd->cmdidx == MMC_CMD_WRITE_MULTIPLE_BLOCK;
+	ret = sandbox_mmc_transfer(priv, offset, data, write, true);
+	if (ret == -EILSEQ)
+		return ret;
+	if (write && multi)
+		priv->stats.multi_writes++;
+	else if (write)
+		priv->stats.single_writes++;
+	else if (multi)
+		priv->stats.multi_reads++;
+	else
+		priv->stats.single_reads++;
+
+	return ret;
+}
+
+/*
+ * Handle CMD25 after a packed CMD23: a header block lists each write as its
+ * CMD23 and CMD25 arguments, and their data follows
+ */
+static int sandbox_mmc_packed_write(struct sandbox_mmc_priv *priv,
+				    struct mmc_cmd *cmd, struct mmc_data *data)
+{
+	const __le32 *hdr = (const __le32 *)data->src;
+	const void *ptr = data->src + MMC_MAX_BLOCK_LEN;
+	uint blocks = priv->packed_blocks;
+	u32 word, count, addr;
+	uint num, i, total = 1;
+	int ret;
+
+	priv->packed_blocks = 0;
+	word = le32_to_cpu(hdr[0]);
+	num = word >> 16;
+	if (data->blocks != blocks || data->blocksize != MMC_MAX_BLOCK_LEN ||
+	    (word & 0xffff) != (MMC_PACKED_WRITE << 8 | MMC_PACKED_VERSION) ||
+	    !num || num > priv->ext_csd[EXT_CSD_MAX_PACKED_WRITES] ||
+	    le32_to_cpu(hdr[3]) != cmd->cmdarg)
+		return sandbox_mmc_protocol_error(priv, "bad packed header");
+	for (i = 1; i <= num; i++)
+		total += le32_to_cpu(hdr[i * 2]) & MMC_CMDQ_BLKCNT_MASK;
+	if (total != blocks)
+		return sandbox_mmc_protocol_error(priv, "bad packed length");
+
+	for (i = 1; i <= num; i++) {
+		count = le32_to_cpu(hdr[i * 2]) & MMC_CMDQ_BLKCNT_MASK;
+		addr = le32_to_cpu(hdr[i * 2 + 1]);
+		ret = sandbox_mmc_access(priv, (u64)addr * MMC_MAX_BLOCK_LEN,
+					 (void *)ptr, count * MMC_MAX_BLOCK_LEN,
+					 true);
+		if (ret)
+			return ret;
+		ptr += count * MMC_MAX_BLOCK_LEN;
+	}
+	priv->stats.packed_writes++;
+	priv->stats.packed_entries += num;
+	priv->stats.bytes_written += blocks * MMC_MAX_BLOCK_LEN;
+	sandbox_mmc_busy(priv, priv->write_latency * 1000ULL +
+			 sandbox_mmc_xfer_ns(priv, blocks * MMC_MAX_BLOCK_LEN,
+					     priv->write_rate));
+
+	return 0;
+}
+
+/* Handle CMD44, which gives the direction and size of a new task */
+static int sandbox_mmc_queue_params(struct sandbox_mmc_priv *priv, u32 arg)
+{
+	uint id = (arg >> 16) & 0x1f;
+
+	if (!sandbox_mmc_cmdq_enabled(priv) || id >= priv->cmdq_depth ||
+	    priv->queued & BIT(id) || priv->pending != -1 ||
+	    !(arg & MMC_CMDQ_BLKCNT_MASK))
+		return sandbox_mmc_protocol_error(priv, "bad CMD44");
+	priv->task_params[id] = arg;
+	priv->pending = id;
+
+	return 0;
+}
+
+/* Handle CMD45, which gives the address of the task and queues it */
+static int sandbox_mmc_queue_addr(struct sandbox_mmc_priv *priv, u32 arg)
+{
+	uint id = priv->pending;
+
+	if (priv->pending == -1)
+		return sandbox_mmc_protocol_error(priv, "CMD45 without CMD44");
+	priv->pending = -1;
+	priv->task_addr[id] = arg;
+	if (priv->queued)
+		priv->overlapped |= BIT(id);
+	else
+		priv->overlapped &= ~BIT(id);
+	if (priv->task_params[id] & MMC_CMDQ_DIR_READ)
+		priv->writes &= ~BIT(id);
+	else
+		priv->writes |= BIT(id);
+	priv->queued |= BIT(id);
+	priv->stats.cmdq_tasks++;
+	priv->stats.cmdq_max_queued = max_t(ulong, priv->stats.cmdq_max_queued,
+					    hweight32(priv->queued));
+
+	return 0;
+}
+
+/* Queue Status Register: reads are made ready first */
+static u32 sandbox_mmc_qsr(struct sandbox_mmc_priv *priv)
+{
+	u32 reads = priv->queued & ~priv->writes;
+
+	return reads ? reads : priv->queued;
+}
+
+/* Whether task @id shares a block with another queued task and one writes */
+static bool sandbox_mmc_task_conflict(struct sandbox_mmc_priv *priv, uint id)
+{
+	u32 start = priv->task_addr[id];
+	u32 end = start + (priv->task_params[id] & MMC_CMDQ_BLKCNT_MASK);
+	u32 other_start, other_end;
+	uint other;
+
+	for (other = 0; other < SANDBOX_MMC_CMDQ_TASKS; other++) {
+		if (other == id || !(priv->queued & BIT(other)))
+			continue;
+		if (!(priv->writes & (BIT(id) | BIT(other))))
+			continue;
+		other_start = priv->task_addr[other];
+		other_end = other_start +
+			    (priv->task_params[other] & MMC_CMDQ_BLKCNT_MASK);
+		if (start < other_end && other_start < end)
+			return true;
+	}
+
+	return false;
+}
+
+/* Handle CMD46 / CMD47, which move the data of a ready task */
+static int sandbox_mmc_execute_task(struct sandbox_mmc_priv *priv,
+				    struct mmc_cmd *cmd, struct mmc_data *data,
+				    bool write)
+{
+	uint id = (cmd->cmdarg >> 16) & 0x1f;
+	u32 params = priv->task_params[id];
+	bool latency = !(priv->overlapped & BIT(id));
+	int ret;
+
+	if (!sandbox_mmc_cmdq_enabled(priv) || !data ||
+	    !(priv->queued & BIT(id)) ||
+	    !(sandbox_mmc_qsr(priv) & BIT(id)))
+		return sandbox_mmc_protocol_error(priv, "task not ready");
+	if (!(priv->writes & BIT(id)) != !write ||
+	    data->blocks != (params & MMC_CMDQ_BLKCNT_MASK) ||
+	    data->blocksize != MMC_MAX_BLOCK_LEN)
+		return sandbox_mmc_protocol_error(priv, "task mismatch");
+	if (sandbox_mmc_task_conflict(priv, id))
+		return sandbox_mmc_protocol_error(priv, "overlapping tasks");
+
+	ret = sandbox_mmc_transfer(priv, (u64)priv->task_addr[id] *
+				   MMC_MAX_BLOCK_LEN, data, write, latency);
+	if (ret == -EILSEQ)
+		return ret;
+	priv->queued &= ~BIT(id);
+
+	return ret;
+}
+
+static int sandbox_mmc_erase(struct sandbox_mmc_priv *priv)
+{
+	u64 offset = (u64)priv->erase_start * MMC_MAX_BLOCK_LEN;
+	u64 size;
+	u8 *zero;
+	int ret = 0;
+
+	if (priv->erase_end < priv->erase_start)
+		return -EIO;
+	size = (u64)(priv->erase_end - priv->erase_start + 1) *
+	       MMC_MAX_BLOCK_LEN;
+	if (offset + size > priv->capacity)
+		return -EIO;
+	priv->stats.erases++;
+	sandbox_mmc_busy(priv, (u64)priv->write_latency * 1000);
+	if (priv->fd == -1) {
+		memset(priv->mem + offset, '\0', size);
+		return 0;
+	}
+
+	zero = calloc(1, SZ_64K);
+	if (!zero)
+		return -ENOMEM;
+	while (size && !ret) {
+		ulong len = min_t(u64, size, SZ_64K);
+
+		ret = sandbox_mmc_access(priv, offset, zero, len, true);
+		offset += len;
+		size -= len;
+	}
+	free(zero);
+
+	return ret;
+}
+
+/* Handle CMD6 for an eMMC, which writes a byte of the EXT_CSD */
+static void sandbox_mmc_switch(struct sandbox_mmc_priv *priv, u32 arg)
+{
+	uint index = (arg >> 16) & 0xff;
+	uint value = (arg >> 8) & 0xff;
+
+	/* Only the modes segment, below EXT_CSD_REV, is writable */
+	priv->switch_error = (arg >> 24) != MMC_SWITCH_MODE_WRITE_BYTE ||
+			     index >= EXT_CSD_REV;
+	if (index == EXT_CSD_CMDQ_MODE_EN) {
+		if (!priv->cmdq_depth)
+			priv->switch_error = true;
+		else if (!(value & 1) &&
+			 (priv->queued || priv->pending != -1)) {
+			sandbox_mmc_protocol_error(priv, "queue not empty");
+			priv->switch_error = true;
+		}
+	}
+	if (!priv->switch_error)
+		priv->ext_csd[index] = value;
+}
+
+#ifdef MMC_SUPPORTS_TUNING
+/* Handle CMD21, which only returns the right pattern in the tuning window */
+static int sandbox_mmc_tuning_block(struct sandbox_mmc_priv *priv,
+				    struct mmc_data *data)
+{
+	const u8 *pattern;
+	uint size;
+
+	priv->stats.tuning_cmds++;
+	if (!priv->emmc ||
+	    (priv->ext_csd[EXT_CSD_HS_TIMING] & 0xf) != EXT_CSD_TIMING_HS200)
+		return -ETIMEDOUT;
+	if (priv->bus_width == 8) {
+		pattern = tuning_blk_pattern_8bit;
+		size = sizeof(tuning_blk_pattern_8bit);
+	} else {
+		pattern = tuning_blk_pattern_4bit;
+		size = sizeof(tuning_blk_pattern_4bit);
+	}
+	if (data->blocksize != size)
+		return -EINVAL;
+	sandbox_mmc_busy(priv, sandbox_mmc_xfer_ns(priv, size,
+						   priv->read_rate));
+	if (!sandbox_mmc_sample_ok(priv))
+		memset(data->dest, 0xa5, size);
+	else
+		memcpy(data->dest, pattern, size);
+
+	return 0;
+}
+#endif
+
+/**
+ * sandbox_mmc_send_cmd() - Emulate SD / eMMC commands
+ *
+ * SD-only commands time out for an eMMC and CMD1 times out for an SD card, so
+ * that the MMC core detects the right type of card.
  */
 static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 				struct mmc_data *data)
 {
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->stats.cmds++;
+	sandbox_mmc_busy(priv, sandbox_mmc_cmd_ns(priv));
+
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
 		memset(cmd->response, '\0', sizeof(cmd->response));
@@ -33,21 +520,58 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		cmd->response[0] = 0 << 16; /* mmc->rca */
 	case MMC_CMD_GO_IDLE_STATE:
 		break;
-	case SD_CMD_SEND_IF_COND:
+	case MMC_CMD_SEND_OP_COND:
+		if (!priv->emmc)
+			return -ETIMEDOUT;
+		cmd->response[0] = OCR_BUSY | OCR_HCS | OCR_VOLTAGE_MASK;
+		break;
+	case SD_CMD_SEND_IF_COND:	/* also MMC_CMD_SEND_EXT_CSD */
+		if (priv->emmc) {
+			if (!data)
+				return -ETIMEDOUT;
+			if (!sandbox_mmc_sample_ok(priv))
+				return -EILSEQ;
+			memcpy(data->dest, priv->ext_csd, MMC_MAX_BLOCK_LEN);
+			priv->stats.bytes_read += MMC_MAX_BLOCK_LEN;
+			sandbox_mmc_busy(priv, sandbox_mmc_xfer_ns(priv,
+						MMC_MAX_BLOCK_LEN,
+						priv->read_rate));
+			break;
+		}
 		cmd->response[0] = 0xaa;
 		break;
-	case MMC_CMD_SEND_STATUS:
-		cmd->response[0] = MMC_STATUS_RDY_FOR_DATA;
+	case MMC_CMD_SEND_STATUS:	/* also SD_CMD_APP_SD_STATUS */
+		if (data)
+			memset(data->dest, '\0', data->blocks * data->blocksize);
+		if (priv->emmc && (cmd->cmdarg & MMC_SEND_STATUS_SQS)) {
+			if (!sandbox_mmc_cmdq_enabled(priv))
+				return sandbox_mmc_protocol_error(priv,
+							"QSR without queue");
+			cmd->response[0] = sandbox_mmc_qsr(priv);
+			break;
+		}
+		cmd->response[0] = MMC_STATUS_RDY_FOR_DATA |
+				   SANDBOX_MMC_STATE_TRAN;
+		if (priv->switch_error)
+			cmd->response[0] |= MMC_STATUS_SWITCH_ERROR;
 		break;
 	case MMC_CMD_SELECT_CARD:
 		break;
-	case MMC_CMD_SEND_CSD:
-		cmd->response[0] = 0;
-		cmd->response[1] = 10 << 16;	/* 1 << block_len */
-		cmd->response[2] = 0;
-		cmd->response[3] = 0;
+	case MMC_CMD_SEND_CSD: {
+		u32 csize = div_u64(priv->capacity, SZ_512K) - 1;
+
+		/* 25MHz legacy speed, CSD version 4 for an eMMC */
+		cmd->response[0] = (priv->emmc ? 4 << 26 : 1 << 30) | 0x32;
+		cmd->response[1] = 9 << 16 | csize >> 16;  /* 1 << block_len */
+		cmd->response[2] = csize << 16;
+		cmd->response[3] = priv->emmc ? 9 << 22 : 0;
 		break;
-	case SD_CMD_SWITCH_FUNC: {
+	}
+	case SD_CMD_SWITCH_FUNC: {	/* also MMC_CMD_SWITCH */
+		if (priv->emmc) {
+			sandbox_mmc_switch(priv, cmd->cmdarg);
+			break;
+		}
 		if (!data)
 			break;
 		u32 *resp = (u32 *)data->dest;
@@ -58,19 +582,65 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		break;
 	}
 	case MMC_CMD_READ_SINGLE_BLOCK:
-		memset(data->dest, '\0', data->blocksize);
-		break;
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
-		strcpy(data->dest, "this is a test");
+		return sandbox_mmc_rw(priv, cmd, data, false);
+	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
+		if (priv->packed_blocks)
+			return sandbox_mmc_packed_write(priv, cmd, data);
+		/* fall through */
+	case MMC_CMD_WRITE_SINGLE_BLOCK:
+		return sandbox_mmc_rw(priv, cmd, data, true);
+	case MMC_CMD_SET_BLOCK_COUNT:
+		priv->packed_blocks = 0;
+		if (priv->emmc && (cmd->cmdarg & MMC_CMD23_ARG_PACKED))
+			priv->packed_blocks = cmd->cmdarg & MMC_CMDQ_BLKCNT_MASK;
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
 		break;
+	case MMC_CMD_QUE_TASK_PARAMS:
+		if (!priv->emmc)
+			return -ETIMEDOUT;
+		return sandbox_mmc_queue_params(priv, cmd->cmdarg);
+	case MMC_CMD_QUE_TASK_ADDR:
+		if (!priv->emmc)
+			return -ETIMEDOUT;
+		return sandbox_mmc_queue_addr(priv, cmd->cmdarg);
+	case MMC_CMD_EXECUTE_READ_TASK:
+	case MMC_CMD_EXECUTE_WRITE_TASK:
+		if (!priv->emmc)
+			return -ETIMEDOUT;
+		return sandbox_mmc_execute_task(priv, cmd, data,
+				cmd->cmdidx == MMC_CMD_EXECUTE_WRITE_TASK);
+	case MMC_CMD_CMDQ_TASK_MGMT:
+		if (!priv->emmc)
+			return -ETIMEDOUT;
+		if (cmd->cmdarg == MMC_CMDQ_DISCARD_QUEUE) {
+			priv->queued = 0;
+			priv->pending = -1;
+		}
+		break;
+	case SD_CMD_ERASE_WR_BLK_START:
+	case MMC_CMD_ERASE_GROUP_START:
+		priv->erase_start = cmd->cmdarg;
+		break;
+	case SD_CMD_ERASE_WR_BLK_END:
+	case MMC_CMD_ERASE_GROUP_END:
+		priv->erase_end = cmd->cmdarg;
+		break;
+	case MMC_CMD_ERASE:
+		return sandbox_mmc_erase(priv);
+#ifdef MMC_SUPPORTS_TUNING
+	case MMC_CMD_SEND_TUNING_BLOCK_HS200:
+		return sandbox_mmc_tuning_block(priv, data);
+#endif
 	case SD_CMD_APP_SEND_OP_COND:
 		cmd->response[0] = OCR_BUSY | OCR_HCS;
 		cmd->response[1] = 0;
 		cmd->response[2] = 0;
 		break;
 	case MMC_CMD_APP_CMD:
+		if (priv->emmc)
+			return -ETIMEDOUT;
 		break;
 	case MMC_CMD_SET_BLOCKLEN:
 		debug("block len %d\n", cmd->cmdarg);
@@ -91,6 +661,13 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 
 static int sandbox_mmc_set_ios(struct udevice *dev)
 {
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	priv->clock = mmc->clock;
+	priv->bus_width = mmc->bus_width;
+	priv->ddr = mmc->ddr_mode;
+
 	return 0;
 }
 
@@ -99,17 +676,184 @@ static int sandbox_mmc_get_cd(struct udevice *dev)
 	return 1;
 }
 
+#ifdef MMC_SUPPORTS_TUNING
+/* Sweep all phases and settle in the middle of the first working window */
+static int sandbox_mmc_execute_tuning(struct udevice *dev, uint opcode)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	int first = -1, last = -1;
+	uint phase;
+
+	for (phase = 0; phase < SANDBOX_MMC_TUNING_PHASES; phase++) {
+		priv->phase = phase;
+		if (mmc_send_tuning(mmc, opcode, NULL)) {
+			if (first != -1)
+				break;
+			continue;
+		}
+		if (first == -1)
+			first = phase;
+		last = phase;
+	}
+	if (first == -1) {
+		priv->phase = 0;
+		return -EIO;
+	}
+	priv->phase = (first + last) / 2;
+
+	return 0;
+}
+#endif
+
+static int sandbox_mmc_wait_dat0(struct udevice *dev, int state,
+				 int timeout_us)
+{
+	/* The card is never busy for longer than the command takes */
+	return 0;
+}
+
 static const struct dm_mmc_ops sandbox_mmc_ops = {
 	.send_cmd = sandbox_mmc_send_cmd,
 	.set_ios = sandbox_mmc_set_ios,
 	.get_cd = sandbox_mmc_get_cd,
+#ifdef MMC_SUPPORTS_TUNING
+	.execute_tuning = sandbox_mmc_execute_tuning,
+#endif
+	.wait_dat0 = sandbox_mmc_wait_dat0,
 };
 
+void sandbox_mmc_get_stats(struct udevice *dev, struct sandbox_mmc_stats *stats)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	*stats = priv->stats;
+}
+
+uint sandbox_mmc_get_tuning_phase(struct udevice *dev)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	return priv->phase;
+}
+
+void sandbox_mmc_set_cmdq(struct udevice *dev, uint depth, uint max_packed)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+	u8 *ext_csd = priv->ext_csd;
+
+	priv->cmdq_depth = min(depth, (uint)SANDBOX_MMC_CMDQ_TASKS);
+	priv->queued = 0;
+	priv->pending = -1;
+	ext_csd[EXT_CSD_CMDQ_MODE_EN] = 0;
+	ext_csd[EXT_CSD_CMDQ_SUPPORT] = !!priv->cmdq_depth;
+	ext_csd[EXT_CSD_CMDQ_DEPTH] = priv->cmdq_depth ?
+				      priv->cmdq_depth - 1 : 0;
+	ext_csd[EXT_CSD_MAX_PACKED_WRITES] = min(max_packed, (uint)U8_MAX);
+}
+
+static void sandbox_mmc_setup_ext_csd(struct sandbox_mmc_priv *priv)
+{
+	u32 sectors = div_u64(priv->capacity, MMC_MAX_BLOCK_LEN);
+	u8 *ext_csd = priv->ext_csd;
+
+	ext_csd[EXT_CSD_REV] = 8;	/* eMMC 5.1 */
+	ext_csd[EXT_CSD_CARD_TYPE] = EXT_CSD_CARD_TYPE_26 |
+				     EXT_CSD_CARD_TYPE_52 |
+				     EXT_CSD_CARD_TYPE_HS200_1_8V;
+	ext_csd[EXT_CSD_SEC_CNT] = sectors;
+	ext_csd[EXT_CSD_SEC_CNT + 1] = sectors >> 8;
+	ext_csd[EXT_CSD_SEC_CNT + 2] = sectors >> 16;
+	ext_csd[EXT_CSD_SEC_CNT + 3] = sectors >> 24;
+	ext_csd[EXT_CSD_HC_WP_GRP_SIZE] = 1;
+	ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE] = 1;
+}
+
 int sandbox_mmc_probe(struct udevice *dev)
 {
 	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+	u32 window[2] = { 4, 11 };
+	const char *path;
+	u32 size_kb;
+	int ret;
+
+	priv->emmc = dev_read_bool(dev, "sandbox,emmc");
+	priv->read_latency = dev_read_u32_default(dev,
+						  "sandbox,read-latency-us",
+						  100);
+	priv->write_latency = dev_read_u32_default(dev,
+						   "sandbox,write-latency-us",
+						   500);
+	priv->read_rate = dev_read_u32_default(dev, "sandbox,read-rate-kbps",
+					       80 * 1024);
+	priv->write_rate = dev_read_u32_default(dev, "sandbox,write-rate-kbps",
+						20 * 1024);
+	priv->real_time = dev_read_bool(dev, "sandbox,real-time");
+	dev_read_u32_array(dev, "sandbox,tuning-window", window, 2);
+	priv->window_first = window[0];
+	priv->window_last = window[1];
+	if (!priv->read_rate || !priv->write_rate)
+		return -EINVAL;
+
+	size_kb = dev_read_u32_default(dev, "sandbox,capacity-kb", 0);
+	priv->fd = -1;
+	path = dev_read_string(dev, "sandbox,filepath");
+	if (path) {
+		priv->fd = os_open(path, OS_O_RDWR | OS_O_CREAT);
+		if (priv->fd < 0) {
+			printf("%s: Cannot open '%s'\n", dev->name, path);
+			return -ENOENT;
+		}
+		if (!size_kb)
+			size_kb = os_lseek(priv->fd, 0, OS_SEEK_END) / SZ_1K;
+	}
+	if (!size_kb)
+		size_kb = SZ_1K;
+	priv->capacity = (u64)(size_kb & ~(SZ_512 - 1)) * SZ_1K;
+	if (!priv->capacity) {
+		printf("%s: Capacity must be at least 512KiB\n", dev->name);
+		ret = -EINVAL;
+		goto err;
+	}
+	if (priv->fd == -1) {
+		priv->mem = calloc(1, priv->capacity);
+		if (!priv->mem)
+			return -ENOMEM;
+	}
+	priv->pending = -1;
+	if (priv->emmc) {
+		sandbox_mmc_setup_ext_csd(priv);
+		sandbox_mmc_set_cmdq(dev,
+				     dev_read_u32_default(dev,
+							  "sandbox,cmdq-depth",
+							  0),
+				     dev_read_u32_default(dev,
+						"sandbox,max-packed-writes", 0));
+	}
+
+	ret = mmc_init(&plat->mmc);
+	if (ret)
+		goto err;
+
+	return 0;
+err:
+	if (priv->fd != -1)
+		os_close(priv->fd);
+	free(priv->mem);
 
-	return mmc_init(&plat->mmc);
+	return ret;
+}
+
+int sandbox_mmc_remove(struct udevice *dev)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	if (priv->fd != -1)
+		os_close(priv->fd);
+	free(priv->mem);
+
+	return 0;
 }
 
 int sandbox_mmc_bind(struct udevice *dev)
@@ -123,6 +867,10 @@ int sandbox_mmc_bind(struct udevice *dev)
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
 	cfg->b_max = U32_MAX;
+	if (dev_read_bool(dev, "sandbox,emmc")) {
+		cfg->host_caps |= MMC_MODE_HS200 | MMC_CAP_CMDQ;
+		cfg->f_max = 200000000;
+	}
 
 	return mmc_bind(dev, &plat->mmc, cfg);
 }
@@ -147,5 +895,7 @@ U_BOOT_DRIVER(mmc_sandbox) = {
 	.bind		= sandbox_mmc_bind,
 	.unbind		= sandbox_mmc_unbind,
 	.probe		= sandbox_mmc_probe,
+	.remove		= sandbox_mmc_remove,
+	.priv_auto_alloc_size = sizeof(struct sandbox_mmc_priv),
 	.platdata_auto_alloc_size = sizeof(struct sandbox_mmc_plat),
 };
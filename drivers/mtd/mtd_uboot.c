@@ -17,6 +17,23 @@
 
 void board_mtdparts_default(const char **mtdids, const char **mtdparts);
 
+/* Bumped each time mtdids or mtdparts is set or deleted */
+static ulong mtd_env_gen = 1;
+
+ulong mtd_env_generation(void)
+{
+	return mtd_env_gen;
+}
+
+static int on_mtdparts(const char *name, const char *value, enum env_op op,
+		       int flags)
+{
+	mtd_env_gen++;
+
+	return 0;
+}
+U_BOOT_ENV_CALLBACK(mtdparts, on_mtdparts);
+
 static const char *get_mtdids(void)
 {
 	__maybe_unused const char *mtdparts = NULL;
@@ -172,8 +189,63 @@ static int mtd_del_parts(struct mtd_info *mtd, bool quiet)
 
 static bool mtd_del_all_parts_failed;
 
-static void mtd_del_all_parts(void)
+/**
+ * struct mtd_parsed_dev - partitions parsed from mtdparts for one device
+ *
+ * @mtd: MTD device the partitions belong to, with a reference held
+ * @parts: Partitions, from mtd_parse_partitions()
+ * @nparts: Number of partitions
+ * @keep: The partitions registered on @mtd already match @parts
+ */
+struct mtd_parsed_dev {
+	struct mtd_info *mtd;
+	struct mtd_partition *parts;
+	int nparts;
+	bool keep;
+};
+
+static struct mtd_parsed_dev *mtd_find_parsed(struct mtd_parsed_dev *devs,
+					      int ndevs, struct mtd_info *mtd)
+{
+	int i;
+
+	for (i = 0; i < ndevs; i++) {
+		if (devs[i].mtd == mtd)
+			return &devs[i];
+	}
+
+	return NULL;
+}
+
+/* Check whether the partitions registered on @mtd are the parsed ones */
+static bool mtd_parts_match(struct mtd_info *mtd, struct mtd_parsed_dev *pdev)
 {
+	struct mtd_info *slave;
+	int i = 0;
+
+	list_for_each_entry(slave, &mtd->partitions, node) {
+		const struct mtd_partition *part = &pdev->parts[i];
+
+		if (i == pdev->nparts || mtd_has_partitions(slave) ||
+		    strcmp(slave->name, part->name) ||
+		    slave->offset != part->offset ||
+		    slave->size != part->size ||
+		    slave->flags != (mtd->flags & ~part->mask_flags))
+			return false;
+		i++;
+	}
+
+	return i == pdev->nparts;
+}
+
+/*
+ * Delete the partitions of every device, except those which are registered
+ * already exactly as parsed: they stay as they are, so that anything using
+ * them keeps a valid mtd_info.
+ */
+static void mtd_del_all_parts(struct mtd_parsed_dev *devs, int ndevs)
+{
+	struct mtd_parsed_dev *pdev;
 	struct mtd_info *mtd;
 	int ret = 0;
 
@@ -187,6 +259,16 @@ static void mtd_del_all_parts(void)
 	 */
 	do {
 		mtd_for_each_device(mtd) {
+			pdev = mtd_find_parsed(devs, ndevs, mtd);
+			if (pdev && pdev->keep)
+				continue;
+
+			if (pdev && mtd_has_partitions(mtd) &&
+			    mtd_parts_match(mtd, pdev)) {
+				pdev->keep = true;
+				continue;
+			}
+
 			ret = mtd_del_parts(mtd, false);
 			if (ret > 0)
 				break;
@@ -196,52 +278,47 @@ static void mtd_del_all_parts(void)
 	} while (ret > 0);
 }
 
-int mtd_probe_devices(void)
+/*
+ * Look up the device named @mtd_name in mtdparts, either directly or through
+ * the mtdids mapping.
+ */
+static struct mtd_info *mtd_get_parts_device(const char *mtd_name)
 {
-	static char *old_mtdparts;
-	static char *old_mtdids;
-	const char *mtdparts = get_mtdparts();
-	const char *mtdids = get_mtdids();
-	const char *mtdparts_next = mtdparts;
+	char linux_name[MTD_NAME_MAX_LEN];
 	struct mtd_info *mtd;
+	int ret;
 
-	mtd_probe_uclass_mtd_devs();
+	mtd = get_mtd_device_nm(mtd_name);
+	if (!IS_ERR_OR_NULL(mtd))
+		return mtd;
 
 	/*
-	 * Check if mtdparts/mtdids changed, if the MTD dev list was updated
-	 * or if our previous attempt to delete existing partititions failed.
-	 * In any of these cases we want to update the partitions, otherwise,
-	 * everything is up-to-date and we can return 0 directly.
+	 * The MTD device named "mtd_name" does not exist. Try to find a
+	 * correspondance with an MTD device having the same type and number
+	 * as defined in the mtdids.
 	 */
-	if ((!mtdparts && !old_mtdparts && !mtdids && !old_mtdids) ||
-	    (mtdparts && old_mtdparts && mtdids && old_mtdids &&
-	     !mtd_dev_list_updated() && !mtd_del_all_parts_failed &&
-	     !strcmp(mtdparts, old_mtdparts) &&
-	     !strcmp(mtdids, old_mtdids)))
-		return 0;
-
-	/* Update the local copy of mtdparts */
-	free(old_mtdparts);
-	free(old_mtdids);
-	old_mtdparts = strdup(mtdparts);
-	old_mtdids = strdup(mtdids);
+	debug("No device named %s\n", mtd_name);
+	ret = mtd_search_alternate_name(mtd_name, linux_name,
+					MTD_NAME_MAX_LEN);
+	if (ret)
+		return NULL;
 
-	/*
-	 * Remove all old parts. Note that partition removal can fail in case
-	 * one of the partition is still being used by an MTD user, so this
-	 * does not guarantee that all old partitions are gone.
-	 */
-	mtd_del_all_parts();
+	mtd = get_mtd_device_nm(linux_name);
+	if (IS_ERR_OR_NULL(mtd))
+		return NULL;
 
-	/*
-	 * Call mtd_dev_list_updated() to clear updates generated by our own
-	 * parts removal loop.
-	 */
-	mtd_dev_list_updated();
+	return mtd;
+}
 
-	/* If either mtdparts or mtdids is empty, then exit */
-	if (!mtdparts || !mtdids)
-		return 0;
+/*
+ * Parse mtdparts into one entry of @devs for each device it names. Devices
+ * which cannot be found are skipped.
+ */
+static int mtd_parse_all_parts(const char *mtdparts,
+			       struct mtd_parsed_dev *devs, int *ndevs)
+{
+	const char *mtdparts_next = mtdparts;
+	struct mtd_info *mtd;
 
 	/* Start the parsing by ignoring the extra 'mtdparts=' prefix, if any */
 	if (!strncmp(mtdparts, "mtdparts=", sizeof("mtdparts=") - 1))
@@ -279,43 +356,17 @@ int mtd_probe_devices(void)
 		mtd_name[mtd_name_len] = '\0';
 		/* Move the pointer forward (including the ':') */
 		mtdparts += mtd_name_len + 1;
-		mtd = get_mtd_device_nm(mtd_name);
-		if (IS_ERR_OR_NULL(mtd)) {
-			char linux_name[MTD_NAME_MAX_LEN];
-
-			/*
-			 * The MTD device named "mtd_name" does not exist. Try
-			 * to find a correspondance with an MTD device having
-			 * the same type and number as defined in the mtdids.
-			 */
-			debug("No device named %s\n", mtd_name);
-			ret = mtd_search_alternate_name(mtd_name, linux_name,
-							MTD_NAME_MAX_LEN);
-			if (!ret)
-				mtd = get_mtd_device_nm(linux_name);
-
-			/*
-			 * If no device could be found, move the mtdparts
-			 * pointer forward until the next set of partitions.
-			 */
-			if (ret || IS_ERR_OR_NULL(mtd)) {
-				printf("Could not find a valid device for %s\n",
-				       mtd_name);
-				mtdparts = mtdparts_next;
-				continue;
-			}
-		}
 
 		/*
-		 * Call mtd_del_parts() again, even if it's already been called
-		 * in mtd_del_all_parts(). We need to know if old partitions are
-		 * still around (because they are still being used by someone),
-		 * and if they are, we shouldn't create new partitions, so just
-		 * skip this MTD device and try the next one.
+		 * If no device could be found, move the mtdparts pointer
+		 * forward until the next set of partitions.
 		 */
-		ret = mtd_del_parts(mtd, true);
-		if (ret < 0)
+		mtd = mtd_get_parts_device(mtd_name);
+		if (!mtd) {
+			printf("Could not find a valid device for %s\n",
+			       mtd_name);
 			continue;
+		}
 
 		/*
 		 * Parse the MTD device partitions. It will update the mtdparts
@@ -329,25 +380,122 @@ int mtd_probe_devices(void)
 			return -EINVAL;
 		}
 
-		if (!nparts)
+		if (!nparts || mtd_find_parsed(devs, *ndevs, mtd)) {
+			mtd_free_parsed_partitions(parts, nparts);
+			put_mtd_device(mtd);
 			continue;
+		}
 
-		/* Create the new MTD partitions */
-		add_mtd_partitions(mtd, parts, nparts);
+		devs[*ndevs].mtd = mtd;
+		devs[*ndevs].parts = parts;
+		devs[*ndevs].nparts = nparts;
+		devs[*ndevs].keep = false;
+		(*ndevs)++;
+	}
 
-		/* Free the structures allocated during the parsing */
-		mtd_free_parsed_partitions(parts, nparts);
+	return 0;
+}
+
+int mtd_probe_devices(void)
+{
+	static char *old_mtdparts;
+	static char *old_mtdids;
+	static ulong old_env_gen;
+	const char *mtdparts = get_mtdparts();
+	const char *mtdids = get_mtdids();
+	struct mtd_parsed_dev *devs = NULL;
+	bool env_ready = gd->flags & GD_FLG_ENV_READY;
+	bool dev_list_updated;
+	const char *p;
+	int ndevs = 0;
+	int i, ret;
+
+	mtd_probe_uclass_mtd_devs();
+	dev_list_updated = mtd_dev_list_updated();
+
+	/*
+	 * Neither variable was set since the partitions were last created, so
+	 * there is not even a string to compare.
+	 */
+	if (env_ready && old_env_gen == mtd_env_generation() &&
+	    !dev_list_updated && !mtd_del_all_parts_failed)
+		return 0;
+
+	/*
+	 * Check if mtdparts/mtdids changed, if the MTD dev list was updated
+	 * or if our previous attempt to delete existing partititions failed.
+	 * In any of these cases we want to update the partitions, otherwise,
+	 * everything is up-to-date and we can return 0 directly.
+	 */
+	if ((!mtdparts && !old_mtdparts && !mtdids && !old_mtdids) ||
+	    (mtdparts && old_mtdparts && mtdids && old_mtdids &&
+	     !dev_list_updated && !mtd_del_all_parts_failed &&
+	     !strcmp(mtdparts, old_mtdparts) &&
+	     !strcmp(mtdids, old_mtdids))) {
+		if (env_ready)
+			old_env_gen = mtd_env_generation();
+		return 0;
+	}
+
+	/* Update the local copy of mtdparts */
+	free(old_mtdparts);
+	free(old_mtdids);
+	old_mtdparts = strdup(mtdparts);
+	old_mtdids = strdup(mtdids);
+	if (env_ready)
+		old_env_gen = mtd_env_generation();
+
+	/*
+	 * Parse everything first, so that the partitions which did not change
+	 * can be told apart from the others. There is at most one device per
+	 * ';' separated entry.
+	 */
+	ret = 0;
+	if (mtdparts && mtdids) {
+		for (i = 1, p = mtdparts; *p; p++)
+			i += *p == ';';
 
-		put_mtd_device(mtd);
+		devs = calloc(i, sizeof(*devs));
+		if (!devs)
+			return -ENOMEM;
+
+		ret = mtd_parse_all_parts(mtdparts, devs, &ndevs);
 	}
 
+	/*
+	 * Remove all old parts which changed. Note that partition removal can
+	 * fail in case one of the partition is still being used by an MTD
+	 * user, so this does not guarantee that all old partitions are gone.
+	 */
+	mtd_del_all_parts(devs, ndevs);
+
+	for (i = 0; i < ndevs; i++) {
+		struct mtd_parsed_dev *pdev = &devs[i];
+
+		/*
+		 * Call mtd_del_parts() again, even if it's already been called
+		 * in mtd_del_all_parts(). We need to know if old partitions are
+		 * still around (because they are still being used by someone),
+		 * and if they are, we shouldn't create new partitions, so just
+		 * skip this MTD device and try the next one.
+		 */
+		if (!ret && !pdev->keep && mtd_del_parts(pdev->mtd, true) >= 0)
+			add_mtd_partitions(pdev->mtd, pdev->parts,
+					   pdev->nparts);
+
+		/* Free the structures allocated during the parsing */
+		mtd_free_parsed_partitions(pdev->parts, pdev->nparts);
+		put_mtd_device(pdev->mtd);
+	}
+	free(devs);
+
 	/*
 	 * Call mtd_dev_list_updated() to clear updates generated by our own
-	 * parts registration loop.
+	 * parts removal and registration loops.
 	 */
 	mtd_dev_list_updated();
 
-	return 0;
+	return ret;
 }
 #else
 int mtd_probe_devices(void)
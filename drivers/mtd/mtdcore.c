@@ -110,20 +110,19 @@ void *idr_find(struct idr *idp, int id)
 
 void *idr_get_next(struct idr *idp, int *next)
 {
-	void *ret;
-	int id = *next;
+	int id;
 
-	ret = idr_find(idp, id);
-	if (ret) {
-		id ++;
-		if (!idp->id[id].used)
-			id = 0;
-		*next = id;
-	} else {
-		*next = 0;
+	/* Skip the holes left by removed devices */
+	for (id = *next; id < MAX_IDR_ID; id++) {
+		if (idp->id[id].used) {
+			*next = id;
+			return idp->id[id].ptr;
+		}
 	}
-	
-	return ret;
+
+	*next = 0;
+
+	return NULL;
 }
 
 int idr_alloc(struct idr *idp, void *ptr, int start, int end, gfp_t gfp_mask)
@@ -147,6 +146,30 @@ int idr_alloc(struct idr *idp, void *ptr, int start, int end, gfp_t gfp_mask)
 
 static DEFINE_IDR(mtd_idr);
 
+#ifdef __UBOOT__
+#define MTD_NAME_HASH_SIZE	32
+
+/* Devices by name, so that lookups do not walk the whole table */
+static struct hlist_head mtd_name_hash[MTD_NAME_HASH_SIZE];
+
+static struct hlist_head *mtd_name_bucket(const char *name)
+{
+	unsigned int hash = 0;
+
+	while (*name)
+		hash = hash * 31 + *name++;
+
+	return &mtd_name_hash[hash % MTD_NAME_HASH_SIZE];
+}
+
+static void mtd_name_rehash(struct mtd_info *mtd)
+{
+	hlist_del_init(&mtd->name_node);
+	if (mtd->name)
+		hlist_add_head(&mtd->name_node, mtd_name_bucket(mtd->name));
+}
+#endif
+
 /* These are exported solely for the purpose of mtd_blkdevs.c. You
    should not use them for _anything_ else */
 DEFINE_MUTEX(mtd_table_mutex);
@@ -440,6 +463,10 @@ int add_mtd_device(struct mtd_info *mtd)
 	mtd->usecount = 0;
 
 	INIT_LIST_HEAD(&mtd->partitions);
+#ifdef __UBOOT__
+	INIT_HLIST_NODE(&mtd->name_node);
+	mtd_name_rehash(mtd);
+#endif
 
 	/* default value if not set by driver */
 	if (mtd->bitflip_threshold == 0)
@@ -558,6 +585,9 @@ int del_mtd_device(struct mtd_info *mtd)
 #endif
 
 		idr_remove(&mtd_idr, mtd->index);
+#ifdef __UBOOT__
+		hlist_del_init(&mtd->name_node);
+#endif
 
 		module_put(THIS_MODULE);
 		ret = 0;
@@ -779,15 +809,34 @@ struct mtd_info *get_mtd_device_nm(const char *name)
 {
 	int err = -ENODEV;
 	struct mtd_info *mtd = NULL, *other;
+#ifdef __UBOOT__
+	struct hlist_node *pos;
+#endif
 
 	mutex_lock(&mtd_table_mutex);
 
-	mtd_for_each_device(other) {
+#ifdef __UBOOT__
+	hlist_for_each_entry(other, pos, mtd_name_bucket(name), name_node) {
 		if (!strcmp(name, other->name)) {
 			mtd = other;
 			break;
 		}
 	}
+#endif
+
+	/* Devices which were renamed after being added are not hashed */
+	if (!mtd) {
+		mtd_for_each_device(other) {
+			if (!strcmp(name, other->name)) {
+				mtd = other;
+				break;
+			}
+		}
+#ifdef __UBOOT__
+		if (mtd)
+			mtd_name_rehash(mtd);
+#endif
+	}
 
 	if (!mtd)
 		goto out_unlock;
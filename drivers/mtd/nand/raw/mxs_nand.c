@@ -29,7 +29,23 @@
 #include <asm/arch/sys_proto.h>
 #include <mxs_nand.h>
 
+#if defined(CONFIG_NAND_MXS_MULTI_PAGES) && !defined(CONFIG_SPL_BUILD)
+#define	MXS_NAND_MULTI_PAGES			CONFIG_NAND_MXS_MULTI_PAGES
+#else
+#define	MXS_NAND_MULTI_PAGES			0
+#endif
+
+/*
+ * A chained read takes five descriptors per page (address, READSTART, wait,
+ * BCH read, BCH disable) plus the final interrupt.
+ */
+#define	MXS_NAND_MULTI_DESC_PER_PAGE		5
+#if MXS_NAND_MULTI_PAGES > 1
+#define	MXS_NAND_DMA_DESCRIPTOR_COUNT		\
+	(MXS_NAND_MULTI_PAGES * MXS_NAND_MULTI_DESC_PER_PAGE + 1)
+#else
 #define	MXS_NAND_DMA_DESCRIPTOR_COUNT		4
+#endif
 
 #if (defined(CONFIG_MX6) || defined(CONFIG_MX7) || defined(CONFIG_IMX8) || defined(CONFIG_IMX8M))
 #define	MXS_NAND_CHUNK_DATA_CHUNK_SIZE_SHIFT	2
@@ -47,6 +63,13 @@
 
 #define	MXS_NAND_BCH_TIMEOUT			10000
 
+/* Command bytes kept for each page of a chained read */
+#define	MXS_NAND_MULTI_CMD_STRIDE		8
+#define	MXS_NAND_MULTI_CMD_READSTART		6
+
+/* Never written by the BCH, which reports 0x00-0x3e, 0xfe or 0xff */
+#define	MXS_NAND_STATUS_PENDING			0xfd
+
 struct nand_ecclayout fake_ecc_layout;
 
 /*
@@ -73,10 +96,26 @@ static void mxs_nand_flush_cmd_buf(struct mxs_nand_info *info)
 
 	flush_dcache_range(addr, addr + MXS_NAND_COMMAND_BUFFER_SIZE);
 }
+
+static void mxs_nand_flush_range(void *buf, size_t len)
+{
+	uint32_t addr = (uintptr_t)buf;
+
+	flush_dcache_range(addr, addr + roundup(len, MXS_DMA_ALIGNMENT));
+}
+
+static void mxs_nand_inval_range(void *buf, size_t len)
+{
+	uint32_t addr = (uintptr_t)buf;
+
+	invalidate_dcache_range(addr, addr + roundup(len, MXS_DMA_ALIGNMENT));
+}
 #else
 static inline void mxs_nand_flush_data_buf(struct mxs_nand_info *info) {}
 static inline void mxs_nand_inval_data_buf(struct mxs_nand_info *info) {}
 static inline void mxs_nand_flush_cmd_buf(struct mxs_nand_info *info) {}
+static inline void mxs_nand_flush_range(void *buf, size_t len) {}
+static inline void mxs_nand_inval_range(void *buf, size_t len) {}
 #endif
 
 static struct mxs_dma_desc *mxs_nand_get_dma_desc(struct mxs_nand_info *info)
@@ -653,21 +692,15 @@ static bool mxs_nand_erased_page(struct mtd_info *mtd, struct nand_chip *nand,
 }
 
 /*
- * Read a page from NAND.
+ * Queue the descriptors which wait for the page to be ready, read it through
+ * the BCH into the given data and auxiliary buffers and then disable the BCH.
  */
-static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
-					uint8_t *buf, int oob_required,
-					int page)
+static void mxs_nand_append_ecc_read(struct mtd_info *mtd,
+				     struct mxs_nand_info *nand_info,
+				     uint8_t *data, uint8_t *aux, int page)
 {
-	struct mxs_nand_info *nand_info = nand_get_controller_data(nand);
-	struct bch_geometry *geo = &nand_info->bch_geometry;
-	struct mxs_bch_regs *bch_regs = nand_info->bch_regs;
-	struct mxs_dma_desc *d;
 	uint32_t channel = MXS_DMA_CHANNEL_AHB_APBH_GPMI0 + nand_info->cur_chip;
-	uint32_t corrected = 0, failed = 0;
-	uint8_t	*status;
-	int i, ret;
-	int flag = 0;
+	struct mxs_dma_desc *d;
 
 	/* Compile the DMA descriptor - wait for ready. */
 	d = mxs_nand_get_dma_desc(nand_info);
@@ -706,8 +739,8 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 		GPMI_ECCCTRL_ECC_CMD_DECODE |
 		GPMI_ECCCTRL_BUFFER_MASK_BCH_PAGE;
 	d->cmd.pio_words[3] = mtd->writesize + mtd->oobsize;
-	d->cmd.pio_words[4] = (dma_addr_t)nand_info->data_buf;
-	d->cmd.pio_words[5] = (dma_addr_t)nand_info->oob_buf;
+	d->cmd.pio_words[4] = (dma_addr_t)data;
+	d->cmd.pio_words[5] = (dma_addr_t)aux;
 
 	if (nand_info->en_randomizer) {
 		d->cmd.pio_words[2] |= GPMI_ECCCTRL_RANDOMIZER_ENABLE |
@@ -736,6 +769,48 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 	d->cmd.pio_words[2] = 0;
 
 	mxs_dma_desc_append(channel, d);
+}
+
+/*
+ * Invalidate only the part of the DMA buffers a page read writes to.
+ */
+static void mxs_nand_inval_page(struct mtd_info *mtd,
+				struct mxs_nand_info *nand_info)
+{
+	mxs_nand_inval_range(nand_info->data_buf, mtd->writesize);
+	mxs_nand_inval_range(nand_info->oob_buf, mtd->oobsize);
+}
+
+/*
+ * On these SoCs the BCH reports a chunk as erased even if it holds a few
+ * bitflips, which then have to be looked up in the DEBUG1 register.
+ */
+static bool mxs_nand_check_erased_bits(struct mxs_nand_info *nand_info)
+{
+	return !nand_info->en_randomizer &&
+	       (is_mx6dqp() || is_mx7() || is_mx6ul() ||
+		is_imx8() || is_imx8m());
+}
+
+/*
+ * Read a page from NAND.
+ */
+static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
+					uint8_t *buf, int oob_required,
+					int page)
+{
+	struct mxs_nand_info *nand_info = nand_get_controller_data(nand);
+	struct bch_geometry *geo = &nand_info->bch_geometry;
+	struct mxs_bch_regs *bch_regs = nand_info->bch_regs;
+	struct mxs_dma_desc *d;
+	uint32_t channel = MXS_DMA_CHANNEL_AHB_APBH_GPMI0 + nand_info->cur_chip;
+	uint32_t corrected = 0, failed = 0;
+	uint8_t	*status;
+	int i, ret;
+	int flag = 0;
+
+	mxs_nand_append_ecc_read(mtd, nand_info, nand_info->data_buf,
+				 nand_info->oob_buf, page);
 
 	/* Compile the DMA descriptor - deassert the NAND lock and interrupt. */
 	d = mxs_nand_get_dma_desc(nand_info);
@@ -748,7 +823,7 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 	mxs_dma_desc_append(channel, d);
 
 	/* Invalidate caches */
-	mxs_nand_inval_data_buf(nand_info);
+	mxs_nand_inval_page(mtd, nand_info);
 
 	/* Execute the DMA chain. */
 	ret = mxs_dma_go(channel);
@@ -766,7 +841,7 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 	mxs_nand_return_dma_descs(nand_info);
 
 	/* Invalidate caches */
-	mxs_nand_inval_data_buf(nand_info);
+	mxs_nand_inval_page(mtd, nand_info);
 
 	/* Read DMA completed, now do the mark swapping. */
 	mxs_nand_swap_block_mark(geo, nand_info->data_buf, nand_info->oob_buf);
@@ -778,9 +853,7 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 			continue;
 
 		if (status[i] == 0xff) {
-			if (!nand_info->en_randomizer &&
-			    (is_mx6dqp() || is_mx7() || is_mx6ul()
-			    || is_imx8() || is_imx8m()))
+			if (mxs_nand_check_erased_bits(nand_info))
 				if (readl(&bch_regs->hw_bch_debug1))
 					flag = 1;
 			continue;
@@ -824,6 +897,249 @@ rtn:
 	return ret;
 }
 
+#if MXS_NAND_MULTI_PAGES > 1
+/*
+ * Queue a command byte, followed by its address cycles if there are any.
+ */
+static void mxs_nand_append_cmd(struct mxs_nand_info *nand_info,
+				uint8_t *cmd, int len)
+{
+	uint32_t channel = MXS_DMA_CHANNEL_AHB_APBH_GPMI0 + nand_info->cur_chip;
+	struct mxs_dma_desc *d;
+
+	d = mxs_nand_get_dma_desc(nand_info);
+	d->cmd.data =
+		MXS_DMA_DESC_COMMAND_DMA_READ | MXS_DMA_DESC_CHAIN |
+		MXS_DMA_DESC_WAIT4END | (3 << MXS_DMA_DESC_PIO_WORDS_OFFSET) |
+		(len << MXS_DMA_DESC_BYTES_OFFSET);
+
+	d->cmd.address = (dma_addr_t)cmd;
+
+	d->cmd.pio_words[0] =
+		GPMI_CTRL0_COMMAND_MODE_WRITE |
+		GPMI_CTRL0_WORD_LENGTH |
+		(nand_info->cur_chip << GPMI_CTRL0_CS_OFFSET) |
+		GPMI_CTRL0_ADDRESS_NAND_CLE |
+		(len > 1 ? GPMI_CTRL0_ADDRESS_INCREMENT : 0) |
+		len;
+	d->cmd.pio_words[1] = 0;
+	d->cmd.pio_words[2] = 0;
+
+	mxs_dma_desc_append(channel, d);
+}
+
+/*
+ * Allocate the buffers for chained reads once the page size is known. Each
+ * page gets a slot holding its data followed by its auxiliary area, so that
+ * every slot starts on a cache line.
+ */
+static int mxs_nand_alloc_multi_bufs(struct mtd_info *mtd,
+				     struct mxs_nand_info *nand_info)
+{
+	uint32_t stride;
+
+	if (nand_info->multi_buf)
+		return 0;
+
+	stride = mtd->writesize + roundup(mtd->oobsize, MXS_DMA_ALIGNMENT);
+	nand_info->multi_buf = memalign(MXS_DMA_ALIGNMENT,
+					stride * MXS_NAND_MULTI_PAGES);
+	nand_info->multi_cmd_buf = memalign(MXS_DMA_ALIGNMENT,
+			roundup(MXS_NAND_MULTI_PAGES * MXS_NAND_MULTI_CMD_STRIDE,
+				MXS_DMA_ALIGNMENT));
+	if (!nand_info->multi_buf || !nand_info->multi_cmd_buf) {
+		free(nand_info->multi_buf);
+		free(nand_info->multi_cmd_buf);
+		nand_info->multi_buf = NULL;
+		nand_info->multi_cmd_buf = NULL;
+		printf("MXS NAND: Error allocating multi-page buffers\n");
+		return -ENOMEM;
+	}
+	nand_info->multi_stride = stride;
+
+	return 0;
+}
+
+/*
+ * Read up to MXS_NAND_MULTI_PAGES pages with a single DMA chain, which sends
+ * the read command for the next page as soon as the BCH has taken the data of
+ * the previous one. The ECC status of the pages is decoded in one pass once
+ * the last page has been corrected.
+ */
+static int mxs_nand_read_page_chain(struct mtd_info *mtd,
+				    struct nand_chip *nand, uint8_t *buf,
+				    int page, int count)
+{
+	struct mxs_nand_info *nand_info = nand_get_controller_data(nand);
+	struct bch_geometry *geo = &nand_info->bch_geometry;
+	uint32_t channel = MXS_DMA_CHANNEL_AHB_APBH_GPMI0 + nand_info->cur_chip;
+	uint32_t stride = nand_info->multi_stride;
+	uint32_t corrected = 0;
+	struct mxs_dma_desc *d;
+	uint8_t *cmd, *slot, *aux, *status;
+	int i, j, n, erased, ret;
+
+	for (i = 0; i < count; i++) {
+		cmd = nand_info->multi_cmd_buf + i * MXS_NAND_MULTI_CMD_STRIDE;
+		n = 0;
+		cmd[n++] = NAND_CMD_READ0;
+		cmd[n++] = 0;
+		cmd[n++] = 0;
+		cmd[n++] = page + i;
+		cmd[n++] = (page + i) >> 8;
+		if (nand->options & NAND_ROW_ADDR_3)
+			cmd[n++] = (page + i) >> 16;
+		cmd[MXS_NAND_MULTI_CMD_READSTART] = NAND_CMD_READSTART;
+
+		/* Mark the status bytes, to tell when the BCH is done */
+		slot = nand_info->multi_buf + i * stride;
+		aux = slot + mtd->writesize;
+		memset(aux + mxs_nand_aux_status_offset(),
+		       MXS_NAND_STATUS_PENDING, geo->ecc_chunk_count);
+
+		mxs_nand_append_cmd(nand_info, cmd, n);
+		mxs_nand_append_cmd(nand_info,
+				    cmd + MXS_NAND_MULTI_CMD_READSTART, 1);
+		mxs_nand_append_ecc_read(mtd, nand_info, slot, aux, page + i);
+	}
+
+	/* Compile the DMA descriptor - deassert the NAND lock and interrupt. */
+	d = mxs_nand_get_dma_desc(nand_info);
+	d->cmd.data =
+		MXS_DMA_DESC_COMMAND_NO_DMAXFER | MXS_DMA_DESC_IRQ |
+		MXS_DMA_DESC_DEC_SEM;
+
+	d->cmd.address = 0;
+
+	mxs_dma_desc_append(channel, d);
+
+	/* Flush caches, covering only the slots this chain uses */
+	mxs_nand_flush_range(nand_info->multi_cmd_buf,
+			     count * MXS_NAND_MULTI_CMD_STRIDE);
+	mxs_nand_flush_range(nand_info->multi_buf, count * stride);
+
+	/* Execute the DMA chain. */
+	ret = mxs_dma_go(channel);
+	if (ret) {
+		printf("MXS NAND: DMA read error\n");
+		goto rtn;
+	}
+
+	/*
+	 * The BCH raises its completion interrupt for each page, so wait until
+	 * it has written the status of the last one.
+	 */
+	aux = nand_info->multi_buf + (count - 1) * stride + mtd->writesize;
+	status = aux + mxs_nand_aux_status_offset();
+	for (i = 0; i < count; i++) {
+		ret = mxs_nand_wait_for_bch_complete(nand_info);
+		if (ret)
+			break;
+
+		mxs_nand_inval_range(aux, mtd->oobsize);
+		if (!memchr(status, MXS_NAND_STATUS_PENDING,
+			    geo->ecc_chunk_count))
+			break;
+	}
+	if (ret || i == count) {
+		printf("MXS NAND: BCH read timeout\n");
+		ret = -ETIMEDOUT;
+		goto rtn;
+	}
+
+	mxs_nand_return_dma_descs(nand_info);
+
+	/* Invalidate caches */
+	mxs_nand_inval_range(nand_info->multi_buf, count * stride);
+
+	for (i = 0; i < count; i++, buf += mtd->writesize) {
+		slot = nand_info->multi_buf + i * stride;
+		aux = slot + mtd->writesize;
+		status = aux + mxs_nand_aux_status_offset();
+
+		/*
+		 * Uncorrectable chunks may be an erased page with bitflips and
+		 * erased chunks may need the DEBUG1 register, which only holds
+		 * the last page. Let the single page read sort those out,
+		 * except for a wholly erased page: the single page read would
+		 * return it as all 0xff whatever DEBUG1 says.
+		 */
+		erased = 0;
+		for (j = 0; j < geo->ecc_chunk_count; j++) {
+			if (status[j] == 0xfe)
+				break;
+			if (status[j] == 0xff &&
+			    mxs_nand_check_erased_bits(nand_info))
+				erased++;
+		}
+
+		if (erased == geo->ecc_chunk_count) {
+			memset(buf, 0xff, mtd->writesize);
+			continue;
+		}
+		if (j < geo->ecc_chunk_count || erased) {
+			nand->cmdfunc(mtd, NAND_CMD_READ0, 0, page + i);
+			ret = mxs_nand_ecc_read_page(mtd, nand, buf, 0,
+						     page + i);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		for (j = 0; j < geo->ecc_chunk_count; j++) {
+			if (status[j] != 0xff)
+				corrected += status[j];
+		}
+
+		mxs_nand_swap_block_mark(geo, slot, aux);
+		memcpy(buf, slot, mtd->writesize);
+	}
+
+	/* Propagate ECC status to the owning MTD. */
+	mtd->ecc_stats.corrected += corrected;
+
+	return 0;
+
+rtn:
+	mxs_nand_return_dma_descs(nand_info);
+
+	return ret;
+}
+
+/*
+ * Read a run of consecutive pages, chaining up to MXS_NAND_MULTI_PAGES of
+ * them into each DMA transfer.
+ */
+static int mxs_nand_ecc_read_page_multi(struct mtd_info *mtd,
+					struct nand_chip *nand, uint8_t *buf,
+					int page, int count)
+{
+	struct mxs_nand_info *nand_info = nand_get_controller_data(nand);
+	int n, ret;
+
+	/* Small page devices have no READSTART to queue */
+	if (mtd->writesize <= 512)
+		return -EOPNOTSUPP;
+
+	ret = mxs_nand_alloc_multi_bufs(mtd, nand_info);
+	if (ret)
+		return ret;
+
+	while (count) {
+		n = min_t(int, count, MXS_NAND_MULTI_PAGES);
+		ret = mxs_nand_read_page_chain(mtd, nand, buf, page, n);
+		if (ret)
+			return ret;
+
+		buf += n * mtd->writesize;
+		page += n;
+		count -= n;
+	}
+
+	return 0;
+}
+#endif
+
 /*
  * Write a page to NAND.
  */
@@ -1403,6 +1719,9 @@ int mxs_nand_init_ctrl(struct mxs_nand_info *nand_info)
 		goto err_free_buffers;
 
 	nand->ecc.read_page	= mxs_nand_ecc_read_page;
+#if MXS_NAND_MULTI_PAGES > 1
+	nand->ecc.read_page_multi = mxs_nand_ecc_read_page_multi;
+#endif
 	nand->ecc.write_page	= mxs_nand_ecc_write_page;
 	nand->ecc.read_oob	= mxs_nand_ecc_read_oob;
 	nand->ecc.write_oob	= mxs_nand_ecc_write_oob;
@@ -2294,6 +2294,63 @@ static int nand_setup_read_retry(struct mtd_info *mtd, int retry_mode)
 	return chip->setup_read_retry(mtd, retry_mode);
 }
 
+/**
+ * nand_read_page_multi - [INTERN] Read a run of whole pages in one go
+ * @mtd: MTD device structure
+ * @page: first page to read, relative to the selected chip
+ * @buf: buffer to store the data
+ * @readlen: number of bytes left to read, starting at @page
+ * @max_bitflips: updated with the bitflips reported by the driver
+ * @ecc_fail: set if a page could not be corrected
+ *
+ * Hands as many pages as possible, up to the end of the selected chip, to
+ * the driver's read_page_multi() method, which can queue them back-to-back
+ * instead of waiting on each page in turn.
+ *
+ * Return: the number of pages read, or 0 if the caller should read page by
+ * page instead.
+ */
+static int nand_read_page_multi(struct mtd_info *mtd, int page, uint8_t *buf,
+				uint32_t readlen, unsigned int *max_bitflips,
+				bool *ecc_fail)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	unsigned int ecc_failures = mtd->ecc_stats.failed;
+	int count;
+	int ret;
+
+	if (!chip->ecc.read_page_multi || chip->options & NAND_NEED_READRDY)
+		return 0;
+
+	if ((chip->options & NAND_USE_BOUNCE_BUFFER) &&
+	    !IS_ALIGNED((unsigned long)buf, chip->buf_align))
+		return 0;
+
+	count = min_t(int, readlen >> chip->page_shift,
+		      chip->pagemask + 1 - page);
+	if (count < 2)
+		return 0;
+
+	ret = chip->ecc.read_page_multi(mtd, chip, buf, page, count);
+	if (ret < 0) {
+		mtd->ecc_stats.failed = ecc_failures;
+		return 0;
+	}
+
+	if (mtd->ecc_stats.failed != ecc_failures) {
+		/* Let the page-by-page path step through the retry modes */
+		if (chip->read_retries > 1) {
+			mtd->ecc_stats.failed = ecc_failures;
+			return 0;
+		}
+		*ecc_fail = true;
+	}
+
+	*max_bitflips = max_t(unsigned int, *max_bitflips, ret);
+
+	return count;
+}
+
 /**
  * nand_do_read_ops - [INTERN] Read data with ECC
  * @mtd: MTD device structure
@@ -2317,6 +2374,7 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	int pages;
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -2334,6 +2392,28 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 		unsigned int ecc_failures = mtd->ecc_stats.failed;
 
 		WATCHDOG_RESET();
+
+		if (!col && !oob && ops->mode != MTD_OPS_RAW) {
+			pages = nand_read_page_multi(mtd, page, buf, readlen,
+						     &max_bitflips, &ecc_fail);
+			if (pages) {
+				bytes = pages << chip->page_shift;
+				buf += bytes;
+				readlen -= bytes;
+				if (!readlen)
+					break;
+
+				realpage += pages;
+				page = realpage & chip->pagemask;
+				if (!page) {
+					chipnr++;
+					chip->select_chip(mtd, -1);
+					chip->select_chip(mtd, chipnr);
+				}
+				continue;
+			}
+		}
+
 		bytes = min(mtd->writesize - col, readlen);
 		aligned = (bytes == mtd->writesize);
 
@@ -58,7 +58,9 @@
  */
 
 #include <common.h>
+#include <bloblist.h>
 #include <malloc.h>
+#include <watchdog.h>
 #include <dm/devres.h>
 #include <linux/compat.h>
 #include <linux/mtd/mtd.h>
@@ -408,37 +410,140 @@ static void read_abs_bbts(struct mtd_info *mtd, uint8_t *buf,
 	}
 }
 
-/* Scan a given block partially */
-static int scan_block_fast(struct mtd_info *mtd, struct nand_bbt_descr *bd,
-			   loff_t offs, uint8_t *buf, int numpages)
+/**
+ * scan_block_oob - [GENERIC] Scan the marker pages of a block
+ * @mtd: MTD device structure
+ * @bd: descriptor for the good/bad block search pattern
+ * @offs: offset of the first marker page
+ * @numpages: number of marker pages to scan
+ * @chipnr: chip currently selected, updated if another one is selected
+ *
+ * The OOB of each page is read straight into the chip's OOB buffer with the
+ * chip left selected, so that the marker pages of consecutive blocks are read
+ * back-to-back without going through mtd_read_oob() for each of them. ECC
+ * errors are ignored when checking for the bad block marker.
+ *
+ * Return: 1 if the block is bad, 0 if it is good, or a negative error code
+ */
+static int scan_block_oob(struct mtd_info *mtd, struct nand_bbt_descr *bd,
+			  loff_t offs, int numpages, int *chipnr)
 {
-	struct mtd_oob_ops ops;
-	int j, ret;
+	struct nand_chip *this = mtd_to_nand(mtd);
+	int j, ret, page;
 
-	ops.ooblen = mtd->oobsize;
-	ops.oobbuf = buf;
-	ops.ooboffs = 0;
-	ops.datbuf = NULL;
-	ops.mode = MTD_OPS_PLACE_OOB;
+	if ((int)(offs >> this->chip_shift) != *chipnr) {
+		this->select_chip(mtd, -1);
+		*chipnr = (int)(offs >> this->chip_shift);
+		this->select_chip(mtd, *chipnr);
+	}
+	page = (int)(offs >> this->page_shift) & this->pagemask;
 
 	for (j = 0; j < numpages; j++) {
-		/*
-		 * Read the full oob until read_oob is fixed to handle single
-		 * byte reads for 16 bit buswidth.
-		 */
-		ret = mtd_read_oob(mtd, offs, &ops);
-		/* Ignore ECC errors when checking for BBM */
-		if (ret && !mtd_is_bitflip_or_eccerr(ret))
+		ret = this->ecc.read_oob(mtd, this, page + j);
+		if (ret < 0)
 			return ret;
 
-		if (check_short_pattern(buf, bd))
+		if (this->options & NAND_NEED_READRDY) {
+			/* Apply delay or wait for ready/busy pin */
+			if (!this->dev_ready)
+				udelay(this->chip_delay);
+			else
+				nand_wait_ready(mtd);
+		}
+
+		if (check_short_pattern(this->oob_poi, bd))
 			return 1;
+	}
+	return 0;
+}
 
-		offs += mtd->writesize;
+#if IS_ENABLED(CONFIG_NAND_BBT_BLOBLIST) && CONFIG_IS_ENABLED(BLOBLIST)
+/* Only the first device scanned uses the bloblist record */
+static bool bbt_handoff_claimed;
+
+/**
+ * bbt_handoff_size - Size of the bloblist record for a device
+ * @mtd: MTD device structure
+ */
+static int bbt_handoff_size(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd_to_nand(mtd);
+	int numblocks = mtd->size >> this->bbt_erase_shift;
+
+	return sizeof(struct nand_bbt_handoff) + DIV_ROUND_UP(numblocks, 8);
+}
+
+/**
+ * bbt_import - Take the bad blocks from a table scanned by an earlier phase
+ * @mtd: MTD device structure
+ *
+ * Return: 0 if the table was used, -ENOENT if there is none for this device
+ */
+static int bbt_import(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd_to_nand(mtd);
+	struct nand_bbt_handoff *ho;
+	int i;
+
+	if (bbt_handoff_claimed)
+		return -ENOENT;
+	ho = bloblist_find(BLOBLISTT_NAND_BBT, bbt_handoff_size(mtd));
+	if (!ho || ho->magic != NAND_BBT_HANDOFF_MAGIC ||
+	    ho->erase_shift != this->bbt_erase_shift ||
+	    ho->numblocks != mtd->size >> this->bbt_erase_shift)
+		return -ENOENT;
+
+	bbt_handoff_claimed = true;
+	for (i = 0; i < ho->numblocks; i++) {
+		if (ho->bitmap[i / 8] & BIT(i % 8)) {
+			bbt_mark_entry(this, i, BBT_BLOCK_FACTORY_BAD);
+			mtd->ecc_stats.badblocks++;
+		}
 	}
+	this->bbt_scan_us = ho->scan_us;
+
 	return 0;
 }
 
+/**
+ * bbt_export - Put the bad block table in the bloblist for the OS
+ * @mtd: MTD device structure
+ */
+static void bbt_export(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd_to_nand(mtd);
+	int numblocks = mtd->size >> this->bbt_erase_shift;
+	struct nand_bbt_handoff *ho;
+	int i;
+
+	if (bbt_handoff_claimed)
+		return;
+	bbt_handoff_claimed = true;
+	ho = bloblist_ensure(BLOBLISTT_NAND_BBT, bbt_handoff_size(mtd));
+	if (!ho)
+		return;
+
+	memset(ho, '\0', bbt_handoff_size(mtd));
+	ho->magic = NAND_BBT_HANDOFF_MAGIC;
+	ho->erase_shift = this->bbt_erase_shift;
+	ho->numblocks = numblocks;
+	ho->scan_us = this->bbt_scan_us;
+	for (i = 0; i < numblocks; i++) {
+		if (bbt_get_entry(this, i) != BBT_BLOCK_GOOD)
+			ho->bitmap[i / 8] |= BIT(i % 8);
+	}
+}
+#else
+static int bbt_import(struct mtd_info *mtd)
+{
+	return -ENOENT;
+}
+
+static void bbt_export(struct mtd_info *mtd)
+{
+}
+#endif
+
 /**
  * create_bbt - [GENERIC] Create a bad block table by scanning the device
  * @mtd: MTD device structure
@@ -455,10 +560,12 @@ static int create_bbt(struct mtd_info *mtd, uint8_t *buf,
 {
 	struct nand_chip *this = mtd_to_nand(mtd);
 	int i, numblocks, numpages;
-	int startblock;
+	int startblock, chipnr = -1;
+	ulong start;
 	loff_t from;
 
 	pr_info("Scanning device for bad blocks\n");
+	start = timer_get_us();
 
 	if (bd->options & NAND_BBT_SCAN2NDPAGE)
 		numpages = 2;
@@ -488,10 +595,13 @@ static int create_bbt(struct mtd_info *mtd, uint8_t *buf,
 		int ret;
 
 		BUG_ON(bd->options & NAND_BBT_NO_OOB);
+		WATCHDOG_RESET();
 
-		ret = scan_block_fast(mtd, bd, from, buf, numpages);
-		if (ret < 0)
+		ret = scan_block_oob(mtd, bd, from, numpages, &chipnr);
+		if (ret < 0) {
+			this->select_chip(mtd, -1);
 			return ret;
+		}
 
 		if (ret) {
 			bbt_mark_entry(this, i, BBT_BLOCK_FACTORY_BAD);
@@ -502,6 +612,11 @@ static int create_bbt(struct mtd_info *mtd, uint8_t *buf,
 
 		from += (1 << this->bbt_erase_shift);
 	}
+	this->select_chip(mtd, -1);
+	this->bbt_scan_us = timer_get_us() - start;
+	pr_debug("nand_bbt: scanned %d blocks in %lu us\n",
+		 numblocks - startblock, this->bbt_scan_us);
+
 	return 0;
 }
 
@@ -819,8 +934,17 @@ static int write_bbt(struct mtd_info *mtd, uint8_t *buf,
 static inline int nand_memory_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd)
 {
 	struct nand_chip *this = mtd_to_nand(mtd);
+	int ret;
 
-	return create_bbt(mtd, this->buffers->databuf, bd, -1);
+	/* An earlier phase may have scanned the device already */
+	if (!bbt_import(mtd))
+		return 0;
+
+	ret = create_bbt(mtd, this->buffers->databuf, bd, -1);
+	if (!ret)
+		bbt_export(mtd);
+
+	return ret;
 }
 
 /**
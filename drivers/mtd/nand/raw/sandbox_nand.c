@@ -0,0 +1,566 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sandbox raw NAND flash simulator
+ *
+ * This emulates a single SLC NAND chip behind a very simple controller which
+ * accepts the standard command set through cmdfunc(). The geometry comes from
+ * the device tree, so that the NAND core, UBI and UBIFS can be exercised with
+ * the same page / block / OOB layout as real boards. The contents are kept in
+ * a host file if "sandbox,filepath" is given, otherwise in memory.
+ *
+ * Program and erase follow the usual NAND rules: programming can only clear
+ * bits and erasing sets a whole block to 0xff. Factory bad blocks read back as
+ * zeroes and refuse to be programmed or erased. Bit flips can be injected into
+ * the data returned by page reads, to test ECC correction and scrubbing.
+ *
+ * Each operation is charged its tR / tPROG / tBERS time in the statistics. By
+ * default this time is not spent, which keeps tests fast; set
+ * "sandbox,real-time" to delay for it as well.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <errno.h>
+#include <malloc.h>
+#include <nand.h>
+#include <os.h>
+#include <asm/test.h>
+#include <linux/log2.h>
+#include <linux/mtd/rawnand.h>
+#include <linux/sizes.h>
+
+#define SANDBOX_NAND_MFR_ID	NAND_MFR_MICRON
+#define SANDBOX_NAND_DEV_ID	0xd3
+
+/* Software Hamming ECC protects this many bytes with each 3-byte code */
+#define SANDBOX_NAND_ECC_STEP	256
+
+enum sandbox_nand_out {
+	SANDBOX_NAND_OUT_DATA,
+	SANDBOX_NAND_OUT_ID,
+	SANDBOX_NAND_OUT_STATUS,
+};
+
+/**
+ * struct sandbox_nand_priv - state of a sandbox NAND chip
+ *
+ * @chip: NAND chip, set up by nand_scan()
+ * @ids: Flash ID table describing just this chip, for nand_scan_ident()
+ * @page_size: Bytes of data per page
+ * @oob_size: Bytes of OOB per page
+ * @pages_per_block: Pages in each erase block
+ * @blocks: Number of erase blocks
+ * @t_read: Time to read a page into the page register (tR), in us
+ * @t_prog: Time to program a page (tPROG), in us
+ * @t_erase: Time to erase a block (tBERS), in us
+ * @real_time: true to delay for each operation, not just count the time
+ * @fd: Backing file, or -1 to keep the contents in memory
+ * @mem: Contents of each block when kept in memory, NULL if erased
+ * @bad: One byte per block, non-zero for a factory bad block
+ * @buf: Page register, @page_size + @oob_size bytes
+ * @tmp: Scratch page used while programming
+ * @out: What read_byte() / read_buf() return
+ * @page: Page selected by the last READ0 / SEQIN / ERASE1
+ * @column: Offset in @buf for the next data transfer
+ * @status: Value returned for NAND_CMD_STATUS
+ * @id_pos: Next byte of the ID to return
+ * @bitflip_interval: Inject bit flips in every Nth page read, 0 for none
+ * @bitflip_bits: Number of bits to flip in such a read
+ * @lfsr: State of the generator which picks the bits to flip
+ * @stats: Operation counters
+ */
+struct sandbox_nand_priv {
+	struct nand_chip chip;
+	struct nand_flash_dev ids[2];
+	u32 page_size;
+	u32 oob_size;
+	u32 pages_per_block;
+	u32 blocks;
+	u32 t_read;
+	u32 t_prog;
+	u32 t_erase;
+	bool real_time;
+	int fd;
+	u8 **mem;
+	u8 *bad;
+	u8 *buf;
+	u8 *tmp;
+	enum sandbox_nand_out out;
+	int page;
+	int column;
+	u8 status;
+	int id_pos;
+	uint bitflip_interval;
+	uint bitflip_bits;
+	u32 lfsr;
+	struct sandbox_nand_stats stats;
+};
+
+static struct sandbox_nand_priv *mtd_to_priv(struct mtd_info *mtd)
+{
+	return nand_get_controller_data(mtd_to_nand(mtd));
+}
+
+static uint sandbox_nand_raw_size(struct sandbox_nand_priv *priv)
+{
+	return priv->page_size + priv->oob_size;
+}
+
+static void sandbox_nand_busy(struct sandbox_nand_priv *priv, u32 us)
+{
+	priv->stats.busy_us += us;
+	if (priv->real_time)
+		udelay(us);
+}
+
+/* Advance the bit-flip generator (Galois LFSR, taps 32,22,2,1) */
+static u32 sandbox_nand_random(struct sandbox_nand_priv *priv)
+{
+	priv->lfsr = (priv->lfsr >> 1) ^ (-(priv->lfsr & 1) & 0x80200003);
+
+	return priv->lfsr;
+}
+
+static int sandbox_nand_load(struct sandbox_nand_priv *priv, int page, u8 *buf)
+{
+	uint raw = sandbox_nand_raw_size(priv);
+	uint block = page / priv->pages_per_block;
+	ssize_t len;
+
+	if (priv->bad[block]) {
+		memset(buf, '\0', raw);
+		return 0;
+	}
+
+	if (priv->fd == -1) {
+		u8 *data = priv->mem[block];
+
+		if (data)
+			memcpy(buf, data + (page % priv->pages_per_block) * raw,
+			       raw);
+		else
+			memset(buf, 0xff, raw);
+		return 0;
+	}
+
+	if (os_lseek(priv->fd, (off_t)page * raw, OS_SEEK_SET) < 0)
+		return -EIO;
+	len = os_read(priv->fd, buf, raw);
+	if (len < 0)
+		return -EIO;
+
+	/* Anything beyond the end of the file has never been programmed */
+	memset(buf + len, 0xff, raw - len);
+
+	return 0;
+}
+
+static int sandbox_nand_store(struct sandbox_nand_priv *priv, int page,
+			      const u8 *buf)
+{
+	uint raw = sandbox_nand_raw_size(priv);
+	uint block = page / priv->pages_per_block;
+
+	if (priv->fd == -1) {
+		u8 *data = priv->mem[block];
+
+		if (!data) {
+			data = malloc(raw * priv->pages_per_block);
+			if (!data)
+				return -ENOMEM;
+			memset(data, 0xff, raw * priv->pages_per_block);
+			priv->mem[block] = data;
+		}
+		memcpy(data + (page % priv->pages_per_block) * raw, buf, raw);
+		return 0;
+	}
+
+	if (os_lseek(priv->fd, (off_t)page * raw, OS_SEEK_SET) < 0 ||
+	    os_write(priv->fd, buf, raw) != raw)
+		return -EIO;
+
+	return 0;
+}
+
+/* Flip some bits in the page register, as a read disturb would */
+static void sandbox_nand_inject_bitflips(struct sandbox_nand_priv *priv)
+{
+	uint steps = max(priv->page_size / SANDBOX_NAND_ECC_STEP, 1U);
+	uint i;
+
+	if (!priv->bitflip_interval ||
+	    priv->stats.reads % priv->bitflip_interval)
+		return;
+
+	/*
+	 * Put each flip in a different ECC step while there are steps left,
+	 * so that up to one flip per step can still be corrected
+	 */
+	for (i = 0; i < priv->bitflip_bits; i++) {
+		uint offset = (i % steps) * SANDBOX_NAND_ECC_STEP +
+			sandbox_nand_random(priv) % SANDBOX_NAND_ECC_STEP;
+
+		priv->buf[offset % priv->page_size] ^=
+			1 << (sandbox_nand_random(priv) & 7);
+		priv->stats.bitflips++;
+	}
+}
+
+static void sandbox_nand_read_page(struct sandbox_nand_priv *priv)
+{
+	priv->stats.reads++;
+	sandbox_nand_busy(priv, priv->t_read);
+	if (sandbox_nand_load(priv, priv->page, priv->buf)) {
+		memset(priv->buf, 0xff, sandbox_nand_raw_size(priv));
+		return;
+	}
+	sandbox_nand_inject_bitflips(priv);
+}
+
+static void sandbox_nand_program(struct sandbox_nand_priv *priv)
+{
+	uint raw = sandbox_nand_raw_size(priv);
+	u8 *old = priv->tmp;
+	uint i;
+
+	priv->stats.programs++;
+	sandbox_nand_busy(priv, priv->t_prog);
+	if (priv->bad[priv->page / priv->pages_per_block] ||
+	    sandbox_nand_load(priv, priv->page, old)) {
+		priv->status |= NAND_STATUS_FAIL;
+		return;
+	}
+
+	/* Programming can only change bits from 1 to 0 */
+	for (i = 0; i < raw; i++)
+		old[i] &= priv->buf[i];
+	if (sandbox_nand_store(priv, priv->page, old))
+		priv->status |= NAND_STATUS_FAIL;
+}
+
+static void sandbox_nand_erase(struct sandbox_nand_priv *priv)
+{
+	uint raw = sandbox_nand_raw_size(priv);
+	uint block = priv->page / priv->pages_per_block;
+	uint i;
+
+	priv->stats.erases++;
+	sandbox_nand_busy(priv, priv->t_erase);
+	if (priv->bad[block]) {
+		priv->status |= NAND_STATUS_FAIL;
+		return;
+	}
+
+	if (priv->fd == -1) {
+		free(priv->mem[block]);
+		priv->mem[block] = NULL;
+		return;
+	}
+
+	memset(priv->buf, 0xff, raw);
+	for (i = 0; i < priv->pages_per_block; i++) {
+		if (sandbox_nand_store(priv, block * priv->pages_per_block + i,
+				       priv->buf)) {
+			priv->status |= NAND_STATUS_FAIL;
+			return;
+		}
+	}
+}
+
+static void sandbox_nand_cmdfunc(struct mtd_info *mtd, unsigned int command,
+				 int column, int page_addr)
+{
+	struct sandbox_nand_priv *priv = mtd_to_priv(mtd);
+
+	if (page_addr != -1)
+		priv->page = page_addr;
+
+	switch (command) {
+	case NAND_CMD_RESET:
+		priv->status = NAND_STATUS_READY | NAND_STATUS_WP;
+		priv->out = SANDBOX_NAND_OUT_STATUS;
+		break;
+	case NAND_CMD_READID:
+		priv->id_pos = 0;
+		priv->out = SANDBOX_NAND_OUT_ID;
+		break;
+	case NAND_CMD_STATUS:
+		priv->out = SANDBOX_NAND_OUT_STATUS;
+		break;
+	case NAND_CMD_READOOB:
+		if (column != -1)
+			column += priv->page_size;
+		/* fall through */
+	case NAND_CMD_READ0:
+		/* READ0 without an address just leaves status mode */
+		if (page_addr != -1)
+			sandbox_nand_read_page(priv);
+		/* fall through */
+	case NAND_CMD_RNDOUT:
+		if (column != -1)
+			priv->column = column;
+		priv->out = SANDBOX_NAND_OUT_DATA;
+		break;
+	case NAND_CMD_SEQIN:
+		memset(priv->buf, 0xff, sandbox_nand_raw_size(priv));
+		/* fall through */
+	case NAND_CMD_RNDIN:
+		if (column != -1)
+			priv->column = column;
+		break;
+	case NAND_CMD_PAGEPROG:
+		priv->status &= ~NAND_STATUS_FAIL;
+		sandbox_nand_program(priv);
+		priv->out = SANDBOX_NAND_OUT_STATUS;
+		break;
+	case NAND_CMD_ERASE1:
+		break;
+	case NAND_CMD_ERASE2:
+		priv->status &= ~NAND_STATUS_FAIL;
+		sandbox_nand_erase(priv);
+		priv->out = SANDBOX_NAND_OUT_STATUS;
+		break;
+	default:
+		debug("%s: Unsupported command %02x\n", __func__, command);
+		break;
+	}
+}
+
+static uint8_t sandbox_nand_read_byte(struct mtd_info *mtd)
+{
+	struct sandbox_nand_priv *priv = mtd_to_priv(mtd);
+
+	switch (priv->out) {
+	case SANDBOX_NAND_OUT_ID:
+		return priv->ids[0].id[priv->id_pos++ % NAND_MAX_ID_LEN];
+	case SANDBOX_NAND_OUT_STATUS:
+		return priv->status;
+	case SANDBOX_NAND_OUT_DATA:
+	default:
+		if (priv->column >= sandbox_nand_raw_size(priv))
+			return 0xff;
+		return priv->buf[priv->column++];
+	}
+}
+
+static void sandbox_nand_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
+{
+	struct sandbox_nand_priv *priv = mtd_to_priv(mtd);
+	int avail = sandbox_nand_raw_size(priv) - priv->column;
+	int i;
+
+	if (priv->out != SANDBOX_NAND_OUT_DATA || len > avail) {
+		for (i = 0; i < len; i++)
+			buf[i] = sandbox_nand_read_byte(mtd);
+		return;
+	}
+	memcpy(buf, priv->buf + priv->column, len);
+	priv->column += len;
+}
+
+static void sandbox_nand_write_buf(struct mtd_info *mtd, const uint8_t *buf,
+				   int len)
+{
+	struct sandbox_nand_priv *priv = mtd_to_priv(mtd);
+	int avail = sandbox_nand_raw_size(priv) - priv->column;
+
+	memcpy(priv->buf + priv->column, buf, min(len, avail));
+	priv->column += min(len, avail);
+}
+
+static int sandbox_nand_waitfunc(struct mtd_info *mtd, struct nand_chip *chip)
+{
+	struct sandbox_nand_priv *priv = mtd_to_priv(mtd);
+
+	return priv->status;
+}
+
+static int sandbox_nand_dev_ready(struct mtd_info *mtd)
+{
+	return 1;
+}
+
+static void sandbox_nand_select_chip(struct mtd_info *mtd, int chipnr)
+{
+}
+
+void sandbox_nand_set_bitflips(struct udevice *dev, uint interval, uint bits)
+{
+	struct sandbox_nand_priv *priv = dev_get_priv(dev);
+
+	priv->bitflip_interval = interval;
+	priv->bitflip_bits = bits;
+}
+
+void sandbox_nand_get_stats(struct udevice *dev,
+			    struct sandbox_nand_stats *stats)
+{
+	struct sandbox_nand_priv *priv = dev_get_priv(dev);
+
+	*stats = priv->stats;
+}
+
+struct mtd_info *sandbox_nand_get_mtd(struct udevice *dev)
+{
+	struct sandbox_nand_priv *priv = dev_get_priv(dev);
+
+	return nand_to_mtd(&priv->chip);
+}
+
+static int sandbox_nand_ofdata_to_platdata(struct udevice *dev)
+{
+	struct sandbox_nand_priv *priv = dev_get_priv(dev);
+	u64 size;
+
+	priv->page_size = dev_read_u32_default(dev, "sandbox,page-size", 2048);
+	priv->oob_size = dev_read_u32_default(dev, "sandbox,oob-size", 64);
+	priv->pages_per_block = dev_read_u32_default(dev,
+						     "sandbox,pages-per-block",
+						     64);
+	priv->blocks = dev_read_u32_default(dev, "sandbox,blocks", 1024);
+	priv->t_read = dev_read_u32_default(dev, "sandbox,read-time-us", 25);
+	priv->t_prog = dev_read_u32_default(dev, "sandbox,program-time-us",
+					    200);
+	priv->t_erase = dev_read_u32_default(dev, "sandbox,erase-time-us",
+					     2000);
+	priv->real_time = dev_read_bool(dev, "sandbox,real-time");
+	priv->bitflip_interval = dev_read_u32_default(dev,
+						      "sandbox,bitflip-interval",
+						      0);
+	priv->bitflip_bits = dev_read_u32_default(dev, "sandbox,bitflip-bits",
+						  1);
+
+	size = (u64)priv->page_size * priv->pages_per_block * priv->blocks;
+	if (!is_power_of_2(priv->page_size) ||
+	    !is_power_of_2(priv->pages_per_block) || !priv->blocks ||
+	    size & (SZ_1M - 1)) {
+		printf("%s: Invalid geometry %ux%ux%u\n", dev->name,
+		       priv->page_size, priv->pages_per_block, priv->blocks);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int sandbox_nand_probe(struct udevice *dev)
+{
+	struct sandbox_nand_priv *priv = dev_get_priv(dev);
+	struct nand_chip *chip = &priv->chip;
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	struct nand_flash_dev *type = &priv->ids[0];
+	const char *path;
+	int count, i;
+	int ret;
+
+	priv->buf = malloc(sandbox_nand_raw_size(priv));
+	priv->tmp = malloc(sandbox_nand_raw_size(priv));
+	priv->bad = calloc(priv->blocks, 1);
+	if (!priv->buf || !priv->tmp || !priv->bad)
+		return -ENOMEM;
+
+	count = dev_read_size(dev, "sandbox,bad-blocks") / (int)sizeof(u32);
+	if (count > 0) {
+		u32 *list = calloc(count, sizeof(u32));
+
+		if (!list)
+			return -ENOMEM;
+		if (!dev_read_u32_array(dev, "sandbox,bad-blocks", list,
+					count)) {
+			for (i = 0; i < count; i++) {
+				if (list[i] < priv->blocks)
+					priv->bad[list[i]] = 1;
+			}
+		}
+		free(list);
+	}
+
+	priv->fd = -1;
+	path = dev_read_string(dev, "sandbox,filepath");
+	if (path) {
+		priv->fd = os_open(path, OS_O_RDWR | OS_O_CREAT);
+		if (priv->fd < 0) {
+			printf("%s: Cannot open '%s'\n", dev->name, path);
+			return -EIO;
+		}
+	} else {
+		priv->mem = calloc(priv->blocks, sizeof(*priv->mem));
+		if (!priv->mem)
+			return -ENOMEM;
+	}
+
+	type->name = "sandbox NAND";
+	type->mfr_id = SANDBOX_NAND_MFR_ID;
+	type->dev_id = SANDBOX_NAND_DEV_ID;
+	type->id_len = 2;
+	type->pagesize = priv->page_size;
+	type->erasesize = priv->page_size * priv->pages_per_block;
+	type->chipsize = ((u64)type->erasesize * priv->blocks) >> 20;
+	type->oobsize = priv->oob_size;
+
+	priv->lfsr = 0x5a5a5a5a;
+	priv->status = NAND_STATUS_READY | NAND_STATUS_WP;
+
+	nand_set_controller_data(chip, priv);
+	mtd->dev = dev;
+	chip->cmdfunc = sandbox_nand_cmdfunc;
+	chip->read_byte = sandbox_nand_read_byte;
+	chip->read_buf = sandbox_nand_read_buf;
+	chip->write_buf = sandbox_nand_write_buf;
+	chip->waitfunc = sandbox_nand_waitfunc;
+	chip->dev_ready = sandbox_nand_dev_ready;
+	chip->select_chip = sandbox_nand_select_chip;
+	chip->ecc.mode = NAND_ECC_SOFT;
+
+	ret = nand_scan_ident(mtd, 1, priv->ids);
+	if (ret)
+		return ret;
+
+	return nand_scan_tail(mtd);
+}
+
+static int sandbox_nand_remove(struct udevice *dev)
+{
+	struct sandbox_nand_priv *priv = dev_get_priv(dev);
+	uint i;
+
+	if (priv->fd != -1)
+		os_close(priv->fd);
+	if (priv->mem) {
+		for (i = 0; i < priv->blocks; i++)
+			free(priv->mem[i]);
+		free(priv->mem);
+	}
+	free(priv->bad);
+	free(priv->tmp);
+	free(priv->buf);
+
+	return 0;
+}
+
+static const struct udevice_id sandbox_nand_ids[] = {
+	{ .compatible = "sandbox,nand" },
+	{ }
+};
+
+U_BOOT_DRIVER(sandbox_nand) = {
+	.name		= "sandbox_nand",
+	.id		= UCLASS_MTD,
+	.of_match	= sandbox_nand_ids,
+	.ofdata_to_platdata = sandbox_nand_ofdata_to_platdata,
+	.probe		= sandbox_nand_probe,
+	.remove		= sandbox_nand_remove,
+	.priv_auto_alloc_size = sizeof(struct sandbox_nand_priv),
+};
+
+void board_nand_init(void)
+{
+	struct udevice *dev;
+	int devnum = 0;
+
+	for (uclass_first_device(UCLASS_MTD, &dev); dev;
+	     uclass_next_device(&dev)) {
+		if (dev->driver != DM_GET_DRIVER(sandbox_nand))
+			continue;
+		nand_register(devnum++, sandbox_nand_get_mtd(dev));
+	}
+}
@@ -275,12 +275,19 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 
 		/* we only support erase here */
 		if (sbsf->cmd == SPINOR_OP_CHIP_ERASE) {
+			/* This has no address, so it runs straight away */
 			sbsf->erase_size = sbsf->data->sector_size *
 				sbsf->data->n_sectors;
+			if (os_lseek(sbsf->fd, 0, OS_SEEK_SET) < 0)
+				return -EIO;
+			sbsf->state = SF_ERASE;
+			break;
 		} else if (sbsf->cmd == SPINOR_OP_BE_4K && (flags & SECT_4K)) {
 			sbsf->erase_size = 4 << 10;
-		} else if (sbsf->cmd == SPINOR_OP_SE && !(flags & SECT_4K)) {
-			sbsf->erase_size = 64 << 10;
+		} else if (sbsf->cmd == SPINOR_OP_BE_32K && (flags & SECT_4K)) {
+			sbsf->erase_size = 32 << 10;
+		} else if (sbsf->cmd == SPINOR_OP_SE) {
+			sbsf->erase_size = sbsf->data->sector_size;
 		} else {
 			debug(" cmd unknown: %#x\n", sbsf->cmd);
 			return -EIO;
@@ -337,8 +344,8 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 		++pos;
 	}
 
-	/* Process the remaining data */
-	while (pos < bytes) {
+	/* Process the remaining data, or a chip erase which has none */
+	while (pos < bytes || sbsf->state == SF_ERASE) {
 		switch (sbsf->state) {
 		case SF_ID: {
 			u8 id;
@@ -36,6 +36,12 @@
 
 #define DEFAULT_READY_WAIT_JIFFIES		(40UL * HZ)
 
+/*
+ * For full-chip erase, calibrated to a 2MB flash (M25P16); should be scaled up
+ * for larger flash
+ */
+#define CHIP_ERASE_2MB_READY_WAIT_JIFFIES	(40UL * HZ)
+
 static int spi_nor_read_write_reg(struct spi_nor *nor, struct spi_mem_op
 		*op, void *buf)
 {
@@ -231,6 +237,30 @@ static struct spi_nor *mtd_to_spi_nor(struct mtd_info *mtd)
 	return mtd->priv;
 }
 
+/*
+ * Record an erase command, keeping the table sorted by size. The first
+ * opcode found for a size is kept.
+ */
+static void spi_nor_add_erase_type(struct spi_nor *nor, u32 size, u8 opcode)
+{
+	struct spi_nor_erase_type *types = nor->erase_types;
+	int i, j;
+
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX && types[i].size; i++) {
+		if (types[i].size == size)
+			return;
+		if (types[i].size > size)
+			break;
+	}
+	if (i == SNOR_ERASE_TYPE_MAX || types[SNOR_ERASE_TYPE_MAX - 1].size)
+		return;
+
+	for (j = SNOR_ERASE_TYPE_MAX - 1; j > i; j--)
+		types[j] = types[j - 1];
+	types[i].size = size;
+	types[i].opcode = opcode;
+}
+
 #ifndef CONFIG_SPI_FLASH_BAR
 static u8 spi_nor_convert_opcode(u8 opcode, const u8 table[][2], size_t size)
 {
@@ -294,12 +324,16 @@ static u8 spi_nor_convert_3to4_erase(u8 opcode)
 static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 				      const struct flash_info *info)
 {
+	int i;
+
 	/* Do some manufacturer fixups first */
 	switch (JEDEC_MFR(info)) {
 	case SNOR_MFR_SPANSION:
 		/* No small sector erase for 4-byte command set */
 		nor->erase_opcode = SPINOR_OP_SE;
 		nor->mtd.erasesize = info->sector_size;
+		memset(nor->erase_types, '\0', sizeof(nor->erase_types));
+		spi_nor_add_erase_type(nor, info->sector_size, SPINOR_OP_SE);
 		break;
 
 	default:
@@ -309,6 +343,11 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 	nor->read_opcode = spi_nor_convert_3to4_read(nor->read_opcode);
 	nor->program_opcode = spi_nor_convert_3to4_program(nor->program_opcode);
 	nor->erase_opcode = spi_nor_convert_3to4_erase(nor->erase_opcode);
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		struct spi_nor_erase_type *type = &nor->erase_types[i];
+
+		type->opcode = spi_nor_convert_3to4_erase(type->opcode);
+	}
 }
 #endif /* !CONFIG_SPI_FLASH_BAR */
 
@@ -521,10 +560,10 @@ static int read_bar(struct spi_nor *nor, const struct flash_info *info)
 /*
  * Initiate the erasure of a single sector
  */
-static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
+static int spi_nor_erase_sector(struct spi_nor *nor, u8 opcode, u32 addr)
 {
 	struct spi_mem_op op =
-		SPI_MEM_OP(SPI_MEM_OP_CMD(nor->erase_opcode, 1),
+		SPI_MEM_OP(SPI_MEM_OP_CMD(opcode, 1),
 			   SPI_MEM_OP_ADDR(nor->addr_width, addr, 1),
 			   SPI_MEM_OP_NO_DUMMY,
 			   SPI_MEM_OP_NO_DATA);
@@ -539,6 +578,69 @@ static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
 	return spi_mem_exec_op(nor->spi, &op);
 }
 
+/*
+ * Initiate the erasure of the whole chip
+ */
+static int spi_nor_erase_chip(struct spi_nor *nor)
+{
+	struct spi_mem_op op =
+		SPI_MEM_OP(SPI_MEM_OP_CMD(SPINOR_OP_CHIP_ERASE, 1),
+			   SPI_MEM_OP_NO_ADDR,
+			   SPI_MEM_OP_NO_DUMMY,
+			   SPI_MEM_OP_NO_DATA);
+
+	return spi_mem_exec_op(nor->spi, &op);
+}
+
+static bool spi_nor_can_erase_chip(struct spi_nor *nor, u32 addr, u32 len)
+{
+	return !addr && len == nor->mtd.size && !nor->erase &&
+		!(nor->flags & SNOR_F_NO_OP_CHIP_ERASE);
+}
+
+/*
+ * Find the largest erase command which starts at @addr and fits in @len
+ */
+static const struct spi_nor_erase_type *
+spi_nor_find_erase_type(struct spi_nor *nor, u32 addr, u32 len)
+{
+	const struct spi_nor_erase_type *type;
+	int i;
+
+	for (i = SNOR_ERASE_TYPE_MAX - 1; i >= 0; i--) {
+		type = &nor->erase_types[i];
+		if (type->size && type->size <= len && !(addr % type->size))
+			return type;
+	}
+
+	return NULL;
+}
+
+int spi_nor_erase_plan(struct spi_nor *nor, u32 addr, u32 len,
+		       struct spi_nor_erase_plan *plan)
+{
+	const struct spi_nor_erase_type *type;
+	int cmds = 0;
+
+	memset(plan, '\0', sizeof(*plan));
+	if (spi_nor_can_erase_chip(nor, addr, len)) {
+		plan->chip = true;
+		return 1;
+	}
+
+	while (len) {
+		type = spi_nor_find_erase_type(nor, addr, len);
+		if (!type)
+			return -EINVAL;
+		plan->count[type - nor->erase_types]++;
+		addr += type->size;
+		len -= type->size;
+		cmds++;
+	}
+
+	return cmds;
+}
+
 /*
  * Erase an address range on the nor chip.  The address range may extend
  * one or more erase sectors.  Return an error is there is a problem erasing.
@@ -546,6 +648,8 @@ static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
 static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 {
 	struct spi_nor *nor = mtd_to_spi_nor(mtd);
+	const struct spi_nor_erase_type *type;
+	unsigned long timeout;
 	u32 addr, len, rem;
 	int ret;
 
@@ -562,7 +666,32 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 	addr = instr->addr;
 	len = instr->len;
 
+	if (spi_nor_can_erase_chip(nor, addr, len)) {
+#ifdef CONFIG_SPI_FLASH_BAR
+		ret = write_bar(nor, addr);
+		if (ret < 0)
+			return ret;
+#endif
+		write_enable(nor);
+
+		ret = spi_nor_erase_chip(nor);
+		if (ret)
+			goto erase_err;
+
+		timeout = max(CHIP_ERASE_2MB_READY_WAIT_JIFFIES,
+			      CHIP_ERASE_2MB_READY_WAIT_JIFFIES *
+			      (unsigned long)div_u64(mtd->size, SZ_2M));
+		ret = spi_nor_wait_till_ready_with_timeout(nor, timeout);
+		goto erase_err;
+	}
+
 	while (len) {
+		type = spi_nor_find_erase_type(nor, addr, len);
+		if (!type) {
+			ret = -EINVAL;
+			goto erase_err;
+		}
+
 #ifdef CONFIG_SPI_FLASH_BAR
 		ret = write_bar(nor, addr);
 		if (ret < 0)
@@ -570,12 +699,12 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 #endif
 		write_enable(nor);
 
-		ret = spi_nor_erase_sector(nor, addr);
+		ret = spi_nor_erase_sector(nor, type->opcode, addr);
 		if (ret)
 			goto erase_err;
 
-		addr += mtd->erasesize;
-		len -= mtd->erasesize;
+		addr += type->size;
+		len -= type->size;
 
 		ret = spi_nor_wait_till_ready(nor);
 		if (ret)
@@ -1929,12 +2058,15 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 
 		erasesize = 1U << erasesize;
 		opcode = (half >> 8) & 0xff;
+		spi_nor_add_erase_type(nor, erasesize, opcode);
 #ifdef CONFIG_SPI_FLASH_USE_4K_SECTORS
 		if (erasesize == SZ_4K) {
 			nor->erase_opcode = opcode;
 			mtd->erasesize = erasesize;
-			break;
+			continue;
 		}
+		if (mtd->erasesize == SZ_4K)
+			continue;
 #endif
 		if (!mtd->erasesize || mtd->erasesize < erasesize) {
 			nor->erase_opcode = opcode;
@@ -2218,6 +2350,7 @@ static int spi_nor_init_params(struct spi_nor *nor,
 	/* Override the parameters with data read from SFDP tables. */
 	nor->addr_width = 0;
 	nor->mtd.erasesize = 0;
+	memset(nor->erase_types, '\0', sizeof(nor->erase_types));
 	if ((info->flags & (SPI_NOR_DUAL_READ | SPI_NOR_QUAD_READ)) &&
 	    !(info->flags & SPI_NOR_SKIP_SFDP)) {
 		struct spi_nor_flash_parameter sfdp_params;
@@ -2226,6 +2359,8 @@ static int spi_nor_init_params(struct spi_nor *nor,
 		if (spi_nor_parse_sfdp(nor, &sfdp_params)) {
 			nor->addr_width = 0;
 			nor->mtd.erasesize = 0;
+			memset(nor->erase_types, '\0',
+			       sizeof(nor->erase_types));
 		} else {
 			memcpy(params, &sfdp_params, sizeof(*params));
 		}
@@ -2346,6 +2481,13 @@ static int spi_nor_select_erase(struct spi_nor *nor,
 	if (mtd->erasesize)
 		return 0;
 
+	/* Small sectors are still used for the edges of larger erases */
+	if (info->flags & SECT_4K)
+		spi_nor_add_erase_type(nor, SZ_4K, SPINOR_OP_BE_4K);
+	else if (info->flags & SECT_4K_PMC)
+		spi_nor_add_erase_type(nor, SZ_4K, SPINOR_OP_BE_4K_PMC);
+	spi_nor_add_erase_type(nor, info->sector_size, SPINOR_OP_SE);
+
 #ifdef CONFIG_SPI_FLASH_USE_4K_SECTORS
 	/* prefer "small sector" erase if possible */
 	if (info->flags & SECT_4K) {
@@ -2610,6 +2752,12 @@ int spi_nor_scan(struct spi_nor *nor)
 		nor->addr_width = 3;
 	}
 
+	/* A driver-specific erase only knows about the selected sector size */
+	if (nor->erase) {
+		memset(nor->erase_types, '\0', sizeof(nor->erase_types));
+		spi_nor_add_erase_type(nor, mtd->erasesize, nor->erase_opcode);
+	}
+
 	if (nor->addr_width > SPI_NOR_MAX_ADDR_WIDTH) {
 		dev_dbg(dev, "address width is too large: %u\n",
 			nor->addr_width);
@@ -88,7 +88,8 @@
 
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
 
-/* Temporary variables used during scanning */
+/* Temporary variables used during scanning, both headers are within @hdrs */
+static void *hdrs;
 static struct ubi_ec_hdr *ech;
 static struct ubi_vid_hdr *vidh;
 
@@ -817,7 +818,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int pnum, int *vid, unsigned long long *sqnum)
 {
 	long long uninitialized_var(ec);
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, bitflips = 0, vol_id = -1, ec_err = 0, vid_err;
 
 	dbg_bld("scan PEB %d", pnum);
 
@@ -830,7 +831,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = ubi_io_read_hdrs(ubi, pnum, hdrs, &vid_err, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -859,7 +860,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		bitflips = 1;
 		break;
 	default:
-		ubi_err(ubi, "'ubi_io_read_ec_hdr()' returned unknown code %d",
+		ubi_err(ubi, "'ubi_io_read_hdrs()' returned unknown code %d",
 			err);
 		return -EINVAL;
 	}
@@ -913,7 +914,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
+	err = vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -982,7 +983,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 			return err;
 		goto adjust_mean_ec;
 	default:
-		ubi_err(ubi, "'ubi_io_read_vid_hdr()' returned unknown code %d",
+		ubi_err(ubi, "VID header check returned unknown code %d",
 			err);
 		return -EINVAL;
 	}
@@ -1211,6 +1212,32 @@ static void destroy_ai(struct ubi_attach_info *ai)
 	kfree(ai);
 }
 
+/**
+ * alloc_hdrs - allocate the buffer used to read the headers of each PEB.
+ * @ubi: UBI device description object
+ *
+ * Returns zero in case of success and %-ENOMEM in case of failure.
+ */
+static int alloc_hdrs(struct ubi_device *ubi)
+{
+	hdrs = kzalloc(ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize, GFP_KERNEL);
+	if (!hdrs)
+		return -ENOMEM;
+
+	ech = hdrs;
+	vidh = hdrs + ubi->vid_hdr_aloffset + ubi->vid_hdr_shift;
+
+	return 0;
+}
+
+static void free_hdrs(void)
+{
+	kfree(hdrs);
+	hdrs = NULL;
+	ech = NULL;
+	vidh = NULL;
+}
+
 /**
  * scan_all - scan entire MTD device.
  * @ubi: UBI device description object
@@ -1229,23 +1256,17 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	struct ubi_ainf_volume *av;
 	struct ubi_ainf_peb *aeb;
 
-	err = -ENOMEM;
-
-	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
-	if (!ech)
+	err = alloc_hdrs(ubi);
+	if (err)
 		return err;
 
-	vidh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
-	if (!vidh)
-		goto out_ech;
-
 	for (pnum = start; pnum < ubi->peb_count; pnum++) {
 		cond_resched();
 
 		dbg_gen("process PEB %d", pnum);
 		err = scan_peb(ubi, ai, pnum, NULL, NULL);
 		if (err < 0)
-			goto out_vidh;
+			goto out_hdrs;
 	}
 
 	ubi_msg(ubi, "scanning is finished");
@@ -1256,7 +1277,7 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	err = late_analysis(ubi, ai);
 	if (err)
-		goto out_vidh;
+		goto out_hdrs;
 
 	/*
 	 * In case of unknown erase counter we use the mean erase counter
@@ -1283,17 +1304,14 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	err = self_check_ai(ubi, ai);
 	if (err)
-		goto out_vidh;
+		goto out_hdrs;
 
-	ubi_free_vid_hdr(ubi, vidh);
-	kfree(ech);
+	free_hdrs();
 
 	return 0;
 
-out_vidh:
-	ubi_free_vid_hdr(ubi, vidh);
-out_ech:
-	kfree(ech);
+out_hdrs:
+	free_hdrs();
 	return err;
 }
 
@@ -1338,15 +1356,9 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	int err, pnum, fm_anchor = -1;
 	unsigned long long max_sqnum = 0;
 
-	err = -ENOMEM;
-
-	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
-	if (!ech)
-		goto out;
-
-	vidh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
-	if (!vidh)
-		goto out_ech;
+	err = alloc_hdrs(ubi);
+	if (err)
+		return err;
 
 	for (pnum = 0; pnum < UBI_FM_MAX_START; pnum++) {
 		int vol_id = -1;
@@ -1356,7 +1368,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 		dbg_gen("process PEB %d", pnum);
 		err = scan_peb(ubi, *ai, pnum, &vol_id, &sqnum);
 		if (err < 0)
-			goto out_vidh;
+			goto out_hdrs;
 
 		if (vol_id == UBI_FM_SB_VOLUME_ID && sqnum > max_sqnum) {
 			max_sqnum = sqnum;
@@ -1364,8 +1376,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 		}
 	}
 
-	ubi_free_vid_hdr(ubi, vidh);
-	kfree(ech);
+	free_hdrs();
 
 	if (fm_anchor < 0)
 		return UBI_NO_FASTMAP;
@@ -1377,11 +1388,8 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 
 	return ubi_scan_fastmap(ubi, *ai, fm_anchor);
 
-out_vidh:
-	ubi_free_vid_hdr(ubi, vidh);
-out_ech:
-	kfree(ech);
-out:
+out_hdrs:
+	free_hdrs();
 	return err;
 }
 
@@ -1397,9 +1405,13 @@ out:
  */
 int ubi_attach(struct ubi_device *ubi, int force_scan)
 {
+	struct ubi_attach_times *times = &ubi->attach_times;
+	unsigned long start;
 	int err;
 	struct ubi_attach_info *ai;
 
+	memset(times, '\0', sizeof(*times));
+	start = timer_get_us();
 	ai = alloc_ai();
 	if (!ai)
 		return -ENOMEM;
@@ -1440,18 +1452,25 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	ubi->max_ec = ai->max_ec;
 	ubi->mean_ec = ai->mean_ec;
 	dbg_gen("max. sequence number:       %llu", ai->max_sqnum);
+	times->scan_us = timer_get_us() - start;
 
+	start = timer_get_us();
 	err = ubi_read_volume_table(ubi, ai);
 	if (err)
 		goto out_ai;
+	times->vtbl_us = timer_get_us() - start;
 
+	start = timer_get_us();
 	err = ubi_wl_init(ubi, ai);
 	if (err)
 		goto out_vtbl;
+	times->wl_us = timer_get_us() - start;
 
+	start = timer_get_us();
 	err = ubi_eba_init(ubi, ai);
 	if (err)
 		goto out_wl;
+	times->eba_us = timer_get_us() - start;
 
 #ifdef CONFIG_MTD_UBI_FASTMAP
 	if (ubi->fm && ubi_dbg_chk_fastmap(ubi)) {
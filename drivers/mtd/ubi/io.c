@@ -703,52 +703,21 @@ bad:
 }
 
 /**
- * ubi_io_read_ec_hdr - read and check an erase counter header.
+ * check_ec_hdr - check an erase counter header which has been read.
  * @ubi: UBI device description object
- * @pnum: physical eraseblock to read from
- * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
- * header
+ * @pnum: physical eraseblock the header was read from
+ * @ec_hdr: the erase counter header
+ * @read_err: result of reading it, %0, %UBI_IO_BITFLIPS or an ECC error
  * @verbose: be verbose if the header is corrupted or was not found
  *
- * This function reads erase counter header from physical eraseblock @pnum and
- * stores it in @ec_hdr. This function also checks CRC checksum of the read
- * erase counter header. The following codes may be returned:
- *
- * o %0 if the CRC checksum is correct and the header was successfully read;
- * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
- *   and corrected by the flash driver; this is harmless but may indicate that
- *   this eraseblock may become bad soon (but may be not);
- * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
- * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
- *   a data integrity error (uncorrectable ECC error in case of NAND);
- * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
- * o a negative error code in case of failure.
+ * Returns the same codes as 'ubi_io_read_ec_hdr()'.
  */
-int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
-		       struct ubi_ec_hdr *ec_hdr, int verbose)
+static int check_ec_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_ec_hdr *ec_hdr, int read_err, int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
 
-	dbg_io("read EC header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
-
-	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
-	if (read_err) {
-		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-			return read_err;
-
-		/*
-		 * We read all the data, but either a correctable bit-flip
-		 * occurred, or MTD reported a data integrity error
-		 * (uncorrectable ECC error in case of NAND). The former is
-		 * harmless, the later may mean that the read data is
-		 * corrupted. But we have a CRC check-sum and we will detect
-		 * this. If the EC header is still OK, we just report this as
-		 * there was a bit-flip, to force scrubbing.
-		 */
-	}
-
 	magic = be32_to_cpu(ec_hdr->magic);
 	if (magic != UBI_EC_HDR_MAGIC) {
 		if (mtd_is_eccerr(read_err))
@@ -818,6 +787,55 @@ int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_ec_hdr - read and check an erase counter header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to read from
+ * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
+ * header
+ * @verbose: be verbose if the header is corrupted or was not found
+ *
+ * This function reads erase counter header from physical eraseblock @pnum and
+ * stores it in @ec_hdr. This function also checks CRC checksum of the read
+ * erase counter header. The following codes may be returned:
+ *
+ * o %0 if the CRC checksum is correct and the header was successfully read;
+ * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
+ *   and corrected by the flash driver; this is harmless but may indicate that
+ *   this eraseblock may become bad soon (but may be not);
+ * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
+ * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
+ *   a data integrity error (uncorrectable ECC error in case of NAND);
+ * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
+ * o a negative error code in case of failure.
+ */
+int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
+		       struct ubi_ec_hdr *ec_hdr, int verbose)
+{
+	int read_err;
+
+	dbg_io("read EC header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
+	if (read_err) {
+		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+			return read_err;
+
+		/*
+		 * We read all the data, but either a correctable bit-flip
+		 * occurred, or MTD reported a data integrity error
+		 * (uncorrectable ECC error in case of NAND). The former is
+		 * harmless, the later may mean that the read data is
+		 * corrupted. But we have a CRC check-sum and we will detect
+		 * this. If the EC header is still OK, we just report this as
+		 * there was a bit-flip, to force scrubbing.
+		 */
+	}
+
+	return check_ec_hdr(ubi, pnum, ec_hdr, read_err, verbose);
+}
+
 /**
  * ubi_io_write_ec_hdr - write an erase counter header.
  * @ubi: UBI device description object
@@ -982,36 +1000,20 @@ bad:
 }
 
 /**
- * ubi_io_read_vid_hdr - read and check a volume identifier header.
+ * check_vid_hdr - check a volume identifier header which has been read.
  * @ubi: UBI device description object
- * @pnum: physical eraseblock number to read from
- * @vid_hdr: &struct ubi_vid_hdr object where to store the read volume
- * identifier header
- * @verbose: be verbose if the header is corrupted or wasn't found
- *
- * This function reads the volume identifier header from physical eraseblock
- * @pnum and stores it in @vid_hdr. It also checks CRC checksum of the read
- * volume identifier header. The error codes are the same as in
- * 'ubi_io_read_ec_hdr()'.
+ * @pnum: physical eraseblock the header was read from
+ * @vid_hdr: the volume identifier header
+ * @read_err: result of reading it, %0, %UBI_IO_BITFLIPS or an ECC error
+ * @verbose: be verbose if the header is corrupted or was not found
  *
- * Note, the implementation of this function is also very similar to
- * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
+ * Returns the same codes as 'ubi_io_read_vid_hdr()'.
  */
-int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
-			struct ubi_vid_hdr *vid_hdr, int verbose)
+static int check_vid_hdr(struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_hdr *vid_hdr, int read_err, int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
-	void *p;
-
-	dbg_io("read VID header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
-
-	p = (char *)vid_hdr - ubi->vid_hdr_shift;
-	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
-			  ubi->vid_hdr_alsize);
-	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-		return read_err;
 
 	magic = be32_to_cpu(vid_hdr->magic);
 	if (magic != UBI_VID_HDR_MAGIC) {
@@ -1066,6 +1068,160 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_vid_hdr - read and check a volume identifier header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @vid_hdr: &struct ubi_vid_hdr object where to store the read volume
+ * identifier header
+ * @verbose: be verbose if the header is corrupted or wasn't found
+ *
+ * This function reads the volume identifier header from physical eraseblock
+ * @pnum and stores it in @vid_hdr. It also checks CRC checksum of the read
+ * volume identifier header. The error codes are the same as in
+ * 'ubi_io_read_ec_hdr()'.
+ *
+ * Note, the implementation of this function is also very similar to
+ * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
+ */
+int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_vid_hdr *vid_hdr, int verbose)
+{
+	int read_err;
+	void *p;
+
+	dbg_io("read VID header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
+
+	p = (char *)vid_hdr - ubi->vid_hdr_shift;
+	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
+			  ubi->vid_hdr_alsize);
+	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+		return read_err;
+
+	return check_vid_hdr(ubi, pnum, vid_hdr, read_err, verbose);
+}
+
+/**
+ * count_zero_bits - count the bits which are not set in a buffer.
+ * @buf: buffer to check
+ * @len: length of @buf
+ * @max: stop counting once there are more than this many
+ *
+ * Returns the number of zero bits, or @max + 1 if there are more than @max.
+ */
+static int count_zero_bits(const void *buf, int len, int max)
+{
+	const uint8_t *p = buf;
+	int i, bits = 0;
+
+	for (i = 0; i < len && bits <= max; i++)
+		if (p[i] != 0xFF)
+			bits += hweight8(~p[i] & 0xFF);
+
+	return min(bits, max + 1);
+}
+
+/**
+ * hdr_read_erased - check whether a header read found an erased page.
+ * @ubi: UBI device description object
+ * @buf: data which was read
+ * @len: length of @buf
+ * @read_err: result of the read
+ *
+ * Some drivers report an ECC error for an erased page with a few bit-flips,
+ * since the ECC bytes are erased too. Such a page is also taken as erased, if
+ * there are no more flips than the ECC could have corrected.
+ *
+ * Returns %UBI_IO_FF or %UBI_IO_FF_BITFLIPS if the page is erased, %0 if not.
+ */
+static int hdr_read_erased(struct ubi_device *ubi, const void *buf, int len,
+			   int read_err)
+{
+	struct mtd_info *mtd = ubi->mtd;
+	int max_flips;
+
+	if (ubi_check_pattern(buf, 0xFF, len))
+		return read_err ? UBI_IO_FF_BITFLIPS : UBI_IO_FF;
+
+	if (mtd_is_eccerr(read_err) && mtd->ecc_strength) {
+		max_flips = mtd->ecc_strength;
+		if (mtd->ecc_step_size)
+			max_flips *= DIV_ROUND_UP(len, mtd->ecc_step_size);
+		if (count_zero_bits(buf, len, max_flips) <= max_flips)
+			return UBI_IO_FF_BITFLIPS;
+	}
+
+	return 0;
+}
+
+/**
+ * ubi_io_read_hdrs - read and check both headers of a PEB.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @buf: buffer of @ubi->vid_hdr_aloffset + @ubi->vid_hdr_alsize bytes
+ * @vid_err: returns the result of checking the volume identifier header
+ * @verbose: be verbose if a header is corrupted or was not found
+ *
+ * Attaching needs both headers of every PEB. If they share one minimal I/O
+ * unit, they are fetched with a single read, which pays the page read time
+ * only once. Otherwise the erase counter header is read first, and the volume
+ * identifier header is only read if the erase counter page is not erased, so
+ * that an empty PEB costs a single page read. The erase counter header is at
+ * the start of @buf and the volume identifier header at
+ * @ubi->vid_hdr_aloffset + @ubi->vid_hdr_shift.
+ *
+ * Returns the same codes as 'ubi_io_read_ec_hdr()' for the erase counter
+ * header. @vid_err is set to the code 'ubi_io_read_vid_hdr()' would have
+ * returned, except for an erased PEB, when both are %UBI_IO_FF or
+ * %UBI_IO_FF_BITFLIPS.
+ */
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum, void *buf,
+		     int *vid_err, int verbose)
+{
+	int len = ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize;
+	int shared = len <= ubi->min_io_size;
+	int ec_read_err, vid_read_err, err;
+
+	dbg_io("read EC%s header from PEB %d", shared ? " and VID" : "", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	if (!shared)
+		len = UBI_EC_HDR_SIZE;
+	ubi->attach_times.hdr_reads += 1;
+	ec_read_err = ubi_io_read(ubi, buf, pnum, 0, len);
+	if (ec_read_err && ec_read_err != UBI_IO_BITFLIPS &&
+	    !mtd_is_eccerr(ec_read_err))
+		return ec_read_err;
+
+	err = hdr_read_erased(ubi, buf, len, ec_read_err);
+	if (err) {
+		dbg_bld("PEB %d is erased", pnum);
+		*vid_err = err;
+		return err;
+	}
+
+	if (shared) {
+		/* One read, so the result applies to both headers */
+		vid_read_err = ec_read_err;
+	} else {
+		ubi->attach_times.hdr_reads += 1;
+		vid_read_err = ubi_io_read(ubi, buf + ubi->vid_hdr_aloffset,
+					   pnum, ubi->vid_hdr_aloffset,
+					   ubi->vid_hdr_alsize);
+	}
+	if (vid_read_err && vid_read_err != UBI_IO_BITFLIPS &&
+	    !mtd_is_eccerr(vid_read_err))
+		*vid_err = vid_read_err;
+	else
+		*vid_err = check_vid_hdr(ubi, pnum, buf +
+					 ubi->vid_hdr_aloffset +
+					 ubi->vid_hdr_shift, vid_read_err,
+					 verbose);
+
+	return check_ec_hdr(ubi, pnum, buf, ec_read_err, verbose);
+}
+
 /**
  * ubi_io_write_vid_hdr - write a volume identifier header.
  * @ubi: UBI device description object
@@ -415,6 +415,22 @@ struct ubi_debug_info {
 	struct dentry *dfs_power_cut_max;
 };
 
+/**
+ * struct ubi_attach_times - where the time went while attaching.
+ * @scan_us: reading and checking the headers of the PEBs, or the fastmap
+ * @vtbl_us: reading the volume table
+ * @wl_us: initializing the wear-leveling sub-system
+ * @eba_us: initializing the EBA sub-system
+ * @hdr_reads: number of flash reads of PEB headers
+ */
+struct ubi_attach_times {
+	unsigned long scan_us;
+	unsigned long vtbl_us;
+	unsigned long wl_us;
+	unsigned long eba_us;
+	int hdr_reads;
+};
+
 /**
  * struct ubi_device - UBI device description structure
  * @dev: UBI device object to use the the Linux device model
@@ -528,6 +544,7 @@ struct ubi_debug_info {
  * @buf_mutex: protects @peb_buf
  * @ckvol_mutex: serializes static volume checking when opening
  *
+ * @attach_times: time spent in each phase of attaching
  * @dbg: debugging information for this UBI device
  */
 struct ubi_device {
@@ -627,6 +644,7 @@ struct ubi_device {
 	struct mutex buf_mutex;
 	struct mutex ckvol_mutex;
 
+	struct ubi_attach_times attach_times;
 	struct ubi_debug_info dbg;
 };
 
@@ -898,6 +916,8 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_hdr *vid_hdr, int verbose);
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_hdr *vid_hdr);
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum, void *buf,
+		     int *vid_err, int verbose);
 
 /* build.c */
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
@@ -47,6 +47,22 @@ void sandbox_eth_skip_timeout(void)
 	skip_timeout = true;
 }
 
+/*
+ * sb_eth_ring_full()
+ *
+ * Count a packet which could not be injected because the receive buffer is
+ * full
+ */
+static void sb_eth_ring_full(struct udevice *dev)
+{
+	struct eth_stats *stats = eth_get_stats(dev);
+
+	if (stats) {
+		stats->rx_ring_full++;
+		stats->rx_dropped++;
+	}
+}
+
 /*
  * sandbox_eth_arp_req_to_reply()
  *
@@ -72,8 +88,10 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		sb_eth_ring_full(dev);
 		return 0;
+	}
 
 	/* store this as the assumed IP of the fake host */
 	priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
@@ -134,8 +152,10 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		sb_eth_ring_full(dev);
 		return 0;
+	}
 
 	/* reply to the ping */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -174,8 +194,10 @@ int sandbox_eth_recv_arp_req(struct udevice *dev)
 	struct arp_hdr *arp_recv;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		sb_eth_ring_full(dev);
 		return -EOVERFLOW;
+	}
 
 	/* Formulate a fake request */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -216,8 +238,10 @@ int sandbox_eth_recv_ping_req(struct udevice *dev)
 	struct icmp_hdr *icmpr;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		sb_eth_ring_full(dev);
 		return -EOVERFLOW;
+	}
 
 	/* Formulate a fake ping */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -325,10 +349,8 @@ static int sb_eth_start(struct udevice *dev)
 	debug("eth_sandbox: Start\n");
 
 	priv->recv_packets = 0;
-	for (int i = 0; i < PKTBUFSRX; i++) {
-		priv->recv_packet_buffer[i] = net_rx_packets[i];
+	for (int i = 0; i < PKTBUFSRX; i++)
 		priv->recv_packet_length[i] = 0;
-	}
 
 	return 0;
 }
@@ -365,26 +387,61 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 	return 0;
 }
 
-static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
+static int sb_eth_recv_batch(struct udevice *dev, int flags,
+			     struct eth_rx_desc *descs, int count)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
 	int i;
 
-	if (!priv->recv_packets)
-		return 0;
+	if (skip_timeout) {
+		timer_test_add_offset(11000UL);
+		skip_timeout = false;
+	}
+
+	count = min(count, priv->recv_packets);
+	for (i = 0; i < count; i++) {
+		descs[i].packet = priv->recv_packet_buffer[i];
+		descs[i].length = priv->recv_packet_length[i];
+	}
+	debug("eth_sandbox: received %d packets, %d waiting\n", count,
+	      priv->recv_packets - count);
+
+	return count;
+}
 
-	--priv->recv_packets;
-	for (i = 0; i < priv->recv_packets; i++) {
-		priv->recv_packet_length[i] = priv->recv_packet_length[i + 1];
-		memcpy(priv->recv_packet_buffer[i],
-		       priv->recv_packet_buffer[i + 1],
-		       priv->recv_packet_length[i + 1]);
+/*
+ * Drop the first @count packets, moving their buffers to the end so that
+ * they can be used again without copying the packets still waiting
+ */
+static int sb_eth_free_batch(struct udevice *dev, struct eth_rx_desc *descs,
+			     int count)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	uchar *done[PKTBUFSRX];
+	int i;
+
+	count = min(count, priv->recv_packets);
+	memcpy(done, priv->recv_packet_buffer, count * sizeof(done[0]));
+	memmove(priv->recv_packet_buffer, priv->recv_packet_buffer + count,
+		(PKTBUFSRX - count) * sizeof(done[0]));
+	memmove(priv->recv_packet_length, priv->recv_packet_length + count,
+		(PKTBUFSRX - count) * sizeof(priv->recv_packet_length[0]));
+	for (i = 0; i < count; i++) {
+		priv->recv_packet_buffer[PKTBUFSRX - count + i] = done[i];
+		priv->recv_packet_length[PKTBUFSRX - count + i] = 0;
 	}
-	priv->recv_packet_length[priv->recv_packets] = 0;
+	priv->recv_packets -= count;
 
 	return 0;
 }
 
+static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
+{
+	struct eth_rx_desc desc = { packet, length };
+
+	return sb_eth_free_batch(dev, &desc, 1);
+}
+
 static void sb_eth_stop(struct udevice *dev)
 {
 	debug("eth_sandbox: Stop\n");
@@ -404,12 +461,38 @@ static const struct eth_ops sb_eth_ops = {
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
 	.free_pkt		= sb_eth_free_pkt,
+	.recv_batch		= sb_eth_recv_batch,
+	.free_batch		= sb_eth_free_batch,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
 };
 
 static int sb_eth_remove(struct udevice *dev)
 {
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int count;
+
+	for (count = 0; count < PKTBUFSRX; count++) {
+		if (!priv->recv_packet_buffer[count])
+			break;
+	}
+	eth_pkt_pool_put(priv->recv_packet_buffer, count);
+	memset(priv->recv_packet_buffer, '\0',
+	       sizeof(priv->recv_packet_buffer));
+
+	return 0;
+}
+
+static int sb_eth_probe(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (eth_pkt_pool_get(priv->recv_packet_buffer, PKTBUFSRX) !=
+	    PKTBUFSRX) {
+		sb_eth_remove(dev);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -443,6 +526,7 @@ U_BOOT_DRIVER(eth_sandbox) = {
 	.id	= UCLASS_ETH,
 	.of_match = sb_eth_ids,
 	.ofdata_to_platdata = sb_eth_ofdata_to_platdata,
+	.probe	= sb_eth_probe,
 	.remove	= sb_eth_remove,
 	.ops	= &sb_eth_ops,
 	.priv_auto_alloc_size = sizeof(struct eth_sandbox_priv),
@@ -173,19 +173,135 @@ void serial_initialize(void)
 	serial_init();
 }
 
-static void _serial_putc(struct udevice *dev, char ch)
+static void __serial_putc(struct udevice *dev, char ch)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 	int err;
 
 	if (ch == '\n')
-		_serial_putc(dev, '\r');
+		__serial_putc(dev, '\r');
 
 	do {
 		err = ops->putc(dev, ch);
 	} while (err == -EAGAIN);
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/**
+ * _serial_tx_drain() - Send buffered output to the UART
+ *
+ * @dev: Serial device
+ * @wait: true to wait until the buffer is empty, false to return as soon as
+ *	the UART cannot accept any more characters
+ */
+static void _serial_tx_drain(struct udevice *dev, bool wait)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int err;
+
+	/* Don't recurse if the driver calls udelay() or similar */
+	if (!upriv->tx_buf || upriv->tx_busy)
+		return;
+	upriv->tx_busy = true;
+	while (upriv->tx_rd_ptr != upriv->tx_wr_ptr) {
+		err = ops->putc(dev, upriv->tx_buf[upriv->tx_rd_ptr]);
+		if (err == -EAGAIN) {
+			if (!wait)
+				break;
+			continue;
+		}
+		upriv->tx_rd_ptr++;
+		upriv->tx_rd_ptr %= CONFIG_SERIAL_TX_BUFFER_SIZE;
+	}
+	upriv->tx_busy = false;
+}
+
+/*
+ * Only the console UART is buffered, since that is the one which is drained
+ * from the idle points. The buffer is allocated on first use after
+ * relocation.
+ */
+static bool _serial_tx_buffered(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (upriv->tx_buf)
+		return true;
+	if (dev != gd->cur_serial_dev || !(gd->flags & GD_FLG_RELOC))
+		return false;
+	upriv->tx_buf = malloc(CONFIG_SERIAL_TX_BUFFER_SIZE);
+
+	return upriv->tx_buf != NULL;
+}
+
+static void _serial_putc(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int next;
+
+	if (!_serial_tx_buffered(dev))
+		return __serial_putc(dev, ch);
+
+	if (ch == '\n')
+		_serial_putc(dev, '\r');
+
+	_serial_tx_drain(dev, false);
+	if (upriv->tx_rd_ptr == upriv->tx_wr_ptr && !upriv->tx_busy &&
+	    ops->putc(dev, ch) != -EAGAIN)
+		return;
+
+	next = (upriv->tx_wr_ptr + 1) % CONFIG_SERIAL_TX_BUFFER_SIZE;
+	if (next == upriv->tx_rd_ptr) {
+		/* Buffer is full, so wait for the UART to make space */
+		if (upriv->tx_busy)
+			return __serial_putc(dev, ch);
+		while (next == upriv->tx_rd_ptr)
+			_serial_tx_drain(dev, false);
+	}
+	upriv->tx_buf[upriv->tx_wr_ptr] = ch;
+	upriv->tx_wr_ptr = next;
+}
+
+static void _serial_puts(struct udevice *dev, const char *str)
+{
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int err;
+
+	if (ops->puts && !_serial_tx_buffered(dev)) {
+		do {
+			err = ops->puts(dev, str);
+		} while (err == -EAGAIN);
+	} else {
+		while (*str)
+			_serial_putc(dev, *str++);
+	}
+}
+
+void serial_poll_tx(void)
+{
+	if (gd->cur_serial_dev)
+		_serial_tx_drain(gd->cur_serial_dev, false);
+}
+
+void serial_flush_tx(void)
+{
+	if (gd->cur_serial_dev)
+		_serial_tx_drain(gd->cur_serial_dev, true);
+}
+
+#else /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
+static inline void _serial_tx_drain(struct udevice *dev, bool wait)
+{
+}
+
+static void _serial_putc(struct udevice *dev, char ch)
+{
+	__serial_putc(dev, ch);
+}
+
 static void _serial_puts(struct udevice *dev, const char *str)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
@@ -200,6 +316,7 @@ static void _serial_puts(struct udevice *dev, const char *str)
 			_serial_putc(dev, *str++);
 	}
 }
+#endif /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
 
 static int __serial_getc(struct udevice *dev)
 {
@@ -208,8 +325,10 @@ static int __serial_getc(struct udevice *dev)
 
 	do {
 		err = ops->getc(dev);
-		if (err == -EAGAIN)
+		if (err == -EAGAIN) {
 			WATCHDOG_RESET();
+			_serial_tx_drain(dev, false);
+		}
 	} while (err == -EAGAIN);
 
 	return err >= 0 ? err : 0;
@@ -219,6 +338,7 @@ static int __serial_tstc(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	_serial_tx_drain(dev, false);
 	if (ops->pending)
 		return ops->pending(dev, true);
 
@@ -500,6 +620,11 @@ static int serial_pre_remove(struct udevice *dev)
 {
 #if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+#endif
+
+	/* Don't lose buffered output, e.g. when removing devices before boot */
+	_serial_tx_drain(dev, true);
+#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
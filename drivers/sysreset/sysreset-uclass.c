@@ -9,6 +9,7 @@
 #include <common.h>
 #include <cpu_func.h>
 #include <hang.h>
+#include <serial.h>
 #include <sysreset.h>
 #include <dm.h>
 #include <errno.h>
@@ -114,6 +115,7 @@ void reset_cpu(ulong addr)
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	printf("resetting ...\n");
+	serial_flush_tx();
 
 	sysreset_walk_halt(SYSRESET_COLD);
 
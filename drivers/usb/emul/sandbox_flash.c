@@ -9,6 +9,7 @@
 #include <os.h>
 #include <scsi.h>
 #include <usb.h>
+#include <asm/test.h>
 
 /*
  * This driver emulates a flash stick using the UFI command specification and
@@ -49,6 +50,7 @@ enum {
  * @status_buff:	Data buffer for outgoing status
  * @buff_used:	Number of bytes ready to transfer back to host
  * @buff:	Data buffer for outgoing data
+ * @stats:	Commands received
  */
 struct sandbox_flash_priv {
 	bool error;
@@ -62,6 +64,7 @@ struct sandbox_flash_priv {
 	struct umass_bbb_csw status;
 	int buff_used;
 	u8 buff[512];
+	struct sandbox_flash_stats stats;
 };
 
 struct sandbox_flash_plat {
@@ -95,6 +98,18 @@ struct __packed scsi_read10_req {
 	u8 spare2[3];
 };
 
+struct __packed scsi_read16_req {
+	u8 cmd;
+	u8 flags;
+	u64 lba;
+	u32 transfer_len;
+	u8 group;
+	u8 control;
+};
+
+/* Opcode of READ(16); SCSI_READ16 in scsi.h is not the value on the wire */
+#define SANDBOX_FLASH_READ16	0x88
+
 static struct usb_device_descriptor flash_device_desc = {
 	.bLength =		sizeof(flash_device_desc),
 	.bDescriptorType =	USB_DT_DEVICE,
@@ -227,6 +242,9 @@ static void handle_read(struct sandbox_flash_priv *priv, ulong lba,
 			ulong transfer_len)
 {
 	debug("%s: lba=%lx, transfer_len=%lx\n", __func__, lba, transfer_len);
+	priv->stats.read_blks += transfer_len;
+	priv->stats.max_read_blks = max(priv->stats.max_read_blks,
+					(uint)transfer_len);
 	if (priv->fd != -1) {
 		os_lseek(priv->fd, lba * SANDBOX_FLASH_BLOCK_LEN, OS_SEEK_SET);
 		priv->read_len = transfer_len;
@@ -280,10 +298,19 @@ static int handle_ufi_command(struct sandbox_flash_plat *plat,
 	case SCSI_READ10: {
 		struct scsi_read10_req *req = (void *)buff;
 
+		priv->stats.read10++;
 		handle_read(priv, be32_to_cpu(req->lba),
 			    be16_to_cpu(req->transfer_len));
 		break;
 	}
+	case SANDBOX_FLASH_READ16: {
+		struct scsi_read16_req *req = (void *)buff;
+
+		priv->stats.read16++;
+		handle_read(priv, be64_to_cpu(req->lba),
+			    be32_to_cpu(req->transfer_len));
+		break;
+	}
 	default:
 		debug("Command not supported: %x\n", req->cmd[0]);
 		return -EPROTONOSUPPORT;
@@ -315,7 +342,8 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 			if ((cbw->bCBWFlags & CBWFLAGS_SBZ) ||
 			    cbw->bCBWLUN != 0)
 				goto err;
-			if (cbw->bCDBLength < 1 || cbw->bCDBLength >= 0x10)
+			if (cbw->bCDBLength < 1 ||
+			    cbw->bCDBLength > CBWCDBLENGTH)
 				goto err;
 			priv->transfer_len = cbw->dCBWDataTransferLength;
 			priv->tag = cbw->dCBWTag;
@@ -365,6 +393,14 @@ err:
 	return 0;
 }
 
+void sandbox_flash_get_stats(struct udevice *dev,
+			     struct sandbox_flash_stats *stats)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	*stats = priv->stats;
+}
+
 static int sandbox_flash_ofdata_to_platdata(struct udevice *dev)
 {
 	struct sandbox_flash_plat *plat = dev_get_platdata(dev);
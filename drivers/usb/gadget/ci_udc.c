@@ -322,6 +322,7 @@ static void ci_ep_free_request(struct usb_ep *ep, struct usb_request *req)
 
 	if (ci_req->b_buf)
 		free(ci_req->b_buf);
+	free(ci_req->dtds);
 	free(ci_req);
 }
 
@@ -371,15 +372,6 @@ static int ci_ep_enable(struct usb_ep *ep,
 	return 0;
 }
 
-static int ci_ep_disable(struct usb_ep *ep)
-{
-	struct ci_ep *ci_ep = container_of(ep, struct ci_ep, ep);
-
-	ci_ep->desc = NULL;
-	ep->desc = NULL;
-	return 0;
-}
-
 static int ci_bounce(struct ci_req *ci_req, int in)
 {
 	struct usb_request *req = &ci_req->req;
@@ -444,6 +436,188 @@ static void ci_debounce(struct ci_req *ci_req, int in)
 	memcpy(req->buf, ci_req->hw_buf, req->actual);
 }
 
+static struct ept_queue_item *ci_req_dtd(struct ci_req *ci_req, int i)
+{
+	return (struct ept_queue_item *)((uint8_t *)ci_req->dtds +
+					 i * ILIST_ENT_SZ);
+}
+
+/**
+ * ci_req_build_dtds() - set up the dTD chain for a request
+ * @ci_ep:	Endpoint the request is queued on (not ep0)
+ * @ci_req:	Request, already bounced
+ * @in:		Direction of the endpoint (IN = 1, OUT = 0)
+ *
+ * Each dTD covers up to EP_MAX_LENGTH_TRANSFER bytes, so a large request
+ * needs several. They are allocated once and kept with the request, and
+ * only the last one interrupts on completion.
+ */
+static int ci_req_build_dtds(struct ci_ep *ci_ep, struct ci_req *ci_req,
+			     int in)
+{
+	uint32_t len_left = ci_req->req.length;
+	uint8_t *buf = ci_req->hw_buf;
+	struct ept_queue_item *dtd = NULL;
+	uint32_t len_this_dtd;
+	unsigned long start;
+	int count, i;
+
+	count = max_t(int, DIV_ROUND_UP(len_left, EP_MAX_LENGTH_TRANSFER), 1);
+	/* See ci_ep_submit_next_request() for when a ZLP is needed */
+	if (in && len_left && !(len_left % ci_ep->ep.maxpacket) &&
+	    ci_req->req.zero)
+		count++;
+
+	if (count > ci_req->dtd_alloc) {
+		free(ci_req->dtds);
+		ci_req->dtd_alloc = 0;
+		ci_req->dtds = memalign(ILIST_ALIGN, count * ILIST_ENT_SZ);
+		if (!ci_req->dtds)
+			return -ENOMEM;
+		ci_req->dtd_alloc = count;
+	}
+	memset(ci_req->dtds, 0, count * ILIST_ENT_SZ);
+
+	for (i = 0; i < count; i++) {
+		dtd = ci_req_dtd(ci_req, i);
+		len_this_dtd = min(len_left, (unsigned)EP_MAX_LENGTH_TRANSFER);
+
+		dtd->info = INFO_BYTES(len_this_dtd) | INFO_ACTIVE;
+		dtd->page0 = (unsigned long)buf;
+		dtd->page1 = ((unsigned long)buf & 0xfffff000) + 0x1000;
+		dtd->page2 = ((unsigned long)buf & 0xfffff000) + 0x2000;
+		dtd->page3 = ((unsigned long)buf & 0xfffff000) + 0x3000;
+		dtd->page4 = ((unsigned long)buf & 0xfffff000) + 0x4000;
+		if (i < count - 1)
+			dtd->next = (unsigned long)ci_req_dtd(ci_req, i + 1);
+		else
+			dtd->next = TERMINATE;
+
+		len_left -= len_this_dtd;
+		buf += len_this_dtd;
+	}
+	dtd->info |= INFO_IOC;
+	ci_req->dtd_count = count;
+
+	start = (unsigned long)ci_req->dtds;
+	flush_dcache_range(start, start + count * ILIST_ENT_SZ);
+
+	return 0;
+}
+
+/**
+ * ci_ep_prime_req() - add a request to the end of the hardware queue
+ * @ci_ep:	Endpoint (not ep0)
+ * @ci_req:	Request with its dTDs set up, not yet on @ci_ep's queue
+ *
+ * If other requests are still queued, the new dTDs are linked after the
+ * last of them and the controller picks them up without a gap. The ATDTW
+ * tripwire tells us whether the controller was still running when the
+ * link was made; if not, the endpoint is primed again.
+ */
+static void ci_ep_prime_req(struct ci_ep *ci_ep, struct ci_req *ci_req)
+{
+	struct ci_udc *udc = (struct ci_udc *)controller.ctrl->hcor;
+	struct ept_queue_item *first = ci_req_dtd(ci_req, 0);
+	struct ept_queue_head *head;
+	struct ept_queue_item *tail;
+	struct ci_req *last;
+	int num, in, bit;
+	u32 stat;
+
+	num = ci_ep->desc->bEndpointAddress & USB_ENDPOINT_NUMBER_MASK;
+	in = (ci_ep->desc->bEndpointAddress & USB_DIR_IN) != 0;
+	bit = in ? EPT_TX(num) : EPT_RX(num);
+
+	if (!list_empty(&ci_ep->queue)) {
+		last = list_last_entry(&ci_ep->queue, struct ci_req, queue);
+		tail = ci_req_dtd(last, last->dtd_count - 1);
+		ci_invalidate_td(tail);
+		tail->next = (unsigned long)first;
+		ci_flush_td(tail);
+
+		if (readl(&udc->epprime) & bit)
+			return;
+		do {
+			setbits_le32(&udc->usbcmd, USBCMD_ATDTW);
+			stat = readl(&udc->epstat) & bit;
+		} while (!(readl(&udc->usbcmd) & USBCMD_ATDTW));
+		clrbits_le32(&udc->usbcmd, USBCMD_ATDTW);
+		if (stat)
+			return;
+	}
+
+	DBG("ept%d %s prime req %p, buffer %p\n",
+	    num, in ? "in" : "out", ci_req, ci_req->hw_buf);
+	head = ci_get_qh(num, in);
+	head->next = (unsigned long)first;
+	head->info = 0;
+	ci_flush_qh(num);
+
+	writel(bit, &udc->epprime);
+}
+
+/**
+ * ci_ep_flush() - stop the controller using an endpoint's queue
+ * @ci_ep:	Endpoint (not ep0)
+ *
+ * Any data not yet transferred for the queued requests is dropped.
+ */
+static void ci_ep_flush(struct ci_ep *ci_ep)
+{
+	struct ci_udc *udc = (struct ci_udc *)controller.ctrl->hcor;
+	struct ept_queue_head *head;
+	int num, in, bit;
+
+	num = ci_ep->desc->bEndpointAddress & USB_ENDPOINT_NUMBER_MASK;
+	in = (ci_ep->desc->bEndpointAddress & USB_DIR_IN) != 0;
+	bit = in ? EPT_TX(num) : EPT_RX(num);
+
+	do {
+		writel(bit, &udc->epflush);
+		while (readl(&udc->epflush) & bit)
+			;
+	} while (readl(&udc->epstat) & bit);
+
+	head = ci_get_qh(num, in);
+	head->next = TERMINATE;
+	head->info = 0;
+	ci_flush_qh(num);
+}
+
+/**
+ * ci_ep_nuke() - complete all requests queued on an endpoint with an error
+ * @ci_ep:	Endpoint (not ep0), already flushed
+ * @status:	Status to give the requests
+ */
+static void ci_ep_nuke(struct ci_ep *ci_ep, int status)
+{
+	struct ci_req *ci_req;
+
+	while (!list_empty(&ci_ep->queue)) {
+		ci_req = list_first_entry(&ci_ep->queue, struct ci_req, queue);
+		list_del_init(&ci_req->queue);
+		ci_req->req.status = status;
+		if (ci_req->req.complete)
+			ci_req->req.complete(&ci_ep->ep, &ci_req->req);
+	}
+}
+
+static int ci_ep_disable(struct usb_ep *ep)
+{
+	struct ci_ep *ci_ep = container_of(ep, struct ci_ep, ep);
+
+	/* The caller may free the requests as soon as this returns */
+	if (ci_ep->desc &&
+	    (ci_ep->desc->bEndpointAddress & USB_ENDPOINT_NUMBER_MASK)) {
+		ci_ep_flush(ci_ep);
+		ci_ep_nuke(ci_ep, -ESHUTDOWN);
+	}
+	ci_ep->desc = NULL;
+	ep->desc = NULL;
+	return 0;
+}
+
 static void ci_ep_submit_next_request(struct ci_ep *ci_ep)
 {
 	struct ci_udc *udc = (struct ci_udc *)controller.ctrl->hcor;
@@ -555,6 +729,7 @@ static int ci_ep_dequeue(struct usb_ep *_ep, struct usb_request *_req)
 {
 	struct ci_ep *ci_ep = container_of(_ep, struct ci_ep, ep);
 	struct ci_req *ci_req;
+	int in;
 
 	list_for_each_entry(ci_req, &ci_ep->queue, queue) {
 		if (&ci_req->req == _req)
@@ -564,7 +739,27 @@ static int ci_ep_dequeue(struct usb_ep *_ep, struct usb_request *_req)
 	if (&ci_req->req != _req)
 		return -EINVAL;
 
-	list_del_init(&ci_req->queue);
+	in = (ci_ep->desc->bEndpointAddress & USB_DIR_IN) != 0;
+	if (ci_ep->desc->bEndpointAddress & USB_ENDPOINT_NUMBER_MASK) {
+		struct ci_req *req, *tmp;
+		LIST_HEAD(requeue);
+
+		/*
+		 * The controller may be working on any of the queued requests,
+		 * so stop it and start again with the ones that are left.
+		 */
+		ci_ep_flush(ci_ep);
+		list_del_init(&ci_req->queue);
+		list_splice_init(&ci_ep->queue, &requeue);
+		list_for_each_entry_safe(req, tmp, &requeue, queue) {
+			list_del_init(&req->queue);
+			ci_req_build_dtds(ci_ep, req, in);
+			ci_ep_prime_req(ci_ep, req);
+			list_add_tail(&req->queue, &ci_ep->queue);
+		}
+	} else {
+		list_del_init(&ci_req->queue);
+	}
 
 	if (ci_req->req.status == -EINPROGRESS) {
 		ci_req->req.status = -ECONNRESET;
@@ -605,6 +800,16 @@ static int ci_ep_queue(struct usb_ep *ep,
 	if (ret)
 		return ret;
 
+	if (num) {
+		/* Other endpoints keep all their requests in the hardware */
+		ret = ci_req_build_dtds(ci_ep, ci_req, in);
+		if (ret)
+			return ret;
+		ci_ep_prime_req(ci_ep, ci_req);
+		list_add_tail(&ci_req->queue, &ci_ep->queue);
+		return 0;
+	}
+
 	DBG("ept%d %s pre-queue req %p, buffer %p\n",
 	    num, in ? "in" : "out", ci_req, ci_req->hw_buf);
 	list_add_tail(&ci_req->queue, &ci_ep->queue);
@@ -626,6 +831,53 @@ static void flip_ep0_direction(void)
 	}
 }
 
+/**
+ * handle_queue_complete() - complete the finished requests on an endpoint
+ * @ci_ep:	Endpoint (not ep0)
+ *
+ * Requests finish in the order they were queued, so this stops at the first
+ * one which the controller is still working on.
+ */
+static void handle_queue_complete(struct ci_ep *ci_ep)
+{
+	struct ept_queue_item *item;
+	struct ci_req *ci_req;
+	unsigned long start;
+	int num, in, len, j;
+
+	num = ci_ep->desc->bEndpointAddress & USB_ENDPOINT_NUMBER_MASK;
+	in = (ci_ep->desc->bEndpointAddress & USB_DIR_IN) != 0;
+
+	while (!list_empty(&ci_ep->queue)) {
+		ci_req = list_first_entry(&ci_ep->queue, struct ci_req, queue);
+		start = (unsigned long)ci_req->dtds;
+		invalidate_dcache_range(start,
+					start + ci_req->dtd_count * ILIST_ENT_SZ);
+		item = ci_req_dtd(ci_req, ci_req->dtd_count - 1);
+		if (item->info & INFO_ACTIVE)
+			break;
+
+		len = 0;
+		for (j = 0; j < ci_req->dtd_count; j++) {
+			item = ci_req_dtd(ci_req, j);
+			len += (item->info >> 16) & 0x7fff;
+			if (item->info & 0xff)
+				printf("EP%d/%s FAIL info=%x pg0=%x\n",
+				       num, in ? "in" : "out", item->info,
+				       item->page0);
+		}
+
+		list_del_init(&ci_req->queue);
+		ci_req->req.actual = ci_req->req.length - len;
+		ci_req->req.status = 0;
+		ci_debounce(ci_req, in);
+
+		DBG("ept%d %s req %p, complete %x\n",
+		    num, in ? "in" : "out", ci_req, len);
+		ci_req->req.complete(&ci_ep->ep, &ci_req->req);
+	}
+}
+
 static void handle_ep_complete(struct ci_ep *ci_ep)
 {
 	struct ept_queue_item *item, *next_td;
@@ -634,6 +886,10 @@ static void handle_ep_complete(struct ci_ep *ci_ep)
 
 	num = ci_ep->desc->bEndpointAddress & USB_ENDPOINT_NUMBER_MASK;
 	in = (ci_ep->desc->bEndpointAddress & USB_DIR_IN) != 0;
+	if (num) {
+		handle_queue_complete(ci_ep);
+		return;
+	}
 	item = ci_get_qtd(num, in);
 	ci_invalidate_qtd(num);
 	ci_req = list_first_entry(&ci_ep->queue, struct ci_req, queue);
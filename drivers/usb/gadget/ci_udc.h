@@ -56,6 +56,7 @@ struct ci_udc {
 #define MICRO_8FRAME	0x8
 #define USBCMD_ITC(x)	((((x) > 0xff) ? 0xff : x) << 16)
 #define USBCMD_FS2	(1 << 15)
+#define USBCMD_ATDTW	(1 << 14)
 #define USBCMD_RST	(1 << 1)
 #define USBCMD_RUN	(1)
 
@@ -87,6 +88,13 @@ struct ci_req {
 	uint8_t *hw_buf;
 	uint32_t hw_len;
 	uint32_t dtd_count;
+	/*
+	 * dTDs for requests on endpoints other than ep0. These are kept with
+	 * the request so that several requests can be chained in the hardware
+	 * queue at once.
+	 */
+	struct ept_queue_item *dtds;
+	uint32_t dtd_alloc;
 };
 
 struct ci_ep {
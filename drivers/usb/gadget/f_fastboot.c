@@ -44,6 +44,9 @@ struct usb_req {
 	usb_req *next;
 };
 
+#define DL_QUEUE_DEPTH		CONFIG_FASTBOOT_USB_RX_QUEUE_DEPTH
+#define DL_BUFFER_SIZE		CONFIG_FASTBOOT_USB_RX_BUF_SIZE
+
 struct f_fastboot {
 	struct usb_function usb_function;
 
@@ -51,6 +54,11 @@ struct f_fastboot {
 	struct usb_ep *in_ep, *out_ep;
 	struct usb_request *in_req, *out_req;
 
+	/* OUT requests for download data, all queued during a download */
+	struct usb_request *dl_req[DL_QUEUE_DEPTH];
+	/* Bytes requested by download requests which have not completed */
+	unsigned int dl_pending;
+
 	usb_req *front, *rear;
 };
 
@@ -316,10 +324,20 @@ static void fastboot_unbind(struct usb_configuration *c, struct usb_function *f)
 static void fastboot_disable(struct usb_function *f)
 {
 	struct f_fastboot *f_fb = func_to_fastboot(f);
+	int i;
 
 	usb_ep_disable(f_fb->out_ep);
 	usb_ep_disable(f_fb->in_ep);
 
+	for (i = 0; i < DL_QUEUE_DEPTH; i++) {
+		if (f_fb->dl_req[i]) {
+			free(f_fb->dl_req[i]->buf);
+			usb_ep_free_request(f_fb->out_ep, f_fb->dl_req[i]);
+			f_fb->dl_req[i] = NULL;
+		}
+	}
+	f_fb->dl_pending = 0;
+
 	if (f_fb->out_req) {
 		free(f_fb->out_req->buf);
 		usb_ep_free_request(f_fb->out_ep, f_fb->out_req);
@@ -332,7 +350,8 @@ static void fastboot_disable(struct usb_function *f)
 	}
 }
 
-static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
+static struct usb_request *fastboot_alloc_req(struct usb_ep *ep,
+					      unsigned int size)
 {
 	struct usb_request *req;
 
@@ -340,8 +359,8 @@ static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
 	if (!req)
 		return NULL;
 
-	req->length = EP_BUFFER_SIZE;
-	req->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, EP_BUFFER_SIZE);
+	req->length = size;
+	req->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, size);
 	if (!req->buf) {
 		usb_ep_free_request(ep, req);
 		return NULL;
@@ -351,6 +370,13 @@ static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
 	return req;
 }
 
+static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
+{
+	return fastboot_alloc_req(ep, EP_BUFFER_SIZE);
+}
+
+static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req);
+
 static int fastboot_set_alt(struct usb_function *f,
 			    unsigned interface, unsigned alt)
 {
@@ -359,6 +385,7 @@ static int fastboot_set_alt(struct usb_function *f,
 	struct usb_gadget *gadget = cdev->gadget;
 	struct f_fastboot *f_fb = func_to_fastboot(f);
 	const struct usb_endpoint_descriptor *d;
+	int i;
 
 	debug("%s: func: %s intf: %d alt: %d\n",
 	      __func__, f->name, interface, alt);
@@ -378,6 +405,17 @@ static int fastboot_set_alt(struct usb_function *f,
 	}
 	f_fb->out_req->complete = rx_handler_command;
 
+	for (i = 0; i < DL_QUEUE_DEPTH; i++) {
+		f_fb->dl_req[i] = fastboot_alloc_req(f_fb->out_ep,
+						     DL_BUFFER_SIZE);
+		if (!f_fb->dl_req[i]) {
+			puts("failed to alloc download req\n");
+			ret = -ENOMEM;
+			goto err;
+		}
+		f_fb->dl_req[i]->complete = rx_handler_dl_image;
+	}
+
 	d = fb_ep_desc(gadget, &fs_ep_in, &hs_ep_in, &ss_ep_in);
 	ret = usb_ep_enable(f_fb->in_ep, d);
 	if (ret) {
@@ -516,16 +554,17 @@ static void compl_do_reset(struct usb_ep *ep, struct usb_request *req)
 #endif
 }
 
+/* Number of download bytes which have not been asked for yet */
 static unsigned int rx_bytes_expected(struct usb_ep *ep)
 {
-	int rx_remain = fastboot_data_remaining();
+	int rx_remain = fastboot_data_remaining() - fastboot_func->dl_pending;
 	unsigned int rem;
 	unsigned int maxpacket = usb_endpoint_maxp(ep->desc);
 
 	if (rx_remain <= 0)
 		return 0;
-	else if (rx_remain > EP_BUFFER_SIZE)
-		return EP_BUFFER_SIZE;
+	else if (rx_remain > DL_BUFFER_SIZE)
+		return DL_BUFFER_SIZE;
 
 	/*
 	 * Some controllers e.g. DWC3 don't like OUT transfers to be
@@ -540,6 +579,43 @@ static unsigned int rx_bytes_expected(struct usb_ep *ep)
 	return rx_remain;
 }
 
+/**
+ * rx_dl_queue() - queue a download request for the next part of the data
+ *
+ * @ep: OUT endpoint
+ * @req: Download request, not queued
+ * @return 0 if queued or if no more data needs to be asked for, -ve on error
+ */
+static int rx_dl_queue(struct usb_ep *ep, struct usb_request *req)
+{
+	unsigned int len = rx_bytes_expected(ep);
+	int ret;
+
+	if (!len)
+		return 0;
+
+	req->length = len;
+	req->actual = 0;
+	ret = usb_ep_queue(ep, req, 0);
+	if (!ret)
+		fastboot_func->dl_pending += len;
+
+	return ret;
+}
+
+/* Stop a download and go back to waiting for a command */
+static void rx_dl_stop(struct usb_ep *ep)
+{
+	int i;
+
+	for (i = 0; i < DL_QUEUE_DEPTH; i++)
+		usb_ep_dequeue(ep, fastboot_func->dl_req[i]);
+	fastboot_func->dl_pending = 0;
+
+	fastboot_func->out_req->actual = 0;
+	usb_ep_queue(ep, fastboot_func->out_req, 0);
+}
+
 static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 {
 	char response[FASTBOOT_RESPONSE_LEN] = {0};
@@ -547,6 +623,8 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	const unsigned char *buffer = req->buf;
 	unsigned int buffer_size = req->actual;
 
+	fastboot_func->dl_pending -= min(req->length,
+					 fastboot_func->dl_pending);
 	if (req->status != 0) {
 		printf("Bad status: %d\n", req->status);
 		return;
@@ -555,25 +633,41 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	if (buffer_size < transfer_size)
 		transfer_size = buffer_size;
 
+	/*
+	 * Requests complete in the order they were queued, so the data
+	 * arrives in order even with several queued
+	 */
 	fastboot_data_download(buffer, transfer_size, response);
 	if (response[0]) {
+		rx_dl_stop(ep);
 		fastboot_tx_write_str(response);
 	} else if (!fastboot_data_remaining()) {
 		fastboot_data_complete(response);
-
-		/*
-		 * Reset global transfer variable
-		 */
-		req->complete = rx_handler_command;
-		req->length = EP_BUFFER_SIZE;
-
+		rx_dl_stop(ep);
+		fastboot_tx_write_str(response);
+	} else if (rx_dl_queue(ep, req)) {
+		fastboot_fail("failed to queue download request", response);
+		rx_dl_stop(ep);
 		fastboot_tx_write_str(response);
-	} else {
-		req->length = rx_bytes_expected(ep);
 	}
+}
 
-	req->actual = 0;
-	usb_ep_queue(ep, req, 0);
+/* Queue all the download requests before telling the host to send */
+static int rx_dl_start(struct usb_ep *ep)
+{
+	int ret;
+	int i;
+
+	fastboot_func->dl_pending = 0;
+	for (i = 0; i < DL_QUEUE_DEPTH; i++) {
+		ret = rx_dl_queue(ep, fastboot_func->dl_req[i]);
+		if (ret) {
+			rx_dl_stop(ep);
+			return ret;
+		}
+	}
+
+	return 0;
 }
 
 static void do_exit_on_complete(struct usb_ep *ep, struct usb_request *req)
@@ -621,8 +715,14 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	if (!strncmp("DATA", response, 4)) {
-		req->complete = rx_handler_dl_image;
-		req->length = rx_bytes_expected(ep);
+		/* The command request is queued again once the data is in */
+		*cmdbuf = '\0';
+		req->actual = 0;
+		if (rx_dl_start(ep))
+			fastboot_fail("failed to queue download request",
+				      response);
+		fastboot_tx_write_str(response);
+		return;
 	}
 
 	fastboot_tx_write_str(response);
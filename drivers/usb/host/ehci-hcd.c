@@ -120,6 +120,15 @@ static struct ehci_ctrl *ehci_get_ctrl(struct usb_device *udev)
 #endif
 }
 
+static void ehci_count_pool_miss(struct usb_device *udev)
+{
+#if CONFIG_IS_ENABLED(DM_USB)
+	struct usb_bus_priv *priv = dev_get_uclass_priv(usb_get_bus(udev->dev));
+
+	priv->stats.pool_misses++;
+#endif
+}
+
 static int ehci_get_port_speed(struct ehci_ctrl *ctrl, uint32_t reg)
 {
 	return PORTSC_PSPD(reg);
@@ -347,7 +356,8 @@ static int
 ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		   int length, struct devrequest *req)
 {
-	ALLOC_ALIGN_BUFFER(struct QH, qh, 1, USB_DMA_MINALIGN);
+	struct ehci_ctrl *ctrl = ehci_get_ctrl(dev);
+	struct QH *qh = &ctrl->async_qh;
 	struct qTD *qtd;
 	int qtd_count = 0;
 	int qtd_counter = 0;
@@ -358,7 +368,6 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	uint32_t c, toggle;
 	int timeout;
 	int ret = 0;
-	struct ehci_ctrl *ctrl = ehci_get_ctrl(dev);
 
 	debug("dev=%p, pipe=%lx, buffer=%p, length=%d, req=%p\n", dev, pipe,
 	      buffer, length, req);
@@ -421,6 +430,13 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		 */
 		qtd_count += 2 + length / xfr_sz;
 	}
+	/*
+	 * Use the preallocated qTDs when the transfer fits, which is almost
+	 * always the case. Only very large transfers need their own.
+	 */
+	if (ctrl->td_pool && qtd_count <= CONFIG_USB_EHCI_TD_POOL_SIZE) {
+		qtd = ctrl->td_pool;
+	} else {
 /*
  * Threshold value based on the worst-case total size of the allocated qTDs for
  * a mass-storage transfer of 65535 blocks of 512 bytes.
@@ -428,10 +444,13 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 #if CONFIG_SYS_MALLOC_LEN <= 64 + 128 * 1024
 #warning CONFIG_SYS_MALLOC_LEN may be too small for EHCI
 #endif
-	qtd = memalign(USB_DMA_MINALIGN, qtd_count * sizeof(struct qTD));
-	if (qtd == NULL) {
-		printf("unable to allocate TDs\n");
-		return -1;
+		qtd = memalign(USB_DMA_MINALIGN,
+			       qtd_count * sizeof(struct qTD));
+		if (qtd == NULL) {
+			printf("unable to allocate TDs\n");
+			return -1;
+		}
+		ehci_count_pool_miss(dev);
 	}
 
 	memset(qh, 0, sizeof(struct QH));
@@ -687,11 +706,13 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 #endif
 	}
 
-	free(qtd);
+	if (qtd != ctrl->td_pool)
+		free(qtd);
 	return (dev->status != USB_ST_NOT_PROC) ? 0 : -1;
 
 fail:
-	free(qtd);
+	if (qtd != ctrl->td_pool)
+		free(qtd);
 	return -1;
 }
 
@@ -1033,6 +1054,12 @@ static int ehci_common_init(struct ehci_ctrl *ctrl, uint tweaks)
 
 	qh_list = &ctrl->qh_list;
 
+	/* qTDs for async transfers, kept until the controller is removed */
+	if (!ctrl->td_pool)
+		ctrl->td_pool = memalign(USB_DMA_MINALIGN,
+					 CONFIG_USB_EHCI_TD_POOL_SIZE *
+					 sizeof(struct qTD));
+
 	/* Set head of reclaim list */
 	memset(qh_list, 0, sizeof(*qh_list));
 	qh_list->qh_link = cpu_to_hc32(virt_to_phys(qh_list) | QH_LINK_TYPE_QH);
@@ -1728,6 +1755,8 @@ int ehci_deregister(struct udevice *dev)
 		return 0;
 
 	ehci_shutdown(ctrl);
+	free(ctrl->td_pool);
+	ctrl->td_pool = NULL;
 
 	return 0;
 }
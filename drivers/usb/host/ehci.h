@@ -251,6 +251,8 @@ struct ehci_ctrl {
 	uint16_t portreset;
 	struct QH qh_list __aligned(USB_DMA_MINALIGN);
 	struct QH periodic_queue __aligned(USB_DMA_MINALIGN);
+	struct QH async_qh __aligned(USB_DMA_MINALIGN);
+	struct qTD *td_pool;	/* preallocated qTDs for async transfers */
 	uint32_t *periodic_list;
 	int periodic_schedules;
 	int ntds;
@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <errno.h>
 #include <memalign.h>
+#include <time.h>
 #include <usb.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -41,17 +42,50 @@ int usb_disable_asynch(int disable)
 	return old_value;
 }
 
+/**
+ * usb_count_xfer() - Update the bus counters after a control or bulk transfer
+ *
+ * The caller counts the transfer itself, this adds its size, time and result.
+ *
+ * @stats: Counters for the USB controller
+ * @udev: Device the transfer was for
+ * @start: Value of timer_get_us() when the transfer was submitted
+ * @length: Number of bytes requested
+ * @err: Return value from the controller
+ */
+static void usb_count_xfer(struct usb_bus_stats *stats,
+			   struct usb_device *udev, ulong start, int length,
+			   int err)
+{
+	ulong us = timer_get_us() - start;
+
+	if (err || udev->status)
+		stats->errors++;
+	if (length > 0)
+		stats->bytes += length;
+	stats->total_us += us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+}
+
 int submit_int_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
 		   int length, int interval, bool nonblock)
 {
 	struct udevice *bus = udev->controller_dev;
 	struct dm_usb_ops *ops = usb_get_ops(bus);
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+	int err;
 
 	if (!ops->interrupt)
 		return -ENOSYS;
 
-	return ops->interrupt(bus, udev, pipe, buffer, length, interval,
-			      nonblock);
+	err = ops->interrupt(bus, udev, pipe, buffer, length, interval,
+			     nonblock);
+	priv->stats.interrupt++;
+	if (err && !nonblock)
+		priv->stats.errors++;
+
+	return err;
 }
 
 int submit_control_msg(struct usb_device *udev, unsigned long pipe,
@@ -60,12 +94,17 @@ int submit_control_msg(struct usb_device *udev, unsigned long pipe,
 	struct udevice *bus = udev->controller_dev;
 	struct dm_usb_ops *ops = usb_get_ops(bus);
 	struct usb_uclass_priv *uc_priv = bus->uclass->priv;
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+	ulong start;
 	int err;
 
 	if (!ops->control)
 		return -ENOSYS;
 
+	start = timer_get_us();
 	err = ops->control(bus, udev, pipe, buffer, length, setup);
+	priv->stats.control++;
+	usb_count_xfer(&priv->stats, udev, start, length, err);
 	if (setup->request == USB_REQ_SET_FEATURE &&
 	    setup->requesttype == USB_RT_PORT &&
 	    setup->value == cpu_to_le16(USB_PORT_FEAT_RESET) &&
@@ -82,11 +121,19 @@ int submit_bulk_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
 {
 	struct udevice *bus = udev->controller_dev;
 	struct dm_usb_ops *ops = usb_get_ops(bus);
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+	ulong start;
+	int err;
 
 	if (!ops->bulk)
 		return -ENOSYS;
 
-	return ops->bulk(bus, udev, pipe, buffer, length);
+	start = timer_get_us();
+	err = ops->bulk(bus, udev, pipe, buffer, length);
+	priv->stats.bulk++;
+	usb_count_xfer(&priv->stats, udev, start, length, err);
+
+	return err;
 }
 
 struct int_queue *create_int_queue(struct usb_device *udev,
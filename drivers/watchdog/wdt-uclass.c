@@ -7,6 +7,7 @@
 #include <dm.h>
 #include <errno.h>
 #include <hang.h>
+#include <serial.h>
 #include <time.h>
 #include <wdt.h>
 #include <dm/device-internal.h>
@@ -78,6 +79,9 @@ void watchdog_reset(void)
 	static ulong next_reset;
 	ulong now;
 
+	if (gd)
+		serial_poll_tx();
+
 	/* Exit if GD is not ready or watchdog is not initialized yet */
 	if (!gd || !(gd->flags & GD_FLG_WDT_READY))
 		return;
@@ -23,6 +23,7 @@
 #include <linux/compat.h>
 #include <linux/err.h>
 #include <linux/lzo.h>
+#include <linux/math64.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -669,23 +670,13 @@ static inline void *kmap(struct page *page)
 	return page->addr;
 }
 
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+static int decompress_block(struct ubifs_info *c, struct inode *inode,
+			    void *addr, unsigned int block,
+			    struct ubifs_data_node *dn)
 {
-	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
 
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
-
 	ubifs_assert(le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
 	len = le32_to_cpu(dn->size);
@@ -716,13 +707,102 @@ dump:
 	return -EINVAL;
 }
 
+static int read_block(struct inode *inode, void *addr, unsigned int block,
+		      struct ubifs_data_node *dn)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	union ubifs_key key;
+	int err;
+
+	data_key_init(c, &key, inode->i_ino, block);
+	err = ubifs_tnc_lookup(c, &key, dn);
+	if (err) {
+		if (err == -ENOENT)
+			/* Not found, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		return err;
+	}
+
+	return decompress_block(c, inode, addr, block, dn);
+}
+
+/**
+ * read_blocks_bulk - read a run of whole blocks with a single LEB read.
+ * @c: UBIFS file-system description object
+ * @inode: inode the blocks belong to
+ * @addr: where to put the first block
+ * @block: number of the first block
+ * @max: maximum number of blocks to fill in
+ *
+ * Data nodes which follow each other in the same LEB are looked up with one
+ * walk of the TNC and read into the bulk-read buffer at once, then
+ * decompressed straight into @addr. Holes between them are zeroed.
+ *
+ * Returns the number of blocks filled in, which is at least 1, or a negative
+ * error code.
+ */
+static int read_blocks_bulk(struct ubifs_info *c, struct inode *inode,
+			    void *addr, unsigned int block, int max)
+{
+	struct bu_info *bu = &c->bu;
+	int err, nn, offs, done = 0;
+
+	data_key_init(c, &bu->key, inode->i_ino, block);
+	bu->buf_len = c->max_bu_buf_len;
+	err = ubifs_tnc_get_bu_keys(c, bu);
+	if (err)
+		return err;
+
+	if (bu->cnt) {
+		err = ubifs_tnc_bulk_read(c, bu);
+		if (err)
+			return err;
+	}
+
+	offs = bu->zbranch[0].offs;
+	for (nn = 0; nn < bu->cnt && done < max; nn++) {
+		struct ubifs_data_node *dn;
+		unsigned int n = key_block(c, &bu->zbranch[nn].key) - block;
+
+		if (n >= max)
+			break;
+
+		/* Anything skipped over is a hole */
+		if (n > done)
+			memset(addr + done * UBIFS_BLOCK_SIZE, 0,
+			       (n - done) * UBIFS_BLOCK_SIZE);
+
+		dn = bu->buf + (bu->zbranch[nn].offs - offs);
+		err = decompress_block(c, inode, addr + n * UBIFS_BLOCK_SIZE,
+				       block + n, dn);
+		if (err)
+			return err;
+		done = n + 1;
+	}
+
+	/* No more data nodes, so the rest of the range is a hole */
+	if (bu->eof && done < max) {
+		memset(addr + done * UBIFS_BLOCK_SIZE, 0,
+		       (max - done) * UBIFS_BLOCK_SIZE);
+		done = max;
+	}
+
+	/* The first block is a hole before a data node in another LEB */
+	if (!done) {
+		memset(addr, 0, UBIFS_BLOCK_SIZE);
+		done = 1;
+	}
+
+	return done;
+}
+
 static int do_readpage(struct ubifs_info *c, struct inode *inode,
-		       struct page *page, int last_block_size)
+		       struct page *page, int last_block_size,
+		       struct ubifs_data_node *dn, void *buff)
 {
 	void *addr;
 	int err = 0, i;
 	unsigned int block, beyond;
-	struct ubifs_data_node *dn;
 	loff_t i_size = inode->i_size;
 
 	dbg_gen("ino %lu, pg %lu, i_size %lld",
@@ -735,13 +815,9 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 	if (block >= beyond) {
 		/* Reading beyond inode */
 		memset(addr, 0, PAGE_CACHE_SIZE);
-		goto out;
+		return 0;
 	}
 
-	dn = kmalloc(UBIFS_MAX_DATA_NODE_SZ, GFP_NOFS);
-	if (!dn)
-		return -ENOMEM;
-
 	i = 0;
 	while (1) {
 		int ret;
@@ -756,7 +832,6 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 			 * the requested size in the destination buffer.
 			 */
 			if (((block + 1) == beyond) || last_block_size) {
-				void *buff;
 				int dlen;
 
 				/*
@@ -765,22 +840,11 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 				 * destination area to a multiple of
 				 * UBIFS_BLOCK_SIZE.
 				 */
-				buff = malloc_cache_aligned(UBIFS_BLOCK_SIZE);
-				if (!buff) {
-					printf("%s: Error, malloc fails!\n",
-					       __func__);
-					err = -ENOMEM;
-					break;
-				}
-
-				/* Read block-size into temp buffer */
 				ret = read_block(inode, buff, block, dn);
 				if (ret) {
 					err = ret;
-					if (err != -ENOENT) {
-						free(buff);
+					if (err != -ENOENT)
 						break;
-					}
 				}
 
 				if (last_block_size)
@@ -790,8 +854,6 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 
 				/* Now copy required size back to dest */
 				memcpy(addr, buff, dlen);
-
-				free(buff);
 			} else {
 				ret = read_block(inode, addr, block, dn);
 				if (ret) {
@@ -810,21 +872,14 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		if (err == -ENOENT) {
 			/* Not found, so it must be a hole */
 			dbg_gen("hole");
-			goto out_free;
+			return 0;
 		}
 		ubifs_err(c, "cannot read page %lu of inode %lu, error %d",
 			  page->index, inode->i_ino, err);
-		goto error;
+		return err;
 	}
 
-out_free:
-	kfree(dn);
-out:
 	return 0;
-
-error:
-	kfree(dn);
-	return err;
 }
 
 int ubifs_read(const char *filename, void *buf, loff_t offset,
@@ -834,6 +889,8 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	unsigned long inum;
 	struct inode *inode;
 	struct page page;
+	struct ubifs_data_node *dn;
+	void *buff;
 	int err = 0;
 	int i;
 	int count;
@@ -882,22 +939,51 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 
 	count = (size + UBIFS_BLOCK_SIZE - 1) >> UBIFS_BLOCK_SHIFT;
 
+	/*
+	 * The data node and the bounce buffer for the last block are shared
+	 * by all the pages of the file
+	 */
+	dn = kmalloc(UBIFS_MAX_DATA_NODE_SZ, GFP_NOFS);
+	buff = malloc_cache_aligned(UBIFS_BLOCK_SIZE);
+	if (!dn || !buff) {
+		printf("%s: Error, malloc fails!\n", __func__);
+		err = -ENOMEM;
+		goto free_buf;
+	}
+
 	page.addr = buf;
 	page.index = offset / PAGE_SIZE;
 	page.inode = inode;
-	for (i = 0; i < count; i++) {
+	for (i = 0; i < count; ) {
+		int n = 1;
+
 		/*
-		 * Make sure to not read beyond the requested size
+		 * Whole blocks before the last one are read in bulk when
+		 * possible, straight into the destination
 		 */
-		if (((i + 1) == count) && (size < inode->i_size))
-			last_block_size = size - (i * PAGE_SIZE);
+		if (c->bu.buf && i + 1 < count) {
+			n = read_blocks_bulk(c, inode, page.addr, page.index,
+					     count - 1 - i);
+			if (n < 0) {
+				err = n;
+				break;
+			}
+		} else {
+			/*
+			 * Make sure to not read beyond the requested size
+			 */
+			if (((i + 1) == count) && (size < inode->i_size))
+				last_block_size = size - (i * PAGE_SIZE);
 
-		err = do_readpage(c, inode, &page, last_block_size);
-		if (err)
-			break;
+			err = do_readpage(c, inode, &page, last_block_size,
+					  dn, buff);
+			if (err)
+				break;
+		}
 
-		page.addr += PAGE_SIZE;
-		page.index++;
+		page.addr += n * PAGE_SIZE;
+		page.index += n;
+		i += n;
 	}
 
 	if (err) {
@@ -907,6 +993,9 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 		*actread = size;
 	}
 
+free_buf:
+	free(buff);
+	kfree(dn);
 put_inode:
 	ubifs_iput(inode);
 
@@ -922,15 +1011,24 @@ void ubifs_close(void)
 /* Compat wrappers for common/cmd_ubifs.c */
 int ubifs_load(char *filename, u32 addr, u32 size)
 {
+	unsigned long time;
 	loff_t actread;
 	int err;
 
 	printf("Loading file '%s' to addr 0x%08x...\n", filename, addr);
 
+	time = get_timer(0);
 	err = ubifs_read(filename, (void *)(uintptr_t)addr, 0, size, &actread);
+	time = get_timer(time);
 	if (err == 0) {
 		env_set_hex("filesize", actread);
-		printf("Done\n");
+		printf("%llu bytes read in %lu ms", actread, time);
+		if (time > 0) {
+			puts(" (");
+			print_size(div_u64(actread, time) * 1000, "/s");
+			puts(")");
+		}
+		puts("\n");
 	}
 
 	return err;
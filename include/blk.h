@@ -186,6 +186,14 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/**
+ * blkcache_get_config() - return the cache geometry, leaving the statistics
+ *
+ * @param blocks - returns the maximum blocks per entry
+ * @param entries - returns the maximum entries in cache
+ */
+void blkcache_get_config(unsigned *blocks, unsigned *entries);
+
 #else
 
 static inline int blkcache_read(int iftype, int dev,
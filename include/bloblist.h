@@ -27,6 +27,8 @@ enum bloblist_tag_t {
 	BLOBLISTT_SPL_HANDOFF,		/* Hand-off info from SPL */
 	BLOBLISTT_VBOOT_CTX,		/* Chromium OS verified boot context */
 	BLOBLISTT_VBOOT_HANDOFF,	/* Chromium OS internal handoff info */
+	BLOBLISTT_LOG_BUFFER,		/* Binary log records (log_buffer.c) */
+	BLOBLISTT_NAND_BBT,		/* Scanned NAND bad blocks (nand_bbt.c) */
 };
 
 /**
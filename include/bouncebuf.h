@@ -35,6 +35,29 @@
  * used directly) upon stop() call.
  */
 #define GEN_BB_RW	(GEN_BB_READ | GEN_BB_WRITE)
+/*
+ * GEN_BB_SPLIT -- The caller can transfer to or from several separate pieces,
+ * as listed in .seg[]. If the buffer is unaligned but word aligned, only the
+ * partial cache lines at its start and end are bounced, and the DMA-aligned
+ * middle of the buffer is used directly. Each piece is word aligned and a
+ * multiple of four bytes long. Without this flag there is always a single
+ * piece, which is .bounce_buffer.
+ */
+#define GEN_BB_SPLIT	(1 << 2)
+
+/* Largest number of pieces a buffer is split into */
+#define BOUNCE_BUFFER_MAX_SEGS	3
+
+/**
+ * struct bounce_buffer_seg - A contiguous piece of a DMA transfer
+ *
+ * @addr: Start of the piece, to be used for DMA
+ * @len: Length of the piece in bytes
+ */
+struct bounce_buffer_seg {
+	void *addr;
+	size_t len;
+};
 
 struct bounce_buffer {
 	/* Copy of data parameter passed to start() */
@@ -51,6 +74,35 @@ struct bounce_buffer {
 	size_t len_aligned;
 	/* Copy of flags parameter passed to start() */
 	unsigned int flags;
+	/* Pieces to use for DMA, in order */
+	struct bounce_buffer_seg seg[BOUNCE_BUFFER_MAX_SEGS];
+	/* Number of pieces in .seg */
+	int nsegs;
+	/*
+	 * With GEN_BB_SPLIT, buffer holding the partial cache lines at the
+	 * start and end of .user_buffer, or NULL if they are not bounced
+	 */
+	void *ends_buffer;
+	/* Number of bytes at the start and end of .user_buffer in .ends_buffer */
+	size_t head_len;
+	size_t tail_len;
+};
+
+/**
+ * struct bounce_buffer_stats - Counters for all bounce buffer sessions
+ *
+ * @sessions: Number of sessions started
+ * @bounced: Number of sessions which copied the whole buffer
+ * @split: Number of sessions which only copied the ends of the buffer
+ * @bytes: Total number of bytes in all sessions
+ * @bytes_bounced: Number of those bytes which were copied
+ */
+struct bounce_buffer_stats {
+	ulong sessions;
+	ulong bounced;
+	ulong split;
+	u64 bytes;
+	u64 bytes_bounced;
 };
 
 /**
@@ -68,4 +120,15 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
  */
 int bounce_buffer_stop(struct bounce_buffer *state);
 
+/**
+ * bounce_buffer_get_stats() -- Read the bounce buffer counters
+ * stats:	returns the counters
+ */
+void bounce_buffer_get_stats(struct bounce_buffer_stats *stats);
+
+/**
+ * bounce_buffer_reset_stats() -- Clear the bounce buffer counters
+ */
+void bounce_buffer_reset_stats(void);
+
 #endif
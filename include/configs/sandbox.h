@@ -27,6 +27,8 @@
 
 #define CONFIG_HOST_MAX_DEVICES 4
 
+#define CONFIG_SYS_MAX_NAND_DEVICE	1
+
 /*
  * Size of malloc() pool, before and after relocation
  */
@@ -143,8 +143,11 @@ struct dfu_entity {
 
 	struct list_head list;
 
+	/* largest write_medium() call when draining in steps, 0 for no limit */
+	unsigned long drain_chunk;
+
 	/* on the fly state */
-	u32 crc;
+	void *hash_ctx;
 	u64 offset;
 	int i_blk_seq_num;
 	u8 *i_buf;
@@ -155,6 +158,11 @@ struct dfu_entity {
 
 	u32 bad_skip;	/* for nand use */
 
+	/* buffer being written to the medium while the other one fills */
+	u8 *d_buf;
+	long d_left;
+	int d_ret;
+
 	unsigned int inited:1;
 };
 
@@ -187,6 +195,20 @@ int dfu_read(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+/**
+ * dfu_drain_step() - write part of a full buffer to the medium
+ *
+ * With CONFIG_DFU_DOUBLE_BUFFER, dfu_write() switches to a second buffer
+ * when the first one is full and leaves the first one to be written out
+ * by this function. It should be called regularly while waiting for more
+ * data. Each call writes at most the entity's drain_chunk bytes, so that
+ * USB requests keep being handled in between.
+ *
+ * @return 0 if OK or nothing to do, -ve on write error. The error is also
+ *	returned by the next dfu_write() or dfu_flush().
+ */
+int dfu_drain_step(void);
+
 /**
  * dfu_initiated_callback - weak callback called on DFU transaction start
  *
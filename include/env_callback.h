@@ -42,6 +42,12 @@
 #define DNS_CALLBACK
 #endif
 
+#ifdef CONFIG_MTD
+#define MTDPARTS_CALLBACKS "mtdids:mtdparts,mtdparts:mtdparts,"
+#else
+#define MTDPARTS_CALLBACKS
+#endif
+
 #ifdef CONFIG_NET
 #define NET_CALLBACKS \
 	"bootfile:bootfile," \
@@ -68,6 +74,7 @@
 	"loadaddr:loadaddr," \
 	SILENT_CALLBACK \
 	SPLASHIMAGE_CALLBACK \
+	MTDPARTS_CALLBACKS \
 	"stdin:console,stdout:console,stderr:console," \
 	"serial#:serialno," \
 	CONFIG_ENV_CALLBACK_LIST_STATIC
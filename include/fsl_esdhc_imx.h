@@ -106,6 +106,9 @@
 #define PROCTL_DTW_4		0x00000002
 #define PROCTL_DTW_8		0x00000004
 #define PROCTL_D3CD		0x00000008
+#define PROCTL_DMAS_MASK	0x00000300
+#define PROCTL_DMAS_SDMA	0x00000000
+#define PROCTL_DMAS_ADMA2	0x00000200
 
 #define CMDARG			0x0002e008
 
@@ -258,10 +261,138 @@ struct fsl_esdhc_cfg {
 #error "Endianess is not defined: please fix to continue"
 #endif
 
+/* ADMA2 descriptor attributes, 32-bit addressing */
+#define ESDHC_ADMA_ATTR_VALID	BIT(0)
+#define ESDHC_ADMA_ATTR_END	BIT(1)
+#define ESDHC_ADMA_ATTR_INT	BIT(2)
+#define ESDHC_ADMA_ATTR_TRAN	BIT(5)
+#define ESDHC_ADMA_ATTR_LINK	(BIT(4) | BIT(5))
+
+/* Largest length a descriptor carries, kept word aligned */
+#define ESDHC_ADMA_MAX_LEN	0xfffcU
+
+/**
+ * struct esdhc_adma_desc - ADMA2 descriptor, as read by the controller
+ *
+ * The fields are little-endian whatever the CPU is.
+ *
+ * @attr: ESDHC_ADMA_ATTR_xxx
+ * @reserved: Must be zero
+ * @len: Number of bytes to transfer
+ * @addr: Bus address of the data
+ */
+struct esdhc_adma_desc {
+	u8 attr;
+	u8 reserved;
+	u16 len;
+	u32 addr;
+} __packed;
+
+/**
+ * struct esdhc_adma_table - ADMA2 descriptor table being built
+ *
+ * @desc: Descriptors, which must be suitably aligned for DMA
+ * @size: Number of entries in @desc
+ * @count: Number of entries used so far
+ * @bytes: Total number of bytes described by the table
+ */
+struct esdhc_adma_table {
+	struct esdhc_adma_desc *desc;
+	uint size;
+	uint count;
+	uint bytes;
+};
+
+/**
+ * struct fsl_esdhc_stats - Data transfer statistics of an eSDHC controller
+ *
+ * @transfers: Number of commands which moved data
+ * @adma_transfers: Number of those done with a single ADMA2 descriptor table
+ * @sdma_transfers: Number of those done with SDMA or PIO
+ * @blocks: Number of blocks transferred
+ * @bytes: Number of bytes transferred
+ * @descs: Number of ADMA2 descriptors written
+ * @max_descs: Largest number of descriptors used by one transfer
+ * @errors: Number of data transfers which failed
+ */
+struct fsl_esdhc_stats {
+	ulong transfers;
+	ulong adma_transfers;
+	ulong sdma_transfers;
+	ulong blocks;
+	u64 bytes;
+	ulong descs;
+	uint max_descs;
+	ulong errors;
+};
+
+/**
+ * esdhc_adma_table_size() - Number of descriptors needed for a transfer
+ *
+ * This is the worst case for a buffer of @len bytes split into @segs
+ * contiguous pieces. The last data descriptor also ends the table.
+ *
+ * @len: Total number of bytes
+ * @segs: Number of pieces the buffer is made of
+ * @return number of descriptors
+ */
+static inline uint esdhc_adma_table_size(uint len, uint segs)
+{
+	return DIV_ROUND_UP(len, ESDHC_ADMA_MAX_LEN) + segs;
+}
+
+/**
+ * esdhc_adma_init() - Start building a descriptor table
+ *
+ * @tbl: Table to set up
+ * @desc: Space for the descriptors
+ * @size: Number of descriptors that fit in @desc
+ */
+void esdhc_adma_init(struct esdhc_adma_table *tbl,
+		     struct esdhc_adma_desc *desc, uint size);
+
+/**
+ * esdhc_adma_add() - Add a contiguous piece of a buffer to a table
+ *
+ * The piece is split into as many descriptors as needed. If it follows on
+ * directly from the previous piece, the last descriptor is extended instead
+ * of starting a new one.
+ *
+ * @tbl: Table to add to
+ * @addr: Bus address of the piece, which must be word aligned
+ * @len: Length of the piece in bytes, which must be a multiple of 4
+ * @return 0 if OK, -EINVAL if the piece is empty, misaligned or not
+ *	addressable by the controller, -ENOSPC if the table is full
+ */
+int esdhc_adma_add(struct esdhc_adma_table *tbl, dma_addr_t addr, uint len);
+
+/**
+ * esdhc_adma_finish() - Mark the end of a descriptor table
+ *
+ * @tbl: Table to finish
+ * @return 0 if OK, -EINVAL if the table is empty
+ */
+int esdhc_adma_finish(struct esdhc_adma_table *tbl);
+
 #ifdef CONFIG_FSL_ESDHC_IMX
 int fsl_esdhc_mmc_init(bd_t *bis);
 int fsl_esdhc_initialize(bd_t *bis, struct fsl_esdhc_cfg *cfg);
 void fdt_fixup_esdhc(void *blob, bd_t *bd);
+
+/**
+ * fsl_esdhc_get_stats() - Read the data transfer statistics of a controller
+ *
+ * @mmc: MMC device attached to the controller
+ * @stats: Returns the statistics
+ */
+void fsl_esdhc_get_stats(struct mmc *mmc, struct fsl_esdhc_stats *stats);
+
+/**
+ * fsl_esdhc_reset_stats() - Clear the data transfer statistics
+ *
+ * @mmc: MMC device attached to the controller
+ */
+void fsl_esdhc_reset_stats(struct mmc *mmc);
 #else
 static inline int fsl_esdhc_mmc_init(bd_t *bis) { return -ENOSYS; }
 static inline void fdt_fixup_esdhc(void *blob, bd_t *bd) {}
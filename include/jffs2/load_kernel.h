@@ -39,6 +39,7 @@ struct part_info {
 	u32 mask_flags;			/* kernel MTD mask flags */
 	u32 sector_size;		/* size of sector */
 	struct mtd_device *dev;		/* parent device */
+	struct hlist_node hash;		/* in the table of names */
 };
 
 struct mtdids {
@@ -128,6 +128,27 @@ struct nand_bbt_descr {
 #define ONENAND_BBT_READ_ECC_ERROR	2
 #define ONENAND_BBT_READ_FATAL_ERROR	4
 
+/* Magic number of a bad block table handed off in the bloblist: "NBBT" */
+#define NAND_BBT_HANDOFF_MAGIC	0x5442424e
+
+/**
+ * struct nand_bbt_handoff - bad block table found by scanning, as handed off
+ *			     in the bloblist (tag BLOBLISTT_NAND_BBT)
+ * @magic:		NAND_BBT_HANDOFF_MAGIC
+ * @erase_shift:	number of address bits in an eraseblock
+ * @numblocks:		number of eraseblocks in the device
+ * @scan_us:		time taken to scan the device, in microseconds
+ * @bitmap:		one bit per eraseblock, least significant bit first,
+ *			set if the block is bad
+ */
+struct nand_bbt_handoff {
+	u32 magic;
+	u32 erase_shift;
+	u32 numblocks;
+	u32 scan_us;
+	u8 bitmap[];
+};
+
 /**
  * struct bbm_info - [GENERIC] Bad Block Table data structure
  * @bbt_erase_shift:	[INTERN] number of address bits in a bbt entry
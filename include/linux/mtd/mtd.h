@@ -329,6 +329,9 @@ struct mtd_info {
 	 * MTD device can itself be a partition).
 	 */
 	struct list_head partitions;
+
+	/* Node in the table used to look devices up by name */
+	struct hlist_node name_node;
 };
 
 #if IS_ENABLED(CONFIG_DM)
@@ -588,6 +588,10 @@ static const struct nand_ecc_caps __name = {			\
  *		any single ECC step, 0 if bitflips uncorrectable, -EIO hw error
  * @read_subpage:	function to read parts of the page covered by ECC;
  *			returns same as read_page()
+ * @read_page_multi:	optional function to read @count consecutive whole pages
+ *			of the selected chip, issuing the page read commands
+ *			itself; returns same as read_page(). On a negative
+ *			return the caller falls back to reading page by page
  * @write_subpage:	function to write parts of the page covered by ECC.
  * @write_page:	function to write a page according to the ECC generator
  *		requirements.
@@ -622,6 +626,8 @@ struct nand_ecc_ctrl {
 			uint8_t *buf, int oob_required, int page);
 	int (*read_subpage)(struct mtd_info *mtd, struct nand_chip *chip,
 			uint32_t offs, uint32_t len, uint8_t *buf, int page);
+	int (*read_page_multi)(struct mtd_info *mtd, struct nand_chip *chip,
+			uint8_t *buf, int page, int count);
 	int (*write_subpage)(struct mtd_info *mtd, struct nand_chip *chip,
 			uint32_t offset, uint32_t data_len,
 			const uint8_t *data_buf, int oob_required, int page);
@@ -873,6 +879,8 @@ nand_get_sdr_timings(const struct nand_data_interface *conf)
  *			  means the configuration should not be applied but
  *			  only checked.
  * @bbt:		[INTERN] bad block table pointer
+ * @bbt_scan_us:	[INTERN] time taken by the last scan for bad blocks, in
+ *			microseconds
  * @bbt_td:		[REPLACEABLE] bad block table descriptor for flash
  *			lookup.
  * @bbt_md:		[REPLACEABLE] bad block table mirror descriptor
@@ -961,6 +969,7 @@ struct nand_chip {
 	struct nand_hw_control hwcontrol;
 
 	uint8_t *bbt;
+	ulong bbt_scan_us;
 	struct nand_bbt_descr *bbt_td;
 	struct nand_bbt_descr *bbt_md;
 
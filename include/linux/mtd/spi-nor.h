@@ -248,6 +248,28 @@ enum spi_nor_option_flags {
 	SNOR_F_BROKEN_RESET	= BIT(6),
 };
 
+#define SNOR_ERASE_TYPE_MAX	4
+
+/**
+ * struct spi_nor_erase_type - an erase command supported by the flash
+ * @size:	number of bytes erased by the command
+ * @opcode:	the erase opcode
+ */
+struct spi_nor_erase_type {
+	u32	size;
+	u8	opcode;
+};
+
+/**
+ * struct spi_nor_erase_plan - erase commands which cover an address range
+ * @count:	number of commands of each type in spi_nor.erase_types
+ * @chip:	true if the range is erased with a single chip erase instead
+ */
+struct spi_nor_erase_plan {
+	u32	count[SNOR_ERASE_TYPE_MAX];
+	bool	chip;
+};
+
 /**
  * struct flash_info - Forward declaration of a structure used internally by
  *		       spi_nor_scan()
@@ -273,6 +295,8 @@ struct flash_info;
  * @page_size:		the page size of the SPI NOR
  * @addr_width:		number of address bytes
  * @erase_opcode:	the opcode for erasing a sector
+ * @erase_types:	the erase commands supported, smallest first; unused
+ *			entries have a size of 0
  * @read_opcode:	the read opcode
  * @read_dummy:		the dummy needed by the read operation
  * @program_opcode:	the program opcode
@@ -312,6 +336,7 @@ struct spi_nor {
 	u32			page_size;
 	u8			addr_width;
 	u8			erase_opcode;
+	struct spi_nor_erase_type erase_types[SNOR_ERASE_TYPE_MAX];
 	u8			read_opcode;
 	u8			read_dummy;
 	u8			program_opcode;
@@ -436,4 +461,21 @@ struct spi_nor_hwcaps {
  */
 int spi_nor_scan(struct spi_nor *nor);
 
+/**
+ * spi_nor_erase_plan() - work out how a range is erased
+ * @nor:	the spi_nor structure
+ * @addr:	start of the range
+ * @len:	length of the range
+ * @plan:	returns the number of commands of each erase type
+ *
+ * The range is covered with the largest erase commands that are aligned
+ * within it, so small sectors are only erased at its unaligned edges. The
+ * whole chip is erased with a single command when the flash supports it.
+ *
+ * Return: number of erase commands needed, or -EINVAL if the range cannot
+ * be erased
+ */
+int spi_nor_erase_plan(struct spi_nor *nor, u32 addr, u32 len,
+		       struct spi_nor_erase_plan *plan);
+
 #endif
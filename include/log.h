@@ -10,6 +10,7 @@
 #define __LOG_H
 
 #include <command.h>
+#include <stdarg.h>
 #include <dm/uclass-id.h>
 #include <linux/list.h>
 
@@ -278,7 +279,11 @@ void __assert_fail(const char *assertion, const char *file, unsigned int line,
  * @file: Name of file where the log record was generated (not allocated)
  * @line: Line number where the log record was generated
  * @func: Function where the log record was generated (not allocated)
- * @msg: Log message (allocated)
+ * @fmt: printf() format string for the message (not allocated)
+ * @args: Arguments for @fmt. This is only valid during the emit() call and
+ *	must be copied with va_copy() before use
+ * @msg: Log message (allocated), or NULL if the record is passed to a driver
+ *	with LOGDF_DEFER_FMT and has not been formatted yet
  */
 struct log_rec {
 	enum log_category_t cat;
@@ -286,18 +291,31 @@ struct log_rec {
 	const char *file;
 	int line;
 	const char *func;
+	const char *fmt;
+	va_list *args;
 	const char *msg;
 };
 
 struct log_device;
 
+/* Flags for struct log_driver */
+enum log_driver_flags {
+	/*
+	 * The driver handles the unformatted record (@fmt and @args) itself, so
+	 * there is no need to format the message before calling emit()
+	 */
+	LOGDF_DEFER_FMT	= 1 << 0,
+};
+
 /**
  * struct log_driver - a driver which accepts and processes log records
  *
  * @name: Name of driver
+ * @flags: Flags for this driver (LOGDF_...)
  */
 struct log_driver {
 	const char *name;
+	int flags;
 	/**
 	 * emit() - emit a log record
 	 *
@@ -305,6 +323,15 @@ struct log_driver {
 	 * for processing. The filter is checked before calling this function.
 	 */
 	int (*emit)(struct log_device *ldev, struct log_rec *rec);
+	/**
+	 * probe() - set up a log device (optional)
+	 *
+	 * Called by log_init() once the device has been added, e.g. to install
+	 * default filters
+	 *
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*probe)(struct log_device *ldev);
 };
 
 /**
@@ -320,12 +347,14 @@ struct log_driver {
  * @drv: Pointer to driver for this device
  * @filter_head: List of filters for this device
  * @sibling_node: Next device in the list of all devices
+ * @priv: Private data for the driver (NULL until the driver sets it up)
  */
 struct log_device {
 	int next_filter_num;
 	struct log_driver *drv;
 	struct list_head filter_head;
 	struct list_head sibling_node;
+	void *priv;
 };
 
 enum {
@@ -441,6 +470,24 @@ int log_add_filter(const char *drv_name, enum log_category_t cat_list[],
  */
 int log_remove_filter(const char *drv_name, int filter_num);
 
+/**
+ * log_buffer_dump() - Format and print the records in the log buffer
+ *
+ * Records are formatted now, from the format string and raw arguments which
+ * were stored when the record was logged. They are written to the console in
+ * the same format as the 'console' log driver, prefixed with a timestamp.
+ *
+ * @return 0 if OK, -ENOENT if there is no log buffer
+ */
+int log_buffer_dump(void);
+
+/**
+ * log_buffer_clear() - Discard all records in the log buffer
+ *
+ * @return 0 if OK, -ENOENT if there is no log buffer
+ */
+int log_buffer_clear(void);
+
 #if CONFIG_IS_ENABLED(LOG)
 /**
  * log_init() - Set up the log system ready for use
@@ -74,6 +74,7 @@ struct bd_info;
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CMDQ		BIT(17)	/* Queued and packed commands */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -112,6 +113,11 @@ struct bd_info;
 #define MMC_CMD_ERASE_GROUP_START	35
 #define MMC_CMD_ERASE_GROUP_END		36
 #define MMC_CMD_ERASE			38
+#define MMC_CMD_QUE_TASK_PARAMS		44
+#define MMC_CMD_QUE_TASK_ADDR		45
+#define MMC_CMD_EXECUTE_READ_TASK	46
+#define MMC_CMD_EXECUTE_WRITE_TASK	47
+#define MMC_CMD_CMDQ_TASK_MGMT		48
 #define MMC_CMD_APP_CMD			55
 #define MMC_CMD_SPI_READ_OCR		58
 #define MMC_CMD_SPI_CRC_ON_OFF		59
@@ -179,6 +185,21 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 
 #define MMC_STATE_PRG		(7 << 9)
 
+/* CMD13 argument asking for the Queue Status Register instead */
+#define MMC_SEND_STATUS_SQS	BIT(15)
+
+/* CMD44 / CMD46 / CMD47 / CMD48 arguments */
+#define MMC_CMDQ_DIR_READ	BIT(30)
+#define MMC_CMDQ_TASK_ID(x)	(((x) & 0x1f) << 16)
+#define MMC_CMDQ_BLKCNT_MASK	0xffff
+#define MMC_CMDQ_DISCARD_QUEUE	1
+#define MMC_CMDQ_DISCARD_TASK	2
+
+/* CMD23 argument for a packed command, and its header */
+#define MMC_CMD23_ARG_PACKED	BIT(30)
+#define MMC_PACKED_VERSION	1
+#define MMC_PACKED_WRITE	2
+
 #define MMC_VDD_165_195		0x00000080	/* VDD voltage 1.65 - 1.95 */
 #define MMC_VDD_20_21		0x00000100	/* VDD voltage 2.0 ~ 2.1 */
 #define MMC_VDD_21_22		0x00000200	/* VDD voltage 2.1 ~ 2.2 */
@@ -212,6 +233,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 /*
  * EXT_CSD fields
  */
+#define EXT_CSD_CMDQ_MODE_EN		15	/* R/W */
 #define EXT_CSD_ENH_START_ADDR		136	/* R/W */
 #define EXT_CSD_ENH_SIZE_MULT		140	/* R/W */
 #define EXT_CSD_GP_SIZE_MULT		143	/* R/W */
@@ -239,6 +261,10 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_HC_ERASE_GRP_SIZE	224	/* RO */
 #define EXT_CSD_BOOT_MULT		226	/* RO */
 #define EXT_CSD_GENERIC_CMD6_TIME       248     /* RO */
+#define EXT_CSD_CMDQ_DEPTH		307	/* RO */
+#define EXT_CSD_CMDQ_SUPPORT		308	/* RO */
+#define EXT_CSD_MAX_PACKED_WRITES	500	/* RO */
+#define EXT_CSD_MAX_PACKED_READS	501	/* RO */
 #define EXT_CSD_BKOPS_SUPPORT		502	/* RO */
 
 /*
@@ -705,6 +731,27 @@ struct mmc {
 				  */
 	u32 quirks;
 	u8 hs400_tuning;
+#if CONFIG_IS_ENABLED(MMC_CMDQ)
+	u8 cmdq_depth;		/* tasks the card can queue, 0 if none */
+	u8 max_packed_writes;	/* writes in a packed command, 0 if none */
+#endif
+};
+
+/**
+ * struct mmc_req - A block read or write handed to mmc_queue_rw()
+ *
+ * @start: First block
+ * @blkcnt: Number of blocks
+ * @buf: Data to write, or buffer to read into
+ * @write: true to write, false to read
+ * @done: Returns the number of blocks transferred
+ */
+struct mmc_req {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buf;
+	bool write;
+	lbaint_t done;
 };
 
 struct mmc_hwpart_conf {
@@ -757,6 +804,15 @@ int mmc_init_device(int num);
 int mmc_init(struct mmc *mmc);
 int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error);
 
+#ifdef MMC_SUPPORTS_TUNING
+#define MMC_TUNING_BLK_PATTERN_4BIT_SIZE	64
+#define MMC_TUNING_BLK_PATTERN_8BIT_SIZE	128
+
+/* Tuning block returned by the card for CMD19 / CMD21 */
+extern const u8 tuning_blk_pattern_4bit[MMC_TUNING_BLK_PATTERN_4BIT_SIZE];
+extern const u8 tuning_blk_pattern_8bit[MMC_TUNING_BLK_PATTERN_8BIT_SIZE];
+#endif
+
 #if CONFIG_IS_ENABLED(MMC_UHS_SUPPORT) || \
     CONFIG_IS_ENABLED(MMC_HS200_SUPPORT) || \
     CONFIG_IS_ENABLED(MMC_HS400_SUPPORT)
@@ -805,6 +861,27 @@ void print_mmc_devices(char separator);
  */
 int get_mmc_num(void);
 int mmc_switch_part(struct mmc *mmc, unsigned int part_num);
+
+/**
+ * mmc_queue_rw() - Run several block requests with as many in flight as
+ * the card allows
+ *
+ * With eMMC command queueing the requests are queued on the card, which may
+ * complete them in any order; requests which overlap a write are held back
+ * until it is done. Otherwise runs of separate write requests are sent as
+ * packed commands if the card supports them; a single request is never split
+ * up to be packed. Anything else runs one request at a time.
+ *
+ * The requests use the currently selected hardware partition. Nothing is
+ * queued on the RPMB partition.
+ *
+ * @mmc:	MMC device
+ * @reqs:	Requests to run; each .done is updated
+ * @count:	Number of requests
+ * @return 0 if all requests completed, -ve on error
+ */
+int mmc_queue_rw(struct mmc *mmc, struct mmc_req *reqs, int count);
+
 int mmc_hwpart_config(struct mmc *mmc, const struct mmc_hwpart_conf *conf,
 		      enum mmc_hwpart_conf_mode mode);
 
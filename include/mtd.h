@@ -11,6 +11,14 @@
 int mtd_probe(struct udevice *dev);
 int mtd_probe_devices(void);
 
+/**
+ * mtd_env_generation() - Tell whether mtdids or mtdparts changed
+ *
+ * @return a counter which changes each time mtdids or mtdparts is set or
+ * deleted, so that users can keep what they parsed from them until then
+ */
+ulong mtd_env_generation(void);
+
 void board_mtdparts_default(const char **mtdids, const char **mtdparts);
 
 #endif	/* _MTD_H_ */
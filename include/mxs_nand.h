@@ -73,6 +73,11 @@ struct mxs_nand_info {
 	struct mxs_dma_desc	**desc;
 	uint32_t		desc_index;
 
+	/* Chained multi-page reads, allocated on first use */
+	uint8_t			*multi_buf;
+	uint8_t			*multi_cmd_buf;
+	uint32_t		multi_stride;
+
 	/* Hardware BCH interface and randomizer */
 	u32 en_randomizer;
 	u32 writesize;
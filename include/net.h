@@ -123,6 +123,42 @@ enum eth_recv_flags {
 	ETH_RECV_CHECK_DEVICE		= 1 << 0,
 };
 
+/**
+ * struct eth_rx_desc - A received packet, as returned by recv_batch()
+ *
+ * @packet: Start of the packet
+ * @length: Length of the packet in bytes
+ */
+struct eth_rx_desc {
+	uchar *packet;
+	int length;
+};
+
+/**
+ * struct eth_stats - Packet counters for an Ethernet device
+ *
+ * The uclass keeps the rx_packets, rx_batches, rx_errors and tx_ counters.
+ * Drivers update rx_dropped and rx_ring_full themselves, through
+ * eth_get_stats().
+ *
+ * @rx_packets: Packets passed to the network stack
+ * @rx_batches: Calls to the driver which returned at least one packet
+ * @rx_errors: Calls to the driver which returned an error
+ * @rx_dropped: Packets the driver had to throw away
+ * @rx_ring_full: Times the driver found its receive ring full
+ * @tx_packets: Packets sent
+ * @tx_errors: Packets the driver failed to send
+ */
+struct eth_stats {
+	u32 rx_packets;
+	u32 rx_batches;
+	u32 rx_errors;
+	u32 rx_dropped;
+	u32 rx_ring_full;
+	u32 tx_packets;
+	u32 tx_errors;
+};
+
 /**
  * struct eth_ops - functions of Ethernet MAC controllers
  *
@@ -136,6 +172,13 @@ enum eth_recv_flags {
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
+ * recv_batch: Like recv, but return up to "count" packets at once in "descs".
+ *	       Returns the number of packets, 0 if the receive FIFO is empty,
+ *	       or an error. If supplied, this is used by eth_rx() instead of
+ *	       recv, which must still be provided for other users - optional
+ * free_batch: Give back all the packets returned by one call to recv_batch,
+ *	       so that the receive ring can be refilled in one go. If not
+ *	       supplied, free_pkt is called for each packet - optional
  * stop: Stop the hardware from looking for packets - may be called even if
  *	 state == PASSIVE
  * mcast: Join or leave a multicast group (for TFTP) - optional
@@ -154,6 +197,10 @@ struct eth_ops {
 	int (*send)(struct udevice *dev, void *packet, int length);
 	int (*recv)(struct udevice *dev, int flags, uchar **packetp);
 	int (*free_pkt)(struct udevice *dev, uchar *packet, int length);
+	int (*recv_batch)(struct udevice *dev, int flags,
+			  struct eth_rx_desc *descs, int count);
+	int (*free_batch)(struct udevice *dev, struct eth_rx_desc *descs,
+			  int count);
 	void (*stop)(struct udevice *dev);
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
 	int (*write_hwaddr)(struct udevice *dev);
@@ -170,6 +217,38 @@ struct udevice *eth_get_dev(void); /* get the current device */
 struct udevice *eth_get_dev_by_name(const char *devname);
 unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
 
+/**
+ * eth_get_stats() - Get the packet counters of a device
+ *
+ * @dev: Ethernet device
+ * @return pointer to the counters, or NULL if @dev is not probed
+ */
+struct eth_stats *eth_get_stats(struct udevice *dev);
+
+/**
+ * eth_pkt_pool_get() - Take packet buffers from the shared pool
+ *
+ * Buffers are PKTSIZE_ALIGN bytes, aligned for DMA. Spare buffers given back
+ * with eth_pkt_pool_put() are used first; new ones are allocated if there
+ * are not enough.
+ *
+ * @bufs: Returns the buffers
+ * @count: Number of buffers wanted
+ * @return number of buffers returned, less than @count if out of memory
+ */
+int eth_pkt_pool_get(uchar **bufs, int count);
+
+/**
+ * eth_pkt_pool_put() - Give packet buffers back to the shared pool
+ *
+ * Up to CONFIG_DM_ETH_PKT_POOL_SIZE buffers are kept for reuse and the rest
+ * are freed.
+ *
+ * @bufs: Buffers obtained from eth_pkt_pool_get()
+ * @count: Number of buffers
+ */
+void eth_pkt_pool_put(uchar **bufs, int count);
+
 /* Used only when NetConsole is enabled */
 int eth_is_active(struct udevice *dev); /* Test device for active state */
 int eth_init_state_only(void); /* Set active state */
@@ -359,6 +438,7 @@ struct vlan_ethernet_hdr {
 #define PROT_NCSI	0x88f8		/* NC-SI control packets        */
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -550,7 +630,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, WGET
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -650,6 +730,56 @@ bool arp_is_waiting(void);		/* Waiting for ARP reply? */
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
 void net_set_timeout_handler(ulong, thand_f *);/* Set timeout handler */
 
+#ifdef CONFIG_NET_ARP_CACHE
+/**
+ * arp_cache_lookup() - Find the MAC address to send a packet to
+ *
+ * This looks up @dest, or the gateway if @dest is not on our subnet, in the
+ * ARP cache. Entries expire CONFIG_NET_ARP_CACHE_TIMEOUT seconds after they
+ * were last confirmed and only apply to the device they were seen on.
+ *
+ * @dest: Destination IP address
+ * @ethaddr: Returns the MAC address to use
+ * @return 0 if found, -ENOENT if not
+ */
+int arp_cache_lookup(struct in_addr dest, uchar *ethaddr);
+
+/**
+ * arp_cache_update() - Record the MAC address of a neighbour
+ *
+ * If the cache is full, the least recently used entry is replaced.
+ *
+ * @ip: IP address of the neighbour
+ * @ethaddr: Its MAC address
+ * @create: true to add the neighbour if it is not in the cache, false to
+ *	only refresh an existing entry
+ */
+void arp_cache_update(struct in_addr ip, const uchar *ethaddr, bool create);
+
+/**
+ * arp_cache_learn() - Record the sender of a received packet
+ *
+ * This is the same as arp_cache_update() but ignores hosts which are not on
+ * our subnet, since their packets come through a router.
+ */
+void arp_cache_learn(struct in_addr ip, const uchar *ethaddr, bool create);
+
+/** arp_cache_flush() - Remove all entries from the ARP cache */
+void arp_cache_flush(void);
+
+/** arp_cache_show() - Print the ARP cache */
+void arp_cache_show(void);
+#else
+static inline int arp_cache_lookup(struct in_addr dest, uchar *ethaddr)
+{
+	return -ENOENT;
+}
+
+static inline void arp_cache_flush(void)
+{
+}
+#endif
+
 /* Network loop state */
 enum net_loop_state {
 	NETLOOP_CONTINUE,
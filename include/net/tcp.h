@@ -0,0 +1,199 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client for bulk downloads
+ */
+
+#ifndef __NET_TCP_H__
+#define __NET_TCP_H__
+
+#include <net.h>
+
+/*
+ *	Internet Protocol (IP) + TCP header, without TCP options
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgement number	*/
+	u8		tcp_hlen;	/* 4 bits header length (words)	*/
+	u8		tcp_flags;	/* Control flags		*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/* TCP control flags */
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PUSH	0x08
+#define TCP_ACK		0x10
+
+/* TCP options */
+#define TCP_O_END	0
+#define TCP_O_NOP	1
+#define TCP_O_MSS	2
+#define TCP_O_WS	3
+
+/* Largest segment which fits in an Ethernet frame (1500-byte MTU) */
+#define TCP_MSS		(1500 - IP_TCP_HDR_SIZE)
+
+/* Largest payload which may be passed to tcp_send() */
+#define TCP_TX_MAX	1024
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT,		/* we closed, waiting for the peer */
+	TCP_LAST_ACK,		/* peer closed, we have sent our FIN */
+};
+
+enum tcp_event {
+	TCP_EV_CONNECTED,	/* handshake complete, data may be sent */
+	TCP_EV_CLOSED,		/* peer sent FIN, all its data was received */
+	TCP_EV_RESET,		/* peer refused or reset the connection */
+	TCP_EV_TIMEOUT,		/* peer stopped responding */
+};
+
+/**
+ * struct tcp_stats - counters for the current connection
+ *
+ * @rx_segs: Number of data segments received in order
+ * @rx_bytes: Number of data bytes delivered
+ * @rx_ooo: Number of segments received after a gap
+ * @rx_dup: Number of segments which only contained data already received
+ * @acks: Number of ACKs sent, including duplicates
+ * @dup_acks: Number of duplicate ACKs sent to request a retransmit
+ * @retransmits: Number of segments we had to send again
+ */
+struct tcp_stats {
+	u32 rx_segs;
+	u64 rx_bytes;
+	u32 rx_ooo;
+	u32 rx_dup;
+	u32 acks;
+	u32 dup_acks;
+	u32 retransmits;
+};
+
+/**
+ * tcp_rx_f - Handler for data received on the connection
+ *
+ * Each byte is delivered exactly once, but segments which arrive after a
+ * lost one are delivered before the gap is filled. The handler may refuse
+ * such out-of-order data, in which case the sender has to send it again.
+ *
+ * @data: Received data
+ * @offset: Offset of @data within the stream, starting at 0
+ * @len: Number of bytes at @data
+ * @in_order: Number of bytes received without a gap from the start of the
+ *	stream, including @data if it is in order
+ * @return 0 if the data was accepted, -ve to refuse it. Only out-of-order
+ *	data can be refused.
+ */
+typedef int tcp_rx_f(const uchar *data, u32 offset, unsigned int len,
+		     u32 in_order);
+
+/**
+ * tcp_event_f - Handler for connection events
+ *
+ * @event: Event which occurred (enum tcp_event)
+ */
+typedef void tcp_event_f(enum tcp_event event);
+
+/**
+ * tcp_connect() - Open a connection
+ *
+ * This sends a SYN and takes over the net_loop() timeout handler, which is
+ * used for delayed ACKs and retransmission. Events are reported through
+ * @event_handler.
+ *
+ * @dest: IP address of the server
+ * @dport: TCP port on the server
+ * @rx_handler: Handler for received data
+ * @event_handler: Handler for connection events
+ */
+void tcp_connect(struct in_addr dest, int dport, tcp_rx_f *rx_handler,
+		 tcp_event_f *event_handler);
+
+/**
+ * tcp_send() - Send data on an established connection
+ *
+ * Only one send may be outstanding at a time. The data is copied and sent
+ * again if it is not acknowledged.
+ *
+ * @data: Data to send
+ * @len: Number of bytes to send (at most TCP_TX_MAX)
+ * @return 0 if OK, -EBUSY if a previous send is not acknowledged yet,
+ *	-ENOTCONN if not connected, -E2BIG if @len is too large
+ */
+int tcp_send(const void *data, int len);
+
+/**
+ * tcp_close() - Close the connection
+ *
+ * Sends a FIN if the connection is open. No more events are reported after
+ * this.
+ */
+void tcp_close(void);
+
+/**
+ * tcp_get_state() - Get the state of the connection
+ *
+ * @return connection state (enum tcp_state)
+ */
+enum tcp_state tcp_get_state(void);
+
+/**
+ * tcp_get_stats() - Get counters for the current connection
+ *
+ * @return pointer to the counters, reset by each tcp_connect()
+ */
+const struct tcp_stats *tcp_get_stats(void);
+
+/**
+ * tcp_set_tcp_header() - Set up the IP and TCP headers of a packet
+ *
+ * Used by net_send_ip_packet(). Any payload must already be in place after
+ * IP_TCP_HDR_SIZE bytes. A SYN carries options instead of a payload.
+ *
+ * @pkt: Start of the IP header
+ * @dest: Destination IP address
+ * @dport: Destination port
+ * @sport: Source port
+ * @payload_len: Number of payload bytes
+ * @action: TCP control flags
+ * @tcp_seq_num: Sequence number
+ * @tcp_ack_num: Acknowledgement number
+ * @return size of the IP and TCP headers, including any options
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+/**
+ * tcp_receive() - Process a received TCP packet
+ *
+ * Called by net_process_received_packet() once the IP header is checked
+ *
+ * @ip: IP packet
+ * @len: Length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+#endif /* __NET_TCP_H__ */
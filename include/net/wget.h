@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP/1.1 download over TCP
+ */
+
+#ifndef __NET_WGET_H__
+#define __NET_WGET_H__
+
+#include <blk.h>
+
+/**
+ * wget_start() - Begin an HTTP GET of net_boot_file_name
+ *
+ * The file name may be given as "<server ip>:<path>", otherwise serverip is
+ * used. Called by net_loop() for WGET.
+ */
+void wget_start(void);
+
+/**
+ * wget_set_blk_dev() - Stream the next download to a block device
+ *
+ * Normally the body is stored at the load address. When a block device is
+ * set, the load address is only used as a staging buffer of
+ * WGET_BLK_BUF_SIZE bytes, which is written to the device as it fills up, so
+ * the file may be larger than the available memory. The last block is padded
+ * with zeroes.
+ *
+ * @desc: Block device to write to, or NULL to store in memory
+ * @start: First block to write
+ */
+void wget_set_blk_dev(struct blk_desc *desc, lbaint_t start);
+
+/* Size of the staging buffer used when writing to a block device */
+#define WGET_BLK_BUF_SIZE	(1 << 20)
+
+#endif /* __NET_WGET_H__ */
@@ -278,6 +278,11 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @tx_buf:	Pointer to the TX buffer, or NULL if output is not buffered
+ * @tx_rd_ptr:	Read pointer in the TX buffer
+ * @tx_wr_ptr:	Write pointer in the TX buffer
+ * @tx_busy:	true while the TX buffer is being drained
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -285,6 +290,11 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	char *tx_buf;
+	int tx_rd_ptr;
+	int tx_wr_ptr;
+	bool tx_busy;
 };
 
 /* Access the serial operations for a device */
@@ -351,4 +361,32 @@ void serial_puts(const char *str);
 int serial_getc(void);
 int serial_tstc(void);
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/**
+ * serial_poll_tx() - Send buffered console output without waiting
+ *
+ * This is called from places where U-Boot is idle or polling, such as
+ * udelay() and ctrlc(), to move characters from the TX buffer to the UART
+ * while it has space.
+ */
+void serial_poll_tx(void);
+
+/**
+ * serial_flush_tx() - Hand all buffered console output to the UART
+ *
+ * This must be called before anything which stops the UART being polled,
+ * such as booting an OS, a reset or a panic. It does not wait for the UART's
+ * own FIFO to empty.
+ */
+void serial_flush_tx(void);
+#else
+static inline void serial_poll_tx(void)
+{
+}
+
+static inline void serial_flush_tx(void)
+{
+}
+#endif
+
 #endif
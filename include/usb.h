@@ -637,6 +637,30 @@ struct usb_dev_platdata {
 	int configno;
 };
 
+/**
+ * struct usb_bus_stats - transfer counters for a USB controller
+ *
+ * @control:	Number of control transfers submitted
+ * @bulk:	Number of bulk transfers submitted
+ * @interrupt:	Number of interrupt transfers submitted
+ * @errors:	Number of transfers which failed
+ * @bytes:	Number of bytes requested by control and bulk transfers
+ * @total_us:	Time spent in control and bulk transfers, in microseconds
+ * @max_us:	Longest control or bulk transfer, in microseconds
+ * @pool_misses: Number of transfers whose descriptors did not fit in the
+ *		controller's preallocated pool and had to be allocated
+ */
+struct usb_bus_stats {
+	ulong control;
+	ulong bulk;
+	ulong interrupt;
+	ulong errors;
+	u64 bytes;
+	u64 total_us;
+	ulong max_us;
+	ulong pool_misses;
+};
+
 /**
  * struct usb_bus_priv - information about the USB controller
  *
@@ -651,11 +675,13 @@ struct usb_dev_platdata {
  *		so this will be false.
  * @companion:  True if this is a companion controller to another USB
  *		controller
+ * @stats:	Transfer counters, updated by the uclass and the controller
  */
 struct usb_bus_priv {
 	int next_addr;
 	bool desc_before_addr;
 	bool companion;
+	struct usb_bus_stats stats;
 };
 
 /**
@@ -12,7 +12,7 @@
 #include <image.h>
 #include <malloc.h>
 #include <memalign.h>
-#include <u-boot/crc.h>
+#include <time.h>
 #include <watchdog.h>
 #include <u-boot/zlib.h>
 
@@ -115,6 +115,15 @@ void gzwrite_progress_finish(int returnval,
 	}
 }
 
+/* Print a rate in MB/s, given a number of bytes and microseconds */
+static void gzwrite_print_rate(const char *what, u64 bytes, u64 us)
+{
+	u64 rate = us ? lldiv(bytes * 100, us) : 0;
+	u32 rem = do_div(rate, 100);
+
+	printf("%s %llu.%02u MB/s", what, rate, rem);
+}
+
 int gzwrite(unsigned char *src, int len,
 	    struct blk_desc *dev,
 	    unsigned long szwritebuf,
@@ -127,9 +136,10 @@ int gzwrite(unsigned char *src, int len,
 	unsigned char *writebuf;
 	unsigned crc = 0;
 	u64 totalfilled = 0;
+	u64 inflate_us = 0, write_us = 0;
+	ulong start;
 	lbaint_t blksperbuf, outblock;
 	u32 expected_crc;
-	u32 payload_size;
 	int iteration = 0;
 
 	if (!szwritebuf ||
@@ -172,8 +182,6 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
-	payload_size = len - i - 8;
-
 	memcpy(&expected_crc, src + len - 8, sizeof(expected_crc));
 	expected_crc = le32_to_cpu(expected_crc);
 	u32 szuncompressed;
@@ -191,20 +199,31 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
+	writebuf = (unsigned char *)malloc_cache_aligned(szwritebuf);
+	if (!writebuf) {
+		printf("%s: cannot allocate %lu byte buffer\n", __func__,
+		       szwritebuf);
+		return -1;
+	}
+
 	gzwrite_progress_init(szexpected);
 
 	s.zalloc = gzalloc;
 	s.zfree = gzfree;
 
-	r = inflateInit2(&s, -MAX_WBITS);
+	/*
+	 * Let zlib parse the gzip wrapper too, so that it keeps the CRC of
+	 * the output as it inflates and checks it against the trailer
+	 */
+	r = inflateInit2(&s, 16 + MAX_WBITS);
 	if (r != Z_OK) {
 		printf("Error: inflateInit2() returned %d\n", r);
+		free(writebuf);
 		return -1;
 	}
 
-	s.next_in = src + i;
-	s.avail_in = payload_size+8;
-	writebuf = (unsigned char *)malloc_cache_aligned(szwritebuf);
+	s.next_in = src;
+	s.avail_in = len;
 
 	/* decompress until deflate stream ends or end of file */
 	do {
@@ -222,14 +241,16 @@ int gzwrite(unsigned char *src, int len,
 
 			s.avail_out = szwritebuf;
 			s.next_out = writebuf;
+			start = timer_get_us();
 			r = inflate(&s, Z_SYNC_FLUSH);
+			inflate_us += timer_get_us() - start;
+			crc = s.adler;
 			if ((r != Z_OK) &&
 			    (r != Z_STREAM_END)) {
 				printf("Error: inflate() returned %d\n", r);
 				goto out;
 			}
 			numfilled = szwritebuf - s.avail_out;
-			crc = crc32(crc, writebuf, numfilled);
 			totalfilled += numfilled;
 			if (numfilled < szwritebuf) {
 				writeblocks = (numfilled+dev->blksz-1)
@@ -243,9 +264,17 @@ int gzwrite(unsigned char *src, int len,
 			gzwrite_progress(iteration++,
 					 totalfilled,
 					 szexpected);
+			start = timer_get_us();
 			blocks_written = blk_dwrite(dev, outblock,
 						    writeblocks, writebuf);
+			write_us += timer_get_us() - start;
 			outblock += blocks_written;
+			if (blocks_written != writeblocks) {
+				printf("Error: wrote %lu of " LBAF " blocks\n",
+				       blocks_written, writeblocks);
+				r = -1;
+				goto out;
+			}
 			if (ctrlc()) {
 				puts("abort\n");
 				goto out;
@@ -264,6 +293,9 @@ int gzwrite(unsigned char *src, int len,
 out:
 	gzwrite_progress_finish(r, totalfilled, szexpected,
 				expected_crc, crc);
+	gzwrite_print_rate("\tinflate", totalfilled, inflate_us);
+	gzwrite_print_rate(", write", totalfilled, write_us);
+	putc('\n');
 	free(writebuf);
 	inflateEnd(&s);
 
@@ -7,6 +7,7 @@
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
+#include <serial.h>
 #include <time.h>
 #include <timer.h>
 #include <watchdog.h>
@@ -180,6 +181,7 @@ void udelay(unsigned long usec)
 
 	do {
 		WATCHDOG_RESET();
+		serial_poll_tx();
 		kv = usec > CONFIG_WD_PERIOD ? CONFIG_WD_PERIOD : usec;
 		__udelay (kv);
 		usec -= kv;
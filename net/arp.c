@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <net.h>
 
 #include "arp.h"
 
@@ -27,6 +28,28 @@
 # define ARP_TIMEOUT_COUNT	CONFIG_NET_RETRY_COUNT
 #endif
 
+#ifdef CONFIG_NET_ARP_CACHE
+/**
+ * struct arp_entry - a neighbour in the ARP cache
+ *
+ * @ip: IP address, or 0 if the entry is free
+ * @ethaddr: MAC address of @ip
+ * @dev_index: Ethernet device the address was seen on
+ * @updated: Time (ms) the address was last confirmed
+ * @used: Time (ms) the entry was last looked up or confirmed, used to
+ *	choose the entry to replace
+ */
+struct arp_entry {
+	struct in_addr ip;
+	uchar ethaddr[ARP_HLEN];
+	int dev_index;
+	ulong updated;
+	ulong used;
+};
+
+static struct arp_entry arp_cache[CONFIG_NET_ARP_CACHE_SIZE];
+#endif
+
 struct in_addr net_arp_wait_packet_ip;
 static struct in_addr net_arp_wait_reply_ip;
 /* MAC address of waiting packet's destination */
@@ -78,23 +101,126 @@ void arp_raw_request(struct in_addr source_ip, const uchar *target_ethaddr,
 	net_send_packet(arp_tx_packet, eth_hdr_size + ARP_HDR_SIZE);
 }
 
-void arp_request(void)
+/* Work out which host has to be resolved to reach @dest */
+static struct in_addr arp_next_hop(struct in_addr dest, bool warn)
 {
-	if ((net_arp_wait_packet_ip.s_addr & net_netmask.s_addr) !=
-	    (net_ip.s_addr & net_netmask.s_addr)) {
-		if (net_gateway.s_addr == 0) {
+	if ((dest.s_addr & net_netmask.s_addr) ==
+	    (net_ip.s_addr & net_netmask.s_addr))
+		return dest;
+	if (net_gateway.s_addr == 0) {
+		if (warn)
 			puts("## Warning: gatewayip needed but not set\n");
-			net_arp_wait_reply_ip = net_arp_wait_packet_ip;
-		} else {
-			net_arp_wait_reply_ip = net_gateway;
-		}
-	} else {
-		net_arp_wait_reply_ip = net_arp_wait_packet_ip;
+		return dest;
 	}
 
+	return net_gateway;
+}
+
+void arp_request(void)
+{
+	net_arp_wait_reply_ip = arp_next_hop(net_arp_wait_packet_ip, true);
+
 	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
 }
 
+#ifdef CONFIG_NET_ARP_CACHE
+static bool arp_entry_valid(struct arp_entry *ent, ulong now)
+{
+	return ent->ip.s_addr && ent->dev_index == eth_get_dev_index() &&
+	       now - ent->updated < CONFIG_NET_ARP_CACHE_TIMEOUT * 1000UL;
+}
+
+static struct arp_entry *arp_cache_find(struct in_addr ip, ulong now)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(arp_cache); i++) {
+		if (arp_cache[i].ip.s_addr == ip.s_addr &&
+		    arp_entry_valid(&arp_cache[i], now))
+			return &arp_cache[i];
+	}
+
+	return NULL;
+}
+
+int arp_cache_lookup(struct in_addr dest, uchar *ethaddr)
+{
+	ulong now = get_timer(0);
+	struct arp_entry *ent;
+
+	ent = arp_cache_find(arp_next_hop(dest, false), now);
+	if (!ent)
+		return -ENOENT;
+	memcpy(ethaddr, ent->ethaddr, ARP_HLEN);
+	ent->used = now;
+
+	return 0;
+}
+
+void arp_cache_update(struct in_addr ip, const uchar *ethaddr, bool create)
+{
+	ulong now = get_timer(0);
+	struct arp_entry *ent;
+	int i;
+
+	if (!ip.s_addr || ip.s_addr == 0xffffffff ||
+	    !is_valid_ethaddr(ethaddr))
+		return;
+
+	ent = arp_cache_find(ip, now);
+	if (!ent) {
+		if (!create)
+			return;
+		/* Use a free or expired entry, else the least recently used */
+		ent = &arp_cache[0];
+		for (i = 0; i < ARRAY_SIZE(arp_cache); i++) {
+			if (!arp_entry_valid(&arp_cache[i], now)) {
+				ent = &arp_cache[i];
+				break;
+			}
+			if (now - arp_cache[i].used > now - ent->used)
+				ent = &arp_cache[i];
+		}
+		ent->ip = ip;
+		ent->dev_index = eth_get_dev_index();
+	}
+	memcpy(ent->ethaddr, ethaddr, ARP_HLEN);
+	ent->updated = now;
+	ent->used = now;
+}
+
+void arp_cache_learn(struct in_addr ip, const uchar *ethaddr, bool create)
+{
+	if (!net_ip.s_addr || (ip.s_addr & net_netmask.s_addr) !=
+	    (net_ip.s_addr & net_netmask.s_addr))
+		return;
+
+	arp_cache_update(ip, ethaddr, create);
+}
+
+void arp_cache_flush(void)
+{
+	memset(arp_cache, '\0', sizeof(arp_cache));
+}
+
+void arp_cache_show(void)
+{
+	ulong now = get_timer(0);
+	struct arp_entry *ent;
+	int i;
+
+	printf("%-16s%-19s%-6s%s\n", "IP address", "MAC address", "Dev",
+	       "Age (s)");
+	for (i = 0, ent = arp_cache; i < ARRAY_SIZE(arp_cache); i++, ent++) {
+		if (!ent->ip.s_addr)
+			continue;
+		printf("%-16pI4%pM  %-6d%lu%s\n", &ent->ip, ent->ethaddr,
+		       ent->dev_index, (now - ent->updated) / 1000,
+		       arp_entry_valid(ent, now) ? "" : " (stale)");
+	}
+}
+#endif
+
 int arp_timeout_check(void)
 {
 	ulong t;
@@ -155,6 +281,17 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 	if (net_ip.s_addr == 0)
 		return;
 
+#ifdef CONFIG_NET_ARP_CACHE
+	/*
+	 * RFC 826: refresh the sender if we know it already, which includes
+	 * gratuitous ARP announcing a new MAC address. Requests for us will
+	 * be followed by traffic to the sender, so add it.
+	 */
+	arp_cache_learn(net_read_ip(&arp->ar_spa), &arp->ar_sha,
+			net_read_ip(&arp->ar_tpa).s_addr == net_ip.s_addr &&
+			ntohs(arp->ar_op) == ARPOP_REQUEST);
+#endif
+
 	if (net_read_ip(&arp->ar_tpa).s_addr != net_ip.s_addr)
 		return;
 
@@ -208,6 +345,9 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 				   "Got ARP REPLY, set eth addr (%pM)\n",
 				   arp->ar_data);
 
+#ifdef CONFIG_NET_ARP_CACHE
+			arp_cache_update(reply_ip_addr, &arp->ar_sha, true);
+#endif
 			/* save address for later use */
 			if (arp_wait_packet_ethaddr != NULL)
 				memcpy(arp_wait_packet_ethaddr,
@@ -10,9 +10,11 @@
 
 #include <common.h>
 #include <command.h>
+#include <dm.h>
 #include <env.h>
 #include <efi_loader.h>
 #include <net.h>
+#include <rtc.h>
 #include <net/tftp.h>
 #include "bootp.h"
 #ifdef CONFIG_LED_STATUS
@@ -52,6 +54,13 @@
 #define CONFIG_BOOTP_ID_CACHE_SIZE 4
 #endif
 
+/*
+ * Environment variable holding the last DHCP lease, and how long to wait for
+ * the server to confirm it before falling back to discovery
+ */
+#define DHCP_LEASE_VAR		"dhcplease"
+#define DHCP_REBOOT_TIMEOUT_MS	1000
+
 u32		bootp_ids[CONFIG_BOOTP_ID_CACHE_SIZE];
 unsigned int	bootp_num_ids;
 int		bootp_try;
@@ -68,6 +77,7 @@ static dhcp_state_t dhcp_state = INIT;
 static u32 dhcp_leasetime;
 static struct in_addr dhcp_server_ip;
 static u8 dhcp_option_overload;
+static struct in_addr dhcp_reboot_ip;
 #define OVERLOAD_FILE 1
 #define OVERLOAD_SNAME 2
 static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
@@ -104,6 +114,25 @@ static void bootp_add_id(ulong id)
 	}
 }
 
+/*
+ * The ID is the lower 4 bytes of our ethernet address plus the current time
+ * in ms. It is returned in network order.
+ */
+static u32 bootp_new_id(void)
+{
+	u32 id;
+
+	id = ((u32)net_ethaddr[2] << 24)
+		| ((u32)net_ethaddr[3] << 16)
+		| ((u32)net_ethaddr[4] << 8)
+		| (u32)net_ethaddr[5];
+	id += get_timer(0);
+	id = htonl(id);
+	bootp_add_id(id);
+
+	return id;
+}
+
 static bool bootp_match_id(ulong id)
 {
 	unsigned int i;
@@ -791,17 +820,7 @@ void bootp_request(void)
 	extlen = bootp_extended((u8 *)bp->bp_vend);
 #endif
 
-	/*
-	 *	Bootp ID is the lower 4 bytes of our ethernet address
-	 *	plus the current time in ms.
-	 */
-	bootp_id = ((u32)net_ethaddr[2] << 24)
-		| ((u32)net_ethaddr[3] << 16)
-		| ((u32)net_ethaddr[4] << 8)
-		| (u32)net_ethaddr[5];
-	bootp_id += get_timer(0);
-	bootp_id = htonl(bootp_id);
-	bootp_add_id(bootp_id);
+	bootp_id = bootp_new_id();
 	net_copy_u32(&bp->bp_id, &bootp_id);
 
 	/*
@@ -966,13 +985,17 @@ static int dhcp_message_type(unsigned char *popt)
 	return -1;
 }
 
-static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
+/*
+ * Send a DHCPREQUEST. @id is the transaction ID in network order. @server_ip
+ * is left out of the request if it is zero.
+ */
+static void dhcp_send_request(u32 id, struct in_addr server_ip,
+			      struct in_addr requested_ip)
 {
 	uchar *pkt, *iphdr;
 	struct bootp_hdr *bp;
 	int pktlen, iplen, extlen;
 	int eth_hdr_size;
-	struct in_addr offered_ip;
 	struct in_addr zero_ip;
 	struct in_addr bcast_ip;
 
@@ -1005,20 +1028,10 @@ static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
 	memcpy(bp->bp_chaddr, net_ethaddr, 6);
 	copy_filename(bp->bp_file, net_boot_file_name, sizeof(bp->bp_file));
 
-	/*
-	 * ID is the id of the OFFER packet
-	 */
-
-	net_copy_u32(&bp->bp_id, &bp_offer->bp_id);
-
-	/*
-	 * Copy options from OFFER packet if present
-	 */
+	net_copy_u32(&bp->bp_id, &id);
 
-	/* Copy offered IP into the parameters request list */
-	net_copy_ip(&offered_ip, &bp_offer->bp_yiaddr);
 	extlen = dhcp_extended((u8 *)bp->bp_vend, DHCP_REQUEST,
-		dhcp_server_ip, offered_ip);
+		server_ip, requested_ip);
 
 	iplen = BOOTP_HDR_SIZE - OPT_FIELD_SIZE + extlen;
 	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
@@ -1032,6 +1045,125 @@ static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
 	net_send_packet(net_tx_packet, pktlen);
 }
 
+static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
+{
+	struct in_addr offered_ip;
+	u32 id;
+
+	/*
+	 * ID is the id of the OFFER packet
+	 */
+	net_copy_u32(&id, &bp_offer->bp_id);
+
+	/* Copy offered IP into the parameters request list */
+	net_copy_ip(&offered_ip, &bp_offer->bp_yiaddr);
+	dhcp_send_request(id, dhcp_server_ip, offered_ip);
+}
+
+/*
+ * Current time in seconds from the RTC, or 0 if there is none. This is used
+ * for the lease expiry, which has to survive a reset.
+ */
+static ulong dhcp_lease_now(void)
+{
+#ifdef CONFIG_DM_RTC
+	struct rtc_time tm;
+	struct udevice *dev;
+
+	if (!uclass_first_device_err(UCLASS_RTC, &dev) &&
+	    !dm_rtc_get(dev, &tm))
+		return rtc_mktime(&tm);
+#endif
+
+	return 0;
+}
+
+/*
+ * Record the lease we are bound to as
+ * "<ipaddr>,<server id>,<gatewayip>,<netmask>,<expiry>", where the expiry is
+ * in RTC seconds (hex), or 0 if unknown
+ */
+static void dhcp_lease_save(void)
+{
+	ulong expiry = 0;
+	ulong now = dhcp_lease_now();
+	char buf[80];
+
+	if (now && dhcp_leasetime != 0xffffffff)
+		expiry = now + ntohl(dhcp_leasetime);
+
+	snprintf(buf, sizeof(buf), "%pI4,%pI4,%pI4,%pI4,%lx", &net_ip,
+		 &dhcp_server_ip, &net_gateway, &net_netmask, expiry);
+	env_set(DHCP_LEASE_VAR, buf);
+}
+
+/*
+ * Find the address of a saved lease which has not expired. Returns 0 if
+ * found, -ENOENT if there is none, -EINVAL if it is invalid or -ETIMEDOUT if
+ * it has expired.
+ */
+static int dhcp_lease_load(struct in_addr *ip)
+{
+	const char *lease = env_get(DHCP_LEASE_VAR);
+	char buf[80], *s;
+	ulong expiry, now;
+	int i;
+
+	if (!lease)
+		return -ENOENT;
+
+	strlcpy(buf, lease, sizeof(buf));
+	s = buf;
+	*ip = string_to_ip(strsep(&s, ","));
+	for (i = 0; s && i < 3; i++)
+		strsep(&s, ",");
+	if (!s || !ip->s_addr)
+		return -EINVAL;
+
+	expiry = simple_strtoul(s, NULL, 16);
+	now = dhcp_lease_now();
+	if (expiry && now && now >= expiry)
+		return -ETIMEDOUT;
+
+	return 0;
+}
+
+static void dhcp_start_discovery(void)
+{
+	bootp_try = 0;
+	bootp_timeout = 250;
+	bootp_request();
+}
+
+/*
+ * RFC 2131 4.3.2: in INIT-REBOOT state the request is broadcast with the
+ * address in 'requested IP address', without a server identifier and with
+ * ciaddr zero
+ */
+static void dhcp_send_reboot_request(void)
+{
+	struct in_addr zero_ip;
+
+	printf("DHCP INIT-REBOOT %pI4 %d\n", &dhcp_reboot_ip, ++bootp_try);
+	dhcp_state = INIT_REBOOT;
+	net_set_udp_handler(dhcp_handler);
+	zero_ip.s_addr = 0;
+	dhcp_send_request(bootp_new_id(), zero_ip, dhcp_reboot_ip);
+}
+
+static void dhcp_reboot_timeout_handler(void)
+{
+	if (get_timer(bootp_start) >= DHCP_REBOOT_TIMEOUT_MS) {
+		puts("\nNo reply to INIT-REBOOT; starting discovery\n");
+		dhcp_start_discovery();
+		return;
+	}
+
+	bootp_timeout *= 2;
+	net_set_timeout_handler(bootp_timeout, dhcp_reboot_timeout_handler);
+	dhcp_send_reboot_request();
+}
+
 /*
  *	Handle DHCP received packets.
  */
@@ -1050,6 +1182,16 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	debug("DHCPHandler: got DHCP packet: (src=%d, dst=%d, len=%d) state: "
 	      "%d\n", src, dest, len, dhcp_state);
 
+	/* A NAK means the saved lease is no longer valid on this network */
+	if (dhcp_state == INIT_REBOOT &&
+	    dhcp_message_type((u8 *)bp->bp_vend) == DHCP_NAK) {
+		printf("DHCP lease for %pI4 refused; starting discovery\n",
+		       &dhcp_reboot_ip);
+		env_set(DHCP_LEASE_VAR, NULL);
+		dhcp_start_discovery();
+		return;
+	}
+
 	if (net_read_ip(&bp->bp_yiaddr).s_addr == 0)
 		return;
 
@@ -1081,8 +1223,10 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		return;
 		break;
+	case INIT_REBOOT:
 	case REQUESTING:
-		debug("DHCP State: REQUESTING\n");
+		debug("DHCP State: %s\n",
+		      dhcp_state == REQUESTING ? "REQUESTING" : "INIT-REBOOT");
 
 		if (dhcp_message_type((u8 *)bp->bp_vend) == DHCP_ACK) {
 			dhcp_packet_process_options(bp);
@@ -1091,6 +1235,8 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			dhcp_state = BOUND;
 			printf("DHCP client bound to address %pI4 (%lu ms)\n",
 			       &net_ip, get_timer(bootp_start));
+			if (IS_ENABLED(CONFIG_DHCP_LEASE_CACHE))
+				dhcp_lease_save();
 			net_set_timeout_handler(0, (thand_f *)0);
 			bootstage_mark_name(BOOTSTAGE_ID_BOOTP_STOP,
 					    "bootp_stop");
@@ -1110,6 +1256,15 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 void dhcp_request(void)
 {
+	if (IS_ENABLED(CONFIG_DHCP_LEASE_CACHE) &&
+	    !dhcp_lease_load(&dhcp_reboot_ip)) {
+		bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
+		net_set_timeout_handler(bootp_timeout,
+					dhcp_reboot_timeout_handler);
+		dhcp_send_reboot_request();
+		return;
+	}
+
 	bootp_request();
 }
 #endif	/* CONFIG_CMD_DHCP */
@@ -10,6 +10,7 @@
 #include <common.h>
 #include <dm.h>
 #include <env.h>
+#include <malloc.h>
 #include <net.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -19,13 +20,21 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Most packets to process in one call to eth_rx() */
+#define ETH_RX_MAX	32
+
+/* Most packets to ask for in one call to recv_batch() */
+#define ETH_RX_BATCH	16
+
 /**
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @stats: Packet counters
  */
 struct eth_device_priv {
 	enum eth_state_t state;
+	struct eth_stats stats;
 };
 
 /**
@@ -40,6 +49,10 @@ struct eth_uclass_priv {
 /* eth_errno - This stores the most recent failure code from DM functions */
 static int eth_errno;
 
+/* Spare packet buffers, see eth_pkt_pool_get() */
+static uchar *eth_pkt_pool[CONFIG_DM_ETH_PKT_POOL_SIZE];
+static int eth_pkt_pool_count;
+
 static struct eth_uclass_priv *eth_get_uclass_priv(void)
 {
 	struct uclass *uc;
@@ -328,6 +341,47 @@ void eth_halt(void)
 		priv->state = ETH_STATE_PASSIVE;
 }
 
+struct eth_stats *eth_get_stats(struct udevice *dev)
+{
+	struct eth_device_priv *priv;
+
+	if (!dev || !device_active(dev))
+		return NULL;
+
+	priv = dev_get_uclass_priv(dev);
+	return &priv->stats;
+}
+
+int eth_pkt_pool_get(uchar **bufs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (eth_pkt_pool_count)
+			bufs[i] = eth_pkt_pool[--eth_pkt_pool_count];
+		else
+			bufs[i] = memalign(ARCH_DMA_MINALIGN,
+					   ALIGN(PKTSIZE_ALIGN,
+						 ARCH_DMA_MINALIGN));
+		if (!bufs[i])
+			break;
+	}
+
+	return i;
+}
+
+void eth_pkt_pool_put(uchar **bufs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (eth_pkt_pool_count < ARRAY_SIZE(eth_pkt_pool))
+			eth_pkt_pool[eth_pkt_pool_count++] = bufs[i];
+		else
+			free(bufs[i]);
+	}
+}
+
 int eth_is_active(struct udevice *dev)
 {
 	struct eth_device_priv *priv;
@@ -341,6 +395,7 @@ int eth_is_active(struct udevice *dev)
 
 int eth_send(void *packet, int length)
 {
+	struct eth_device_priv *priv;
 	struct udevice *current;
 	int ret;
 
@@ -351,10 +406,14 @@ int eth_send(void *packet, int length)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	priv = dev_get_uclass_priv(current);
 	ret = eth_get_ops(current)->send(current, packet, length);
 	if (ret < 0) {
+		priv->stats.tx_errors++;
 		/* We cannot completely return the error at present */
 		debug("%s: send() returned error %d\n", __func__, ret);
+	} else {
+		priv->stats.tx_packets++;
 	}
 #if defined(CONFIG_CMD_PCAP)
 	if (ret >= 0)
@@ -363,8 +422,52 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+/*
+ * Take packets from the driver a batch at a time, so that it can hand over
+ * and refill several ring entries at once
+ */
+static int eth_rx_batch(struct udevice *dev, struct eth_stats *stats)
+{
+	struct eth_ops *ops = eth_get_ops(dev);
+	struct eth_rx_desc descs[ETH_RX_BATCH];
+	int flags = ETH_RECV_CHECK_DEVICE;
+	int total, count;
+	int ret;
+	int i;
+
+	for (total = 0; total < ETH_RX_MAX; total += ret) {
+		count = min(ETH_RX_MAX - total, ETH_RX_BATCH);
+		ret = ops->recv_batch(dev, flags, descs, count);
+		flags = 0;
+		if (ret <= 0)
+			return ret;
+
+		stats->rx_batches++;
+		for (i = 0; i < ret; i++) {
+			if (descs[i].length <= 0)
+				continue;
+			net_process_received_packet(descs[i].packet,
+						    descs[i].length);
+			stats->rx_packets++;
+		}
+
+		if (ops->free_batch) {
+			ops->free_batch(dev, descs, ret);
+		} else if (ops->free_pkt) {
+			for (i = 0; i < ret; i++)
+				ops->free_pkt(dev, descs[i].packet,
+					      descs[i].length);
+		}
+		if (ret < count)
+			break;
+	}
+
+	return 0;
+}
+
 int eth_rx(void)
 {
+	struct eth_device_priv *priv;
 	struct udevice *current;
 	uchar *packet;
 	int flags;
@@ -378,21 +481,32 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
+	priv = dev_get_uclass_priv(current);
+	if (eth_get_ops(current)->recv_batch) {
+		ret = eth_rx_batch(current, &priv->stats);
+		goto done;
+	}
+
+	/* Process up to ETH_RX_MAX packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < 32; i++) {
+	for (i = 0; i < ETH_RX_MAX; i++) {
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
-		if (ret > 0)
+		if (ret > 0) {
+			priv->stats.rx_batches++;
 			net_process_received_packet(packet, ret);
+			priv->stats.rx_packets++;
+		}
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
 			break;
 	}
+done:
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
+		priv->stats.rx_errors++;
 		/* We cannot completely return the error at present */
 		debug("%s: recv() returned error %d\n", __func__, ret);
 	}
@@ -519,6 +633,10 @@ static int eth_post_probe(struct udevice *dev)
 			ops->recv += gd->reloc_off;
 		if (ops->free_pkt)
 			ops->free_pkt += gd->reloc_off;
+		if (ops->recv_batch)
+			ops->recv_batch += gd->reloc_off;
+		if (ops->free_batch)
+			ops->free_batch += gd->reloc_off;
 		if (ops->stop)
 			ops->stop += gd->reloc_off;
 		if (ops->mcast)
@@ -98,6 +98,12 @@
 #include <net.h>
 #include <net/fastboot.h>
 #include <net/tftp.h>
+#if defined(CONFIG_PROT_TCP)
+#include <net/tcp.h>
+#endif
+#if defined(CONFIG_CMD_WGET)
+#include <net/wget.h>
+#endif
 #if defined(CONFIG_CMD_PCAP)
 #include <net/pcap.h>
 #endif
@@ -544,6 +550,11 @@ restart:
 		case WOL:
 			wol_start();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			wget_start();
+			break;
 #endif
 		default:
 			break;
@@ -851,6 +862,8 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	/* if broadcast, make the ether address a broadcast and don't do ARP */
 	if (dest.s_addr == 0xFFFFFFFF)
 		ether = (uchar *)net_bcast_ethaddr;
+	else if (memcmp(ether, net_null_ethaddr, 6) == 0)
+		arp_cache_lookup(dest, ether);
 
 	pkt = (uchar *)net_tx_packet;
 
@@ -862,6 +875,14 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				   payload_len);
 		pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 		break;
+#if defined(CONFIG_PROT_TCP)
+	case IPPROTO_TCP:
+		pkt_hdr_size = eth_hdr_size +
+			tcp_set_tcp_header(pkt + eth_hdr_size, dest, dport,
+					   sport, payload_len, action,
+					   tcp_seq_num, tcp_ack_num);
+		break;
+#endif
 	default:
 		return -EINVAL;
 	}
@@ -1236,6 +1257,11 @@ void net_process_received_packet(uchar *in_packet, int len)
 		}
 		/* Read source IP address for later use */
 		src_ip = net_read_ip(&ip->ip_src);
+#ifdef CONFIG_NET_ARP_CACHE
+		/* Learn the sender's MAC address if it is sending to us */
+		arp_cache_learn(src_ip, et->et_src,
+				dst_ip.s_addr == net_ip.s_addr);
+#endif
 		/*
 		 * The function returns the unchanged packet if it's not
 		 * a fragment, and either the complete packet or NULL if
@@ -1268,6 +1294,14 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#if defined(CONFIG_PROT_TCP)
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			debug_cond(DEBUG_DEV_PKT,
+				   "received TCP (to=%pI4, from=%pI4, len=%d)\n",
+				   &dst_ip, &src_ip, len);
+			tcp_receive((struct ip_tcp_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1371,6 +1405,9 @@ static int net_check_prereq(enum proto_t protocol)
 #endif
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
+#endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
 #endif
 		/* Fall through */
 	case TFTPGET:
@@ -36,6 +36,7 @@
 #include "nfs.h"
 #include "bootp.h"
 #include <time.h>
+#include <linux/log2.h>
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
 #define NFS_RETRY_COUNT 30
@@ -48,12 +49,38 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+/*
+ * Bytes in an NFSv3 READ reply before the data: RPC header, status,
+ * attributes, count, eof and data length
+ */
+#define NFS3_READ_REPLY_HDR	((6 + 1 + 22 + 3) * sizeof(uint32_t))
+
+/**
+ * struct nfs_read_slot - a READ request which has not been answered yet
+ *
+ * @xid: RPC ID of the request, or 0 if the slot is free
+ * @offset: File offset requested
+ * @len: Number of bytes requested
+ * @sent: Time (ms) the request was sent
+ */
+struct nfs_read_slot {
+	ulong xid;
+	u32 offset;
+	u32 len;
+	ulong sent;
+};
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
 static ulong nfs_timeout = NFS_TIMEOUT;
 
+static struct nfs_read_slot nfs_read_slots[CONFIG_NFS_READ_WINDOW];
+static u32 nfs_read_size;	/* Bytes asked for by each READ */
+static u32 nfs_read_next;	/* Offset of the next READ to send */
+static u32 nfs_read_end;	/* File size, once a reply shows the end */
+static u32 nfs_read_bytes;	/* Bytes received so far */
+static u32 nfs_read_hashes;	/* Progress hashes printed */
+
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
 static int filefh3_length;	/* (variable) length of filefh when NFSv3 */
@@ -72,6 +99,7 @@ static int nfs_state;
 #define STATE_LOOKUP_REQ		5
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
+#define STATE_FSINFO_REQ		8
 
 static char *nfs_filename;
 static char *nfs_path;
@@ -390,6 +418,126 @@ static void nfs_read_req(int offset, int readlen)
 	rpc_req(PROG_NFS, NFS_READ, data, len);
 }
 
+/**************************************************************************
+NFS3_FSINFO - Ask an NFSv3 server how much it can read at once
+**************************************************************************/
+static void nfs_fsinfo_req(void)
+{
+	uint32_t data[1024];
+	uint32_t *p;
+	int len;
+
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	*p++ = htonl(filefh3_length);
+	memcpy(p, filefh, filefh3_length);
+	p += (filefh3_length / 4);
+
+	len = (uint32_t *)p - (uint32_t *)&(data[0]);
+
+	rpc_req(PROG_NFS, NFS3PROC_FSINFO, data, len);
+}
+
+/* Largest READ we can receive, before the server has its say */
+static u32 nfs_read_size_max(void)
+{
+#ifdef CONFIG_IP_DEFRAG
+	/* NFSv3 replies may be fragmented and reassembled */
+	if (!(supported_nfs_versions & NFSV2_FLAG))
+		return max_t(u32, NFS_READ_SIZE,
+			     rounddown_pow_of_two(CONFIG_NET_MAXDEFRAG -
+						  IP_UDP_HDR_SIZE -
+						  NFS3_READ_REPLY_HDR));
+#endif
+	return NFS_READ_SIZE;
+}
+
+static void nfs_read_send(struct nfs_read_slot *slot)
+{
+	nfs_read_req(slot->offset, slot->len);
+	slot->xid = rpc_id;
+	slot->sent = get_timer(0);
+}
+
+/* Send READs for the next parts of the file until the window is full */
+static void nfs_read_fill(void)
+{
+	struct nfs_read_slot *slot;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_read_slots); i++) {
+		slot = &nfs_read_slots[i];
+		if (slot->xid)
+			continue;
+		if (nfs_read_next >= nfs_read_end)
+			break;
+		slot->offset = nfs_read_next;
+		slot->len = nfs_read_size;
+		nfs_read_next += nfs_read_size;
+		nfs_read_send(slot);
+	}
+}
+
+/* Send READs again which have been waiting at least @age ms */
+static void nfs_read_retransmit(ulong age)
+{
+	struct nfs_read_slot *slot;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_read_slots); i++) {
+		slot = &nfs_read_slots[i];
+		if (slot->xid && get_timer(slot->sent) >= age)
+			nfs_read_send(slot);
+	}
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_read_slots, '\0', sizeof(nfs_read_slots));
+	nfs_read_next = 0;
+	nfs_read_end = ~0U;
+	nfs_read_bytes = 0;
+	nfs_read_hashes = 0;
+	nfs_state = STATE_READ_REQ;
+	nfs_read_fill();
+}
+
+/*
+ * Free the slots for READs past the end of the file. Returns true if all
+ * of the file has been received.
+ */
+static bool nfs_read_done(void)
+{
+	struct nfs_read_slot *slot;
+	bool done = true;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_read_slots); i++) {
+		slot = &nfs_read_slots[i];
+		if (!slot->xid)
+			continue;
+		if (slot->offset >= nfs_read_end)
+			slot->xid = 0;
+		else
+			done = false;
+	}
+
+	return done && nfs_read_next >= nfs_read_end;
+}
+
+static void nfs_show_progress(void)
+{
+	u32 step = NFS_READ_SIZE / 2 * 10;
+
+	while (nfs_read_hashes < DIV_ROUND_UP(nfs_read_bytes, step)) {
+		if (nfs_read_hashes && !(nfs_read_hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+		nfs_read_hashes++;
+	}
+}
+
 /**************************************************************************
 RPC request dispatcher
 **************************************************************************/
@@ -419,8 +567,11 @@ static void nfs_send(void)
 	case STATE_LOOKUP_REQ:
 		nfs_lookup_req(nfs_filename);
 		break;
+	case STATE_FSINFO_REQ:
+		nfs_fsinfo_req();
+		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_retransmit(0);
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -663,21 +814,78 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs_fsinfo_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int nfsv3_data_offset;
+	u32 rtmax, rtpref;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memcpy(&rpc_pkt.u.data[0], pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
 	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
 		return -NFS_RPC_DROP;
 
+	if (rpc_pkt.u.reply.rstatus  ||
+	    rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus  ||
+	    rpc_pkt.u.reply.data[0])
+		return -NFS_RPC_ERR;
+
+	nfsv3_data_offset = nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+	if ((uchar *)&rpc_pkt.u.reply.data[3 + nfsv3_data_offset] -
+	    (uchar *)&rpc_pkt > len)
+		return -NFS_RPC_DROP;
+
+	rtmax = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+	rtpref = ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]);
+	if (rtpref && rtpref < rtmax)
+		rtmax = rtpref;
+	if (rtmax && rtmax < nfs_read_size)
+		nfs_read_size = rtmax;
+	debug("NFS read size %u (rtmax %u)\n", nfs_read_size,
+	      ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]));
+
+	return 0;
+}
+
+/*
+ * Handle a READ reply, which may be for any of the requests in flight.
+ * Returns the number of bytes received, or -ve on error
+ */
+static int nfs_read_reply(uchar *pkt, unsigned len)
+{
+	struct rpc_t rpc_pkt;
+	struct nfs_read_slot *slot = NULL;
+	uint32_t *data = rpc_pkt.u.reply.data;
+	unsigned int hdr_len;
+	ulong xid;
+	u32 rlen;
+	int data_off;
+	bool eof;
+	int i;
+
+	debug("%s\n", __func__);
+
+	/* The data can be larger than rpc_pkt, so only copy the header */
+	hdr_len = min_t(unsigned int, len, NFS3_READ_REPLY_HDR);
+	if (hdr_len < (uchar *)&data[1] - (uchar *)&rpc_pkt)
+		return -NFS_RPC_DROP;
+	memcpy(&rpc_pkt.u.data[0], pkt, hdr_len);
+
+	xid = ntohl(rpc_pkt.u.reply.id);
+	for (i = 0; i < ARRAY_SIZE(nfs_read_slots); i++) {
+		if (nfs_read_slots[i].xid == xid) {
+			slot = &nfs_read_slots[i];
+			break;
+		}
+	}
+	if (!slot)
+		return -NFS_RPC_DROP;
+
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
@@ -689,34 +897,46 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
-		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		data_off = 19;
+		if ((uchar *)&data[data_off] - (uchar *)&rpc_pkt > hdr_len)
+			return -NFS_RPC_DROP;
+		rlen = ntohl(data[18]);
+		/* NFSv2 only gives less than asked for at the end */
+		eof = rlen < slot->len;
 	} else {  /* NFSV3_FLAG */
-		int nfsv3_data_offset =
-			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
-
-		/* count value */
-		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
-		/* Skip unused values :
-			EOF:		32 bits value,
-			data_size:	32 bits value,
-		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		int nfsv3_data_offset = nfs3_get_attributes_offset(data);
+
+		/*
+		 * After the attributes come the count, the EOF flag and the
+		 * length of the data
+		 */
+		data_off = 4 + nfsv3_data_offset;
+		if ((uchar *)&data[data_off] - (uchar *)&rpc_pkt > hdr_len)
+			return -NFS_RPC_DROP;
+		rlen = ntohl(data[1 + nfsv3_data_offset]);
+		eof = data[2 + nfsv3_data_offset] || !rlen;
+	}
+	data_off = (uchar *)&data[data_off] - (uchar *)&rpc_pkt;
+
+	if (rlen > slot->len || data_off + rlen > len)
+		return -9999;
+
+	if (rlen && store_block(pkt + data_off, slot->offset, rlen))
+		return -9999;
+
+	nfs_read_bytes += rlen;
+	if (eof) {
+		slot->xid = 0;
+		nfs_read_end = min(nfs_read_end, slot->offset + rlen);
+	} else if (rlen < slot->len) {
+		/* The server sent less than asked for, so ask for the rest */
+		slot->offset += rlen;
+		slot->len -= rlen;
+		nfs_read_send(slot);
+	} else {
+		slot->xid = 0;
 	}
-
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
-
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
 
 	return rlen;
 }
@@ -746,7 +966,8 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	debug("%s\n", __func__);
 
-	if (len > sizeof(struct rpc_t))
+	/* Only READ replies may be larger, if IP fragments are reassembled */
+	if (len > sizeof(struct rpc_t) && nfs_state != STATE_READ_REQ)
 		return;
 
 	if (dest != nfs_our_port)
@@ -812,13 +1033,26 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
 		} else {
-			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_size = nfs_read_size_max();
+			if (supported_nfs_versions & NFSV2_FLAG) {
+				nfs_read_start();
+			} else {
+				nfs_state = STATE_FSINFO_REQ;
+				nfs_send();
+			}
 		}
 		break;
 
+	case STATE_FSINFO_REQ:
+		reply = nfs_fsinfo_reply(pkt, len);
+		if (reply == -NFS_RPC_DROP)
+			break;
+		/* Without FSINFO, stick to the smallest size */
+		if (reply)
+			nfs_read_size = NFS_READ_SIZE;
+		nfs_read_start();
+		break;
+
 	case STATE_READLINK_REQ:
 		reply = nfs_readlink_reply(pkt, len);
 		if (reply == -NFS_RPC_DROP) {
@@ -842,18 +1076,26 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
+		if (rlen >= 0) {
+			nfs_show_progress();
+			if (nfs_read_done()) {
+				nfs_download_state = NETLOOP_SUCCESS;
+				nfs_state = STATE_UMOUNT_REQ;
+				nfs_send();
+				break;
+			}
+			/*
+			 * Replies keep the timeout from expiring, so check
+			 * here for requests which have been lost
+			 */
+			nfs_read_retransmit(nfs_timeout);
+			nfs_read_fill();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
@@ -36,10 +36,18 @@ static void set_icmp_header(uchar *pkt, struct in_addr dest)
 
 static int ping_send(void)
 {
+	uchar ethaddr[ARP_HLEN];
 	uchar *pkt;
 	int eth_hdr_size;
 
-	/* XXX always send arp request */
+	/* Send straight away if the ARP cache has the address */
+	if (!arp_cache_lookup(net_ping_ip, ethaddr)) {
+		eth_hdr_size = net_set_ether(net_tx_packet, ethaddr, PROT_IP);
+		pkt = (uchar *)net_tx_packet + eth_hdr_size;
+		set_icmp_header(pkt, net_ping_ip);
+		net_send_packet(net_tx_packet, eth_hdr_size + IP_ICMP_HDR_SIZE);
+		return 0;	/* transmitted */
+	}
 
 	debug_cond(DEBUG_DEV_PKT, "sending ARP for %pI4\n", &net_ping_ip);
 
@@ -0,0 +1,623 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client for bulk downloads
+ *
+ * This supports a single connection opened by U-Boot, which receives a large
+ * amount of data and sends very little. Received data is handed on as soon as
+ * it arrives, with its offset in the stream, so that it can be put straight
+ * in place. Nothing needs to be buffered here and the receive window can be
+ * large. The sender is kept streaming by:
+ *
+ * - advertising a large receive window (scaled if above 64KB)
+ * - delaying ACKs so that only every other full segment is acknowledged
+ * - keeping segments which arrive after a lost one, and sending a duplicate
+ *   ACK straight away for each, so that after three of them the sender does a
+ *   fast retransmit of the missing segment instead of waiting for its
+ *   retransmit timer (there is no SACK). Once the gap is filled the ACK moves
+ *   past everything kept, so one loss costs one retransmitted segment.
+ *
+ * Our own data (e.g. an HTTP request) is small: only one segment may be
+ * outstanding and it is sent again on timeout or after three duplicate ACKs.
+ */
+
+#include <common.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+#include "net_rand.h"
+
+/* Timer tick used for delayed ACKs and retransmission, in ms */
+#define TCP_TICK_MS		10
+/* Longest time an ACK may be delayed, in ms */
+#define TCP_DELACK_MS		20
+/* Number of full segments after which an ACK is sent straight away */
+#define TCP_DELACK_SEGS		2
+/*
+ * Number of segments to ACK straight away at the start and after a loss,
+ * while the sender's congestion window is small and it waits for each ACK
+ */
+#define TCP_QUICKACK_SEGS	16
+/* Initial retransmit timeout, in ms; doubles on each retry up to the max */
+#define TCP_RTO_MS		500
+#define TCP_RTO_MAX_MS		8000
+#ifndef CONFIG_NET_RETRY_COUNT
+# define TCP_RETRIES		8
+#else
+# define TCP_RETRIES		(CONFIG_NET_RETRY_COUNT * 2)
+#endif
+/* Number of duplicate ACKs from the peer which trigger a fast retransmit */
+#define TCP_DUPACK_THRESH	3
+/* Number of separate ranges of data which can be kept after a gap */
+#define TCP_OOO_MAX		8
+
+/* Window scale needed to advertise CONFIG_TCP_RX_WINDOW */
+#if CONFIG_TCP_RX_WINDOW > 0x1fffffff
+# define TCP_WSCALE		14
+#elif CONFIG_TCP_RX_WINDOW > 0xffffff
+# define TCP_WSCALE		10
+#elif CONFIG_TCP_RX_WINDOW > 0xfffff
+# define TCP_WSCALE		6
+#elif CONFIG_TCP_RX_WINDOW > 0xffff
+# define TCP_WSCALE		4
+#else
+# define TCP_WSCALE		0
+#endif
+
+/* Pseudo header used for the TCP checksum */
+struct tcp_pseudo_hdr {
+	struct in_addr	src;
+	struct in_addr	dst;
+	u8		zero;
+	u8		proto;
+	u16		len;
+} __attribute__((packed));
+
+/* Range of sequence numbers, from @start up to but excluding @end */
+struct tcp_range {
+	u32 start;
+	u32 end;
+};
+
+/**
+ * struct tcp_conn - state of the connection
+ *
+ * @state: Connection state
+ * @remote_ip: Server IP address
+ * @remote_port: Server port
+ * @local_port: Our port
+ * @wscale: Window scale agreed with the peer (0 if none)
+ * @iss: Our initial sequence number
+ * @snd_una: Oldest sequence number not acknowledged by the peer
+ * @snd_nxt: Next sequence number we will send
+ * @irs: Peer's initial sequence number
+ * @rcv_nxt: Next sequence number expected from the peer
+ * @unacked: Number of segments received since we last sent an ACK
+ * @quickack: Number of segments still to be ACKed without delay
+ * @rcv_high: Sequence number after the highest one seen from the peer;
+ *	above @rcv_nxt while recovering a loss
+ * @ooo_count: Number of entries in @ooo
+ * @ooo: Ranges of sequence numbers received after a gap, in order
+ * @ack_due: Time by which a delayed ACK must be sent
+ * @rto: Current retransmit timeout in ms
+ * @rto_start: Time at which the retransmit timer was started
+ * @retries: Number of times the timer expired without progress
+ * @dup_acks: Number of duplicate ACKs received for @snd_una
+ * @tx_flags: Control flags of the outstanding segment (SYN or FIN)
+ * @tx_len: Number of data bytes in the outstanding segment
+ * @tx_data: Data of the outstanding segment, kept for retransmission
+ * @rx_handler: Handler for received data
+ * @event_handler: Handler for connection events
+ * @stats: Counters
+ */
+struct tcp_conn {
+	enum tcp_state state;
+	struct in_addr remote_ip;
+	u16 remote_port;
+	u16 local_port;
+	u8 wscale;
+	u32 iss;
+	u32 snd_una;
+	u32 snd_nxt;
+	u32 irs;
+	u32 rcv_nxt;
+	int unacked;
+	int quickack;
+	u32 rcv_high;
+	int ooo_count;
+	struct tcp_range ooo[TCP_OOO_MAX];
+	ulong ack_due;
+	ulong rto;
+	ulong rto_start;
+	int retries;
+	int dup_acks;
+	u8 tx_flags;
+	int tx_len;
+	uchar tx_data[TCP_TX_MAX];
+	tcp_rx_f *rx_handler;
+	tcp_event_f *event_handler;
+	struct tcp_stats stats;
+};
+
+static struct tcp_conn tcp;
+
+static inline bool tcp_seq_before(u32 a, u32 b)
+{
+	return (s32)(a - b) < 0;
+}
+
+static inline bool tcp_seq_after(u32 a, u32 b)
+{
+	return (s32)(b - a) < 0;
+}
+
+static unsigned int tcp_checksum(struct ip_tcp_hdr *ip, int tcp_len)
+{
+	struct tcp_pseudo_hdr ph;
+	unsigned int sum;
+
+	net_copy_ip(&ph.src, &ip->ip_src);
+	net_copy_ip(&ph.dst, &ip->ip_dst);
+	ph.zero = 0;
+	ph.proto = IPPROTO_TCP;
+	ph.len = htons(tcp_len);
+	sum = compute_ip_checksum(&ph, sizeof(ph));
+
+	return add_ip_checksums(sizeof(ph), sum,
+				compute_ip_checksum(&ip->tcp_src, tcp_len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int hdr_len = TCP_HDR_SIZE;
+	ulong win;
+
+	if (action & TCP_SYN) {
+		/* A SYN carries our options and no data */
+		*opt++ = TCP_O_MSS;
+		*opt++ = 4;
+		put_unaligned_be16(TCP_MSS, opt);
+		opt += 2;
+		if (TCP_WSCALE) {
+			*opt++ = TCP_O_NOP;
+			*opt++ = TCP_O_WS;
+			*opt++ = 3;
+			*opt++ = TCP_WSCALE;
+		}
+		hdr_len = opt - pkt - IP_HDR_SIZE;
+		payload_len = 0;
+		/* The window in a SYN is never scaled */
+		win = min(CONFIG_TCP_RX_WINDOW, 0xffff);
+	} else {
+		win = min(CONFIG_TCP_RX_WINDOW >> tcp.wscale, 0xffff);
+	}
+
+	/* Zero the byte after odd-sized data so the checksum works */
+	if (payload_len & 1)
+		pkt[IP_HDR_SIZE + hdr_len + payload_len] = 0;
+
+	net_set_ip_header(pkt, dest, net_ip, IP_HDR_SIZE + hdr_len + payload_len,
+			  IPPROTO_TCP);
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = (action & TCP_ACK) ? htonl(tcp_ack_num) : 0;
+	ip->tcp_hlen = (hdr_len / 4) << 4;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(win);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = tcp_checksum(ip, hdr_len + payload_len);
+
+	return IP_HDR_SIZE + hdr_len;
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const void *data, int len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+
+	if (len)
+		memcpy(pkt, data, len);
+	if (flags & TCP_ACK) {
+		tcp.unacked = 0;
+		tcp.stats.acks++;
+	}
+	net_send_ip_packet(net_server_ethaddr, tcp.remote_ip, tcp.remote_port,
+			   tcp.local_port, len, IPPROTO_TCP, flags, seq,
+			   tcp.rcv_nxt);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp.snd_nxt, NULL, 0);
+}
+
+/* Send the outstanding segment again */
+static void tcp_retransmit(void)
+{
+	u8 flags = tcp.tx_flags;
+
+	if (tcp.state != TCP_SYN_SENT)
+		flags |= TCP_ACK;
+	if (tcp.tx_len)
+		flags |= TCP_PUSH;
+	tcp.stats.retransmits++;
+	tcp_send_segment(flags, tcp.snd_una, tcp.tx_data, tcp.tx_len);
+}
+
+static void tcp_event(enum tcp_event event)
+{
+	if (tcp.event_handler)
+		tcp.event_handler(event);
+}
+
+static void tcp_abort(enum tcp_event event)
+{
+	tcp.state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+	tcp_event(event);
+}
+
+static void tcp_restart_timer(void)
+{
+	tcp.rto_start = get_timer(0);
+	tcp.retries = 0;
+	tcp.rto = TCP_RTO_MS;
+}
+
+static void tcp_tick(void)
+{
+	if (tcp.state == TCP_CLOSED)
+		return;
+	net_set_timeout_handler(TCP_TICK_MS, tcp_tick);
+
+	if (tcp.unacked && (long)(get_timer(0) - tcp.ack_due) >= 0)
+		tcp_send_ack();
+
+	if (get_timer(tcp.rto_start) < tcp.rto || arp_is_waiting())
+		return;
+	if (++tcp.retries > TCP_RETRIES) {
+		printf("TCP: no response from %pI4:%d\n", &tcp.remote_ip,
+		       tcp.remote_port);
+		tcp_abort(TCP_EV_TIMEOUT);
+		return;
+	}
+	tcp.rto_start = get_timer(0);
+	tcp.rto = min(tcp.rto * 2, (ulong)TCP_RTO_MAX_MS);
+
+	/*
+	 * Send our outstanding segment again. If there is none we are waiting
+	 * for data, so repeat our last ACK in case it was lost.
+	 */
+	if (tcp.snd_una != tcp.snd_nxt) {
+		tcp_retransmit();
+	} else {
+		tcp.quickack = TCP_QUICKACK_SEGS;
+		tcp.stats.dup_acks++;
+		tcp_send_ack();
+	}
+}
+
+void tcp_connect(struct in_addr dest, int dport, tcp_rx_f *rx_handler,
+		 tcp_event_f *event_handler)
+{
+	memset(&tcp, '\0', sizeof(tcp));
+	tcp.remote_ip = dest;
+	tcp.remote_port = dport;
+	tcp.local_port = 49152 + (get_timer(0) % 16384);
+	tcp.rx_handler = rx_handler;
+	tcp.event_handler = event_handler;
+	tcp.iss = seed_mac() ^ (u32)get_ticks();
+	tcp.snd_una = tcp.iss;
+	tcp.snd_nxt = tcp.iss + 1;
+	tcp.tx_flags = TCP_SYN;
+	tcp.state = TCP_SYN_SENT;
+
+	tcp_restart_timer();
+	net_set_timeout_handler(TCP_TICK_MS, tcp_tick);
+	tcp_send_segment(TCP_SYN, tcp.iss, NULL, 0);
+}
+
+int tcp_send(const void *data, int len)
+{
+	if (tcp.state != TCP_ESTABLISHED)
+		return -ENOTCONN;
+	if (tcp.snd_una != tcp.snd_nxt)
+		return -EBUSY;
+	if (len > TCP_TX_MAX)
+		return -E2BIG;
+
+	memcpy(tcp.tx_data, data, len);
+	tcp.tx_len = len;
+	tcp.tx_flags = 0;
+	tcp.snd_nxt += len;
+	tcp.dup_acks = 0;
+	tcp_restart_timer();
+	tcp_send_segment(TCP_ACK | TCP_PUSH, tcp.snd_una, data, len);
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	tcp.event_handler = NULL;
+	tcp.rx_handler = NULL;
+	if (tcp.state == TCP_ESTABLISHED) {
+		tcp_send_segment(TCP_FIN | TCP_ACK, tcp.snd_nxt, NULL, 0);
+		tcp.snd_nxt++;
+		tcp.state = TCP_FIN_WAIT;
+	} else if (tcp.state != TCP_FIN_WAIT) {
+		tcp.state = TCP_CLOSED;
+	}
+	net_set_timeout_handler(0, NULL);
+}
+
+enum tcp_state tcp_get_state(void)
+{
+	return tcp.state;
+}
+
+const struct tcp_stats *tcp_get_stats(void)
+{
+	return &tcp.stats;
+}
+
+/* Pick up the options we care about from the peer's SYN */
+static void tcp_parse_syn_options(struct ip_tcp_hdr *ip, int hdr_len)
+{
+	uchar *opt = (uchar *)&ip->tcp_src + TCP_HDR_SIZE;
+	uchar *end = (uchar *)&ip->tcp_src + hdr_len;
+	bool wscale = false;
+
+	while (opt < end && *opt != TCP_O_END) {
+		if (*opt == TCP_O_NOP) {
+			opt++;
+			continue;
+		}
+		if (opt + 1 >= end || opt[1] < 2 || opt + opt[1] > end)
+			break;
+		if (*opt == TCP_O_WS && opt[1] == 3)
+			wscale = true;
+		opt += opt[1];
+	}
+
+	/* We may only scale our window if the peer agreed to scaling */
+	tcp.wscale = wscale ? TCP_WSCALE : 0;
+}
+
+/* Handle the acknowledgement field of a segment from the peer */
+static void tcp_handle_ack(u32 ack, int len)
+{
+	if (tcp_seq_after(ack, tcp.snd_una) &&
+	    !tcp_seq_after(ack, tcp.snd_nxt)) {
+		tcp.snd_una = ack;
+		tcp.dup_acks = 0;
+		if (ack == tcp.snd_nxt) {
+			tcp.tx_len = 0;
+			tcp.tx_flags = 0;
+		}
+		tcp_restart_timer();
+	} else if (ack == tcp.snd_una && tcp.snd_una != tcp.snd_nxt && !len) {
+		if (++tcp.dup_acks == TCP_DUPACK_THRESH)
+			tcp_retransmit();
+	}
+}
+
+/*
+ * Keep a segment which arrived after a gap. The data is handed on straight
+ * away, so only its range needs recording.
+ */
+static void tcp_handle_ooo(u32 seq, uchar *data, int len)
+{
+	u32 end = seq + len;
+	int i;
+
+	tcp.stats.rx_ooo++;
+	if (tcp_seq_after(end, tcp.rcv_high))
+		tcp.rcv_high = end;
+	if (!len || end - tcp.rcv_nxt > CONFIG_TCP_RX_WINDOW ||
+	    tcp.ooo_count == TCP_OOO_MAX)
+		return;
+
+	/* Find where it goes; anything overlapping is treated as a repeat */
+	for (i = 0; i < tcp.ooo_count; i++) {
+		if (!tcp_seq_after(end, tcp.ooo[i].start))
+			break;
+		if (tcp_seq_before(seq, tcp.ooo[i].end))
+			return;
+	}
+	if (!tcp.rx_handler ||
+	    tcp.rx_handler(data, seq - tcp.irs - 1, len,
+			   tcp.rcv_nxt - tcp.irs - 1))
+		return;
+
+	/* Extend a neighbour if possible, else insert a new range */
+	if (i && tcp.ooo[i - 1].end == seq) {
+		tcp.ooo[i - 1].end = end;
+		if (i < tcp.ooo_count && tcp.ooo[i].start == end) {
+			tcp.ooo[i - 1].end = tcp.ooo[i].end;
+			memmove(&tcp.ooo[i], &tcp.ooo[i + 1],
+				(--tcp.ooo_count - i) * sizeof(tcp.ooo[0]));
+		}
+	} else if (i < tcp.ooo_count && tcp.ooo[i].start == end) {
+		tcp.ooo[i].start = seq;
+	} else {
+		memmove(&tcp.ooo[i + 1], &tcp.ooo[i],
+			(tcp.ooo_count++ - i) * sizeof(tcp.ooo[0]));
+		tcp.ooo[i].start = seq;
+		tcp.ooo[i].end = end;
+	}
+	tcp.stats.rx_bytes += len;
+}
+
+/* Handle data and FIN in a segment on an established connection */
+static void tcp_handle_data(u32 seq, uchar *data, int len, u8 flags)
+{
+	bool fin = flags & TCP_FIN;
+	bool recovering;
+	u32 skip, offset;
+
+	if (!len && !fin)
+		return;
+
+	if (tcp_seq_after(seq, tcp.rcv_nxt)) {
+		/*
+		 * Something is missing. Keep this and tell the sender straight
+		 * away what we are still waiting for; duplicate ACKs make it
+		 * resend the missing segment.
+		 */
+		tcp_handle_ooo(seq, data, len);
+		tcp.stats.dup_acks++;
+		tcp.quickack = TCP_QUICKACK_SEGS;
+		tcp_send_ack();
+		return;
+	}
+
+	/* Trim anything we already have */
+	skip = tcp.rcv_nxt - seq;
+	if (skip >= len && !(fin && skip == len)) {
+		tcp.stats.rx_dup++;
+		tcp_send_ack();
+		return;
+	}
+	data += skip;
+	len -= skip;
+	recovering = tcp_seq_before(tcp.rcv_nxt, tcp.rcv_high);
+	if (tcp.ooo_count && len >= tcp.ooo[0].start - tcp.rcv_nxt) {
+		len = tcp.ooo[0].start - tcp.rcv_nxt;
+		fin = false;
+	}
+
+	if (len) {
+		/*
+		 * Move past the gap just filled and any data received after it.
+		 * The handler may close the connection, so update state first.
+		 */
+		offset = tcp.rcv_nxt - tcp.irs - 1;
+		tcp.rcv_nxt += len;
+		if (tcp.ooo_count && tcp.ooo[0].start == tcp.rcv_nxt) {
+			tcp.rcv_nxt = tcp.ooo[0].end;
+			memmove(&tcp.ooo[0], &tcp.ooo[1],
+				--tcp.ooo_count * sizeof(tcp.ooo[0]));
+		}
+		tcp.stats.rx_segs++;
+		tcp.stats.rx_bytes += len;
+		if (tcp.quickack)
+			tcp.quickack--;
+		if (!tcp.unacked++)
+			tcp.ack_due = get_timer(0) + TCP_DELACK_MS;
+		tcp_restart_timer();
+		if (tcp.rx_handler)
+			tcp.rx_handler(data, offset, len,
+				       tcp.rcv_nxt - tcp.irs - 1);
+		if (tcp.state == TCP_CLOSED ||
+		    (tcp.state == TCP_FIN_WAIT && !fin))
+			return;
+	}
+
+	if (fin) {
+		tcp.rcv_nxt++;
+		if (tcp.state == TCP_FIN_WAIT) {
+			tcp_send_ack();
+			tcp_abort(TCP_EV_CLOSED);
+			return;
+		}
+		/* We have nothing more to send, so close our side too */
+		tcp_send_segment(TCP_FIN | TCP_ACK, tcp.snd_nxt, NULL, 0);
+		tcp.snd_nxt++;
+		tcp.state = TCP_LAST_ACK;
+		net_set_timeout_handler(0, NULL);
+		tcp_event(TCP_EV_CLOSED);
+		return;
+	}
+
+	/*
+	 * While filling gaps, ACK at once so the sender moves on to the next
+	 * one. Otherwise ACK every other segment or at the end of a burst.
+	 */
+	if (recovering || tcp.quickack || tcp.unacked >= TCP_DELACK_SEGS ||
+	    (flags & TCP_PUSH && len < TCP_MSS))
+		tcp_send_ack();
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	struct in_addr src;
+	u8 flags;
+	int hdr_len;
+	u32 seq, ack;
+
+	if (len < IP_TCP_HDR_SIZE)
+		return;
+	hdr_len = (ip->tcp_hlen >> 4) * 4;
+	if (hdr_len < TCP_HDR_SIZE || hdr_len > len - IP_HDR_SIZE)
+		return;
+	if (tcp_checksum(ip, len - IP_HDR_SIZE) & 0xfffe) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	src = net_read_ip(&ip->ip_src);
+	if (tcp.state == TCP_CLOSED || src.s_addr != tcp.remote_ip.s_addr ||
+	    ntohs(ip->tcp_src) != tcp.remote_port ||
+	    ntohs(ip->tcp_dst) != tcp.local_port)
+		return;
+
+	flags = ip->tcp_flags;
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	len -= IP_HDR_SIZE + hdr_len;
+	debug("TCP: flags %02x seq %u ack %u len %d\n", flags, seq, ack, len);
+
+	if (flags & TCP_RST) {
+		/* Only accept a reset which matches what we sent */
+		if (tcp.state == TCP_SYN_SENT ? (flags & TCP_ACK) &&
+		    ack == tcp.snd_nxt : seq == tcp.rcv_nxt) {
+			debug("TCP: connection reset\n");
+			tcp_abort(TCP_EV_RESET);
+		}
+		return;
+	}
+
+	switch (tcp.state) {
+	case TCP_SYN_SENT:
+		if ((flags & (TCP_SYN | TCP_ACK)) != (TCP_SYN | TCP_ACK) ||
+		    ack != tcp.snd_nxt)
+			return;
+		tcp_parse_syn_options(ip, hdr_len);
+		tcp.irs = seq;
+		tcp.rcv_nxt = seq + 1;
+		tcp.rcv_high = tcp.rcv_nxt;
+		tcp.quickack = TCP_QUICKACK_SEGS;
+		tcp.snd_una = ack;
+		tcp.tx_flags = 0;
+		tcp.state = TCP_ESTABLISHED;
+		tcp_restart_timer();
+		tcp_send_ack();
+		tcp_event(TCP_EV_CONNECTED);
+		break;
+	case TCP_ESTABLISHED:
+	case TCP_FIN_WAIT:
+		if (flags & TCP_SYN) {
+			/* Our ACK of the SYN was lost */
+			tcp_send_ack();
+			return;
+		}
+		if (flags & TCP_ACK)
+			tcp_handle_ack(ack, len);
+		tcp_handle_data(seq, (uchar *)&ip->tcp_src + hdr_len, len,
+				flags);
+		break;
+	case TCP_LAST_ACK:
+		/* Repeat our FIN in case the peer did not see it */
+		if (flags & TCP_FIN)
+			tcp_send_segment(TCP_FIN | TCP_ACK, tcp.snd_nxt - 1,
+					 NULL, 0);
+		break;
+	default:
+		break;
+	}
+}
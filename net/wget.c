@@ -0,0 +1,425 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP/1.1 download over TCP
+ *
+ * This sends a single GET request and streams the body of the response to
+ * memory, or through a staging buffer to a block device. TCP lets the server
+ * keep a whole window of data in flight, so this is much faster than TFTP on
+ * links with any latency.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <env.h>
+#include <image.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <linux/math64.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Well known HTTP port # */
+#define SERVER_PORT		80
+/* Longest response header we accept */
+#define WGET_HDR_MAX		2048
+/* Bytes per '#' printed while loading */
+#define WGET_HASH_BYTES		(128 << 10)
+/* Number of "loading" hashes per line */
+#define HASHES_PER_LINE		65
+
+enum wget_state {
+	WGET_CONNECTING,
+	WGET_HEADERS,
+	WGET_BODY,
+	WGET_DONE,
+};
+
+static enum wget_state wget_state;
+static struct in_addr wget_server_ip;
+static int wget_server_port;
+static char wget_path[1024];
+static char wget_hdr[WGET_HDR_MAX + 1];	/* Response header, NUL-terminated */
+static int wget_hdr_len;
+static bool wget_has_len;		/* Content-Length was given */
+static ulong wget_content_len;
+static ulong wget_load_addr;
+static ulong wget_load_size;
+static ulong wget_time_start;
+static ulong wget_next_hash;
+static int wget_num_hash;
+static u32 wget_body_off;		/* Stream offset of the body */
+
+/* Block device to stream to, if any */
+static struct blk_desc *wget_blk;
+static lbaint_t wget_blk_start;
+static lbaint_t wget_blk_next;		/* Next block to write */
+static ulong wget_blk_base;		/* Body offset of the staging buffer */
+
+void wget_set_blk_dev(struct blk_desc *desc, lbaint_t start)
+{
+	wget_blk = desc;
+	wget_blk_start = start;
+}
+
+static void wget_fail(const char *msg)
+{
+	tcp_close();
+	wget_state = WGET_DONE;
+	printf("\nwget: %s\n", msg);
+	net_set_state(NETLOOP_FAIL);
+}
+
+/**
+ * wget_blk_flush() - Write the staging buffer to the block device
+ *
+ * The last block is padded with zeroes if needed
+ *
+ * @len: Number of bytes in the buffer
+ * @return 0 if OK, -EIO on a write error
+ */
+static int wget_blk_flush(ulong len)
+{
+	ulong blksz = wget_blk->blksz;
+	lbaint_t blkcnt;
+	uchar *buf;
+
+	buf = map_sysmem(wget_load_addr, WGET_BLK_BUF_SIZE);
+	if (len % blksz)
+		memset(buf + len, '\0', blksz - len % blksz);
+	blkcnt = DIV_ROUND_UP(len, blksz);
+	if (blkcnt && blk_dwrite(wget_blk, wget_blk_next, blkcnt, buf) !=
+	    blkcnt) {
+		unmap_sysmem(buf);
+		return -EIO;
+	}
+	unmap_sysmem(buf);
+	wget_blk_next += blkcnt;
+	wget_blk_base += len;
+
+	return 0;
+}
+
+/**
+ * wget_store() - Store part of the body
+ *
+ * Data which follows a gap is stored in place, but only within the current
+ * staging buffer when writing to a block device. The buffer is written out
+ * when in-order data fills it; if filling a gap completes the buffer, the
+ * caller must write it out with wget_blk_sync().
+ *
+ * @src: Data to store
+ * @pos: Offset of the data within the body
+ * @len: Number of bytes to store
+ * @in_order: true if there is no gap before this data
+ * @return 0 if OK, -ENOSPC if out-of-order data does not fit (it will be
+ *	sent again), -EIO on error (the download is stopped)
+ */
+static int wget_store(const uchar *src, ulong pos, ulong len, bool in_order)
+{
+	ulong n;
+	void *ptr;
+
+	if (!wget_blk) {
+		if (pos + len > wget_load_size) {
+			if (in_order)
+				wget_fail("trying to overwrite reserved memory...");
+			return in_order ? -EIO : -ENOSPC;
+		}
+		ptr = map_sysmem(wget_load_addr + pos, len);
+		memcpy(ptr, src, len);
+		unmap_sysmem(ptr);
+		return 0;
+	}
+
+	if (!in_order && pos + len > wget_blk_base + WGET_BLK_BUF_SIZE)
+		return -ENOSPC;
+	while (len) {
+		n = min(len, wget_blk_base + WGET_BLK_BUF_SIZE - pos);
+		ptr = map_sysmem(wget_load_addr + pos - wget_blk_base, n);
+		memcpy(ptr, src, n);
+		unmap_sysmem(ptr);
+		src += n;
+		pos += n;
+		len -= n;
+		if (pos == wget_blk_base + WGET_BLK_BUF_SIZE && in_order &&
+		    wget_blk_flush(WGET_BLK_BUF_SIZE)) {
+			wget_fail("block device write error");
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * wget_blk_sync() - Write out the staging buffer once it is complete
+ *
+ * @size: Number of bytes of the body received without a gap
+ * @return 0 if OK, -EIO on error (the download is stopped)
+ */
+static int wget_blk_sync(ulong size)
+{
+	if (!wget_blk || size != wget_blk_base + WGET_BLK_BUF_SIZE)
+		return 0;
+	if (wget_blk_flush(WGET_BLK_BUF_SIZE)) {
+		wget_fail("block device write error");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void wget_complete(void)
+{
+	const struct tcp_stats *stats = tcp_get_stats();
+	ulong time;
+
+	tcp_close();
+	wget_state = WGET_DONE;
+	if (wget_has_len && net_boot_file_size != wget_content_len) {
+		printf("\nwget: connection closed after %u of %lu bytes\n",
+		       net_boot_file_size, wget_content_len);
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (wget_blk) {
+		if (wget_blk_flush(net_boot_file_size - wget_blk_base)) {
+			wget_fail("block device write error");
+			return;
+		}
+		printf("\n\t " LBAF " blocks written at " LBAF,
+		       wget_blk_next - wget_blk_start, wget_blk_start);
+	}
+
+	time = get_timer(wget_time_start);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(div_u64((u64)net_boot_file_size * 1000, time),
+			   "/s");
+	}
+	puts("\ndone\n");
+	debug("TCP: %u segments, %u out of order, %u dup ACKs, %u retransmits\n",
+	      stats->rx_segs, stats->rx_ooo, stats->dup_acks,
+	      stats->retransmits);
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+/* Check the status line and pick out the headers we need */
+static int wget_parse_header(void)
+{
+	char *line, *next;
+	ulong status;
+
+	if (strncmp(wget_hdr, "HTTP/1.", 7) || !strchr(wget_hdr, ' '))
+		return -EPROTO;
+	status = simple_strtoul(strchr(wget_hdr, ' ') + 1, NULL, 10);
+	next = strstr(wget_hdr, "\r\n");
+	*next = '\0';
+	if (status != 200) {
+		printf("wget: server returned '%s'\n", wget_hdr);
+		return -ENOENT;
+	}
+
+	for (line = next + 2; *line; line = next + 2) {
+		next = strstr(line, "\r\n");
+		if (!next)
+			break;
+		*next = '\0';
+		if (!strncasecmp(line, "Content-Length:", 15)) {
+			wget_content_len = simple_strtoul(line + 15, NULL, 10);
+			wget_has_len = true;
+		} else if (!strncasecmp(line, "Transfer-Encoding:", 18) &&
+			   strstr(line + 18, "chunked")) {
+			puts("wget: chunked transfer encoding not supported\n");
+			return -EPROTONOSUPPORT;
+		}
+	}
+
+	if (wget_has_len) {
+		printf("Size is 0x%lx Bytes = ", wget_content_len);
+		print_size(wget_content_len, "\n");
+		if (!wget_blk && wget_content_len > wget_load_size) {
+			puts("wget: file does not fit in free memory\n");
+			return -ENOSPC;
+		}
+	}
+
+	return 0;
+}
+
+static int wget_rx_handler(const uchar *data, u32 offset, unsigned int len,
+			   u32 in_order)
+{
+	bool ooo = offset > in_order;
+	char *end;
+	int used;
+
+	if (wget_state == WGET_HEADERS) {
+		/* The header must be read in order to know where the body is */
+		if (ooo)
+			return -EAGAIN;
+		used = min((int)len, WGET_HDR_MAX - wget_hdr_len);
+		memcpy(wget_hdr + wget_hdr_len, data, used);
+		wget_hdr[wget_hdr_len + used] = '\0';
+		end = strstr(wget_hdr, "\r\n\r\n");
+		if (!end) {
+			wget_hdr_len += used;
+			if (wget_hdr_len == WGET_HDR_MAX)
+				wget_fail("response header too long");
+			return 0;
+		}
+		end += 4;
+		used = end - wget_hdr - wget_hdr_len;
+		*end = '\0';
+		if (wget_parse_header()) {
+			wget_fail("bad response");
+			return 0;
+		}
+		wget_state = WGET_BODY;
+		wget_body_off = offset + used;
+		puts("Loading: ");
+		data += used;
+		offset += used;
+		len -= used;
+	}
+
+	if (wget_state != WGET_BODY)
+		return ooo ? -EAGAIN : 0;
+	if (len && wget_store(data, offset - wget_body_off, len, !ooo))
+		return -ENOSPC;
+	if (ooo)
+		return 0;
+
+	net_boot_file_size = in_order - wget_body_off;
+	if (wget_blk_sync(net_boot_file_size))
+		return 0;
+	while (net_boot_file_size >= wget_next_hash) {
+		putc('#');
+		if (++wget_num_hash == HASHES_PER_LINE) {
+			puts("\n\t ");
+			wget_num_hash = 0;
+		}
+		wget_next_hash += WGET_HASH_BYTES;
+	}
+
+	/* Don't wait for the server to close if we have everything */
+	if (wget_has_len && net_boot_file_size == wget_content_len)
+		wget_complete();
+
+	return 0;
+}
+
+static void wget_event_handler(enum tcp_event event)
+{
+	char req[TCP_TX_MAX];
+	int len;
+
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		len = snprintf(req, sizeof(req),
+			       "GET %s HTTP/1.1\r\n"
+			       "Host: %pI4\r\n"
+			       "User-Agent: U-Boot\r\n"
+			       "Connection: close\r\n\r\n",
+			       wget_path, &wget_server_ip);
+		if (len >= sizeof(req) || tcp_send(req, len)) {
+			wget_fail("request too long");
+			return;
+		}
+		wget_state = WGET_HEADERS;
+		break;
+	case TCP_EV_CLOSED:
+		if (wget_state == WGET_BODY)
+			wget_complete();
+		else
+			wget_fail("connection closed before the response");
+		break;
+	case TCP_EV_RESET:
+		wget_fail("connection refused or reset");
+		break;
+	case TCP_EV_TIMEOUT:
+		wget_fail("timeout");
+		break;
+	}
+}
+
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#else
+	wget_load_size = ULONG_MAX - image_load_addr;
+#endif
+	wget_load_addr = image_load_addr;
+	if (wget_blk && wget_load_size < WGET_BLK_BUF_SIZE)
+		return -1;
+
+	return 0;
+}
+
+void wget_start(void)
+{
+	char *ep;
+
+	wget_server_ip = net_server_ip;
+	wget_path[0] = '/';
+	if (!net_parse_bootfile(&wget_server_ip, wget_path + 1,
+				sizeof(wget_path) - 1)) {
+		puts("*** ERROR: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	/* Allow both "path" and "/path" */
+	if (wget_path[1] == '/')
+		memmove(wget_path, wget_path + 1, strlen(wget_path));
+
+	wget_server_port = SERVER_PORT;
+	ep = env_get("httpdstp");
+	if (ep)
+		wget_server_port = simple_strtol(ep, NULL, 10);
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4:%d; our IP address is %pI4\n",
+	       &wget_server_ip, wget_server_port, &net_ip);
+	printf("Path '%s'.\n", wget_path);
+
+	if (wget_init_load_addr()) {
+		puts("\nwget error: trying to overwrite reserved memory...\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (wget_blk)
+		printf("Staging buffer: 0x%lx, writing to block " LBAF "\n",
+		       wget_load_addr, wget_blk_start);
+	else
+		printf("Load address: 0x%lx\n", wget_load_addr);
+
+	wget_state = WGET_CONNECTING;
+	wget_hdr_len = 0;
+	wget_has_len = false;
+	wget_content_len = 0;
+	wget_next_hash = WGET_HASH_BYTES;
+	wget_num_hash = 0;
+	wget_blk_next = wget_blk_start;
+	wget_blk_base = 0;
+	net_boot_file_size = 0;
+	wget_time_start = get_timer(0);
+
+	/* zero out server ether in case the server ip has changed */
+	memset(net_server_ethaddr, 0, 6);
+	tcp_connect(wget_server_ip, wget_server_port, wget_rx_handler,
+		    wget_event_handler);
+}
@@ -7,16 +7,25 @@
  */
 
 #include <common.h>
+#include <blk.h>
+#include <command.h>
 #include <dm.h>
 #include <env.h>
 #include <fdtdec.h>
+#include <hexdump.h>
+#include <image.h>
 #include <malloc.h>
+#include <mmc.h>
 #include <net.h>
+#include <time.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
 #include <asm/eth.h>
+#include <net/tcp.h>
+#include <net/wget.h>
 #include <test/ut.h>
+#include "../../net/bootp.h"
 
 #define DM_TEST_ETH_NUM		4
 
@@ -329,6 +338,8 @@ static int sb_with_async_arp_handler(struct udevice *dev, void *packet,
 static int dm_test_eth_async_arp_reply(struct unit_test_state *uts)
 {
 	net_ping_ip = string_to_ip("1.1.2.2");
+	/* Make sure that an ARP request is sent */
+	arp_cache_flush();
 
 	sandbox_eth_set_tx_handler(0, sb_with_async_arp_handler);
 	/* Used by all of the ut_assert macros in the tx_handler */
@@ -414,6 +425,8 @@ static int sb_with_async_ping_handler(struct udevice *dev, void *packet,
 static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 {
 	net_ping_ip = string_to_ip("1.1.2.2");
+	/* Make sure that an ARP request is sent */
+	arp_cache_flush();
 
 	sandbox_eth_set_tx_handler(0, sb_with_async_ping_handler);
 	/* Used by all of the ut_assert macros in the tx_handler */
@@ -429,3 +442,665 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, DM_TESTF_SCAN_FDT);
+
+/* Check that waiting packets are taken from the driver in one batch */
+static int dm_test_eth_rx_batch(struct unit_test_state *uts)
+{
+	struct eth_stats *stats, before;
+	struct udevice *dev;
+	int i;
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(eth_init());
+	dev = eth_get_dev();
+	ut_assertnonnull(dev);
+	stats = eth_get_stats(dev);
+	ut_assertnonnull(stats);
+	before = *stats;
+
+	/* Fill the receive buffer, so that one more ping is dropped */
+	for (i = 0; i < PKTBUFSRX; i++)
+		ut_assertok(sandbox_eth_recv_ping_req(dev));
+	ut_asserteq(-EOVERFLOW, sandbox_eth_recv_ping_req(dev));
+	ut_asserteq(before.rx_ring_full + 1, stats->rx_ring_full);
+	ut_asserteq(before.rx_dropped + 1, stats->rx_dropped);
+
+	/* All the pings are answered after one call to the driver */
+	ut_assertok(eth_rx());
+	ut_asserteq(before.rx_packets + PKTBUFSRX, stats->rx_packets);
+	ut_asserteq(before.rx_batches + 1, stats->rx_batches);
+	ut_asserteq(before.tx_packets + PKTBUFSRX, stats->tx_packets);
+
+	/* The buffers can be used again */
+	ut_assertok(sandbox_eth_recv_ping_req(dev));
+	ut_assertok(eth_rx());
+	ut_asserteq(before.rx_packets + PKTBUFSRX + 1, stats->rx_packets);
+	ut_asserteq(before.rx_batches + 2, stats->rx_batches);
+	ut_asserteq(0, eth_rx());
+	ut_asserteq(before.rx_batches + 2, stats->rx_batches);
+	ut_asserteq(before.rx_errors, stats->rx_errors);
+
+	if (IS_ENABLED(CONFIG_CMD_NET_STATS))
+		ut_assertok(run_command("net stats eth@10002000", 0));
+	eth_halt();
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_rx_batch, DM_TESTF_SCAN_FDT);
+
+#if defined(CONFIG_NET_ARP_CACHE)
+/**
+ * struct sb_arp_count - ARP requests seen by sb_count_arp_handler()
+ *
+ * @requests: Number of ARP requests sent
+ * @ethaddr: MAC address given in the reply
+ */
+struct sb_arp_count {
+	int requests;
+	uchar ethaddr[ARP_HLEN];
+};
+
+static int sb_count_arp_handler(struct udevice *dev, void *packet,
+				unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_arp_count *count = priv->priv;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len)) {
+		count->requests++;
+		memcpy(count->ethaddr, priv->fake_host_hwaddr, ARP_HLEN);
+	}
+	sandbox_eth_ping_req_to_reply(dev, packet, len);
+
+	return 0;
+}
+
+/* Inject a gratuitous ARP from @ip giving a new MAC address */
+static void sb_recv_gratuitous_arp(struct in_addr ip, const uchar *ethaddr)
+{
+	uchar pkt[ETHER_HDR_SIZE + ARP_HDR_SIZE];
+	struct ethernet_hdr *eth = (void *)pkt;
+	struct arp_hdr *arp = (void *)pkt + ETHER_HDR_SIZE;
+
+	memset(pkt, '\0', sizeof(pkt));
+	memcpy(eth->et_dest, net_bcast_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, ethaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_ARP);
+	arp->ar_hrd = htons(ARP_ETHER);
+	arp->ar_pro = htons(PROT_IP);
+	arp->ar_hln = ARP_HLEN;
+	arp->ar_pln = ARP_PLEN;
+	arp->ar_op = htons(ARPOP_REQUEST);
+	memcpy(&arp->ar_sha, ethaddr, ARP_HLEN);
+	net_write_ip(&arp->ar_spa, ip);
+	net_write_ip(&arp->ar_tpa, ip);
+
+	net_process_received_packet(pkt, sizeof(pkt));
+}
+
+/* Check that resolved MAC addresses are kept between commands */
+static int dm_test_eth_arp_cache(struct unit_test_state *uts)
+{
+	const uchar new_ethaddr[ARP_HLEN] = { 0x02, 0x11, 0x22, 0x33, 0x44,
+					      0x55 };
+	struct sb_arp_count count;
+	uchar ethaddr[ARP_HLEN];
+	struct in_addr ip;
+	int i;
+
+	memset(&count, '\0', sizeof(count));
+	arp_cache_flush();
+	net_ping_ip = string_to_ip("1.1.2.2");
+	sandbox_eth_set_tx_handler(0, sb_count_arp_handler);
+	sandbox_eth_set_priv(0, &count);
+	env_set("ethact", "eth@10002000");
+
+	/* The first ping has to use ARP, the second does not */
+	ut_assertok(net_loop(PING));
+	ut_asserteq(1, count.requests);
+	ut_assertok(net_loop(PING));
+	ut_asserteq(1, count.requests);
+	ut_assertok(arp_cache_lookup(net_ping_ip, ethaddr));
+	ut_asserteq_mem(count.ethaddr, ethaddr, ARP_HLEN);
+
+	/* A gratuitous ARP changes the address */
+	sb_recv_gratuitous_arp(net_ping_ip, new_ethaddr);
+	ut_assertok(arp_cache_lookup(net_ping_ip, ethaddr));
+	ut_asserteq_mem(new_ethaddr, ethaddr, ARP_HLEN);
+
+	/* Entries expire, after which ARP is used again */
+	timer_test_add_offset(CONFIG_NET_ARP_CACHE_TIMEOUT * 1000 + 1);
+	ut_asserteq(-ENOENT, arp_cache_lookup(net_ping_ip, ethaddr));
+	ut_assertok(net_loop(PING));
+	ut_asserteq(2, count.requests);
+
+	/* When full, the least recently used entry is replaced */
+	arp_cache_flush();
+	for (i = 0; i < CONFIG_NET_ARP_CACHE_SIZE; i++) {
+		ip.s_addr = htonl(0x0101020a + i);
+		arp_cache_update(ip, new_ethaddr, true);
+		timer_test_add_offset(1);
+	}
+	ip.s_addr = htonl(0x0101020a);
+	ut_assertok(arp_cache_lookup(ip, ethaddr));
+	timer_test_add_offset(1);
+	ip.s_addr = htonl(0x0101020a + CONFIG_NET_ARP_CACHE_SIZE);
+	arp_cache_update(ip, new_ethaddr, true);
+	ut_assertok(arp_cache_lookup(ip, ethaddr));
+	ip.s_addr = htonl(0x0101020a);
+	ut_assertok(arp_cache_lookup(ip, ethaddr));
+	if (CONFIG_NET_ARP_CACHE_SIZE > 1) {
+		ip.s_addr = htonl(0x0101020b);
+		ut_asserteq(-ENOENT, arp_cache_lookup(ip, ethaddr));
+	}
+
+	arp_cache_flush();
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_arp_cache, DM_TESTF_SCAN_FDT);
+#endif
+
+#if defined(CONFIG_DHCP_LEASE_CACHE)
+/**
+ * struct sb_dhcp_server - state of the simulated DHCP server
+ *
+ * @uts: Test state, used by the ut_assert macros in the tx_handler
+ * @server_ip: Address of the server
+ * @lease_ip: Address the server hands out and confirms
+ * @discovers: Number of DHCPDISCOVERs received
+ * @requests: Number of DHCPREQUESTs received
+ * @reboot_requests: Number of DHCPREQUESTs without a server identifier
+ *	(INIT-REBOOT)
+ * @naks: Number of DHCPNAKs sent
+ */
+struct sb_dhcp_server {
+	struct unit_test_state *uts;
+	struct in_addr server_ip;
+	struct in_addr lease_ip;
+	int discovers;
+	int requests;
+	int reboot_requests;
+	int naks;
+};
+
+static u8 *sb_dhcp_put_ip(u8 *opt, int code, const char *ip)
+{
+	struct in_addr addr = string_to_ip(ip);
+
+	*opt++ = code;
+	*opt++ = 4;
+	memcpy(opt, &addr, 4);
+
+	return opt + 4;
+}
+
+static int sb_dhcp_reply(struct udevice *dev, struct bootp_hdr *req, int type,
+			 struct in_addr yiaddr)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_dhcp_server *server = priv->priv;
+	struct ethernet_hdr *eth;
+	struct ip_udp_hdr *ip;
+	struct bootp_hdr *bp;
+	struct in_addr bcast_ip;
+	u8 *opt;
+
+	/* Don't allow the buffer to overrun */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return 0;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memset(eth, '\0', PKTSIZE);
+	memcpy(eth->et_dest, req->bp_chaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	bcast_ip.s_addr = 0xffffffff;
+	net_set_ip_header((uchar *)ip, bcast_ip, server->server_ip,
+			  IP_UDP_HDR_SIZE + BOOTP_HDR_SIZE, IPPROTO_UDP);
+	ip->udp_src = htons(67);
+	ip->udp_dst = htons(68);
+	ip->udp_len = htons(UDP_HDR_SIZE + BOOTP_HDR_SIZE);
+
+	bp = (void *)ip + IP_UDP_HDR_SIZE;
+	bp->bp_op = OP_BOOTREPLY;
+	bp->bp_htype = HWT_ETHER;
+	bp->bp_hlen = HWL_ETHER;
+	net_copy_u32(&bp->bp_id, &req->bp_id);
+	net_write_ip(&bp->bp_yiaddr, yiaddr);
+	memcpy(bp->bp_chaddr, req->bp_chaddr, sizeof(bp->bp_chaddr));
+
+	opt = (u8 *)bp->bp_vend;
+	*opt++ = 99;		/* RFC1048 Magic Cookie */
+	*opt++ = 130;
+	*opt++ = 83;
+	*opt++ = 99;
+	*opt++ = 53;		/* DHCP Message Type */
+	*opt++ = 1;
+	*opt++ = type;
+	*opt++ = 54;		/* Server identifier */
+	*opt++ = 4;
+	memcpy(opt, &server->server_ip, 4);
+	opt += 4;
+	if (type != DHCP_NAK) {
+		*opt++ = 51;	/* Lease time: one hour */
+		*opt++ = 4;
+		*opt++ = 0;
+		*opt++ = 0;
+		*opt++ = 0x0e;
+		*opt++ = 0x10;
+		opt = sb_dhcp_put_ip(opt, 1, "255.255.255.0");
+		opt = sb_dhcp_put_ip(opt, 3, "1.1.2.254");
+	}
+	*opt++ = 255;
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + BOOTP_HDR_SIZE;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+static int sb_dhcp_server_handler(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_dhcp_server *server = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct bootp_hdr *bp = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	struct in_addr requested_ip, server_id;
+	u8 *opt, *end = packet + len;
+	int type = 0;
+	/* Used by all of the ut_assert macros */
+	struct unit_test_state *uts = server->uts;
+
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP ||
+	    ntohs(ip->udp_dst) != 67)
+		return 0;
+
+	ut_asserteq(OP_BOOTREQUEST, bp->bp_op);
+	ut_asserteq(htonl(0x63825363), net_read_u32((u32 *)bp->bp_vend));
+
+	requested_ip.s_addr = 0;
+	server_id.s_addr = 0;
+	opt = (u8 *)bp->bp_vend + 4;
+	while (opt < end && *opt != 255) {
+		if (!*opt) {
+			opt++;
+			continue;
+		}
+		if (*opt == 53)
+			type = opt[2];
+		else if (*opt == 50)
+			memcpy(&requested_ip, opt + 2, 4);
+		else if (*opt == 54)
+			memcpy(&server_id, opt + 2, 4);
+		opt += opt[1] + 2;
+	}
+
+	switch (type) {
+	case DHCP_DISCOVER:
+		server->discovers++;
+		return sb_dhcp_reply(dev, bp, DHCP_OFFER, server->lease_ip);
+	case DHCP_REQUEST:
+		server->requests++;
+		if (!server_id.s_addr) {
+			/* RFC 2131 4.3.2: INIT-REBOOT leaves ciaddr zero */
+			server->reboot_requests++;
+			ut_asserteq(0, net_read_ip(&bp->bp_ciaddr).s_addr);
+		}
+		if (requested_ip.s_addr != server->lease_ip.s_addr) {
+			requested_ip.s_addr = 0;
+			server->naks++;
+			return sb_dhcp_reply(dev, bp, DHCP_NAK, requested_ip);
+		}
+		return sb_dhcp_reply(dev, bp, DHCP_ACK, server->lease_ip);
+	}
+
+	return 0;
+}
+
+static void sb_dhcp_reset(struct sb_dhcp_server *server, const char *lease)
+{
+	server->lease_ip = string_to_ip(lease);
+	server->discovers = 0;
+	server->requests = 0;
+	server->reboot_requests = 0;
+	server->naks = 0;
+}
+
+/* Check that a saved DHCP lease is confirmed without a full discovery */
+static int dm_test_eth_dhcp_lease(struct unit_test_state *uts)
+{
+	struct in_addr old_ip = net_ip;
+	struct in_addr old_netmask = net_netmask;
+	struct in_addr old_gateway = net_gateway;
+	struct sb_dhcp_server server;
+	const char *expect;
+
+	server.uts = uts;
+	server.server_ip = string_to_ip("1.1.2.1");
+	sandbox_eth_set_tx_handler(0, sb_dhcp_server_handler);
+	sandbox_eth_set_priv(0, &server);
+	env_set("ethact", "eth@10002000");
+	env_set("autoload", "no");
+
+	/* No lease yet, so DISCOVER/OFFER/REQUEST/ACK */
+	env_set("dhcplease", NULL);
+	sb_dhcp_reset(&server, "1.1.2.10");
+	ut_assert(net_loop(DHCP) >= 0);
+	ut_asserteq(1, server.discovers);
+	ut_asserteq(1, server.requests);
+	ut_asserteq(0, server.reboot_requests);
+	ut_asserteq(server.lease_ip.s_addr, net_ip.s_addr);
+	ut_asserteq(string_to_ip("1.1.2.254").s_addr, net_gateway.s_addr);
+	expect = "1.1.2.10,1.1.2.1,1.1.2.254,255.255.255.0,";
+	ut_assertnonnull(env_get("dhcplease"));
+	ut_asserteq(0, strncmp(expect, env_get("dhcplease"), strlen(expect)));
+
+	/* The saved lease only needs one INIT-REBOOT request */
+	sb_dhcp_reset(&server, "1.1.2.10");
+	net_ip.s_addr = 0;
+	ut_assert(net_loop(DHCP) >= 0);
+	ut_asserteq(0, server.discovers);
+	ut_asserteq(1, server.requests);
+	ut_asserteq(1, server.reboot_requests);
+	ut_asserteq(0, server.naks);
+	ut_asserteq(server.lease_ip.s_addr, net_ip.s_addr);
+
+	/* The server refuses the old address, so we fall back to discovery */
+	sb_dhcp_reset(&server, "1.1.2.20");
+	ut_assert(net_loop(DHCP) >= 0);
+	ut_asserteq(1, server.discovers);
+	ut_asserteq(2, server.requests);
+	ut_asserteq(1, server.reboot_requests);
+	ut_asserteq(1, server.naks);
+	ut_asserteq(server.lease_ip.s_addr, net_ip.s_addr);
+	expect = "1.1.2.20,";
+	ut_asserteq(0, strncmp(expect, env_get("dhcplease"), strlen(expect)));
+
+	/* An expired lease is not used */
+	env_set("dhcplease", "1.1.2.20,1.1.2.1,1.1.2.254,255.255.255.0,1");
+	sb_dhcp_reset(&server, "1.1.2.20");
+	ut_assert(net_loop(DHCP) >= 0);
+	ut_asserteq(1, server.discovers);
+	ut_asserteq(0, server.reboot_requests);
+
+	env_set("dhcplease", NULL);
+	env_set("autoload", NULL);
+	sandbox_eth_set_tx_handler(0, NULL);
+	net_ip = old_ip;
+	net_netmask = old_netmask;
+	net_gateway = old_gateway;
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_dhcp_lease, DM_TESTF_SCAN_FDT);
+#endif
+
+#if defined(CONFIG_CMD_WGET)
+/* Body bytes in each data segment sent by the simulated HTTP server */
+#define SB_HTTP_SEG		1024
+/* Number of segments the server sends ahead of the last ACK */
+#define SB_HTTP_WINDOW		2
+
+/**
+ * struct sb_http_server - state of the simulated HTTP server
+ *
+ * The response header goes in a segment of its own, followed by the body in
+ * SB_HTTP_SEG-byte segments, so that segments line up with the body offsets.
+ *
+ * @uts: Test state, used by the ut_assert macros in the tx_handler
+ * @server_ip: Address of the server
+ * @client_port: TCP port of the client
+ * @iss: Initial sequence number of the server
+ * @rcv_nxt: Next sequence number expected from the client
+ * @acked: Number of stream bytes acknowledged by the client
+ * @hdr: Response header
+ * @hdr_len: Length of the response header
+ * @size: Size of the body
+ * @segs: Number of segments in the stream, including the header
+ * @next: Number of segments sent so far
+ * @held: Segment sent after the one following it, or 0 for none
+ * @requests: Number of requests received
+ */
+struct sb_http_server {
+	struct unit_test_state *uts;
+	struct in_addr server_ip;
+	u16 client_port;
+	u32 iss;
+	u32 rcv_nxt;
+	u32 acked;
+	char hdr[64];
+	int hdr_len;
+	ulong size;
+	int segs;
+	int next;
+	int held;
+	int requests;
+};
+
+static u8 sb_http_byte(ulong pos)
+{
+	return pos + (pos >> 10) * 7;
+}
+
+static int sb_http_send(struct udevice *dev, u8 flags, u32 seq,
+			const void *data, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_server *server = priv->priv;
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __attribute__((packed)) ph;
+	struct ethernet_hdr *eth;
+	struct ip_tcp_hdr *ip;
+	uchar *payload;
+	uint sum;
+
+	/* Don't allow the buffer to overrun */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return 0;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	payload = (uchar *)ip + IP_TCP_HDR_SIZE;
+	memcpy(payload, data, len);
+	if (len & 1)
+		payload[len] = 0;
+	net_set_ip_header((uchar *)ip, net_ip, server->server_ip,
+			  IP_TCP_HDR_SIZE + len, IPPROTO_TCP);
+	ip->tcp_src = htons(80);
+	ip->tcp_dst = htons(server->client_port);
+	ip->tcp_seq = htonl(seq);
+	ip->tcp_ack = htonl(server->rcv_nxt);
+	ip->tcp_hlen = (TCP_HDR_SIZE / 4) << 4;
+	ip->tcp_flags = flags | TCP_ACK;
+	ip->tcp_win = htons(0xffff);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+
+	net_copy_ip(&ph.src, &ip->ip_src);
+	net_copy_ip(&ph.dst, &ip->ip_dst);
+	ph.zero = 0;
+	ph.proto = IPPROTO_TCP;
+	ph.len = htons(TCP_HDR_SIZE + len);
+	sum = compute_ip_checksum(&ph, sizeof(ph));
+	ip->tcp_xsum = add_ip_checksums(sizeof(ph), sum,
+					compute_ip_checksum(&ip->tcp_src,
+							    TCP_HDR_SIZE + len));
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_TCP_HDR_SIZE + len;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+/* Send the segments allowed by the window, in the server's chosen order */
+static int sb_http_send_more(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_server *server = priv->priv;
+	uchar buf[SB_HTTP_SEG];
+	const void *data;
+	ulong pos;
+	u32 off;
+	int seg, len, i;
+
+	while (server->next < server->segs &&
+	       priv->recv_packets < PKTBUFSRX) {
+		seg = server->next;
+		if (server->held && seg == server->held)
+			seg++;
+		else if (server->held && seg == server->held + 1)
+			seg--;
+
+		if (!seg) {
+			off = 0;
+			len = server->hdr_len;
+			data = server->hdr;
+		} else {
+			pos = (ulong)(seg - 1) * SB_HTTP_SEG;
+			off = server->hdr_len + pos;
+			len = min_t(ulong, server->size - pos, SB_HTTP_SEG);
+			for (i = 0; i < len; i++)
+				buf[i] = sb_http_byte(pos + i);
+			data = buf;
+		}
+		if (off + len - server->acked > SB_HTTP_WINDOW * SB_HTTP_SEG)
+			break;
+		sb_http_send(dev, 0, server->iss + 1 + off, data, len);
+		server->next++;
+	}
+
+	return 0;
+}
+
+static int sb_http_server_handler(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_http_server *server = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *ip = packet + ETHER_HDR_SIZE;
+	const char *expect = "GET /file.bin HTTP/1.1\r\n";
+	char *data;
+	int data_len;
+	/* Used by all of the ut_assert macros */
+	struct unit_test_state *uts = server->uts;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_TCP)
+		return 0;
+	ut_asserteq(80, ntohs(ip->tcp_dst));
+
+	data = (char *)&ip->tcp_src + (ip->tcp_hlen >> 4) * 4;
+	data_len = ntohs(ip->ip_len) - (data - (char *)ip);
+	if (ip->tcp_flags & TCP_SYN) {
+		server->client_port = ntohs(ip->tcp_src);
+		server->rcv_nxt = ntohl(ip->tcp_seq) + 1;
+		return sb_http_send(dev, TCP_SYN, server->iss, NULL, 0);
+	}
+	/* The client only closes once it has the whole body */
+	if (ip->tcp_flags & TCP_FIN)
+		return 0;
+
+	if (data_len) {
+		ut_assert(data_len >= strlen(expect));
+		ut_asserteq(0, strncmp(expect, data, strlen(expect)));
+		server->rcv_nxt += data_len;
+		server->requests++;
+	}
+	server->acked = ntohl(ip->tcp_ack) - server->iss - 1;
+	if (!server->requests)
+		return 0;
+
+	return sb_http_send_more(dev);
+}
+
+/*
+ * Check that a body streamed to a block device is written out intact when a
+ * segment arrives out of order and fills the staging buffer
+ */
+static int dm_test_eth_wget_blk(struct unit_test_state *uts)
+{
+	struct in_addr old_server_ip = net_server_ip;
+	ulong old_load_addr = image_load_addr;
+	struct sb_http_server server;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	lbaint_t blkcnt;
+	u8 *buf;
+	ulong i;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc2", &dev));
+	ut_assertok(mmc_init(mmc_get_mmc_dev(dev)));
+	desc = mmc_get_blk_desc(mmc_get_mmc_dev(dev));
+
+	memset(&server, '\0', sizeof(server));
+	server.uts = uts;
+	server.server_ip = string_to_ip("1.1.2.2");
+	server.iss = 0x12345678;
+	server.size = WGET_BLK_BUF_SIZE + 4 * SB_HTTP_SEG;
+	server.segs = 1 + server.size / SB_HTTP_SEG;
+	server.hdr_len = snprintf(server.hdr, sizeof(server.hdr),
+				  "HTTP/1.1 200 OK\r\n"
+				  "Content-Length: %lu\r\n\r\n", server.size);
+	/*
+	 * Send the segment which ends at the end of the staging buffer ahead
+	 * of the one before it, so that filling the gap completes the buffer
+	 */
+	server.held = WGET_BLK_BUF_SIZE / SB_HTTP_SEG - 1;
+
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	sandbox_eth_set_priv(0, &server);
+	env_set("ethact", "eth@10002000");
+	net_server_ip = server.server_ip;
+	image_load_addr = 0x1000000;
+	copy_filename(net_boot_file_name, "file.bin",
+		      sizeof(net_boot_file_name));
+	wget_set_blk_dev(desc, 0x10);
+	ut_asserteq(server.size, net_loop(WGET));
+	wget_set_blk_dev(NULL, 0);
+	ut_asserteq(1, server.requests);
+	ut_asserteq(server.segs, server.next);
+	ut_asserteq(1, tcp_get_stats()->rx_ooo);
+
+	blkcnt = server.size / desc->blksz;
+	buf = malloc(server.size);
+	ut_assertnonnull(buf);
+	ut_asserteq(blkcnt, blk_dread(desc, 0x10, blkcnt, buf));
+	for (i = 0; i < server.size; i++) {
+		if (buf[i] != sb_http_byte(i))
+			break;
+	}
+	free(buf);
+	ut_asserteq(server.size, i);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	net_server_ip = old_server_ip;
+	image_load_addr = old_load_addr;
+	net_boot_file_name[0] = '\0';
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_wget_blk, DM_TESTF_SCAN_FDT);
+#endif
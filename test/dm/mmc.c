@@ -5,14 +5,14 @@
 
 #include <common.h>
 #include <dm.h>
+#include <fsl_esdhc_imx.h>
+#include <hexdump.h>
 #include <mmc.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
-/*
- * Basic test of the mmc uclass. We could expand this by implementing an MMC
- * stack for sandbox, or at least implementing the basic operation.
- */
+/* Basic test of the mmc uclass */
 static int dm_test_mmc_base(struct unit_test_state *uts)
 {
 	struct udevice *dev;
@@ -27,17 +27,276 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 {
 	struct udevice *dev;
 	struct blk_desc *dev_desc;
-	char cmp[1024];
+	char write[1024], read[1024];
+	int i;
 
 	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
 	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
 
-	/* Read a few blocks and look for the string we expect */
+	/* Write a few blocks and check that they read back the same */
 	ut_asserteq(512, dev_desc->blksz);
-	memset(cmp, '\0', sizeof(cmp));
-	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
-	ut_assertok(strcmp(cmp, "this is a test"));
+	ut_asserteq((1 << 20) / 512, dev_desc->lba);
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i;
+	ut_asserteq(2, blk_dwrite(dev_desc, 0, 2, write));
+	memset(read, '\0', sizeof(read));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+
+	/* Erased blocks read as zeroes */
+	ut_asserteq(2, blk_derase(dev_desc, 0, 2));
+	memset(write, '\0', sizeof(write));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+
+	/* Reading past the end of the card fails */
+	ut_asserteq(0, blk_dread(dev_desc, dev_desc->lba - 1, 2, read));
 
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that a multi-block read is counted and costs less than single reads */
+static int dm_test_mmc_multi_block(struct unit_test_state *uts)
+{
+	struct sandbox_mmc_stats before, single, multi;
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	char buf[16 * 512];
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+
+	/* Use fresh blocks each time so that the block cache cannot help */
+	sandbox_mmc_get_stats(dev, &before);
+	for (i = 0; i < 16; i++)
+		ut_asserteq(1, blk_dread(dev_desc, 100 + i, 1, buf + i * 512));
+	sandbox_mmc_get_stats(dev, &single);
+	ut_asserteq(16, single.single_reads - before.single_reads);
+	ut_asserteq(0, single.multi_reads - before.multi_reads);
+	ut_asserteq(16 * 512, single.bytes_read - before.bytes_read);
+
+	ut_asserteq(16, blk_dread(dev_desc, 200, 16, buf));
+	sandbox_mmc_get_stats(dev, &multi);
+	ut_asserteq(0, multi.single_reads - single.single_reads);
+	ut_asserteq(1, multi.multi_reads - single.multi_reads);
+	ut_asserteq(16 * 512, multi.bytes_read - single.bytes_read);
+
+	/* Each single-block read pays the access latency (100us) again */
+	ut_assert(multi.busy_ns - single.busy_ns <
+		  single.busy_ns - before.busy_ns);
+	ut_assert(single.busy_ns - before.busy_ns >= 16 * 100 * 1000);
+	ut_assert(multi.cmds - single.cmds < single.cmds - before.cmds);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_multi_block, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(MMC_HS200_SUPPORT)
+/* Test that the eMMC is tuned and used in HS200 mode */
+static int dm_test_mmc_hs200(struct unit_test_state *uts)
+{
+	struct sandbox_mmc_stats stats;
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char write[512], read[512];
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc2", &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_asserteq(MMC_HS_200, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+	ut_asserteq(200000000, mmc->clock);
+	ut_asserteq(4 << 20, mmc->capacity);
+
+	/* The window is phases 4 to 11, so tuning stops at 12 */
+	sandbox_mmc_get_stats(dev, &stats);
+	ut_asserteq(13, stats.tuning_cmds);
+	ut_asserteq(7, sandbox_mmc_get_tuning_phase(dev));
+
+	dev_desc = mmc_get_blk_desc(mmc);
+	memset(write, 0xaa, sizeof(write));
+	ut_asserteq(1, blk_dwrite(dev_desc, 10, 1, write));
+	ut_asserteq(1, blk_dread(dev_desc, 10, 1, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_hs200, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_CMDQ)
+static int mmc_test_set_cmdq(struct unit_test_state *uts, struct udevice *dev,
+			     uint depth, uint max_packed)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	sandbox_mmc_set_cmdq(dev, depth, max_packed);
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(depth, mmc->cmdq_depth);
+	ut_asserteq(max_packed, mmc->max_packed_writes);
+
+	return 0;
+}
+
+/* Test queued requests with a command queue, packed writes and neither */
+static int dm_test_mmc_cmdq(struct unit_test_state *uts)
+{
+	struct sandbox_mmc_stats before, after;
+	char w1[8 * 512], w2[4 * 512], r1[8 * 512], r2[4 * 512];
+	struct mmc_req reqs[4];
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	int i;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc2", &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	dev_desc = mmc_get_blk_desc(mmc);
+	ut_asserteq(8, mmc->cmdq_depth);
+	ut_asserteq(8, mmc->max_packed_writes);
+
+	for (i = 0; i < sizeof(w1); i++)
+		w1[i] = i * 3;
+	memset(w2, 0x5a, sizeof(w2));
+
+	/* The read of the blocks being written must wait for the write */
+	memset(reqs, '\0', sizeof(reqs));
+	reqs[0] = (struct mmc_req){ .start = 100, .blkcnt = 8, .buf = w1,
+				    .write = true };
+	reqs[1] = (struct mmc_req){ .start = 200, .blkcnt = 4, .buf = w2,
+				    .write = true };
+	reqs[2] = (struct mmc_req){ .start = 100, .blkcnt = 8, .buf = r1 };
+	reqs[3] = (struct mmc_req){ .start = 200, .blkcnt = 4, .buf = r2 };
+	sandbox_mmc_get_stats(dev, &before);
+	ut_assertok(mmc_queue_rw(mmc, reqs, 4));
+	sandbox_mmc_get_stats(dev, &after);
+	for (i = 0; i < 4; i++)
+		ut_asserteq(reqs[i].blkcnt, reqs[i].done);
+	ut_asserteq_mem(w1, r1, sizeof(w1));
+	ut_asserteq_mem(w2, r2, sizeof(w2));
+	ut_asserteq(4, after.cmdq_tasks - before.cmdq_tasks);
+	ut_asserteq(2, after.cmdq_max_queued);
+	ut_asserteq(0, after.protocol_errors);
+	ut_asserteq(0, after.multi_writes - before.multi_writes);
+	ut_asserteq(0, after.multi_reads - before.multi_reads);
+
+	/* Queueing is switched off again afterwards */
+	ut_asserteq(4, blk_dread(dev_desc, 300, 4, r2));
+	sandbox_mmc_get_stats(dev, &after);
+	ut_asserteq(0, after.protocol_errors);
+
+	/* Without a queue, the two writes go in one packed command */
+	ut_assertok(mmc_test_set_cmdq(uts, dev, 0, 8));
+	memset(r1, '\0', sizeof(r1));
+	reqs[0].start = 400;
+	reqs[1].start = 500;
+	reqs[2].start = 400;
+	sandbox_mmc_get_stats(dev, &before);
+	ut_assertok(mmc_queue_rw(mmc, reqs, 3));
+	sandbox_mmc_get_stats(dev, &after);
+	for (i = 0; i < 3; i++)
+		ut_asserteq(reqs[i].blkcnt, reqs[i].done);
+	ut_asserteq_mem(w1, r1, sizeof(w1));
+	ut_asserteq(1, after.packed_writes - before.packed_writes);
+	ut_asserteq(2, after.packed_entries - before.packed_entries);
+	ut_asserteq(0, after.multi_writes - before.multi_writes);
+	ut_asserteq(0, after.cmdq_tasks - before.cmdq_tasks);
+	ut_asserteq(4, blk_dread(dev_desc, 500, 4, r2));
+	ut_asserteq_mem(w2, r2, sizeof(w2));
+
+	/* A lone write is not worth packing */
+	reqs[0].start = 800;
+	sandbox_mmc_get_stats(dev, &before);
+	ut_assertok(mmc_queue_rw(mmc, reqs, 1));
+	sandbox_mmc_get_stats(dev, &after);
+	ut_asserteq(1, after.multi_writes - before.multi_writes);
+	ut_asserteq(0, after.packed_writes - before.packed_writes);
+
+	/* With neither, each request is a command of its own */
+	ut_assertok(mmc_test_set_cmdq(uts, dev, 0, 0));
+	reqs[0].start = 600;
+	reqs[1].start = 700;
+	sandbox_mmc_get_stats(dev, &before);
+	ut_assertok(mmc_queue_rw(mmc, reqs, 2));
+	sandbox_mmc_get_stats(dev, &after);
+	ut_asserteq(2, after.multi_writes - before.multi_writes);
+	ut_asserteq(0, after.packed_writes - before.packed_writes);
+	ut_asserteq(0, after.protocol_errors);
+
+	/* Requests beyond the end of the device are refused */
+	reqs[0].start = dev_desc->lba - 4;
+	ut_asserteq(-EINVAL, mmc_queue_rw(mmc, reqs, 1));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmdq, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_FSL_ESDHC_IMX_ADMA
+/* Build ADMA2 descriptor tables as the i.MX eSDHC driver does */
+static int dm_test_mmc_esdhc_adma(struct unit_test_state *uts)
+{
+	struct esdhc_adma_desc desc[8];
+	struct esdhc_adma_table tbl;
+	const u8 tran = ESDHC_ADMA_ATTR_VALID | ESDHC_ADMA_ATTR_TRAN;
+
+	/* A single block needs a single descriptor, which ends the table */
+	esdhc_adma_init(&tbl, desc, ARRAY_SIZE(desc));
+	ut_assertok(esdhc_adma_add(&tbl, 0x10000000, 512));
+	ut_assertok(esdhc_adma_finish(&tbl));
+	ut_asserteq(1, tbl.count);
+	ut_asserteq(512, tbl.bytes);
+	ut_asserteq(tran | ESDHC_ADMA_ATTR_END, desc[0].attr);
+	ut_asserteq(0, desc[0].reserved);
+	ut_asserteq(512, le16_to_cpu(desc[0].len));
+	ut_asserteq(0x10000000, le32_to_cpu(desc[0].addr));
+
+	/* A large transfer is split at the descriptor length limit */
+	esdhc_adma_init(&tbl, desc, ARRAY_SIZE(desc));
+	ut_assertok(esdhc_adma_add(&tbl, 0x10000000, 256 * 512));
+	ut_assertok(esdhc_adma_finish(&tbl));
+	ut_asserteq(3, tbl.count);
+	ut_asserteq(256 * 512, tbl.bytes);
+	ut_asserteq(ESDHC_ADMA_MAX_LEN, le16_to_cpu(desc[0].len));
+	ut_asserteq(tran, desc[0].attr);
+	ut_asserteq(0x10000000 + ESDHC_ADMA_MAX_LEN,
+		    le32_to_cpu(desc[1].addr));
+	ut_asserteq(tran, desc[1].attr);
+	ut_asserteq(256 * 512 - 2 * ESDHC_ADMA_MAX_LEN,
+		    le16_to_cpu(desc[2].len));
+	ut_asserteq(tran | ESDHC_ADMA_ATTR_END, desc[2].attr);
+	ut_assert(tbl.count <= esdhc_adma_table_size(256 * 512, 1));
+
+	/* Pieces which follow on are merged; the others are gathered */
+	esdhc_adma_init(&tbl, desc, ARRAY_SIZE(desc));
+	ut_assertok(esdhc_adma_add(&tbl, 0x10000000, 1024));
+	ut_assertok(esdhc_adma_add(&tbl, 0x10000400, 2048));
+	ut_assertok(esdhc_adma_add(&tbl, 0x20000000, 512));
+	ut_assertok(esdhc_adma_finish(&tbl));
+	ut_asserteq(2, tbl.count);
+	ut_asserteq(3584, tbl.bytes);
+	ut_asserteq(3072, le16_to_cpu(desc[0].len));
+	ut_asserteq(tran, desc[0].attr);
+	ut_asserteq(0x20000000, le32_to_cpu(desc[1].addr));
+	ut_asserteq(tran | ESDHC_ADMA_ATTR_END, desc[1].attr);
+
+	/* Misaligned, empty and out-of-range pieces are refused */
+	esdhc_adma_init(&tbl, desc, ARRAY_SIZE(desc));
+	ut_asserteq(-EINVAL, esdhc_adma_add(&tbl, 0x10000002, 512));
+	ut_asserteq(-EINVAL, esdhc_adma_add(&tbl, 0x10000000, 510));
+	ut_asserteq(-EINVAL, esdhc_adma_add(&tbl, 0x10000000, 0));
+	ut_asserteq(-EINVAL, esdhc_adma_add(&tbl, 0xfffffe00, 1024));
+	ut_asserteq(-EINVAL, esdhc_adma_finish(&tbl));
+
+	/* A table which is too small is reported as full */
+	esdhc_adma_init(&tbl, desc, 2);
+	ut_asserteq(-ENOSPC, esdhc_adma_add(&tbl, 0x10000000, 384 * 512));
+	ut_asserteq(2, tbl.count);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_esdhc_adma, 0);
+#endif
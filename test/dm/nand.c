@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the sandbox NAND flash simulator
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/rawnand.h>
+#include <test/ut.h>
+
+static int nand_erase_block(struct mtd_info *mtd, uint block)
+{
+	struct erase_info instr = {
+		.mtd	= mtd,
+		.addr	= (loff_t)block * mtd->erasesize,
+		.len	= mtd->erasesize,
+	};
+
+	return mtd_erase(mtd, &instr);
+}
+
+/* Test the geometry, bad blocks and reading back what was written */
+static int dm_test_nand_sandbox(struct unit_test_state *uts)
+{
+	struct sandbox_nand_stats stats;
+	struct mtd_oob_ops ops = { };
+	struct mtd_info *mtd;
+	struct udevice *dev;
+	u8 *src, *dst;
+	size_t retlen;
+	loff_t offs;
+	int i;
+
+	ut_assertok(uclass_get_device_by_driver(UCLASS_MTD,
+						DM_GET_DRIVER(sandbox_nand),
+						&dev));
+	mtd = sandbox_nand_get_mtd(dev);
+	ut_asserteq(2048, mtd->writesize);
+	ut_asserteq(64, mtd->oobsize);
+	ut_asserteq(128 << 10, mtd->erasesize);
+	ut_asserteq(8 << 20, mtd->size);
+
+	/* The bad block scan found the bad block and was timed */
+	ut_asserteq(0, mtd_block_isbad(mtd, 0));
+	ut_asserteq(1, mtd_block_isbad(mtd, 5 * mtd->erasesize));
+	ut_assert(mtd_to_nand(mtd)->bbt_scan_us > 0);
+	ut_asserteq(-EIO, nand_erase_block(mtd, 5));
+
+	src = malloc(mtd->writesize);
+	dst = malloc(mtd->writesize);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	for (i = 0; i < mtd->writesize; i++)
+		src[i] = i * 7;
+
+	offs = mtd->erasesize + 3 * mtd->writesize;
+	ut_assertok(nand_erase_block(mtd, 1));
+	ut_assertok(mtd_read(mtd, offs, mtd->writesize, &retlen, dst));
+	for (i = 0; i < mtd->writesize; i++)
+		ut_asserteq(0xff, dst[i]);
+
+	ut_assertok(mtd_write(mtd, offs, mtd->writesize, &retlen, src));
+	ut_asserteq(mtd->writesize, retlen);
+	ut_assertok(mtd_read(mtd, offs, mtd->writesize, &retlen, dst));
+	ut_asserteq_mem(src, dst, mtd->writesize);
+
+	sandbox_nand_get_stats(dev, &stats);
+	ut_assert(stats.reads >= 2);
+	ut_assert(stats.programs >= 1);
+	ut_assert(stats.erases >= 2);
+	ut_assert(stats.busy_us >= 2 * 2000 + 200);
+	ut_asserteq(0, stats.bitflips);
+
+	/* One flip per ECC step is corrected */
+	sandbox_nand_set_bitflips(dev, 1, 1);
+	memset(dst, '\0', mtd->writesize);
+	ut_asserteq(-EUCLEAN, mtd_read(mtd, offs, mtd->writesize, &retlen,
+				       dst));
+	ut_asserteq_mem(src, dst, mtd->writesize);
+
+	/* Two flips in the same step are not */
+	sandbox_nand_set_bitflips(dev, 1, mtd->writesize / 256 + 1);
+	ut_asserteq(-EBADMSG, mtd_read(mtd, offs, mtd->writesize, &retlen,
+				       dst));
+	sandbox_nand_set_bitflips(dev, 0, 0);
+
+	sandbox_nand_get_stats(dev, &stats);
+	ut_asserteq(1 + mtd->writesize / 256 + 1, stats.bitflips);
+
+	/* Programming can only clear bits */
+	memset(src, 0xff, mtd->writesize);
+	src[0] = 0;
+	ut_assertok(mtd_write(mtd, offs + mtd->writesize, mtd->writesize,
+			      &retlen, src));
+	src[0] = 0xff;
+	src[1] = 0;
+	ut_assertok(mtd_write(mtd, offs + mtd->writesize, mtd->writesize,
+			      &retlen, src));
+	ops.mode = MTD_OPS_RAW;
+	ops.len = mtd->writesize;
+	ops.datbuf = dst;
+
+	/* The ECC no longer matches, so read the page raw */
+	ut_assertok(mtd_read_oob(mtd, offs + mtd->writesize, &ops));
+	ut_asserteq(0, dst[0]);
+	ut_asserteq(0, dst[1]);
+
+	free(dst);
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_nand_sandbox, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -5,6 +5,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <console.h>
 #include <dm.h>
 #include <fdtdec.h>
 #include <mapmem.h>
@@ -15,7 +16,9 @@
 #include <asm/test.h>
 #include <dm/test.h>
 #include <dm/util.h>
+#include <linux/sizes.h>
 #include <test/ut.h>
+#include <u-boot/crc.h>
 
 /* Simple test of sandbox SPI flash */
 static int dm_test_spi_flash(struct unit_test_state *uts)
@@ -74,6 +77,42 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_spi_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Test that erases use the largest commands the flash supports */
+static int dm_test_spi_flash_erase_plan(struct unit_test_state *uts)
+{
+	struct spi_nor_erase_plan plan;
+	struct spi_flash *flash;
+	struct udevice *dev;
+	int full_size = 0x200000;
+	u8 *buf;
+
+	buf = map_sysmem(0x20000, full_size);
+	memset(buf, '\0', full_size);
+	ut_assertok(os_write_file("spi.bin", buf, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	flash = dev_get_uclass_priv(dev);
+
+	/* The M25P16 only has 64KiB sectors */
+	ut_asserteq(SZ_64K, flash->erase_types[0].size);
+	ut_asserteq(0, flash->erase_types[1].size);
+	ut_asserteq(3, spi_nor_erase_plan(flash, SZ_64K, 3 * SZ_64K, &plan));
+	ut_asserteq(3, plan.count[0]);
+	ut_asserteq(false, plan.chip);
+	ut_asserteq(-EINVAL, spi_nor_erase_plan(flash, SZ_4K, SZ_64K, &plan));
+
+	/* The whole flash is erased with a single command */
+	ut_asserteq(1, spi_nor_erase_plan(flash, 0, full_size, &plan));
+	ut_asserteq(true, plan.chip);
+	ut_assertok(spi_flash_erase_dm(dev, 0, full_size));
+	ut_assertok(spi_flash_read_dm(dev, 0, full_size, buf));
+	ut_assertnull(memchr_inv(buf, 0xff, full_size));
+
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_erase_plan, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* Functional test that sandbox SPI flash works correctly */
 static int dm_test_spi_flash_func(struct unit_test_state *uts)
 {
@@ -101,3 +140,87 @@ static int dm_test_spi_flash_func(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash_func, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Find the summary printed by sf update and check how sectors were handled */
+static int sf_check_update(struct unit_test_state *uts, const char *expect)
+{
+	char line[256];
+
+	while (console_record_readline(line, sizeof(line)) > 0) {
+		if (strstr(line, "sectors written")) {
+			ut_asserteq(0, strncmp(expect, line, strlen(expect)));
+			return 0;
+		}
+	}
+	ut_asserteq_str(expect, "");
+
+	return 0;
+}
+
+/* Check the digest table, which describes two sectors at the start */
+static int sf_check_digests(struct unit_test_state *uts, struct udevice *dev)
+{
+	u32 table[7];
+	void *buf;
+	int i;
+
+	/* Magic, offset, sector size, count and CRC, then the digests */
+	ut_assertok(spi_flash_read_dm(dev, 0x1f0000, sizeof(table), table));
+	ut_asserteq(0x47444653, table[0]);
+	ut_asserteq(0, table[1]);
+	ut_asserteq(SZ_64K, table[2]);
+	ut_asserteq(2, table[3]);
+	ut_asserteq(crc32(0, (uchar *)&table[5], 2 * sizeof(u32)), table[4]);
+	for (i = 0; i < 2; i++) {
+		buf = map_sysmem(0x10000 + i * SZ_64K, SZ_64K);
+		ut_asserteq(crc32(0, buf, SZ_64K), table[5 + i]);
+		unmap_sysmem(buf);
+	}
+
+	return 0;
+}
+
+/* Test that sf update keeps a table of sector digests and skips with it */
+static int dm_test_spi_flash_update(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+
+	ut_asserteq(0, run_command_list(
+		"host save hostfs - 0 spi.bin 200000;"
+		"sf probe;"
+		"mw.b 10000 5a 28000;"
+		"sf update 10000 0 28000 1f0000", -1,  0));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	ut_assertok(sf_check_digests(uts, dev));
+
+	/* The whole sectors are skipped using the table */
+	console_record_reset();
+	ut_assertok(run_command("sf update 10000 0 28000 1f0000", 0));
+	ut_assertok(sf_check_update(uts,
+		"0 sectors written, 3 unchanged (2 from digests)"));
+	ut_assertok(sf_check_digests(uts, dev));
+
+	/* A changed sector is written and its digest updated */
+	console_record_reset();
+	ut_assertok(run_command("mw.b 10005 a5 1", 0));
+	ut_assertok(run_command("sf update 10000 0 28000 1f0000", 0));
+	ut_assertok(sf_check_update(uts,
+		"1 sectors written, 2 unchanged (1 from digests)"));
+	ut_assertok(sf_check_digests(uts, dev));
+
+	console_record_reset();
+	ut_assertok(run_command("sf update 10000 0 28000 1f0000", 0));
+	ut_assertok(sf_check_update(uts,
+		"0 sectors written, 3 unchanged (2 from digests)"));
+	ut_asserteq(0, run_command_list(
+		"sf read 40000 0 28000;"
+		"cmp.b 10000 40000 28000", -1,  0));
+
+	/* The table may not overlap the region being updated */
+	ut_asserteq(1, run_command("sf update 10000 0 28000 20000", 0));
+
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_update, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -6,6 +6,7 @@
 #include <common.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc.h>
 #include <usb.h>
 #include <asm/io.h>
 #include <asm/state.h>
@@ -61,6 +62,108 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Test that large reads are split up and small sequential reads read ahead */
+static int dm_test_usb_flash_xfer(struct unit_test_state *uts)
+{
+	struct sandbox_flash_stats before, stats;
+	struct udevice *dev, *emul;
+	struct blk_desc *dev_desc;
+	const int count = 1000;
+	char *buf;
+#if CONFIG_IS_ENABLED(BLOCK_CACHE) && CONFIG_USB_STORAGE_READAHEAD
+	struct block_cache_stats cache;
+	int ra, i;
+#endif
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(usb_emul_find_for_dev(dev, &emul));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	buf = malloc(count * dev_desc->blksz);
+	ut_assertnonnull(buf);
+
+	/* Each command reads at most CONFIG_USB_STORAGE_MAX_XFER_BLK blocks */
+	sandbox_flash_get_stats(emul, &before);
+	ut_asserteq(count, blk_dread(dev_desc, 100, count, buf));
+	sandbox_flash_get_stats(emul, &stats);
+	ut_asserteq(DIV_ROUND_UP(count, CONFIG_USB_STORAGE_MAX_XFER_BLK),
+		    stats.read10 + stats.read16 - before.read10 - before.read16);
+	ut_asserteq(before.read_blks + count, stats.read_blks);
+	ut_asserteq(min(count, CONFIG_USB_STORAGE_MAX_XFER_BLK),
+		    stats.max_read_blks);
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE) && CONFIG_USB_STORAGE_READAHEAD
+	blkcache_stats(&cache);
+	blkcache_configure(16, 8);
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+
+	/* The second of two sequential reads also reads the blocks after it */
+	sandbox_flash_get_stats(emul, &before);
+	ut_asserteq(1, blk_dread(dev_desc, 0, 1, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+	ut_asserteq(1, blk_dread(dev_desc, 1, 1, buf));
+	sandbox_flash_get_stats(emul, &stats);
+	ut_asserteq(before.read10 + 2, stats.read10);
+	ra = stats.read_blks - before.read_blks - 2;
+	ut_assert(ra > 0);
+	ut_asserteq(0, ra % 16);
+
+	/* ...so these come from the block cache */
+	before = stats;
+	for (i = 2; i < 2 + ra; i++)
+		ut_asserteq(1, blk_dread(dev_desc, i, 1, buf));
+	sandbox_flash_get_stats(emul, &stats);
+	ut_asserteq(before.read10, stats.read10);
+
+	/* A large read is not read ahead, even if it follows on */
+	ut_asserteq(count, blk_dread(dev_desc, 2 + ra, count, buf));
+	sandbox_flash_get_stats(emul, &stats);
+	ut_asserteq(before.read_blks + count, stats.read_blks);
+
+	blkcache_configure(cache.max_blocks_per_entry, cache.max_entries);
+#endif
+	free(buf);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_xfer, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that the controller counts the transfers made through it */
+static int dm_test_usb_bus_stats(struct unit_test_state *uts)
+{
+	struct usb_bus_stats before, *stats;
+	struct usb_bus_priv *priv;
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	char buf[16 * 512];
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	priv = dev_get_uclass_priv(usb_get_bus(dev));
+	stats = &priv->stats;
+
+	/* Enumeration uses control transfers */
+	ut_assert(stats->control > 0);
+	ut_assert(stats->total_us >= stats->max_us);
+
+	/* A read needs a command, the data and the status */
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	before = *stats;
+	ut_asserteq(16, blk_dread(dev_desc, 200, 16, buf));
+	ut_asserteq(before.bulk + 3, stats->bulk);
+	ut_assert(stats->bytes >= before.bytes + sizeof(buf));
+	ut_asserteq(before.errors, stats->errors);
+	ut_asserteq(before.control, stats->control);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_bus_stats, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
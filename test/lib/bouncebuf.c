@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the bounce buffer
+ */
+
+#include <common.h>
+#include <bouncebuf.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define BB_ALIGN	ARCH_DMA_MINALIGN
+
+/* Only the ends of a word-aligned buffer are bounced in split mode */
+static int lib_test_bouncebuf_split(struct unit_test_state *uts)
+{
+	struct bounce_buffer_stats stats;
+	struct bounce_buffer bb;
+	u8 *buf, *data;
+	size_t len = 4 * BB_ALIGN;
+	int i;
+
+	buf = memalign(BB_ALIGN, 6 * BB_ALIGN);
+	ut_assertnonnull(buf);
+	for (i = 0; i < 6 * BB_ALIGN; i++)
+		buf[i] = i;
+	data = buf + 4;
+
+	bounce_buffer_reset_stats();
+
+	/* Data going to the device is copied into the ends */
+	ut_assertok(bounce_buffer_start(&bb, data, len,
+					GEN_BB_READ | GEN_BB_SPLIT));
+	ut_asserteq(3, bb.nsegs);
+	ut_assert(bb.seg[0].addr != data);
+	ut_asserteq(BB_ALIGN - 4, bb.seg[0].len);
+	ut_asserteq_mem(data, bb.seg[0].addr, bb.seg[0].len);
+	ut_asserteq_ptr(buf + BB_ALIGN, bb.seg[1].addr);
+	ut_asserteq(3 * BB_ALIGN, bb.seg[1].len);
+	ut_asserteq(4, bb.seg[2].len);
+	ut_asserteq_mem(buf + 4 * BB_ALIGN, bb.seg[2].addr, 4);
+	ut_assertok(bounce_buffer_stop(&bb));
+
+	/* Data coming from the device is copied back from the ends */
+	ut_assertok(bounce_buffer_start(&bb, data, len,
+					GEN_BB_WRITE | GEN_BB_SPLIT));
+	ut_asserteq(3, bb.nsegs);
+	for (i = 0; i < bb.nsegs; i++)
+		memset(bb.seg[i].addr, 0xa5, bb.seg[i].len);
+	ut_assertok(bounce_buffer_stop(&bb));
+	for (i = 0; i < 6 * BB_ALIGN; i++) {
+		u8 expect = i;
+
+		if (buf + i >= data && buf + i < data + len)
+			expect = 0xa5;
+		ut_asserteq(expect, buf[i]);
+	}
+
+	bounce_buffer_get_stats(&stats);
+	ut_asserteq(2, stats.sessions);
+	ut_asserteq(2, stats.split);
+	ut_asserteq(0, stats.bounced);
+	ut_asserteq(2 * len, stats.bytes);
+	ut_asserteq(2 * BB_ALIGN, stats.bytes_bounced);
+
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_bouncebuf_split, 0);
+
+/* Buffers which cannot be split are bounced or used whole */
+static int lib_test_bouncebuf_whole(struct unit_test_state *uts)
+{
+	struct bounce_buffer_stats stats;
+	struct bounce_buffer bb;
+	u8 *buf;
+	size_t len = 4 * BB_ALIGN;
+
+	buf = memalign(BB_ALIGN, 6 * BB_ALIGN);
+	ut_assertnonnull(buf);
+	memset(buf, 0x5a, 6 * BB_ALIGN);
+
+	bounce_buffer_reset_stats();
+
+	/* Aligned: used directly */
+	ut_assertok(bounce_buffer_start(&bb, buf, len,
+					GEN_BB_READ | GEN_BB_SPLIT));
+	ut_asserteq(1, bb.nsegs);
+	ut_asserteq_ptr(buf, bb.seg[0].addr);
+	ut_asserteq(len, bb.seg[0].len);
+	ut_assertok(bounce_buffer_stop(&bb));
+
+	/* Not word aligned: bounced in full */
+	ut_assertok(bounce_buffer_start(&bb, buf + 1, len,
+					GEN_BB_READ | GEN_BB_SPLIT));
+	ut_asserteq(1, bb.nsegs);
+	ut_assert(bb.bounce_buffer != buf + 1);
+	ut_asserteq_ptr(bb.bounce_buffer, bb.seg[0].addr);
+	ut_asserteq_mem(buf + 1, bb.bounce_buffer, len);
+	ut_assertok(bounce_buffer_stop(&bb));
+
+	/* No split mode: bounced in full */
+	ut_assertok(bounce_buffer_start(&bb, buf + 4, len, GEN_BB_READ));
+	ut_asserteq(1, bb.nsegs);
+	ut_assert(bb.bounce_buffer != buf + 4);
+	ut_assertok(bounce_buffer_stop(&bb));
+
+	bounce_buffer_get_stats(&stats);
+	ut_asserteq(3, stats.sessions);
+	ut_asserteq(0, stats.split);
+	ut_asserteq(2, stats.bounced);
+	ut_asserteq(2 * len, stats.bytes_bounced);
+
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_bouncebuf_whole, 0);
@@ -0,0 +1,106 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Test loading a single configuration of an external-data FIT with 'fitload'
+
+import os
+import pytest
+import u_boot_utils as util
+
+# Two boards, each with its own kernel. Only board 2's kernel should be read.
+its = '''
+/dts-v1/;
+
+/ {
+        description = "Multi-board FIT";
+        #address-cells = <1>;
+
+        images {
+                kernel-1 {
+                        data = /incbin/("%(kernel1)s");
+                        type = "kernel";
+                        arch = "sandbox";
+                        os = "linux";
+                        compression = "none";
+                        load = <0x40000>;
+                        entry = <0x40000>;
+                        hash-1 {
+                                algo = "sha1";
+                        };
+                };
+                kernel-2 {
+                        data = /incbin/("%(kernel2)s");
+                        type = "kernel";
+                        arch = "sandbox";
+                        os = "linux";
+                        compression = "none";
+                        load = <0x80000>;
+                        entry = <0x80000>;
+                        hash-1 {
+                                algo = "sha1";
+                        };
+                };
+        };
+        configurations {
+                default = "conf-1";
+                conf-1 {
+                        kernel = "kernel-1";
+                };
+                conf-2 {
+                        kernel = "kernel-2";
+                };
+        };
+};
+'''
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fitload')
+@pytest.mark.requiredtool('dtc')
+def test_fitload(u_boot_console):
+    """Test that fitload reads only the images of the chosen configuration"""
+    cons = u_boot_console
+
+    def make_fname(leaf):
+        return os.path.join(cons.config.build_dir, leaf)
+
+    def make_kernel(leaf, text):
+        fname = make_fname(leaf)
+        with open(fname, 'w') as fd:
+            for i in range(1000):
+                print('this %s %d is unlikely to boot' % (text, i), file=fd)
+        return fname
+
+    kernel1 = make_kernel('fitload-kernel1.bin', 'kernel1')
+    kernel2 = make_kernel('fitload-kernel2.bin', 'kernel2')
+    its_fname = make_fname('fitload.its')
+    fit = make_fname('fitload.fit')
+    out = make_fname('fitload-out.bin')
+    with open(its_fname, 'w') as fd:
+        print(its % {'kernel1': kernel1, 'kernel2': kernel2}, file=fd)
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    util.run_and_log(cons, [mkimage, '-E', '-f', its_fname, fit])
+
+    fit_size = os.stat(fit).st_size
+    kernel_size = os.stat(kernel2).st_size
+
+    with cons.log.section('fitload'):
+        cons.run_command('mw.b 80000 0 %x' % kernel_size)
+        output = cons.run_command('fitload hostfs - 1000 %s conf-2' % fit)
+        read = int(output.split()[0])
+        assert ('of %d bytes read' % fit_size) in output
+        assert read <= fit_size - os.stat(kernel1).st_size
+
+        # The kernel should be at its load address already
+        cons.run_command('host save hostfs - 80000 %s %x' %
+                         (out, kernel_size))
+        with open(kernel2, 'rb') as fd:
+            expect = fd.read()
+        with open(out, 'rb') as fd:
+            assert fd.read() == expect
+
+        # bootm should find it there and check the hash
+        output = cons.run_command('bootm start 1000#conf-2')
+        assert 'kernel-2' in output
+        assert 'sha1+ OK' in output
+
+        output = cons.run_command('fitload hostfs - 1000 %s conf-3' % fit)
+        assert "Configuration 'conf-3' not found" in output
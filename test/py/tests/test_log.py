@@ -130,3 +130,36 @@ def test_log_format(u_boot_console):
         run_with_format('FLfm', 'file.c:123-func() msg')
         run_with_format('lm', 'NOTICE. msg')
         run_with_format('m', 'msg')
+
+@pytest.mark.buildconfigspec('cmd_log')
+@pytest.mark.buildconfigspec('log_buffer')
+def test_log_dump(u_boot_console):
+    """Test that records in the log buffer are formatted by 'log dump'"""
+    cons = u_boot_console
+    with cons.log.section('dump'):
+        cons.run_command('log format fm')
+        output = cons.run_command('log dump -c')
+        assert output == ''
+        output = cons.run_command('log rec arch notice file.c 123 func msg1')
+        output = cons.run_command('log rec arch info file.c 124 func msg2')
+        output = cons.run_command('log dump')
+        lines = output.replace('\r', '').splitlines()
+        assert len(lines) == 2
+        assert lines[0].endswith('] func() msg1')
+        assert lines[1].endswith('] func() msg2')
+        assert lines[0].startswith('[')
+
+        # Records below the console's level are still stored
+        cons.run_command('log level 6')
+        output = cons.run_command('log rec arch debug file.c 125 func msg3')
+        assert 'msg3' not in output
+        output = cons.run_command('log dump')
+        assert output.replace('\r', '').splitlines()[-1].endswith(
+            '] func() msg3')
+
+        # Records above the buffer's level are not
+        cons.run_command('log dump -c')
+        cons.run_command('log rec arch content file.c 126 func msg4')
+        output = cons.run_command('log dump')
+        assert 'msg4' not in output
+        cons.run_command('log format default')
@@ -0,0 +1,52 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+import pytest
+
+# The sandbox NAND simulator is 8MiB with 128KiB blocks
+MTDIDS = 'nand0=nand0'
+MTDPARTS = 'mtdparts=nand0:1m(boot),-(data)'
+
+def set_env(u_boot_console, mtdids, mtdparts):
+    u_boot_console.run_command('setenv mtdids %s' % mtdids)
+    u_boot_console.run_command('setenv mtdparts %s' % mtdparts)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_mtdparts')
+@pytest.mark.buildconfigspec('cmd_nand')
+def test_mtdparts(u_boot_console):
+    """Test that the partitions follow each change to mtdparts, and can be
+    looked up by name."""
+
+    try:
+        set_env(u_boot_console, MTDIDS, MTDPARTS)
+        response = u_boot_console.run_command('mtdparts')
+        assert 'device nand0 <nand0>, # parts = 2' in response
+        assert ' 1: data' in response
+        assert '0x00700000\t0x00100000' in response
+
+        response = u_boot_console.run_command('chpart data')
+        assert 'partition changed to nand0,1' in response
+
+        # Asking again without touching the variables gives the same table
+        response = u_boot_console.run_command('mtdparts')
+        assert '0x00700000\t0x00100000' in response
+
+        set_env(u_boot_console, MTDIDS, 'mtdparts=nand0:2m(boot),-(rootfs)')
+        response = u_boot_console.run_command('mtdparts')
+        assert ' 1: rootfs' in response
+        assert '0x00600000\t0x00200000' in response
+
+        response = u_boot_console.run_command('chpart data')
+        assert 'partition changed' not in response
+        response = u_boot_console.run_command('chpart rootfs')
+        assert 'partition changed to nand0,1' in response
+
+        # Editing the table sets mtdparts, which must not lose the change
+        u_boot_console.run_command('mtdparts del boot')
+        response = u_boot_console.run_command('mtdparts')
+        assert '# parts = 1' in response
+        assert ' 0: rootfs' in response
+    finally:
+        u_boot_console.run_command('setenv mtdparts')
+        u_boot_console.run_command('setenv mtdids')
+        u_boot_console.run_command('setenv partition')
@@ -55,6 +55,20 @@ env__net_nfs_readable_file = {
     'size': 5058624,
     'crc32': 'c2244b26',
 }
+
+# Details regarding a file that may be read from an HTTP server. This variable
+# may be omitted or set to None if HTTP testing is not possible or desired.
+# On sandbox this can be a server on localhost (e.g. 'python3 -m http.server')
+# reached through the eth-raw device on 'lo'. If 'port' is omitted, port 80 is
+# used. If the same file is also given in env__net_tftp_readable_file, the
+# TFTP and HTTP throughput are logged for comparison.
+env__net_wget_readable_file = {
+    'fn': 'ubtest-readable.bin',
+    'addr': 0x10000000,
+    'port': 8000,
+    'size': 5058624,
+    'crc32': 'c2244b26',
+}
 """
 
 net_set_up = False
@@ -206,3 +220,66 @@ def test_net_nfs(u_boot_console):
 
     output = u_boot_console.run_command('crc32 %x $filesize' % addr)
     assert expected_crc in output
+
+def net_rate(output):
+    """Get the transfer rate printed by tftpboot or wget, e.g. '1.5 MiB/s'"""
+    for line in output.splitlines():
+        line = line.strip()
+        if line.endswith('/s'):
+            return line
+    return None
+
+@pytest.mark.buildconfigspec('cmd_wget')
+def test_net_wget(u_boot_console):
+    """Test the wget command.
+
+    A file is downloaded from the HTTP server, its size and optionally its
+    CRC32 are validated.
+
+    The details of the file to download are provided by the boardenv_* file;
+    see the comment at the beginning of this file.
+    """
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_wget_readable_file', None)
+    if not f:
+        pytest.skip('No HTTP readable file to read')
+
+    addr = f.get('addr', None)
+    if not addr:
+        addr = u_boot_utils.find_ram_base(u_boot_console)
+
+    fn = f['fn']
+    port = f.get('port', None)
+    if port:
+        u_boot_console.run_command('setenv httpdstp %d' % port)
+    try:
+        output = u_boot_console.run_command('wget %x %s' % (addr, fn))
+    finally:
+        if port:
+            u_boot_console.run_command('setenv httpdstp')
+    expected_text = 'Bytes transferred = '
+    sz = f.get('size', None)
+    if sz:
+        expected_text += '%d' % sz
+    assert expected_text in output
+    wget_rate = net_rate(output)
+
+    expected_crc = f.get('crc32', None)
+    if expected_crc and \
+            u_boot_console.config.buildconfig.get('config_cmd_crc32', 'n') == 'y':
+        output = u_boot_console.run_command('crc32 %x $filesize' % addr)
+        assert expected_crc in output
+
+    # Compare with TFTP if the same file is available there
+    t = u_boot_console.config.env.get('env__net_tftp_readable_file', None)
+    if not t or t['fn'] != fn or \
+            u_boot_console.config.buildconfig.get('config_cmd_tftpboot',
+                                                  'n') != 'y':
+        return
+    output = u_boot_console.run_command('tftpboot %x %s' % (addr, fn))
+    assert expected_text in output
+    u_boot_console.log.info('HTTP: %s, TFTP: %s' %
+                            (wget_rate, net_rate(output)))